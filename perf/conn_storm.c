@@ -0,0 +1,114 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pipeline.h"
+#include "../src/tcp.h"
+
+#include "../src/utils/err.c"
+#include "../src/utils/sleep.c"
+#include "../src/utils/stopwatch.c"
+
+#include <stddef.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/*  Measures how fast a TCP endpoint accepts a storm of connections, e.g. when
+    all the clients reconnect at once after a restart. */
+
+int main (int argc, char *argv [])
+{
+    int rc;
+    int s;
+    int i;
+    const char *address;
+    int listeners;
+    int clients;
+    int connections;
+    int total;
+    int *socks;
+    struct nn_stopwatch stopwatch;
+    uint64_t elapsed;
+    unsigned long rate;
+
+    if (argc != 5) {
+        printf ("usage: conn_storm <bind-to> <listeners> <clients> "
+            "<connections-per-client>\n");
+        return 1;
+    }
+
+    address = argv [1];
+    listeners = atoi (argv [2]);
+    clients = atoi (argv [3]);
+    connections = atoi (argv [4]);
+    total = clients * connections;
+
+    s = nn_socket (AF_SP, NN_PULL);
+    assert (s != -1);
+    rc = nn_setsockopt (s, NN_TCP, NN_TCP_LISTENERS, &listeners,
+        sizeof (listeners));
+    assert (rc == 0);
+    rc = nn_bind (s, address);
+    assert (rc >= 0);
+
+    socks = malloc (sizeof (int) * clients);
+    assert (socks);
+
+    nn_stopwatch_init (&stopwatch);
+
+    /*  The connections are opened asynchronously by the worker threads. */
+    for (i = 0; i != clients; i++) {
+        socks [i] = nn_socket (AF_SP, NN_PUSH);
+        assert (socks [i] != -1);
+        rc = nn_setsockopt (socks [i], NN_TCP, NN_TCP_CONNECTIONS,
+            &connections, sizeof (connections));
+        assert (rc == 0);
+        rc = nn_connect (socks [i], address);
+        assert (rc >= 0);
+    }
+
+    while (nn_get_statistic (s, NN_STAT_ACCEPTED_CONNECTIONS) <
+          (uint64_t) total)
+        nn_sleep (1);
+
+    elapsed = nn_stopwatch_term (&stopwatch);
+
+    for (i = 0; i != clients; i++) {
+        rc = nn_close (socks [i]);
+        assert (rc == 0);
+    }
+    free (socks);
+    rc = nn_close (s);
+    assert (rc == 0);
+
+    if (elapsed == 0)
+        elapsed = 1;
+    rate = (unsigned long) ((double) total / (double) elapsed * 1000000);
+
+    printf ("listeners: %d\n", listeners);
+    printf ("connections: %d\n", total);
+    printf ("elapsed: %.3f [ms]\n", (double) elapsed / 1000);
+    printf ("accept rate: %d [conn/s]\n", (int) rate);
+
+    return 0;
+}
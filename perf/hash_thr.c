@@ -0,0 +1,142 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "../src/utils/hash.c"
+#include "../src/utils/alloc.c"
+#include "../src/utils/err.c"
+#include "../src/utils/stopwatch.c"
+
+#include <stddef.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <stdio.h>
+
+/*  Measures nn_hash throughput for tables of different sizes under three
+    mixes of operations: lookups only, mostly lookups with some churn, and
+    churn only. Keys are modelled after XREP pipe keys, i.e. consecutive
+    integers starting at a random offset. The longest single insertion while
+    filling the table is reported as well, as that's where growing the table
+    would show up. */
+
+static uint32_t seed = 1;
+
+static uint32_t next_random (void)
+{
+    /*  Deterministic LCG so that the runs are comparable. */
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) & 0xffffff;
+}
+
+static void run (uint32_t size, int op_count, int lookups, int churn)
+{
+    int i;
+    uint32_t k;
+    uint32_t base;
+    uint32_t r;
+    int found;
+    struct nn_hash hash;
+    struct nn_hash_item *items;
+    struct nn_stopwatch stopwatch;
+    uint64_t elapsed;
+    uint64_t worst;
+    unsigned long throughput;
+
+    /*  Items [0, size) are in the table. Items [size, 2 * size) are spare
+        ones used for churn. */
+    items = malloc (sizeof (struct nn_hash_item) * size * 2);
+    assert (items);
+    base = next_random ();
+    nn_hash_init (&hash);
+    worst = 0;
+    for (k = 0; k != size * 2; ++k) {
+        nn_hash_item_init (&items [k]);
+        if (k >= size)
+            continue;
+        nn_stopwatch_init (&stopwatch);
+        nn_hash_insert (&hash, base + k, &items [k]);
+        elapsed = nn_stopwatch_term (&stopwatch);
+        if (elapsed > worst)
+            worst = elapsed;
+    }
+
+    /*  Each churn operation erases a random item and inserts a spare one
+        in its place, under a new key. */
+    found = 0;
+    nn_stopwatch_init (&stopwatch);
+    for (i = 0; i != op_count; ++i) {
+        r = next_random ();
+        if ((int) (r % 100) < lookups) {
+            found += nn_hash_get (&hash, base + r % (size * 2)) ? 1 : 0;
+            continue;
+        }
+        if ((int) (r % 100) < lookups + churn) {
+            k = r % (size * 2);
+            if (nn_hash_item_isinhash (&items [k]))
+                nn_hash_erase (&hash, &items [k]);
+            else
+                nn_hash_insert (&hash, base + k, &items [k]);
+        }
+    }
+    elapsed = nn_stopwatch_term (&stopwatch);
+
+    for (k = 0; k != size * 2; ++k) {
+        if (nn_hash_item_isinhash (&items [k]))
+            nn_hash_erase (&hash, &items [k]);
+        nn_hash_item_term (&items [k]);
+    }
+    nn_hash_term (&hash);
+    free (items);
+
+    if (elapsed == 0)
+        elapsed = 1;
+    throughput = (unsigned long)
+        ((double) op_count / (double) elapsed * 1000000);
+
+    printf ("items: %lu, lookups: %d%%, churn: %d%%\n",
+        (unsigned long) size, lookups, churn);
+    printf ("found: %d of %d\n", found, op_count);
+    printf ("longest insert: %lu [us]\n", (unsigned long) worst);
+    printf ("mean throughput: %lu [op/s]\n", throughput);
+}
+
+int main (int argc, char *argv [])
+{
+    int op_count;
+    uint32_t sizes [] = {100, 20000, 1000000};
+    int i;
+
+    if (argc != 2) {
+        printf ("usage: hash_thr <op-count>\n");
+        return 1;
+    }
+
+    op_count = atoi (argv [1]);
+
+    for (i = 0; i != 3; ++i) {
+        run (sizes [i], op_count, 100, 0);
+        run (sizes [i], op_count, 90, 10);
+        run (sizes [i], op_count, 0, 100);
+    }
+
+    return 0;
+}
@@ -0,0 +1,152 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "../src/nn.h"
+#include "../src/pipeline.h"
+#include "../src/tcp.h"
+
+#include "../src/utils/attr.h"
+
+#include "../src/utils/err.c"
+#include "../src/utils/sleep.c"
+#include "../src/utils/thread.c"
+#include "../src/utils/stopwatch.c"
+
+#include <stddef.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*  Measures the aggregate throughput of a TCP endpoint striped across
+    several parallel connections (NN_TCP_CONNECTIONS). */
+
+static const char *address;
+static int connections;
+static size_t message_size;
+static int message_count;
+static int sender;
+
+void worker (NN_UNUSED void *arg)
+{
+    int rc;
+    int s;
+    int i;
+    char *buf;
+
+    s = nn_socket (AF_SP, NN_PUSH);
+    assert (s != -1);
+    rc = nn_setsockopt (s, NN_TCP, NN_TCP_CONNECTIONS, &connections,
+        sizeof (connections));
+    assert (rc == 0);
+    rc = nn_connect (s, address);
+    assert (rc >= 0);
+
+    /*  Let all the connections get established, so that the messages are
+        spread across all of them right from the start. */
+    while (nn_get_statistic (s, NN_STAT_CURRENT_CONNECTIONS) <
+          (uint64_t) connections)
+        nn_sleep (10);
+
+    buf = malloc (message_size);
+    assert (buf);
+    memset (buf, 111, message_size);
+
+    for (i = 0; i != message_count; i++) {
+        rc = nn_send (s, buf, message_size, 0);
+        assert (rc == (int)message_size);
+    }
+
+    free (buf);
+
+    /*  The socket is closed by the main thread once all the messages were
+        received. Closing it here could drop the messages still in flight. */
+    sender = s;
+}
+
+int main (int argc, char *argv [])
+{
+    int rc;
+    int s;
+    int i;
+    char *buf;
+    struct nn_thread thread;
+    struct nn_stopwatch stopwatch;
+    uint64_t elapsed;
+    unsigned long throughput;
+    double megabits;
+
+    if (argc != 5) {
+        printf ("usage: stripe_thr <bind-to> <connections> <msg-size> "
+            "<msg-count>\n");
+        return 1;
+    }
+
+    address = argv [1];
+    connections = atoi (argv [2]);
+    message_size = atoi (argv [3]);
+    message_count = atoi (argv [4]);
+
+    s = nn_socket (AF_SP, NN_PULL);
+    assert (s != -1);
+    rc = nn_bind (s, address);
+    assert (rc >= 0);
+
+    buf = malloc (message_size);
+    assert (buf);
+
+    nn_thread_init (&thread, worker, NULL);
+
+    /*  First message is used to start the stopwatch. */
+    rc = nn_recv (s, buf, message_size, 0);
+    assert (rc == (int)message_size);
+
+    nn_stopwatch_init (&stopwatch);
+
+    for (i = 1; i != message_count; i++) {
+        rc = nn_recv (s, buf, message_size, 0);
+        assert (rc == (int)message_size);
+    }
+
+    elapsed = nn_stopwatch_term (&stopwatch);
+
+    nn_thread_term (&thread);
+    rc = nn_close (sender);
+    assert (rc == 0);
+    free (buf);
+    rc = nn_close (s);
+    assert (rc == 0);
+
+    if (elapsed == 0)
+        elapsed = 1;
+    throughput = (unsigned long)
+        ((double) (message_count - 1) / (double) elapsed * 1000000);
+    megabits = (double) (throughput * message_size * 8) / 1000000;
+
+    printf ("connections: %d\n", connections);
+    printf ("message size: %d [B]\n", (int) message_size);
+    printf ("message count: %d\n", message_count);
+    printf ("mean throughput: %d [msg/s]\n", (int) throughput);
+    printf ("mean throughput: %.3f [Mb/s]\n", (double) megabits);
+
+    return 0;
+}
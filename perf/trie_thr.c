@@ -0,0 +1,153 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/protocols/pubsub/trie.c"
+#include "../src/utils/alloc.c"
+#include "../src/utils/err.c"
+#include "../src/utils/stopwatch.c"
+
+#include <stddef.h>
+#include <assert.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdio.h>
+
+/*  Measures nn_trie_match throughput for subscription sets of different
+    sizes. Topics are modelled after market data feeds, i.e. hierarchical
+    "venue.class.SYMBOL.field" strings, and the published topics are skewed
+    so that a small number of symbols accounts for most of the traffic. */
+
+#define TOPIC_MAX 64
+
+static const char *venues [] = {"XNYS", "XNAS", "XLON", "XTKS", "XHKG",
+    "XPAR", "XETR", "XASX"};
+static const char *classes [] = {"eq", "fx", "fi", "cm"};
+static const char *fields [] = {"trade", "quote", "book", "stats"};
+
+static uint32_t seed = 1;
+
+static uint32_t next_random (void)
+{
+    /*  Deterministic LCG so that the runs are comparable. */
+    seed = seed * 1103515245 + 12345;
+    return (seed >> 8) & 0xffffff;
+}
+
+static size_t make_topic (char *buf, uint32_t id)
+{
+    char symbol [6];
+    uint32_t s;
+    int i;
+
+    s = id / 16;
+    for (i = 0; i != 5; ++i) {
+        symbol [i] = (char) ('A' + s % 26);
+        s /= 26;
+    }
+    symbol [5] = 0;
+    return (size_t) sprintf (buf, "%s.%s.%s.%s",
+        venues [id % 8], classes [(id / 8) % 4], symbol, fields [id % 4]);
+}
+
+static void run (int subs, int match_count)
+{
+    int rc;
+    int i;
+    int matched;
+    char *msgs;
+    size_t *sizes;
+    struct nn_trie trie;
+    struct nn_stopwatch stopwatch;
+    uint64_t elapsed;
+    unsigned long throughput;
+    uint32_t r;
+    char topic [TOPIC_MAX];
+    size_t sz;
+
+    /*  Subscribe to the first 'subs' topics. Every third subscription is
+        a coarser one, covering all the fields of the symbol. */
+    nn_trie_init (&trie);
+    for (i = 0; i != subs; ++i) {
+        sz = make_topic (topic, (uint32_t) i);
+        if (i % 3 == 0)
+            sz = strrchr (topic, '.') - topic + 1;
+        rc = nn_trie_subscribe (&trie, (const uint8_t*) topic, sz);
+        assert (rc >= 0);
+    }
+
+    /*  Pre-generate a pool of messages. Roughly 90% of them hit
+        a subscription, popular topics being picked more often. The body
+        is appended to the topic as it would be on the wire. */
+    msgs = malloc (1024 * TOPIC_MAX);
+    assert (msgs);
+    sizes = malloc (1024 * sizeof (size_t));
+    assert (sizes);
+    for (i = 0; i != 1024; ++i) {
+        r = next_random ();
+        if (r % 10 == 0)
+            r = (uint32_t) subs + r % 100000;
+        else
+            r = (uint32_t) (((uint64_t) (r % 4096) * (r % 4096) *
+                (uint32_t) subs) >> 24);
+        sz = make_topic (msgs + i * TOPIC_MAX, r);
+        memcpy (msgs + i * TOPIC_MAX + sz, "|1024.25|300", 12);
+        sizes [i] = sz + 12;
+    }
+
+    matched = 0;
+    nn_stopwatch_init (&stopwatch);
+    for (i = 0; i != match_count; ++i)
+        matched += nn_trie_match (&trie,
+            (const uint8_t*) (msgs + (i & 1023) * TOPIC_MAX), sizes [i & 1023]);
+    elapsed = nn_stopwatch_term (&stopwatch);
+
+    free (sizes);
+    free (msgs);
+    nn_trie_term (&trie);
+
+    if (elapsed == 0)
+        elapsed = 1;
+    throughput = (unsigned long)
+        ((double) match_count / (double) elapsed * 1000000);
+
+    printf ("subscriptions: %d\n", subs);
+    printf ("matched: %d of %d\n", matched, match_count);
+    printf ("mean throughput: %lu [match/s]\n", throughput);
+}
+
+int main (int argc, char *argv [])
+{
+    int match_count;
+
+    if (argc != 2) {
+        printf ("usage: trie_thr <match-count>\n");
+        return 1;
+    }
+
+    match_count = atoi (argv [1]);
+
+    run (10, match_count);
+    run (1000, match_count);
+    run (100000, match_count);
+
+    return 0;
+}
@@ -26,6 +26,9 @@
 #include "../utils/cont.h"
 #include "../utils/fast.h"
 
+/*  Private functions. */
+static void nn_ctx_process (struct nn_ctx *self);
+
 void nn_ctx_init (struct nn_ctx *self, struct nn_pool *pool,
     nn_ctx_onleave onleave)
 {
@@ -53,15 +56,10 @@ void nn_ctx_leave (struct nn_ctx *self)
     struct nn_queue_item *item;
     struct nn_fsm_event *event;
     struct nn_queue eventsto;
+    struct nn_ctx *ctx;
 
     /*  Process any queued events before leaving the context. */
-    while (1) {
-        item = nn_queue_pop (&self->events);
-        event = nn_cont (item, struct nn_fsm_event, item);
-        if (!event)
-            break;
-        nn_fsm_event_process (event);
-    }
+    nn_ctx_process (self);
 
     /*  Notify the owner that we are leaving the context. */
     if (nn_fast (self->onleave != NULL))
@@ -81,15 +79,27 @@ void nn_ctx_leave (struct nn_ctx *self)
     nn_mutex_unlock (&self->sync);
 
     /*  Process any queued external events. Before processing each event
-        lock the context it belongs to. */
-    while (1) {
-        item = nn_queue_pop (&eventsto);
+        lock the context it belongs to. A run of events destined for the same
+        context is processed while the context is locked only once, so that
+        e.g. a burst of notifications to a peer doesn't make the two contexts
+        ping-pong the locks. The events raised inside the context are still
+        processed between the external ones. */
+    item = nn_queue_pop (&eventsto);
+    while (item) {
         event = nn_cont (item, struct nn_fsm_event, item);
-        if (!event)
-            break;
-        nn_ctx_enter (event->fsm->ctx);
-        nn_fsm_event_process (event);
-        nn_ctx_leave (event->fsm->ctx);
+        ctx = event->fsm->ctx;
+        nn_ctx_enter (ctx);
+        while (1) {
+            nn_fsm_event_process (event);
+            item = nn_queue_pop (&eventsto);
+            if (!item)
+                break;
+            event = nn_cont (item, struct nn_fsm_event, item);
+            if (event->fsm->ctx != ctx)
+                break;
+            nn_ctx_process (ctx);
+        }
+        nn_ctx_leave (ctx);
     }
 
     nn_queue_term (&eventsto);
@@ -100,6 +110,11 @@ struct nn_worker *nn_ctx_choose_worker (struct nn_ctx *self)
     return nn_pool_choose_worker (self->pool);
 }
 
+struct nn_worker *nn_ctx_spread_worker (struct nn_ctx *self)
+{
+    return nn_pool_spread_worker (self->pool);
+}
+
 void nn_ctx_raise (struct nn_ctx *self, struct nn_fsm_event *event)
 {
     nn_queue_push (&self->events, &event->item);
@@ -110,3 +125,16 @@ void nn_ctx_raiseto (struct nn_ctx *self, struct nn_fsm_event *event)
     nn_queue_push (&self->eventsto, &event->item);
 }
 
+static void nn_ctx_process (struct nn_ctx *self)
+{
+    struct nn_queue_item *item;
+    struct nn_fsm_event *event;
+
+    while (1) {
+        item = nn_queue_pop (&self->events);
+        event = nn_cont (item, struct nn_fsm_event, item);
+        if (!event)
+            break;
+        nn_fsm_event_process (event);
+    }
+}
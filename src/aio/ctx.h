@@ -50,6 +50,7 @@ void nn_ctx_enter (struct nn_ctx *self);
 void nn_ctx_leave (struct nn_ctx *self);
 
 struct nn_worker *nn_ctx_choose_worker (struct nn_ctx *self);
+struct nn_worker *nn_ctx_spread_worker (struct nn_ctx *self);
 
 void nn_ctx_raise (struct nn_ctx *self, struct nn_fsm_event *event);
 void nn_ctx_raiseto (struct nn_ctx *self, struct nn_fsm_event *event);
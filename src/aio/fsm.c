@@ -172,6 +172,11 @@ struct nn_worker *nn_fsm_choose_worker (struct nn_fsm *self)
     return nn_ctx_choose_worker (self->ctx);
 }
 
+struct nn_worker *nn_fsm_spread_worker (struct nn_fsm *self)
+{
+    return nn_ctx_spread_worker (self->ctx);
+}
+
 void nn_fsm_action (struct nn_fsm *self, int type)
 {
     nn_assert (type > 0);
@@ -92,6 +92,7 @@ void nn_fsm_stopped_noevent (struct nn_fsm *self);
 void nn_fsm_swap_owner (struct nn_fsm *self, struct nn_fsm_owner *owner);
 
 struct nn_worker *nn_fsm_choose_worker (struct nn_fsm *self);
+struct nn_worker *nn_fsm_spread_worker (struct nn_fsm *self);
 
 /*  Using this function state machine can trigger an action on itself. */
 void nn_fsm_action (struct nn_fsm *self, int type);
@@ -25,15 +25,35 @@
 
 #include "worker.h"
 
+#include "../utils/atomic.h"
+
+/*  Maximal number of worker threads in the pool. */
+#define NN_POOL_MAXWORKERS 64
+
 /*  Worker thread pool. */
 
 struct nn_pool {
-    struct nn_worker worker;
+
+    /*  The worker threads. */
+    struct nn_worker *workers;
+    int nworkers;
+
+    /*  Index of the worker to be handed out next by nn_pool_spread_worker. */
+    struct nn_atomic next;
 };
 
-int nn_pool_init (struct nn_pool *self);
+/*  Starts 'nworkers' worker threads. */
+int nn_pool_init (struct nn_pool *self, int nworkers);
 void nn_pool_term (struct nn_pool *self);
+
+/*  Returns the default worker thread. All the objects using it see their
+    worker tasks executed in the order they were posted. */
 struct nn_worker *nn_pool_choose_worker (struct nn_pool *self);
 
+/*  Returns the worker threads in round-robin fashion. Only objects that
+    don't depend on the ordering of their tasks with respect to other
+    objects may be spread across the worker threads this way. */
+struct nn_worker *nn_pool_spread_worker (struct nn_pool *self);
+
 #endif
 
@@ -41,6 +41,10 @@
 /*  Maximum number of iovecs that can be passed to nn_usock_send function. */
 #define NN_USOCK_MAX_IOVCNT 3
 
+/*  Maximum number of file descriptors received from the peer that can wait
+    to be retrieved by nn_usock_recvfd. Any further ones are closed. */
+#define NN_USOCK_MAX_FDS 16
+
 /*  Size of the buffer used for batch-reads of inbound data. To keep the
     performance optimal make sure that this value is larger than network MTU. */
 #define NN_USOCK_BATCH_SIZE 2048
@@ -62,6 +66,10 @@ void nn_usock_stop (struct nn_usock *self);
 
 void nn_usock_swap_owner (struct nn_usock *self, struct nn_fsm_owner *owner);
 
+/*  Moves an idle socket to the next worker thread of the pool. See
+    nn_pool_spread_worker for when this is safe to do. */
+void nn_usock_spread (struct nn_usock *self);
+
 int nn_usock_setsockopt (struct nn_usock *self, int level, int optname,
     const void *optval, size_t optlen);
 
@@ -89,6 +97,21 @@ void nn_usock_send (struct nn_usock *self, const struct nn_iovec *iov,
     int iovcnt);
 void nn_usock_recv (struct nn_usock *self, void *buf, size_t len, int *fd);
 
+#if !defined NN_HAVE_WINDOWS
+
+/*  Same as nn_usock_send, except that the file descriptor 'fd' is passed to
+    the peer along with the data. The caller remains the owner of 'fd' and
+    must keep it open till NN_USOCK_SENT is raised. */
+void nn_usock_send_fd (struct nn_usock *self, const struct nn_iovec *iov,
+    int iovcnt, int fd);
+
+/*  Returns the oldest of the file descriptors received from the peer with
+    the data read so far, or -1 if there's none. The caller becomes the owner
+    of the file descriptor. */
+int nn_usock_recvfd (struct nn_usock *self);
+
+#endif
+
 int nn_usock_geterrno (struct nn_usock *self);
 
 #endif
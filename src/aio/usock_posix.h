@@ -60,6 +60,12 @@ struct nn_usock {
 
         /*  File descriptor received via SCM_RIGHTS, if any. */
         int *pfd;
+
+        /*  File descriptors received via SCM_RIGHTS while nobody asked for
+            them. They are kept in the order of arrival till they are
+            retrieved by nn_usock_recvfd. */
+        int fds [NN_USOCK_MAX_FDS];
+        int nfds;
     } in;
 
     /*  Members related to sending data. */
@@ -70,6 +76,14 @@ struct nn_usock {
 
         /*  List of buffers being sent at the moment. Referenced from 'hdr'. */
         struct iovec iov [NN_USOCK_MAX_IOVCNT];
+
+        /*  Ancillary data carrying the file descriptor being passed to
+            the peer, if any. Referenced from 'hdr'. */
+#if defined NN_HAVE_MSG_CONTROL
+        uint8_t ctrl [CMSG_SPACE (sizeof (int))];
+#else
+        int fd;
+#endif
     } out;
 
     /*  Asynchronous tasks for the worker. */
@@ -92,4 +106,8 @@ struct nn_usock {
 
     /*  Errno remembered in NN_USOCK_ERROR state  */
     int errnum;
+
+    /*  Number of connections the listening socket has accepted in a row
+        without waiting for the poller. */
+    int naccepted;
 };
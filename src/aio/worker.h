@@ -27,6 +27,14 @@
 #include "fsm.h"
 #include "timerset.h"
 
+struct nn_worker_task;
+
+/*  Work attached to a task. It is run in the worker thread before
+    NN_WORKER_TASK_EXECUTE is delivered to the owner, but outside of
+    the owner's context, so a lengthy computation doesn't block the socket.
+    It must not touch anything the owner may access in the meantime. */
+typedef void nn_worker_fn (struct nn_worker_task *task);
+
 #if defined NN_HAVE_WINDOWS
 #include "worker_win.h"
 #else
@@ -47,11 +55,10 @@ int nn_worker_timer_isactive (struct nn_worker_timer *self);
 
 #define NN_WORKER_TASK_EXECUTE 1
 
-struct nn_worker_task;
-
 void nn_worker_task_init (struct nn_worker_task *self, int src,
     struct nn_fsm *owner);
 void nn_worker_task_term (struct nn_worker_task *self);
+void nn_worker_task_setfn (struct nn_worker_task *self, nn_worker_fn *fn);
 
 struct nn_worker;
 
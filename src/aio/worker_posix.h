@@ -45,6 +45,7 @@ void nn_worker_fd_term (struct nn_worker_fd *self);
 struct nn_worker_task {
     int src;
     struct nn_fsm *owner;
+    nn_worker_fn *fn;
     struct nn_queue_item item;
 };
 
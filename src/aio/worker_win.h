@@ -29,6 +29,7 @@
 struct nn_worker_task {
     int src;
     struct nn_fsm *owner;
+    nn_worker_fn *fn;
 };
 
 #define NN_WORKER_OP_DONE 1
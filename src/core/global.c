@@ -130,12 +130,14 @@ const struct nn_socktype *nn_socktypes[] = {
 
 extern struct nn_transport nn_inproc;
 extern struct nn_transport nn_ipc;
+extern struct nn_transport nn_shm;
 extern struct nn_transport nn_tcp;
 extern struct nn_transport nn_ws;
 
 const struct nn_transport *nn_transports[] = {
     &nn_inproc,
     &nn_ipc,
+    &nn_shm,
     &nn_tcp,
     &nn_ws,
     NULL,
@@ -178,6 +180,7 @@ static nn_once_t once = NN_ONCE_INITIALIZER;
 /*  Context creation- and termination-related private functions. */
 static void nn_global_init (void);
 static void nn_global_term (void);
+static int nn_global_ncpus (void);
 
 /*  Private function that unifies nn_bind and nn_connect functionality.
     It returns the ID of the newly created endpoint. */
@@ -188,9 +191,7 @@ static int nn_global_create_ep (struct nn_sock *, const char *addr, int bind);
 static int nn_global_create_socket (int domain, int protocol);
 
 /*  Socket holds. */
-static int nn_global_hold_socket (struct nn_sock **sockp, int s);
 static int nn_global_hold_socket_locked (struct nn_sock **sockp, int s);
-static void nn_global_rele_socket(struct nn_sock *);
 
 int nn_errno (void)
 {
@@ -206,6 +207,7 @@ static void nn_global_init (void)
 {
     int i;
     char *envvar;
+    int nworkers;
 
 #if defined NN_HAVE_WINDOWS
     int rc;
@@ -258,8 +260,35 @@ static void nn_global_init (void)
         }
     }
 
-    /*  Start the worker threads. */
-    nn_pool_init (&self.pool);
+    /*  Start the worker threads, one per CPU unless the NN_WORKERS
+        environment variable says otherwise. */
+    nworkers = nn_global_ncpus ();
+    envvar = getenv ("NN_WORKERS");
+    if (envvar)
+        nworkers = atoi (envvar);
+    if (nworkers < 1)
+        nworkers = 1;
+    if (nworkers > NN_POOL_MAXWORKERS)
+        nworkers = NN_POOL_MAXWORKERS;
+    nn_pool_init (&self.pool, nworkers);
+}
+
+/*  Returns the number of CPUs available, or 1 if it can't be found out. */
+static int nn_global_ncpus (void)
+{
+#if defined NN_HAVE_WINDOWS
+    SYSTEM_INFO info;
+
+    GetSystemInfo (&info);
+    return (int) info.dwNumberOfProcessors;
+#elif defined _SC_NPROCESSORS_ONLN
+    long ncpus;
+
+    ncpus = sysconf (_SC_NPROCESSORS_ONLN);
+    return ncpus < 1 ? 1 : (int) ncpus;
+#else
+    return 1;
+#endif
 }
 
 static void nn_global_term (void)
@@ -1018,6 +1047,12 @@ uint64_t nn_get_statistic (int s, int statistic)
     case NN_STAT_BYTES_RECEIVED:
         val = sock->statistics.bytes_received;
         break;
+    case NN_STAT_DROPPED_MESSAGES:
+        val = sock->statistics.dropped_messages;
+        break;
+    case NN_STAT_BATCHES_SENT:
+        val = sock->statistics.batches_sent;
+        break;
     case NN_STAT_CURRENT_CONNECTIONS:
         val = sock->statistics.current_connections;
         break;
@@ -24,6 +24,8 @@
 #ifndef NN_GLOBAL_INCLUDED
 #define NN_GLOBAL_INCLUDED
 
+struct nn_sock;
+
 /*  Provides access to the list of available transports. */
 const struct nn_transport *nn_global_transport (int id);
 
@@ -31,4 +33,10 @@ const struct nn_transport *nn_global_transport (int id);
 struct nn_pool *nn_global_getpool ();
 int nn_global_print_errors();
 
+/*  Gets a hold on the socket with the specified descriptor so that it's not
+    deallocated while in use.  Every successful hold has to be matched by
+    a call to nn_global_rele_socket. */
+int nn_global_hold_socket (struct nn_sock **sockp, int s);
+void nn_global_rele_socket (struct nn_sock *sock);
+
 #endif
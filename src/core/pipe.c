@@ -164,6 +164,12 @@ int nn_pipebase_ispeer (struct nn_pipebase *self, int socktype)
     return nn_sock_ispeer (self->sock, socktype);
 }
 
+void nn_pipebase_stat_increment (struct nn_pipebase *self, int name,
+    int increment)
+{
+    nn_sock_stat_increment (self->sock, name, increment);
+}
+
 void nn_pipe_setdata (struct nn_pipe *self, void *data)
 {
     ((struct nn_pipebase*) self)->data = data;
@@ -193,6 +199,27 @@ int nn_pipe_send (struct nn_pipe *self, struct nn_msg *msg)
     return rc | NN_PIPEBASE_RELEASE;
 }
 
+int nn_pipe_close (struct nn_pipe *self)
+{
+    struct nn_pipebase *pipebase;
+
+    pipebase = (struct nn_pipebase*) self;
+    if (!pipebase->vfptr->close)
+        return -ENOTSUP;
+    pipebase->vfptr->close (pipebase);
+    return 0;
+}
+
+size_t nn_pipe_backlog (struct nn_pipe *self)
+{
+    struct nn_pipebase *pipebase;
+
+    pipebase = (struct nn_pipebase*) self;
+    if (!pipebase->vfptr->backlog)
+        return 0;
+    return pipebase->vfptr->backlog (pipebase);
+}
+
 int nn_pipe_recv (struct nn_pipe *self, struct nn_msg *msg)
 {
     int rc;
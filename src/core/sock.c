@@ -1072,6 +1072,14 @@ void nn_sock_stat_increment (struct nn_sock *self, int name, int64_t increment)
             nn_assert (increment >= 0);
             self->statistics.bytes_received += increment;
             break;
+        case NN_STAT_DROPPED_MESSAGES:
+            nn_assert (increment > 0);
+            self->statistics.dropped_messages += increment;
+            break;
+        case NN_STAT_BATCHES_SENT:
+            nn_assert (increment > 0);
+            self->statistics.batches_sent += increment;
+            break;
 
         case NN_STAT_CURRENT_CONNECTIONS:
             nn_assert (increment > 0 ||
@@ -37,7 +37,7 @@
 struct nn_pipe;
 
 /*  The maximum implemented transport ID. */
-#define NN_MAX_TRANSPORT 4
+#define NN_MAX_TRANSPORT 5
 
 struct nn_sock
 {
@@ -114,6 +114,10 @@ struct nn_sock
         uint64_t bytes_sent;
         /*  Bytes recevied (sum length of data in messages received)  */
         uint64_t bytes_received;
+        /*  Messages dropped because a peer couldn't keep up  */
+        uint64_t dropped_messages;
+        /*  Frames carrying batched messages sent  */
+        uint64_t batches_sent;
 
         /*****  Level-style values *****/
 
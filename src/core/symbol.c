@@ -27,6 +27,7 @@
 
 #include "../inproc.h"
 #include "../ipc.h"
+#include "../shm.h"
 #include "../tcp.h"
 
 #include "../pair.h"
@@ -80,6 +81,7 @@ static const struct nn_symbol_properties sym_value_names [] = {
 
     NN_SYM(NN_INPROC, TRANSPORT, NONE, NONE),
     NN_SYM(NN_IPC, TRANSPORT, NONE, NONE),
+    NN_SYM(NN_SHM, TRANSPORT, NONE, NONE),
     NN_SYM(NN_TCP, TRANSPORT, NONE, NONE),
     NN_SYM(NN_WS, TRANSPORT, NONE, NONE),
 
@@ -118,14 +120,56 @@ static const struct nn_symbol_properties sym_value_names [] = {
 
     NN_SYM(NN_SUB_SUBSCRIBE, TRANSPORT_OPTION, STR, NONE),
     NN_SYM(NN_SUB_UNSUBSCRIBE, TRANSPORT_OPTION, STR, NONE),
+    NN_SYM(NN_SUB_SUBSCRIBE_BULK, TRANSPORT_OPTION, STR, NONE),
+    NN_SYM(NN_SUB_UNSUBSCRIBE_BULK, TRANSPORT_OPTION, STR, NONE),
+    NN_SYM(NN_SUB_EXACT_TOPIC_LEN, TRANSPORT_OPTION, INT, BYTES),
+    NN_SYM(NN_SUB_BURST, TRANSPORT_OPTION, INT, MESSAGES),
+    NN_SYM(NN_SUB_BURST_BYTES, TRANSPORT_OPTION, INT, BYTES),
+    NN_SYM(NN_SUB_PIPE_STATS, TRANSPORT_OPTION, NONE, NONE),
+    NN_SYM(NN_PUB_QUEUE_LEN, TRANSPORT_OPTION, INT, MESSAGES),
+    NN_SYM(NN_PUB_OVERFLOW, TRANSPORT_OPTION, INT, NONE),
+    NN_SYM(NN_PUB_MAX_DROPS, TRANSPORT_OPTION, INT, MESSAGES),
+    NN_SYM(NN_PUB_CONFLATE, TRANSPORT_OPTION, INT, BYTES),
+    NN_SYM(NN_PUB_LAST_VALUE, TRANSPORT_OPTION, INT, BOOLEAN),
+    NN_SYM(NN_PUB_PIPE_STATS, TRANSPORT_OPTION, NONE, NONE),
     NN_SYM(NN_REQ_RESEND_IVL, TRANSPORT_OPTION, INT, MILLISECONDS),
+    NN_SYM(NN_REQ_LB_POLICY, TRANSPORT_OPTION, INT, NONE),
+    NN_SYM(NN_REQ_PIPE_LOAD, TRANSPORT_OPTION, NONE, NONE),
+    NN_SYM(NN_REQ_EXPLORE, TRANSPORT_OPTION, INT, NONE),
+    NN_SYM(NN_REQ_HEDGE_IVL, TRANSPORT_OPTION, INT, MILLISECONDS),
+    NN_SYM(NN_REQ_HEDGE_PERCENTILE, TRANSPORT_OPTION, INT, NONE),
+    NN_SYM(NN_REP_BURST, TRANSPORT_OPTION, INT, MESSAGES),
+    NN_SYM(NN_REP_BURST_BYTES, TRANSPORT_OPTION, INT, BYTES),
+    NN_SYM(NN_REP_PIPE_STATS, TRANSPORT_OPTION, NONE, NONE),
+    NN_SYM(NN_PUSH_LB_POLICY, TRANSPORT_OPTION, INT, NONE),
+    NN_SYM(NN_PUSH_PIPE_LOAD, TRANSPORT_OPTION, NONE, NONE),
+    NN_SYM(NN_PULL_BURST, TRANSPORT_OPTION, INT, MESSAGES),
+    NN_SYM(NN_PULL_BURST_BYTES, TRANSPORT_OPTION, INT, BYTES),
+    NN_SYM(NN_PULL_PIPE_STATS, TRANSPORT_OPTION, NONE, NONE),
     NN_SYM(NN_SURVEYOR_DEADLINE, TRANSPORT_OPTION, INT, MILLISECONDS),
+    NN_SYM(NN_SURVEYOR_QUORUM, TRANSPORT_OPTION, INT, MESSAGES),
+    NN_SYM(NN_IPC_SHMEM_THRESHOLD, TRANSPORT_OPTION, INT, BYTES),
+    NN_SYM(NN_IPC_BATCH, TRANSPORT_OPTION, INT, BOOLEAN),
+    NN_SYM(NN_IPC_VARINT, TRANSPORT_OPTION, INT, BOOLEAN),
+    NN_SYM(NN_SHM_RINGSZ, TRANSPORT_OPTION, INT, BYTES),
     NN_SYM(NN_TCP_NODELAY, TRANSPORT_OPTION, INT, BOOLEAN),
+    NN_SYM(NN_TCP_LISTENERS, TRANSPORT_OPTION, INT, NONE),
+    NN_SYM(NN_TCP_CONNECTIONS, TRANSPORT_OPTION, INT, NONE),
+    NN_SYM(NN_TCP_COMPRESS, TRANSPORT_OPTION, INT, BYTES),
+    NN_SYM(NN_TCP_BATCH, TRANSPORT_OPTION, INT, BOOLEAN),
+    NN_SYM(NN_TCP_VARINT, TRANSPORT_OPTION, INT, BOOLEAN),
+    NN_SYM(NN_TCP_REUSEPORT, TRANSPORT_OPTION, INT, BOOLEAN),
     NN_SYM(NN_WS_MSG_TYPE, TRANSPORT_OPTION, INT, NONE),
 
     NN_SYM(NN_DONTWAIT, FLAG, NONE, NONE),
     NN_SYM(NN_WS_MSG_TYPE_TEXT, FLAG, NONE, NONE),
     NN_SYM(NN_WS_MSG_TYPE_BINARY, FLAG, NONE, NONE),
+    NN_SYM(NN_PUB_DROP_NEWEST, FLAG, NONE, NONE),
+    NN_SYM(NN_PUB_DROP_OLDEST, FLAG, NONE, NONE),
+    NN_SYM(NN_PUB_DISCONNECT, FLAG, NONE, NONE),
+    NN_SYM(NN_LB_ROUND_ROBIN, FLAG, NONE, NONE),
+    NN_SYM(NN_LB_LEAST_LOADED, FLAG, NONE, NONE),
+    NN_SYM(NN_LB_LOWEST_LATENCY, FLAG, NONE, NONE),
 
     NN_SYM(NN_POLLIN, EVENT, NONE, NONE),
     NN_SYM(NN_POLLOUT, EVENT, NONE, NONE),
@@ -174,6 +218,8 @@ static const struct nn_symbol_properties sym_value_names [] = {
     NN_SYM(NN_STAT_MESSAGES_RECEIVED, STATISTIC, INT, MESSAGES),
     NN_SYM(NN_STAT_BYTES_SENT, STATISTIC, INT, BYTES),
     NN_SYM(NN_STAT_BYTES_RECEIVED, STATISTIC, INT, BYTES),
+    NN_SYM(NN_STAT_DROPPED_MESSAGES, STATISTIC, INT, MESSAGES),
+    NN_SYM(NN_STAT_BATCHES_SENT, STATISTIC, INT, COUNTER),
     NN_SYM(NN_STAT_CURRENT_CONNECTIONS, STATISTIC, INT, NONE),
     NN_SYM(NN_STAT_INPROGRESS_CONNECTIONS, STATISTIC, INT, NONE),
     NN_SYM(NN_STAT_CURRENT_SND_PRIORITY, STATISTIC, INT, PRIORITY),
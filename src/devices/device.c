@@ -22,12 +22,18 @@
 */
 
 #include "../nn.h"
+#include "../tcp.h"
+
+#include "../core/global.h"
+#include "../core/sock.h"
 
 #include "../utils/err.h"
+#include "../utils/alloc.h"
 #include "../utils/fast.h"
 #include "../utils/fd.h"
 #include "../utils/attr.h"
 #include "../utils/thread.h"
+#include "../utils/msg.h"
 #include "device.h"
 
 #include <string.h>
@@ -43,6 +49,99 @@ int nn_device (int s1, int s2)
     return nn_custom_device (&nn_ordinary_device, s1, s2, 0);
 }
 
+struct nn_device_shard_args {
+    int s1;
+    int s2;
+    int rc;
+    int err;
+};
+
+static void nn_device_shard (void *a)
+{
+    struct nn_device_shard_args *args = a;
+
+    args->rc = nn_device (args->s1, args->s2);
+    args->err = args->rc < 0 ? nn_errno () : 0;
+}
+
+int nn_device_shards (const int *s1, const int *s2, int nshards,
+    const char *addr)
+{
+    int i;
+    int rc;
+    int opt;
+    int err;
+    int *eids;
+    struct nn_thread *threads;
+    struct nn_device_shard_args *args;
+
+    if (nn_slow (!s1 || !s2 || nshards < 1)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    /*  Bind all the front-end sockets to the same TCP address. Thanks to
+        SO_REUSEPORT the kernel then spreads the incoming connections among
+        the shards, each connection sticking to the shard that accepted it. */
+    if (addr) {
+        eids = nn_alloc (sizeof (int) * nshards, "device shard endpoints");
+        alloc_assert (eids);
+        opt = 1;
+        for (i = 0; i != nshards; ++i) {
+            rc = nn_setsockopt (s1 [i], NN_TCP, NN_TCP_REUSEPORT, &opt,
+                sizeof (opt));
+            if (nn_fast (rc == 0))
+                rc = nn_bind (s1 [i], addr);
+            if (nn_slow (rc < 0)) {
+                err = nn_errno ();
+                while (i--)
+                    nn_shutdown (s1 [i], eids [i]);
+                nn_free (eids);
+                errno = err;
+                return -1;
+            }
+            eids [i] = rc;
+        }
+        nn_free (eids);
+    }
+
+    threads = nn_alloc (sizeof (struct nn_thread) * nshards,
+        "device shard threads");
+    alloc_assert (threads);
+    args = nn_alloc (sizeof (struct nn_device_shard_args) * nshards,
+        "device shard args");
+    alloc_assert (args);
+
+    /*  Each shard is an independent device with a socket pair of its own,
+        so a pipe is always served by the same thread and the replies travel
+        back through the pair that forwarded the request. The calling thread
+        runs the first shard. */
+    for (i = 0; i != nshards; ++i) {
+        args [i].s1 = s1 [i];
+        args [i].s2 = s2 [i];
+    }
+    for (i = 1; i != nshards; ++i)
+        nn_thread_init (&threads [i], nn_device_shard, &args [i]);
+    nn_device_shard (&args [0]);
+    for (i = 1; i != nshards; ++i)
+        nn_thread_term (&threads [i]);
+
+    /*  Report the error of the first shard that failed. */
+    rc = 0;
+    for (i = 0; i != nshards; ++i) {
+        if (args [i].rc < 0) {
+            rc = args [i].rc;
+            errno = args [i].err;
+            break;
+        }
+    }
+
+    nn_free (args);
+    nn_free (threads);
+
+    return rc;
+}
+
 int nn_device_entry (struct nn_device_recipe *device, int s1, int s2,
     NN_UNUSED int flags)
 {
@@ -209,6 +308,9 @@ int nn_device_loopback (struct nn_device_recipe *device, int s)
         return -1;
     }
 
+    if (nn_device_isbatching (device))
+        return nn_device_batch (s, s, 0);
+
     for (;;) {
         rc = nn_device_mvmsg (device, s, s, 0);
         if (nn_slow (rc < 0))
@@ -243,6 +345,9 @@ int nn_device_twoway (struct nn_device_recipe *device, int s1, int s2)
     struct nn_device_forwarder_args a1;
     struct nn_device_forwarder_args a2;
 
+    if (nn_device_isbatching (device))
+        return nn_device_batch (s1, s2, 1);
+
     a1.device = device;
     a1.s1 = s1;
     a1.s2 = s2;
@@ -269,6 +374,9 @@ int nn_device_oneway (struct nn_device_recipe *device, int s1, int s2)
 {
     int rc;
 
+    if (nn_device_isbatching (device))
+        return nn_device_batch (s1, s2, 0);
+
     while (1) {
         rc = nn_device_mvmsg (device, s1, s2, 0);
         if (nn_slow (rc < 0))
@@ -319,3 +427,141 @@ int nn_device_rewritemsg (NN_UNUSED struct nn_device_recipe *device,
 {
     return 1; /* always forward */
 }
+
+int nn_device_isbatching (struct nn_device_recipe *device)
+{
+    /*  Messages can be moved in batches as long as there's no user-supplied
+        hook that would expect to see each of them as nn_msghdr. */
+    return device->nn_device_mvmsg == nn_device_mvmsg &&
+        device->nn_device_rewritemsg == nn_device_rewritemsg;
+}
+
+/*  One direction of a batching device. */
+struct nn_device_flow {
+    struct nn_sock *from;
+    struct nn_sock *to;
+    int fromidx;
+    int toidx;
+
+    /*  Message that was received but couldn't be sent yet because the
+        destination was full. While it's here, nothing more is read from
+        the source socket, which propagates the backpressure upstream. */
+    struct nn_msg msg;
+    int pending;
+};
+
+/*  Moves up to NN_DEVICE_BATCH messages in the flow without blocking.
+    Returns the number of messages moved or a negative error code. */
+static int nn_device_flow_move (struct nn_device_flow *self)
+{
+    int rc;
+    int moved;
+    size_t sz;
+
+    for (moved = 0; moved != NN_DEVICE_BATCH; ++moved) {
+        if (!self->pending) {
+            rc = nn_sock_recv (self->from, &self->msg, NN_DONTWAIT);
+            if (rc == -EAGAIN)
+                break;
+            if (nn_slow (rc < 0))
+                return rc;
+            self->pending = 1;
+            sz = nn_chunkref_size (&self->msg.body);
+            nn_sock_stat_increment (self->from, NN_STAT_MESSAGES_RECEIVED, 1);
+            nn_sock_stat_increment (self->from, NN_STAT_BYTES_RECEIVED, sz);
+        }
+        sz = nn_chunkref_size (&self->msg.body);
+        rc = nn_sock_send (self->to, &self->msg, NN_DONTWAIT);
+        if (rc == -EAGAIN)
+            break;
+        if (nn_slow (rc < 0))
+            return rc;
+        self->pending = 0;
+        nn_sock_stat_increment (self->to, NN_STAT_MESSAGES_SENT, 1);
+        nn_sock_stat_increment (self->to, NN_STAT_BYTES_SENT, sz);
+    }
+
+    return moved;
+}
+
+int nn_device_batch (int s1, int s2, int twoway)
+{
+    int rc;
+    int i;
+    int nflows;
+    int moved;
+    struct nn_sock *sock1;
+    struct nn_sock *sock2;
+    struct nn_device_flow flows [2];
+    struct nn_pollfd pfd [2];
+
+    /*  The sockets are held for the whole lifetime of the device so that
+        the global lock isn't touched for every message. Closing either of
+        them signals its file descriptors, which wakes the device up and
+        makes the next operation fail with EBADF. */
+    rc = nn_global_hold_socket (&sock1, s1);
+    if (nn_slow (rc < 0)) {
+        errno = -rc;
+        return -1;
+    }
+    rc = nn_global_hold_socket (&sock2, s2);
+    if (nn_slow (rc < 0)) {
+        nn_global_rele_socket (sock1);
+        errno = -rc;
+        return -1;
+    }
+
+    pfd [0].fd = s1;
+    pfd [1].fd = s2;
+    flows [0].from = sock1;
+    flows [0].to = sock2;
+    flows [0].fromidx = 0;
+    flows [0].toidx = s1 == s2 ? 0 : 1;
+    flows [0].pending = 0;
+    flows [1].from = sock2;
+    flows [1].to = sock1;
+    flows [1].fromidx = 1;
+    flows [1].toidx = 0;
+    flows [1].pending = 0;
+    nflows = twoway ? 2 : 1;
+
+    while (1) {
+
+        /*  Drain whatever is available in all the directions. Batches are
+            capped so that a busy direction can't starve the other one. */
+        moved = 0;
+        for (i = 0; i != nflows; ++i) {
+            rc = nn_device_flow_move (&flows [i]);
+            if (nn_slow (rc < 0))
+                goto fail;
+            moved += rc;
+        }
+        if (moved)
+            continue;
+
+        /*  Nothing can be moved at the moment. Wait till the source becomes
+            readable or, if there's a message stuck, till the destination
+            becomes writeable. */
+        pfd [0].events = 0;
+        pfd [1].events = 0;
+        for (i = 0; i != nflows; ++i) {
+            if (flows [i].pending)
+                pfd [flows [i].toidx].events |= NN_POLLOUT;
+            else
+                pfd [flows [i].fromidx].events |= NN_POLLIN;
+        }
+        /*  If polling fails, it's because one of the sockets is being
+            closed or because of a signal. Either way, the next attempt to
+            move the messages will sort it out. */
+        (void) nn_poll (pfd, s1 == s2 ? 1 : 2, -1);
+    }
+
+fail:
+    for (i = 0; i != nflows; ++i)
+        if (flows [i].pending)
+            nn_msg_term (&flows [i].msg);
+    nn_global_rele_socket (sock2);
+    nn_global_rele_socket (sock1);
+    errno = -rc;
+    return -1;
+}
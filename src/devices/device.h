@@ -79,6 +79,19 @@ int nn_device_entry(struct nn_device_recipe *device,
 int nn_device_rewritemsg(struct nn_device_recipe *device,
     int from, int to, int flags, struct nn_msghdr *msghdr, int bytes);
 
+/*  Maximum number of messages moved in one direction before the batching
+    device checks the other direction. */
+#define NN_DEVICE_BATCH 64
+
+/*  Returns 1 if the device uses default message handling and thus can be
+    run by nn_device_batch. */
+int nn_device_isbatching (struct nn_device_recipe *device);
+
+/*  Forwards messages between s1 and s2 (or only from s1 to s2, if twoway
+    is zero) on the calling thread, moving them in batches without blocking
+    and polling only when there's nothing to move. */
+int nn_device_batch (int s1, int s2, int twoway);
+
 
 /*  At least one socket must be passed to the device. */
 #define NN_CHECK_AT_LEAST_ONE_SOCKET (1 << 0)
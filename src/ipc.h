@@ -33,6 +33,9 @@ extern "C" {
 #define NN_IPC_SEC_ATTR 1
 #define NN_IPC_OUTBUFSZ 2
 #define NN_IPC_INBUFSZ 3
+#define NN_IPC_SHMEM_THRESHOLD 4
+#define NN_IPC_BATCH 5
+#define NN_IPC_VARINT 6
 
 #ifdef __cplusplus
 }
@@ -336,6 +336,39 @@ NN_EXPORT  struct nn_cmsghdr *nn_cmsg_nxthdr_ (
 #define NN_RCVMAXSIZE 16
 #define NN_MAXTTL 17
 
+/*  Load balancing policies.                                                  */
+#define NN_LB_ROUND_ROBIN 1
+#define NN_LB_LEAST_LOADED 2
+#define NN_LB_LOWEST_LATENCY 3
+
+/*  Load of a single outbound pipe as reported by NN_PUSH_PIPE_LOAD and
+    NN_REQ_PIPE_LOAD socket options. */
+struct nn_pipe_load {
+    int priority;
+    uint32_t outstanding;
+    uint64_t backlog;
+    uint64_t sent;
+    uint64_t latency;
+};
+
+/*  Share of a single inbound pipe as reported by NN_PULL_PIPE_STATS,
+    NN_SUB_PIPE_STATS and NN_REP_PIPE_STATS socket options. 'bursts' is the
+    number of times the fair-queuer turned to the pipe. */
+struct nn_pipe_recv_stats {
+    int priority;
+    uint64_t received;
+    uint64_t bytes;
+    uint64_t bursts;
+};
+
+/*  Traffic of a single outbound pipe as reported by NN_PUB_PIPE_STATS socket
+    option. 'queued' is the number of messages waiting for the peer. */
+struct nn_pipe_send_stats {
+    uint64_t sent;
+    uint64_t dropped;
+    uint64_t queued;
+};
+
 /*  Send/recv options.                                                        */
 #define NN_DONTWAIT 1
 
@@ -377,6 +410,8 @@ NN_EXPORT int nn_poll (struct nn_pollfd *fds, int nfds, int timeout);
 /******************************************************************************/
 
 NN_EXPORT int nn_device (int s1, int s2);
+NN_EXPORT int nn_device_shards (const int *s1, const int *s2, int nshards,
+    const char *addr);
 
 /******************************************************************************/
 /*  Statistics.                                                               */
@@ -400,6 +435,8 @@ NN_EXPORT int nn_device (int s1, int s2);
 #define NN_STAT_MESSAGES_RECEIVED       302
 #define NN_STAT_BYTES_SENT              303
 #define NN_STAT_BYTES_RECEIVED          304
+#define NN_STAT_DROPPED_MESSAGES        305
+#define NN_STAT_BATCHES_SENT            306
 /*  Protocol statistics  */
 #define	NN_STAT_CURRENT_SND_PRIORITY    401
 
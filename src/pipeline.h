@@ -33,6 +33,13 @@ extern "C" {
 #define NN_PUSH (NN_PROTO_PIPELINE * 16 + 0)
 #define NN_PULL (NN_PROTO_PIPELINE * 16 + 1)
 
+#define NN_PUSH_LB_POLICY 1
+#define NN_PUSH_PIPE_LOAD 2
+
+#define NN_PULL_BURST 1
+#define NN_PULL_BURST_BYTES 2
+#define NN_PULL_PIPE_STATS 3
+
 #ifdef __cplusplus
 }
 #endif
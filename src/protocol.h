@@ -70,6 +70,15 @@ int nn_pipe_send (struct nn_pipe *self, struct nn_msg *msg);
     the call. It will be initialised when the call succeeds. */
 int nn_pipe_recv (struct nn_pipe *self, struct nn_msg *msg);
 
+/*  Ask the transport to drop the underlying connection. The pipe is removed
+    from the socket later on, via the rm() function. Returns -ENOTSUP if
+    the transport doesn't support closing individual connections. */
+int nn_pipe_close (struct nn_pipe *self);
+
+/*  Returns the number of bytes sent to the pipe that the transport holds
+    waiting to be sent. Returns 0 if the transport doesn't track this. */
+size_t nn_pipe_backlog (struct nn_pipe *self);
+
 /*  Get option for pipe. Mostly useful for endpoint-specific options  */
 void nn_pipe_getopt (struct nn_pipe *self, int level, int option,
     void *optval, size_t *optvallen);
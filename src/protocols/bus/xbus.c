@@ -60,7 +60,7 @@ void nn_xbus_init (struct nn_xbus *self,
     const struct nn_sockbase_vfptr *vfptr, void *hint)
 {
     nn_sockbase_init (&self->sockbase, vfptr, hint);
-    nn_dist_init (&self->outpipes);
+    nn_dist_init (&self->outpipes, &self->sockbase);
     nn_fq_init (&self->inpipes);
 }
 
@@ -56,6 +56,10 @@ static void nn_xpull_in (struct nn_sockbase *self, struct nn_pipe *pipe);
 static void nn_xpull_out (struct nn_sockbase *self, struct nn_pipe *pipe);
 static int nn_xpull_events (struct nn_sockbase *self);
 static int nn_xpull_recv (struct nn_sockbase *self, struct nn_msg *msg);
+static int nn_xpull_setopt (struct nn_sockbase *self, int level, int option,
+    const void *optval, size_t optvallen);
+static int nn_xpull_getopt (struct nn_sockbase *self, int level, int option,
+    void *optval, size_t *optvallen);
 static const struct nn_sockbase_vfptr nn_xpull_sockbase_vfptr = {
     NULL,
     nn_xpull_destroy,
@@ -66,8 +70,8 @@ static const struct nn_sockbase_vfptr nn_xpull_sockbase_vfptr = {
     nn_xpull_events,
     NULL,
     nn_xpull_recv,
-    NULL,
-    NULL
+    nn_xpull_setopt,
+    nn_xpull_getopt
 };
 
 static void nn_xpull_init (struct nn_xpull *self,
@@ -161,6 +165,65 @@ static int nn_xpull_recv (struct nn_sockbase *self, struct nn_msg *msg)
     return rc < 0 ? rc : 0;
 }
 
+static int nn_xpull_setopt (struct nn_sockbase *self, int level, int option,
+    const void *optval, size_t optvallen)
+{
+    struct nn_xpull *xpull;
+
+    xpull = nn_cont (self, struct nn_xpull, sockbase);
+
+    if (level != NN_PULL)
+        return -ENOPROTOOPT;
+
+    if (option == NN_PULL_BURST) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        return nn_fq_setburst (&xpull->fq, *(int*) optval);
+    }
+
+    if (option == NN_PULL_BURST_BYTES) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        return nn_fq_setburstbytes (&xpull->fq, *(int*) optval);
+    }
+
+    return -ENOPROTOOPT;
+}
+
+static int nn_xpull_getopt (struct nn_sockbase *self, int level, int option,
+    void *optval, size_t *optvallen)
+{
+    struct nn_xpull *xpull;
+
+    xpull = nn_cont (self, struct nn_xpull, sockbase);
+
+    if (level != NN_PULL)
+        return -ENOPROTOOPT;
+
+    if (option == NN_PULL_BURST) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = xpull->fq.burst;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    if (option == NN_PULL_BURST_BYTES) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = (int) xpull->fq.burst_bytes;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    if (option == NN_PULL_PIPE_STATS) {
+        nn_fq_getstats (&xpull->fq, optval, optvallen);
+        return 0;
+    }
+
+    return -ENOPROTOOPT;
+}
+
 int nn_xpull_create (void *hint, struct nn_sockbase **sockbase)
 {
     struct nn_xpull *self;
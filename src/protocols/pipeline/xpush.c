@@ -56,6 +56,10 @@ static void nn_xpush_in (struct nn_sockbase *self, struct nn_pipe *pipe);
 static void nn_xpush_out (struct nn_sockbase *self, struct nn_pipe *pipe);
 static int nn_xpush_events (struct nn_sockbase *self);
 static int nn_xpush_send (struct nn_sockbase *self, struct nn_msg *msg);
+static int nn_xpush_setopt (struct nn_sockbase *self, int level, int option,
+    const void *optval, size_t optvallen);
+static int nn_xpush_getopt (struct nn_sockbase *self, int level, int option,
+    void *optval, size_t *optvallen);
 static const struct nn_sockbase_vfptr nn_xpush_sockbase_vfptr = {
     NULL,
     nn_xpush_destroy,
@@ -66,8 +70,8 @@ static const struct nn_sockbase_vfptr nn_xpush_sockbase_vfptr = {
     nn_xpush_events,
     nn_xpush_send,
     NULL,
-    NULL,
-    NULL
+    nn_xpush_setopt,
+    nn_xpush_getopt
 };
 
 static void nn_xpush_init (struct nn_xpush *self,
@@ -156,8 +160,73 @@ static int nn_xpush_events (struct nn_sockbase *self)
 
 static int nn_xpush_send (struct nn_sockbase *self, struct nn_msg *msg)
 {
-    return nn_lb_send (&nn_cont (self, struct nn_xpush, sockbase)->lb,
-        msg, NULL);
+    int rc;
+    struct nn_xpush *xpush;
+    struct nn_pipe *to;
+    struct nn_xpush_data *data;
+
+    xpush = nn_cont (self, struct nn_xpush, sockbase);
+
+    rc = nn_lb_send (&xpush->lb, msg, &to);
+    if (nn_slow (rc < 0))
+        return rc;
+
+    /*  There are no acknowledgements in the pipeline pattern. The message
+        is done as soon as it's passed to the transport, so the load of
+        the pipe is the backlog of the transport only. */
+    data = nn_pipe_getdata (to);
+    nn_lb_done (&xpush->lb, &data->lb);
+
+    return rc;
+}
+
+static int nn_xpush_setopt (struct nn_sockbase *self, int level, int option,
+    const void *optval, size_t optvallen)
+{
+    struct nn_xpush *xpush;
+
+    xpush = nn_cont (self, struct nn_xpush, sockbase);
+
+    if (level != NN_PUSH)
+        return -ENOPROTOOPT;
+
+    if (option == NN_PUSH_LB_POLICY) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+
+        /*  There are no replies to measure the latency by. */
+        if (nn_slow (*(int*) optval == NN_LB_LOWEST_LATENCY))
+            return -EINVAL;
+        return nn_lb_setpolicy (&xpush->lb, *(int*) optval);
+    }
+
+    return -ENOPROTOOPT;
+}
+
+static int nn_xpush_getopt (struct nn_sockbase *self, int level, int option,
+    void *optval, size_t *optvallen)
+{
+    struct nn_xpush *xpush;
+
+    xpush = nn_cont (self, struct nn_xpush, sockbase);
+
+    if (level != NN_PUSH)
+        return -ENOPROTOOPT;
+
+    if (option == NN_PUSH_LB_POLICY) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = xpush->lb.policy;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    if (option == NN_PUSH_PIPE_LOAD) {
+        nn_lb_getload (&xpush->lb, optval, optvallen);
+        return 0;
+    }
+
+    return -ENOPROTOOPT;
 }
 
 int nn_xpush_create (void *hint, struct nn_sockbase **sockbase)
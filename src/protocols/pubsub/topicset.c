@@ -0,0 +1,203 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include <string.h>
+
+#include "topicset.h"
+#include "../../utils/alloc.h"
+#include "../../utils/fast.h"
+#include "../../utils/err.h"
+
+/*  Private functions. */
+static uint32_t nn_topicset_hash (const uint8_t *data, size_t size);
+static uint32_t *nn_topicset_refcount (struct nn_topicset *self,
+    size_t index);
+static size_t nn_topicset_find (struct nn_topicset *self,
+    const uint8_t *data, uint32_t hash);
+static void nn_topicset_rehash (struct nn_topicset *self);
+
+void nn_topicset_init (struct nn_topicset *self, size_t keylen)
+{
+    nn_assert (keylen > 0 && keylen <= NN_TOPICSET_KEYLEN_MAX);
+
+    self->keylen = keylen;
+    self->stride = (sizeof (uint32_t) + keylen + 3) & ~((size_t) 3);
+    self->slots = NN_TOPICSET_INITIAL_SLOTS;
+    self->items = 0;
+    self->array = nn_alloc (self->slots * self->stride, "topic set");
+    alloc_assert (self->array);
+    memset (self->array, 0, self->slots * self->stride);
+}
+
+void nn_topicset_term (struct nn_topicset *self)
+{
+    nn_free (self->array);
+}
+
+int nn_topicset_subscribe (struct nn_topicset *self, const uint8_t *data,
+    size_t size)
+{
+    size_t i;
+    uint32_t *refcount;
+
+    if (nn_slow (size != self->keylen))
+        return -EINVAL;
+
+    i = nn_topicset_find (self, data, nn_topicset_hash (data, size));
+    refcount = nn_topicset_refcount (self, i);
+
+    /*  Existing subscription. */
+    if (*refcount) {
+        ++*refcount;
+        return 0;
+    }
+
+    /*  New subscription. Keep the load factor at or below 1/2 so that the
+        probe sequences stay short. */
+    *refcount = 1;
+    memcpy (refcount + 1, data, size);
+    ++self->items;
+    if (self->items * 2 > self->slots)
+        nn_topicset_rehash (self);
+    return 1;
+}
+
+int nn_topicset_unsubscribe (struct nn_topicset *self, const uint8_t *data,
+    size_t size)
+{
+    size_t i;
+    size_t j;
+    size_t home;
+    size_t mask;
+    uint32_t *refcount;
+
+    if (nn_slow (size != self->keylen))
+        return -EINVAL;
+
+    i = nn_topicset_find (self, data, nn_topicset_hash (data, size));
+    refcount = nn_topicset_refcount (self, i);
+    if (nn_slow (!*refcount))
+        return -EINVAL;
+    if (--*refcount)
+        return 0;
+    --self->items;
+
+    /*  The slot became empty. Shift the following items of the probe
+        sequence backwards so that no tombstones are needed. */
+    mask = self->slots - 1;
+    j = i;
+    while (1) {
+        j = (j + 1) & mask;
+        refcount = nn_topicset_refcount (self, j);
+        if (!*refcount)
+            break;
+        home = nn_topicset_hash ((uint8_t*) (refcount + 1), self->keylen) &
+            mask;
+
+        /*  Item in slot j can be moved to slot i only if its home slot is
+            not located cyclically in (i, j]. */
+        if (i <= j ? (i < home && home <= j) : (i < home || home <= j))
+            continue;
+        memcpy (nn_topicset_refcount (self, i), refcount, self->stride);
+        *refcount = 0;
+        i = j;
+    }
+
+    return 1;
+}
+
+int nn_topicset_match (struct nn_topicset *self, const uint8_t *data,
+    size_t size)
+{
+    if (size < self->keylen)
+        return 0;
+    return *nn_topicset_refcount (self, nn_topicset_find (self, data,
+        nn_topicset_hash (data, self->keylen))) ? 1 : 0;
+}
+
+static uint32_t nn_topicset_hash (const uint8_t *data, size_t size)
+{
+    /*  FNV-1a. */
+    uint32_t hash;
+
+    hash = 2166136261u;
+    while (size--) {
+        hash ^= *data++;
+        hash *= 16777619u;
+    }
+    return hash;
+}
+
+static uint32_t *nn_topicset_refcount (struct nn_topicset *self,
+    size_t index)
+{
+    return (uint32_t*) (self->array + index * self->stride);
+}
+
+static size_t nn_topicset_find (struct nn_topicset *self,
+    const uint8_t *data, uint32_t hash)
+{
+    /*  Returns index of the slot holding the topic or, if the topic is
+        not present, index of the empty slot where it would be stored. */
+
+    size_t i;
+    size_t mask;
+    uint32_t *refcount;
+
+    mask = self->slots - 1;
+    i = hash & mask;
+    while (1) {
+        refcount = nn_topicset_refcount (self, i);
+        if (!*refcount ||
+              memcmp (refcount + 1, data, self->keylen) == 0)
+            return i;
+        i = (i + 1) & mask;
+    }
+}
+
+static void nn_topicset_rehash (struct nn_topicset *self)
+{
+    size_t i;
+    size_t j;
+    size_t old_slots;
+    uint8_t *old_array;
+    uint32_t *refcount;
+
+    old_slots = self->slots;
+    old_array = self->array;
+
+    self->slots *= 2;
+    self->array = nn_alloc (self->slots * self->stride, "topic set");
+    alloc_assert (self->array);
+    memset (self->array, 0, self->slots * self->stride);
+
+    for (i = 0; i != old_slots; ++i) {
+        refcount = (uint32_t*) (old_array + i * self->stride);
+        if (!*refcount)
+            continue;
+        j = nn_topicset_find (self, (uint8_t*) (refcount + 1),
+            nn_topicset_hash ((uint8_t*) (refcount + 1), self->keylen));
+        memcpy (nn_topicset_refcount (self, j), refcount, self->stride);
+    }
+
+    nn_free (old_array);
+}
@@ -0,0 +1,83 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#ifndef NN_TOPICSET_INCLUDED
+#define NN_TOPICSET_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*  This class implements a set of fixed-length topics. It is an alternative
+    to nn_trie for the case where all the topics have the same length and
+    a message matches a subscription only if its first 'keylen' bytes are
+    equal to the topic. The set uses open addressing with linear probing,
+    so a lookup is a hash computation followed by a scan over a few
+    adjacent slots. */
+
+/*  Initial number of slots. Must be a power of two. */
+#define NN_TOPICSET_INITIAL_SLOTS 32
+
+/*  Maximum supported topic length. */
+#define NN_TOPICSET_KEYLEN_MAX 255
+
+struct nn_topicset {
+
+    /*  Length of every topic in the set. */
+    size_t keylen;
+
+    /*  Size of a single slot. Each slot consists of a 32-bit reference
+        count followed by the topic itself. Reference count of zero marks
+        an empty slot. */
+    size_t stride;
+
+    /*  Number of slots and number of the slots in use. */
+    size_t slots;
+    size_t items;
+
+    /*  The array of slots. */
+    uint8_t *array;
+};
+
+/*  Initialise an empty set of topics of 'keylen' bytes each. */
+void nn_topicset_init (struct nn_topicset *self, size_t keylen);
+
+/*  Release all the resources associated with the set. */
+void nn_topicset_term (struct nn_topicset *self);
+
+/*  Add the topic to the set. If the topic is not yet there, 1 is returned.
+    If it already exists, its reference count is incremented and 0 is
+    returned. If the topic has a wrong size -EINVAL is returned. */
+int nn_topicset_subscribe (struct nn_topicset *self, const uint8_t *data,
+    size_t size);
+
+/*  Remove the topic from the set. If the topic was actually removed, 1 is
+    returned. If reference count was decremented without falling to zero,
+    0 is returned. If there's no such topic -EINVAL is returned. */
+int nn_topicset_unsubscribe (struct nn_topicset *self, const uint8_t *data,
+    size_t size);
+
+/*  Checks whether the first 'keylen' bytes of the supplied message are
+    in the set. If so, it returns 1, otherwise it returns 0. */
+int nn_topicset_match (struct nn_topicset *self, const uint8_t *data,
+    size_t size);
+
+#endif
@@ -29,34 +29,327 @@
 #include "../../utils/fast.h"
 #include "../../utils/err.h"
 
+/*  Select the vectorised implementation of the hot lookup paths. The SIMD
+    code is used only where the instruction set is guaranteed to be present
+    at compile time; everything else uses the portable scalar loops. */
+#if defined NN_TRIE_NO_SIMD
+#elif defined __SSE2__ || defined _M_X64 || \
+    (defined _M_IX86_FP && _M_IX86_FP >= 2)
+#define NN_TRIE_SSE2
+#include <emmintrin.h>
+#elif defined __ARM_NEON || defined __ARM_NEON__
+#define NN_TRIE_NEON
+#include <arm_neon.h>
+#endif
+
+#if defined _MSC_VER && (defined NN_TRIE_SSE2 || defined NN_TRIE_NEON)
+#include <intrin.h>
+#endif
+
 /*  Double check that the size of node structure is as small as
     we believe it to be. */
 CT_ASSERT (sizeof (struct nn_trie_node) == 24);
 
+/*  Vectorised prefix comparison loads 16 bytes starting at the prefix. */
+CT_ASSERT (offsetof (struct nn_trie_node, prefix) + 16 <=
+    sizeof (struct nn_trie_node));
+
+/*  Slab chunk header. It is followed by NN_TRIE_SLAB_CHUNK_NODES nodes. */
+struct nn_trie_chunk {
+    struct nn_trie_chunk *next;
+};
+
 /*  Forward declarations. */
-static struct nn_trie_node *nn_node_compact (struct nn_trie_node *self);
+static void nn_trie_slabs_init (struct nn_trie_slab *slabs);
+static void nn_trie_slabs_term (struct nn_trie_slab *slabs);
+static int nn_node_slots (struct nn_trie_node *self);
+static struct nn_trie_node *nn_node_alloc (struct nn_trie *trie, int slots);
+static void nn_node_free (struct nn_trie *trie, struct nn_trie_node *self,
+    int slots);
+static struct nn_trie_node *nn_node_resize (struct nn_trie *trie,
+    struct nn_trie_node *self, int old_slots, int new_slots);
+static struct nn_trie_node *nn_node_relocate (struct nn_trie *trie,
+    struct nn_trie_node *self);
+static struct nn_trie_node *nn_node_compact (struct nn_trie *trie,
+    struct nn_trie_node *self);
 static int nn_node_check_prefix (struct nn_trie_node *self,
     const uint8_t *data, size_t size);
 static struct nn_trie_node **nn_node_child (struct nn_trie_node *self,
     int index);
 static struct nn_trie_node **nn_node_next (struct nn_trie_node *self,
     uint8_t c);
-static int nn_node_unsubscribe (struct nn_trie_node **self,
-    const uint8_t *data, size_t size);
-static void nn_node_term (struct nn_trie_node *self);
+static int nn_node_unsubscribe (struct nn_trie *trie,
+    struct nn_trie_node **self, const uint8_t *data, size_t size);
+static void nn_node_term (struct nn_trie *trie, struct nn_trie_node *self);
 static int nn_node_has_subscribers (struct nn_trie_node *self);
 static void nn_node_dump (struct nn_trie_node *self, int indent);
 static void nn_node_indent (int indent);
 static void nn_node_putchar (uint8_t c);
 
+#if defined NN_TRIE_SSE2 || defined NN_TRIE_NEON
+
+static int nn_trie_ctz32 (uint32_t x)
+{
+    /*  Returns the index of the lowest set bit. 'x' must not be zero. */
+#if defined __GNUC__ || defined __llvm__
+    return __builtin_ctz (x);
+#elif defined _MSC_VER
+    unsigned long index;
+
+    _BitScanForward (&index, x);
+    return (int) index;
+#else
+    int i;
+
+    for (i = 0; !(x & 1); ++i)
+        x >>= 1;
+    return i;
+#endif
+}
+
+#if defined NN_TRIE_NEON
+static int nn_trie_ctz64 (uint64_t x)
+{
+    /*  Returns the index of the lowest set bit. 'x' must not be zero. */
+    if ((uint32_t) x)
+        return nn_trie_ctz32 ((uint32_t) x);
+    return 32 + nn_trie_ctz32 ((uint32_t) (x >> 32));
+}
+#endif
+
+static int nn_trie_find8 (const uint8_t *children, int count, uint8_t c)
+{
+    /*  Returns the index of character 'c' among the first 'count' elements
+        of the 8-byte sparse child array, or -1 if it is not present. */
+
+#if defined NN_TRIE_SSE2
+    uint32_t mask;
+
+    mask = (uint32_t) _mm_movemask_epi8 (_mm_cmpeq_epi8 (
+        _mm_loadl_epi64 ((const __m128i*) children),
+        _mm_set1_epi8 ((char) c)));
+    mask &= (1u << count) - 1;
+    return mask ? nn_trie_ctz32 (mask) : -1;
+#else
+    uint64_t mask;
+
+    mask = vget_lane_u64 (vreinterpret_u64_u8 (vceq_u8 (
+        vld1_u8 (children), vdup_n_u8 (c))), 0);
+    if (count < 8)
+        mask &= (((uint64_t) 1) << (count * 8)) - 1;
+    return mask ? nn_trie_ctz64 (mask) / 8 : -1;
+#endif
+}
+
+static int nn_trie_mismatch16 (const uint8_t *a, const uint8_t *b)
+{
+    /*  Returns the index of the first byte in which the two 16-byte blocks
+        differ, or 16 if they are identical. */
+
+#if defined NN_TRIE_SSE2
+    uint32_t mask;
+
+    mask = (uint32_t) _mm_movemask_epi8 (_mm_cmpeq_epi8 (
+        _mm_loadu_si128 ((const __m128i*) a),
+        _mm_loadu_si128 ((const __m128i*) b)));
+    mask = ~mask & 0xffff;
+    return mask ? nn_trie_ctz32 (mask) : 16;
+#else
+    uint8x16_t neq;
+    uint64_t lo;
+    uint64_t hi;
+
+    neq = vmvnq_u8 (vceqq_u8 (vld1q_u8 (a), vld1q_u8 (b)));
+    lo = vgetq_lane_u64 (vreinterpretq_u64_u8 (neq), 0);
+    hi = vgetq_lane_u64 (vreinterpretq_u64_u8 (neq), 1);
+    if (lo)
+        return nn_trie_ctz64 (lo) / 8;
+    return hi ? 8 + nn_trie_ctz64 (hi) / 8 : 16;
+#endif
+}
+
+#endif
+
 void nn_trie_init (struct nn_trie *self)
 {
     self->root = NULL;
+    nn_trie_slabs_init (self->slabs);
 }
 
 void nn_trie_term (struct nn_trie *self)
 {
-    nn_node_term (self->root);
+    nn_node_term (self, self->root);
+    nn_trie_slabs_term (self->slabs);
+}
+
+int nn_trie_compact (struct nn_trie *self)
+{
+    int i;
+    size_t used;
+    size_t capacity;
+    struct nn_trie_slab old [NN_TRIE_SLAB_CLASSES];
+
+    /*  Compact only if more than half of the slab memory is unused. Each
+        slab may legitimately waste up to one chunk, so don't bother with
+        small tries; this also keeps the compaction amortised. */
+    used = 0;
+    capacity = 0;
+    for (i = 0; i != NN_TRIE_SLAB_CLASSES; ++i) {
+        used += self->slabs [i].used;
+        capacity += self->slabs [i].capacity;
+    }
+    if (capacity - used <= used ||
+          capacity - used <= NN_TRIE_SLAB_CLASSES * NN_TRIE_SLAB_CHUNK_NODES)
+        return 0;
+
+    /*  Copy the whole trie into new slabs. Old chunks are released
+        in one go afterwards. */
+    memcpy (old, self->slabs, sizeof (old));
+    nn_trie_slabs_init (self->slabs);
+    self->root = nn_node_relocate (self, self->root);
+    nn_trie_slabs_term (old);
+
+    return 1;
+}
+
+static void nn_trie_slabs_init (struct nn_trie_slab *slabs)
+{
+    int i;
+
+    for (i = 0; i != NN_TRIE_SLAB_CLASSES; ++i) {
+        slabs [i].chunks = NULL;
+        slabs [i].free = NULL;
+        slabs [i].used = 0;
+        slabs [i].capacity = 0;
+    }
+}
+
+static void nn_trie_slabs_term (struct nn_trie_slab *slabs)
+{
+    int i;
+    struct nn_trie_chunk *chunk;
+
+    for (i = 0; i != NN_TRIE_SLAB_CLASSES; ++i) {
+        while (slabs [i].chunks) {
+            chunk = slabs [i].chunks;
+            slabs [i].chunks = chunk->next;
+            nn_free (chunk);
+        }
+    }
+}
+
+static int nn_node_slots (struct nn_trie_node *self)
+{
+    /*  Returns the number of child pointers following the node. */
+    return self->type <= NN_TRIE_SPARSE_MAX ?
+        self->type : (self->u.dense.max - self->u.dense.min + 1);
+}
+
+static struct nn_trie_node *nn_node_alloc (struct nn_trie *trie, int slots)
+{
+    int i;
+    size_t sz;
+    struct nn_trie_slab *slab;
+    struct nn_trie_chunk *chunk;
+    struct nn_trie_node *node;
+    uint8_t *pos;
+
+    sz = sizeof (struct nn_trie_node) + slots * sizeof (struct nn_trie_node*);
+
+    /*  Big nodes are allocated directly. */
+    if (slots >= NN_TRIE_SLAB_CLASSES) {
+        node = nn_alloc (sz, "trie node");
+        alloc_assert (node);
+        return node;
+    }
+
+    /*  If there are no free nodes in the slab, allocate a new chunk and
+        put all its nodes to the list of free nodes. */
+    slab = &trie->slabs [slots];
+    if (!slab->free) {
+        chunk = nn_alloc (sizeof (struct nn_trie_chunk) +
+            NN_TRIE_SLAB_CHUNK_NODES * sz, "trie slab");
+        alloc_assert (chunk);
+        chunk->next = slab->chunks;
+        slab->chunks = chunk;
+        pos = ((uint8_t*) (chunk + 1)) + NN_TRIE_SLAB_CHUNK_NODES * sz;
+        for (i = 0; i != NN_TRIE_SLAB_CHUNK_NODES; ++i) {
+            pos -= sz;
+            *(void**) pos = slab->free;
+            slab->free = pos;
+        }
+        slab->capacity += NN_TRIE_SLAB_CHUNK_NODES;
+    }
+
+    node = slab->free;
+    slab->free = *(void**) node;
+    ++slab->used;
+    return node;
+}
+
+static void nn_node_free (struct nn_trie *trie, struct nn_trie_node *self,
+    int slots)
+{
+    struct nn_trie_slab *slab;
+
+    if (slots >= NN_TRIE_SLAB_CLASSES) {
+        nn_free (self);
+        return;
+    }
+
+    slab = &trie->slabs [slots];
+    *(void**) self = slab->free;
+    slab->free = self;
+    --slab->used;
+}
+
+static struct nn_trie_node *nn_node_resize (struct nn_trie *trie,
+    struct nn_trie_node *self, int old_slots, int new_slots)
+{
+    struct nn_trie_node *node;
+
+    if (old_slots >= NN_TRIE_SLAB_CLASSES &&
+          new_slots >= NN_TRIE_SLAB_CLASSES) {
+        node = nn_realloc (self, sizeof (struct nn_trie_node) +
+            new_slots * sizeof (struct nn_trie_node*));
+        alloc_assert (node);
+        return node;
+    }
+
+    node = nn_node_alloc (trie, new_slots);
+    memcpy (node, self, sizeof (struct nn_trie_node) +
+        (old_slots < new_slots ? old_slots : new_slots) *
+        sizeof (struct nn_trie_node*));
+    nn_node_free (trie, self, old_slots);
+    return node;
+}
+
+static struct nn_trie_node *nn_node_relocate (struct nn_trie *trie,
+    struct nn_trie_node *self)
+{
+    int i;
+    int slots;
+    struct nn_trie_node *node;
+
+    if (!self)
+        return NULL;
+
+    /*  The parent is copied before its children so that the nodes end up
+        in the slabs in the order they are visited by nn_trie_match. */
+    slots = nn_node_slots (self);
+    if (slots < NN_TRIE_SLAB_CLASSES) {
+        node = nn_node_alloc (trie, slots);
+        memcpy (node, self, sizeof (struct nn_trie_node) +
+            slots * sizeof (struct nn_trie_node*));
+    }
+    else
+        node = self;
+
+    for (i = 0; i != slots; ++i)
+        *nn_node_child (node, i) = nn_node_relocate (trie,
+            *nn_node_child (node, i));
+
+    return node;
 }
 
 void nn_trie_dump (struct nn_trie *self)
@@ -134,7 +427,7 @@ void nn_node_putchar (uint8_t c)
         putchar (c);
 }
 
-void nn_node_term (struct nn_trie_node *self)
+void nn_node_term (struct nn_trie *trie, struct nn_trie_node *self)
 {
     int children;
     int i;
@@ -144,13 +437,14 @@ void nn_node_term (struct nn_trie_node *self)
         return;
 
     /*  Recursively destroy the child nodes. */
-    children = self->type <= NN_TRIE_SPARSE_MAX ?
-        self->type : (self->u.dense.max - self->u.dense.min + 1);
+    children = nn_node_slots (self);
     for (i = 0; i != children; ++i)
-        nn_node_term (*nn_node_child (self, i));
+        nn_node_term (trie, *nn_node_child (self, i));
 
-    /*  Deallocate this node. */
-    nn_free (self);
+    /*  Deallocate this node. Nodes living in the slabs are released
+        together with the slab chunks. */
+    if (children >= NN_TRIE_SLAB_CLASSES)
+        nn_free (self);
 }
 
 int nn_node_check_prefix (struct nn_trie_node *self,
@@ -159,6 +453,18 @@ int nn_node_check_prefix (struct nn_trie_node *self,
     /*  Check how many characters from the data match the prefix. */
 
     int i;
+#if defined NN_TRIE_SSE2 || defined NN_TRIE_NEON
+    int pos;
+
+    /*  The prefix starts at offset 6 of a 24-byte node, so loading 16 bytes
+        from it never leaves the node. Data is loaded as a whole vector only
+        if there are at least 16 bytes available, otherwise we would read
+        past the end of the message. */
+    if (size >= 16) {
+        pos = nn_trie_mismatch16 (self->prefix, data);
+        return pos < self->prefix_len ? pos : self->prefix_len;
+    }
+#endif
 
     for (i = 0; i != self->prefix_len; ++i) {
         if (!size || self->prefix [i] != *data)
@@ -188,10 +494,15 @@ struct nn_trie_node **nn_node_next (struct nn_trie_node *self, uint8_t c)
 
     /*  Sparse mode. */
     if (self->type <= 8) {
+#if defined NN_TRIE_SSE2 || defined NN_TRIE_NEON
+        i = nn_trie_find8 (self->u.sparse.children, self->type, c);
+        return i < 0 ? NULL : nn_node_child (self, i);
+#else
         for (i = 0; i != self->type; ++i)
             if (self->u.sparse.children [i] == c)
                 return nn_node_child (self, i);
         return NULL;
+#endif
     }
 
     /*  Dense mode. */
@@ -200,7 +511,8 @@ struct nn_trie_node **nn_node_next (struct nn_trie_node *self, uint8_t c)
     return nn_node_child (self, c - self->u.dense.min);
 }
 
-struct nn_trie_node *nn_node_compact (struct nn_trie_node *self)
+struct nn_trie_node *nn_node_compact (struct nn_trie *trie,
+    struct nn_trie_node *self)
 {
     /*  Tries to merge the node with the child node. Returns pointer to
         the compacted node. */
@@ -227,7 +539,7 @@ struct nn_trie_node *nn_node_compact (struct nn_trie_node *self)
     ch->prefix_len += self->prefix_len + 1;
 
     /*  Get rid of the obsolete parent node. */
-    nn_free (self);
+    nn_node_free (trie, self, 1);
 
     /*  Return the new compacted node. */
     return ch;
@@ -286,9 +598,7 @@ int nn_trie_subscribe (struct nn_trie *self, const uint8_t *data, size_t size)
 step2:
 
     ch = *node;
-    *node = nn_alloc (sizeof (struct nn_trie_node) +
-        sizeof (struct nn_trie_node*), "trie node");
-    assert (*node);
+    *node = nn_node_alloc (self, 1);
     (*node)->refcount = 0;
     (*node)->prefix_len = pos;
     (*node)->type = 1;
@@ -296,7 +606,7 @@ step2:
     (*node)->u.sparse.children [0] = ch->prefix [pos];
     ch->prefix_len -= (pos + 1);
     memmove (ch->prefix, ch->prefix + pos + 1, ch->prefix_len);
-    ch = nn_node_compact (ch);
+    ch = nn_node_compact (self, ch);
     *nn_node_child (*node, 0) = ch;
 
     /*  Step 3 -- Adjust the child array to accommodate the new character. */
@@ -309,9 +619,8 @@ step3:
 
     /*  If the new branch fits into sparse array... */
     if ((*node)->type < NN_TRIE_SPARSE_MAX) {
-        *node = nn_realloc (*node, sizeof (struct nn_trie_node) +
-            ((*node)->type + 1) * sizeof (struct nn_trie_node*));
-        assert (*node);
+        *node = nn_node_resize (self, *node, (*node)->type,
+            (*node)->type + 1);
         (*node)->u.sparse.children [(*node)->type] = *data;
         ++(*node)->type;
         node = nn_node_child (*node, (*node)->type - 1);
@@ -328,11 +637,9 @@ step3:
         if (c < (*node)->u.dense.min || c > (*node)->u.dense.max) {
             new_min = (*node)->u.dense.min < c ? (*node)->u.dense.min : c;
             new_max = (*node)->u.dense.max > c ? (*node)->u.dense.max : c;
-            *node = nn_realloc (*node, sizeof (struct nn_trie_node) +
-                (new_max - new_min + 1) * sizeof (struct nn_trie_node*));
-            assert (*node);
             old_children = (*node)->u.dense.max - (*node)->u.dense.min + 1;
             new_children = new_max - new_min + 1;
+            *node = nn_node_resize (self, *node, old_children, new_children);
             if ((*node)->u.dense.min != new_min) {
                 inserted = (*node)->u.dense.min - new_min;
                 memmove (nn_node_child (*node, inserted),
@@ -373,13 +680,10 @@ step3:
 
         /*  Create a new mode, while keeping the old one for a while. */
         old_node = *node;
-        *node = (struct nn_trie_node*) nn_alloc (sizeof (struct nn_trie_node) +
-            (new_max - new_min + 1) * sizeof (struct nn_trie_node*),
-            "trie node");
-        assert (*node);
+        *node = nn_node_alloc (self, new_max - new_min + 1);
 
         /*  Fill in the new node. */
-        (*node)->refcount = 0;
+        (*node)->refcount = old_node->refcount;
         (*node)->prefix_len = old_node->prefix_len;
         (*node)->type = NN_TRIE_DENSE_TYPE;
         memcpy ((*node)->prefix, old_node->prefix, old_node->prefix_len);
@@ -396,7 +700,7 @@ step3:
         --size;
 
         /*  Get rid of the obsolete old node. */
-        nn_free (old_node);
+        nn_node_free (self, old_node, old_node->type);
     }
 
     /*  Step 4 -- Create new nodes for remaining part of the subscription. */
@@ -407,9 +711,7 @@ step4:
 
         /*  Create a new node to hold the next part of the subscription. */
         more_nodes = size > NN_TRIE_PREFIX_MAX;
-        *node = nn_alloc (sizeof (struct nn_trie_node) +
-            (more_nodes ? sizeof (struct nn_trie_node*) : 0), "trie node");
-        assert (*node);
+        *node = nn_node_alloc (self, more_nodes ? 1 : 0);
 
         /*  Fill in the new node. */
         (*node)->refcount = 0;
@@ -461,6 +763,11 @@ int nn_trie_match (struct nn_trie *self, const uint8_t *data, size_t size)
         if (nn_node_has_subscribers (node))
             return 1;
 
+        /*  If there are no more data, there's nothing to match the following
+            node against. */
+        if (!size)
+            return 0;
+
         /*  Move to the next node. */
         tmp = nn_node_next (node, *data);
         node = tmp ? *tmp : NULL;
@@ -471,26 +778,37 @@ int nn_trie_match (struct nn_trie *self, const uint8_t *data, size_t size)
 
 int nn_trie_unsubscribe (struct nn_trie *self, const uint8_t *data, size_t size)
 {
-    return nn_node_unsubscribe (&self->root, data, size);
+    return nn_node_unsubscribe (self, &self->root, data, size);
 }
 
-static int nn_node_unsubscribe (struct nn_trie_node **self,
-    const uint8_t *data, size_t size)
+static int nn_node_unsubscribe (struct nn_trie *trie,
+    struct nn_trie_node **self, const uint8_t *data, size_t size)
 {
     int i;
     int j;
     int index;
     int new_min;
+    int old_children;
+    int rc;
     struct nn_trie_node **ch;
     struct nn_trie_node *new_node;
     struct nn_trie_node *ch2;
 
-    if (!size)
+    /*  If the node has a prefix, it represents a longer string than the one
+        being unsubscribed. */
+    if (!size) {
+        if (*self && (*self)->prefix_len)
+            return -EINVAL;
         goto found;
+    }
 
-    /*  If prefix does not match the data, return. */
+    /*  The path to the subscription ends prematurely. */
+    if (nn_slow (!*self))
+        return -EINVAL;
+
+    /*  If prefix does not match the data, there's no such subscription. */
     if (nn_node_check_prefix (*self, data, size) != (*self)->prefix_len)
-        return 0;
+        return -EINVAL;
 
     /*  Skip the prefix. */
     data += (*self)->prefix_len;
@@ -502,13 +820,14 @@ static int nn_node_unsubscribe (struct nn_trie_node **self,
     /*  Move to the next node. */
     ch = nn_node_next (*self, *data);
     if (!ch)
-        return 0; /*  TODO: This should be an error. */
+        return -EINVAL;
 
     /*  Recursive traversal of the trie happens here. If the subscription
         wasn't really removed, nothing have changed in the trie and
         no additional pruning is needed. */
-    if (nn_node_unsubscribe (ch, data + 1, size - 1) == 0)
-        return 0;
+    rc = nn_node_unsubscribe (trie, ch, data + 1, size - 1);
+    if (rc <= 0)
+        return rc;
 
     /*  Subscription removal is already done. Now we are going to compact
         the trie. However, if the following node remains in place, there's
@@ -535,20 +854,19 @@ static int nn_node_unsubscribe (struct nn_trie_node **self,
             nn_node_child (*self, index + 1),
             ((*self)->type - index - 1) * sizeof (struct nn_trie_node*));
         --(*self)->type;
-        *self = nn_realloc (*self, sizeof (struct nn_trie_node) +
-            ((*self)->type * sizeof (struct nn_trie_node*)));
-        assert (*self);
-        
+        *self = nn_node_resize (trie, *self, (*self)->type + 1,
+            (*self)->type);
+
         /*  If there are no more children and no refcount, we can delete
             the node altogether. */
         if (!(*self)->type && !nn_node_has_subscribers (*self)) {
-            nn_free (*self);
+            nn_node_free (trie, *self, 0);
             *self = NULL;
             return 1;
         }
 
         /*  Try to merge the node with the following node. */
-        *self = nn_node_compact (*self);
+        *self = nn_node_compact (trie, *self);
 
         return 1;
     }
@@ -567,30 +885,28 @@ static int nn_node_unsubscribe (struct nn_trie_node **self,
                  if (*nn_node_child (*self, i))
                      break;
              new_min = i + (*self)->u.dense.min;
+             old_children = (*self)->u.dense.max - (*self)->u.dense.min + 1;
              memmove (nn_node_child (*self, 0), nn_node_child (*self, i),
                  ((*self)->u.dense.max - new_min + 1) *
                  sizeof (struct nn_trie_node*));
              (*self)->u.dense.min = new_min;
              --(*self)->u.dense.nbr;
-             *self = nn_realloc (*self, sizeof (struct nn_trie_node) +
-                 ((*self)->u.dense.max - new_min + 1) *
-                 sizeof (struct nn_trie_node*));
-             assert (*self);
+             *self = nn_node_resize (trie, *self, old_children,
+                 (*self)->u.dense.max - new_min + 1);
              return 1;
         }
 
         /*  If the removed item is the rightmost one, trim the array from
             the right side. */
         if (*data == (*self)->u.dense.max) {
+             old_children = (*self)->u.dense.max - (*self)->u.dense.min + 1;
              for (i = (*self)->u.dense.max - (*self)->u.dense.min; i != 0; --i)
                  if (*nn_node_child (*self, i))
                      break;
              (*self)->u.dense.max = i + (*self)->u.dense.min;
              --(*self)->u.dense.nbr;
-             *self = nn_realloc (*self, sizeof (struct nn_trie_node) +
-                 ((*self)->u.dense.max - (*self)->u.dense.min + 1) *
-                 sizeof (struct nn_trie_node*));
-             assert (*self);
+             *self = nn_node_resize (trie, *self, old_children,
+                 (*self)->u.dense.max - (*self)->u.dense.min + 1);
              return 1;
         }
 
@@ -601,10 +917,8 @@ static int nn_node_unsubscribe (struct nn_trie_node **self,
 
     /*  Convert dense array into sparse array. */
     {
-        new_node = nn_alloc (sizeof (struct nn_trie_node) +
-            NN_TRIE_SPARSE_MAX * sizeof (struct nn_trie_node*), "trie node");
-        assert (new_node);
-        new_node->refcount = 0;
+        new_node = nn_node_alloc (trie, NN_TRIE_SPARSE_MAX);
+        new_node->refcount = (*self)->refcount;
         new_node->prefix_len = (*self)->prefix_len;
         memcpy (new_node->prefix, (*self)->prefix, new_node->prefix_len);
         new_node->type = NN_TRIE_SPARSE_MAX;
@@ -619,7 +933,7 @@ static int nn_node_unsubscribe (struct nn_trie_node **self,
             }
         }
         assert (j == NN_TRIE_SPARSE_MAX);
-        nn_free (*self);
+        nn_node_free (trie, *self, nn_node_slots (*self));
         *self = new_node;
         return 1;
     }
@@ -641,13 +955,13 @@ found:
 
         /*  If there are no children, we can delete the node altogether. */
         if (!(*self)->type) {
-            nn_free (*self);
+            nn_node_free (trie, *self, 0);
             *self = NULL;
             return 1;
         }
 
         /*  Try to merge the node with the following node. */
-        *self = nn_node_compact (*self);
+        *self = nn_node_compact (trie, *self);
         return 1;
     }
 
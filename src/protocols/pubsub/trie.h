@@ -84,11 +84,39 @@ struct nn_trie_node
 };
 /*  The structure is followed by the array of pointers to children. */
 
+/*  Nodes with fewer child slots than this are allocated from the per-trie
+    slabs. Bigger (dense) nodes are allocated using nn_alloc. */
+#define NN_TRIE_SLAB_CLASSES (NN_TRIE_SPARSE_MAX + 1)
+
+/*  Number of nodes carved out of a single slab chunk. */
+#define NN_TRIE_SLAB_CHUNK_NODES 64
+
+struct nn_trie_chunk;
+
+/*  Pool of equally sized nodes. Nodes are carved out of big chunks so that
+    the nodes of a trie are kept close to each other in memory and so that
+    subscribing doesn't have to hit the general purpose allocator for every
+    single node. */
+struct nn_trie_slab {
+
+    /*  List of the chunks allocated for this slab. */
+    struct nn_trie_chunk *chunks;
+
+    /*  List of unused nodes, linked through their first bytes. */
+    void *free;
+
+    /*  Number of nodes in use and the total number of nodes in the chunks. */
+    size_t used;
+    size_t capacity;
+};
+
 struct nn_trie {
 
     /*  The root node of the trie (representing the empty subscription). */
     struct nn_trie_node *root;
 
+    /*  Slabs for nodes with 0 to NN_TRIE_SPARSE_MAX child slots. */
+    struct nn_trie_slab slabs [NN_TRIE_SLAB_CLASSES];
 };
 
 /*  Initialise an empty trie. */
@@ -104,7 +132,8 @@ int nn_trie_subscribe (struct nn_trie *self, const uint8_t *data, size_t size);
 
 /*  Remove the string from the trie. If the string was actually removed,
     1 is returned. If reference count was decremented without falling to zero,
-    0 is returned. */
+    0 is returned. If there's no such string in the trie, -EINVAL is
+    returned. */
 int nn_trie_unsubscribe (struct nn_trie *self, const uint8_t *data,
     size_t size);
 
@@ -112,6 +141,11 @@ int nn_trie_unsubscribe (struct nn_trie *self, const uint8_t *data,
     it returns 0. */
 int nn_trie_match (struct nn_trie *self, const uint8_t *data, size_t size);
 
+/*  If mass unsubscription left most of the slab memory unused, relocates
+    all the nodes to fresh chunks in depth-first order and releases the old
+    ones. Returns 1 if the compaction was done, 0 if it wasn't worth it. */
+int nn_trie_compact (struct nn_trie *self);
+
 /*  Debugging interface. */
 void nn_trie_dump (struct nn_trie *self);
 
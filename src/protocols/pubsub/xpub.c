@@ -62,6 +62,10 @@ static void nn_xpub_in (struct nn_sockbase *self, struct nn_pipe *pipe);
 static void nn_xpub_out (struct nn_sockbase *self, struct nn_pipe *pipe);
 static int nn_xpub_events (struct nn_sockbase *self);
 static int nn_xpub_send (struct nn_sockbase *self, struct nn_msg *msg);
+static int nn_xpub_setopt (struct nn_sockbase *self, int level, int option,
+    const void *optval, size_t optvallen);
+static int nn_xpub_getopt (struct nn_sockbase *self, int level, int option,
+    void *optval, size_t *optvallen);
 static const struct nn_sockbase_vfptr nn_xpub_sockbase_vfptr = {
     NULL,
     nn_xpub_destroy,
@@ -72,15 +76,15 @@ static const struct nn_sockbase_vfptr nn_xpub_sockbase_vfptr = {
     nn_xpub_events,
     nn_xpub_send,
     NULL,
-    NULL,
-    NULL
+    nn_xpub_setopt,
+    nn_xpub_getopt
 };
 
 static void nn_xpub_init (struct nn_xpub *self,
     const struct nn_sockbase_vfptr *vfptr, void *hint)
 {
     nn_sockbase_init (&self->sockbase, vfptr, hint);
-    nn_dist_init (&self->outpipes);
+    nn_dist_init (&self->outpipes, &self->sockbase);
 }
 
 static void nn_xpub_term (struct nn_xpub *self)
@@ -156,6 +160,109 @@ static int nn_xpub_send (struct nn_sockbase *self, struct nn_msg *msg)
         msg, NULL);
 }
 
+static int nn_xpub_setopt (struct nn_sockbase *self, int level, int option,
+    const void *optval, size_t optvallen)
+{
+    struct nn_xpub *xpub;
+    int val;
+
+    xpub = nn_cont (self, struct nn_xpub, sockbase);
+
+    if (level != NN_PUB)
+        return -ENOPROTOOPT;
+
+    if (nn_slow (optvallen != sizeof (int)))
+        return -EINVAL;
+    val = *(int*) optval;
+
+    switch (option) {
+    case NN_PUB_QUEUE_LEN:
+        if (nn_slow (val < 0))
+            return -EINVAL;
+        xpub->outpipes.qlen = val;
+        return 0;
+    case NN_PUB_OVERFLOW:
+        switch (val) {
+        case NN_PUB_DROP_NEWEST:
+            xpub->outpipes.policy = NN_DIST_DROP_NEWEST;
+            return 0;
+        case NN_PUB_DROP_OLDEST:
+            xpub->outpipes.policy = NN_DIST_DROP_OLDEST;
+            return 0;
+        case NN_PUB_DISCONNECT:
+            xpub->outpipes.policy = NN_DIST_DISCONNECT;
+            return 0;
+        default:
+            return -EINVAL;
+        }
+    case NN_PUB_MAX_DROPS:
+        if (nn_slow (val < 1))
+            return -EINVAL;
+        xpub->outpipes.maxdrops = val;
+        return 0;
+    case NN_PUB_CONFLATE:
+        if (nn_slow (val < 0))
+            return -EINVAL;
+        return nn_dist_setkeylen (&xpub->outpipes, (size_t) val);
+    case NN_PUB_LAST_VALUE:
+        nn_dist_setlastvalue (&xpub->outpipes, val ? 1 : 0);
+        return 0;
+    }
+
+    return -ENOPROTOOPT;
+}
+
+static int nn_xpub_getopt (struct nn_sockbase *self, int level, int option,
+    void *optval, size_t *optvallen)
+{
+    struct nn_xpub *xpub;
+    int val;
+
+    xpub = nn_cont (self, struct nn_xpub, sockbase);
+
+    if (level != NN_PUB)
+        return -ENOPROTOOPT;
+
+    switch (option) {
+    case NN_PUB_QUEUE_LEN:
+        val = xpub->outpipes.qlen;
+        break;
+    case NN_PUB_OVERFLOW:
+        switch (xpub->outpipes.policy) {
+        case NN_DIST_DROP_OLDEST:
+            val = NN_PUB_DROP_OLDEST;
+            break;
+        case NN_DIST_DISCONNECT:
+            val = NN_PUB_DISCONNECT;
+            break;
+        default:
+            val = NN_PUB_DROP_NEWEST;
+            break;
+        }
+        break;
+    case NN_PUB_MAX_DROPS:
+        val = xpub->outpipes.maxdrops;
+        break;
+    case NN_PUB_CONFLATE:
+        val = (int) xpub->outpipes.keylen;
+        break;
+    case NN_PUB_LAST_VALUE:
+        val = xpub->outpipes.lastvalue;
+        break;
+    case NN_PUB_PIPE_STATS:
+        nn_dist_getstats (&xpub->outpipes, optval, optvallen);
+        return 0;
+    default:
+        return -ENOPROTOOPT;
+    }
+
+    if (nn_slow (*optvallen < sizeof (int)))
+        return -EINVAL;
+    *(int*) optval = val;
+    *optvallen = sizeof (int);
+    return 0;
+}
+
 int nn_xpub_create (void *hint, struct nn_sockbase **sockbase)
 {
     struct nn_xpub *self;
@@ -24,6 +24,7 @@
 
 #include "xsub.h"
 #include "trie.h"
+#include "topicset.h"
 
 #include "../../nn.h"
 #include "../../pubsub.h"
@@ -35,6 +36,7 @@
 #include "../../utils/fast.h"
 #include "../../utils/alloc.h"
 #include "../../utils/attr.h"
+#include "../../utils/wire.h"
 
 struct nn_xsub_data {
     struct nn_fq_data fq;
@@ -43,13 +45,25 @@ struct nn_xsub_data {
 struct nn_xsub {
     struct nn_sockbase sockbase;
     struct nn_fq fq;
+
+    /*  Length of the topics in exact-match mode. If zero, the subscriptions
+        are prefixes stored in the trie. Otherwise they are stored in the
+        topic set. */
+    int topic_len;
     struct nn_trie trie;
+    struct nn_topicset topicset;
 };
 
 /*  Private functions. */
 static void nn_xsub_init (struct nn_xsub *self,
     const struct nn_sockbase_vfptr *vfptr, void *hint);
 static void nn_xsub_term (struct nn_xsub *self);
+static int nn_xsub_subscribe (struct nn_xsub *self, const uint8_t *data,
+    size_t size);
+static int nn_xsub_unsubscribe (struct nn_xsub *self, const uint8_t *data,
+    size_t size);
+static int nn_xsub_match (struct nn_xsub *self, const uint8_t *data,
+    size_t size);
 
 /*  Implementation of nn_sockbase's virtual functions. */
 static void nn_xsub_destroy (struct nn_sockbase *self);
@@ -61,6 +75,10 @@ static int nn_xsub_events (struct nn_sockbase *self);
 static int nn_xsub_recv (struct nn_sockbase *self, struct nn_msg *msg);
 static int nn_xsub_setopt (struct nn_sockbase *self, int level, int option,
     const void *optval, size_t optvallen);
+static int nn_xsub_getopt (struct nn_sockbase *self, int level, int option,
+    void *optval, size_t *optvallen);
+static int nn_xsub_check_bulk (struct nn_xsub *self, const uint8_t *buf,
+    size_t len);
 static const struct nn_sockbase_vfptr nn_xsub_sockbase_vfptr = {
     NULL,
     nn_xsub_destroy,
@@ -72,7 +90,7 @@ static const struct nn_sockbase_vfptr nn_xsub_sockbase_vfptr = {
     NULL,
     nn_xsub_recv,
     nn_xsub_setopt,
-    NULL
+    nn_xsub_getopt
 };
 
 static void nn_xsub_init (struct nn_xsub *self,
@@ -80,12 +98,16 @@ static void nn_xsub_init (struct nn_xsub *self,
 {
     nn_sockbase_init (&self->sockbase, vfptr, hint);
     nn_fq_init (&self->fq);
+    self->topic_len = 0;
     nn_trie_init (&self->trie);
 }
 
 static void nn_xsub_term (struct nn_xsub *self)
 {
-    nn_trie_term (&self->trie);
+    if (self->topic_len)
+        nn_topicset_term (&self->topicset);
+    else
+        nn_trie_term (&self->trie);
     nn_fq_term (&self->fq);
     nn_sockbase_term (&self->sockbase);
 }
@@ -171,7 +193,7 @@ static int nn_xsub_recv (struct nn_sockbase *self, struct nn_msg *msg)
         if (nn_slow (rc == -EAGAIN))
             return -EAGAIN;
         errnum_assert (rc >= 0, -rc);
-        rc = nn_trie_match (&xsub->trie, nn_chunkref_data (&msg->body),
+        rc = nn_xsub_match (xsub, nn_chunkref_data (&msg->body),
             nn_chunkref_size (&msg->body));
         if (rc == 0) {
             nn_msg_term (msg);
@@ -187,7 +209,10 @@ static int nn_xsub_setopt (struct nn_sockbase *self, int level, int option,
         const void *optval, size_t optvallen)
 {
     int rc;
+    int val;
     struct nn_xsub *xsub;
+    const uint8_t *pos;
+    size_t sz;
 
     xsub = nn_cont (self, struct nn_xsub, sockbase);
 
@@ -195,22 +220,193 @@ static int nn_xsub_setopt (struct nn_sockbase *self, int level, int option,
         return -ENOPROTOOPT;
 
     if (option == NN_SUB_SUBSCRIBE) {
-        rc = nn_trie_subscribe (&xsub->trie, optval, optvallen);
+        rc = nn_xsub_subscribe (xsub, optval, optvallen);
         if (rc >= 0)
             return 0;
         return rc;
     }
 
     if (option == NN_SUB_UNSUBSCRIBE) {
-        rc = nn_trie_unsubscribe (&xsub->trie, optval, optvallen);
+        rc = nn_xsub_unsubscribe (xsub, optval, optvallen);
+        if (!xsub->topic_len)
+            nn_trie_compact (&xsub->trie);
         if (rc >= 0)
             return 0;
         return rc;
     }
 
+    if (option == NN_SUB_SUBSCRIBE_BULK) {
+        rc = nn_xsub_check_bulk (xsub, optval, optvallen);
+        if (nn_slow (rc < 0))
+            return rc;
+        pos = optval;
+        while (optvallen) {
+            sz = nn_getl (pos);
+            rc = nn_xsub_subscribe (xsub, pos + 4, sz);
+            errnum_assert (rc >= 0, -rc);
+            pos += 4 + sz;
+            optvallen -= 4 + sz;
+        }
+        return 0;
+    }
+
+    if (option == NN_SUB_UNSUBSCRIBE_BULK) {
+        rc = nn_xsub_check_bulk (xsub, optval, optvallen);
+        if (nn_slow (rc < 0))
+            return rc;
+
+        pos = optval;
+        while (optvallen) {
+            sz = nn_getl (pos);
+            rc = nn_xsub_unsubscribe (xsub, pos + 4, sz);
+            errnum_assert (rc >= 0, -rc);
+            pos += 4 + sz;
+            optvallen -= 4 + sz;
+        }
+        if (!xsub->topic_len)
+            nn_trie_compact (&xsub->trie);
+        return 0;
+    }
+
+    if (option == NN_SUB_EXACT_TOPIC_LEN) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        val = *(int*) optval;
+        if (nn_slow (val < 0 || val > NN_TOPICSET_KEYLEN_MAX))
+            return -EINVAL;
+
+        /*  The mode can't be switched while there are subscriptions. */
+        if (nn_slow (xsub->topic_len ? xsub->topicset.items != 0 :
+              xsub->trie.root != NULL))
+            return -EINVAL;
+
+        if (xsub->topic_len)
+            nn_topicset_term (&xsub->topicset);
+        else
+            nn_trie_term (&xsub->trie);
+        xsub->topic_len = val;
+        if (xsub->topic_len)
+            nn_topicset_init (&xsub->topicset, xsub->topic_len);
+        else
+            nn_trie_init (&xsub->trie);
+        return 0;
+    }
+
+    if (option == NN_SUB_BURST) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        return nn_fq_setburst (&xsub->fq, *(int*) optval);
+    }
+
+    if (option == NN_SUB_BURST_BYTES) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        return nn_fq_setburstbytes (&xsub->fq, *(int*) optval);
+    }
+
+    return -ENOPROTOOPT;
+}
+
+static int nn_xsub_getopt (struct nn_sockbase *self, int level, int option,
+        void *optval, size_t *optvallen)
+{
+    struct nn_xsub *xsub;
+
+    xsub = nn_cont (self, struct nn_xsub, sockbase);
+
+    if (level != NN_SUB)
+        return -ENOPROTOOPT;
+
+    if (option == NN_SUB_EXACT_TOPIC_LEN) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = xsub->topic_len;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    if (option == NN_SUB_BURST) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = xsub->fq.burst;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    if (option == NN_SUB_BURST_BYTES) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = (int) xsub->fq.burst_bytes;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    if (option == NN_SUB_PIPE_STATS) {
+        nn_fq_getstats (&xsub->fq, optval, optvallen);
+        return 0;
+    }
+
     return -ENOPROTOOPT;
 }
 
+static int nn_xsub_subscribe (struct nn_xsub *self, const uint8_t *data,
+    size_t size)
+{
+    if (self->topic_len)
+        return nn_topicset_subscribe (&self->topicset, data, size);
+    return nn_trie_subscribe (&self->trie, data, size);
+}
+
+static int nn_xsub_unsubscribe (struct nn_xsub *self, const uint8_t *data,
+    size_t size)
+{
+    int rc;
+
+    if (self->topic_len) {
+        if (nn_slow (size != (size_t) self->topic_len))
+            return -EINVAL;
+        rc = nn_topicset_unsubscribe (&self->topicset, data, size);
+    }
+    else
+        rc = nn_trie_unsubscribe (&self->trie, data, size);
+
+    /*  Unsubscribing from a topic that is not subscribed is a no-op. */
+    if (rc == -EINVAL)
+        return 0;
+    return rc;
+}
+
+static int nn_xsub_match (struct nn_xsub *self, const uint8_t *data,
+    size_t size)
+{
+    if (self->topic_len)
+        return nn_topicset_match (&self->topicset, data, size);
+    return nn_trie_match (&self->trie, data, size);
+}
+
+static int nn_xsub_check_bulk (struct nn_xsub *self, const uint8_t *buf,
+    size_t len)
+{
+    /*  Checks that the buffer consists of a sequence of topics, each of them
+        preceded by its size as a 32-bit integer in network byte order. In
+        exact-match mode all the topics must be of the configured length. */
+
+    size_t sz;
+
+    while (len) {
+        if (nn_slow (len < 4))
+            return -EINVAL;
+        sz = nn_getl (buf);
+        if (nn_slow (sz > len - 4))
+            return -EINVAL;
+        if (nn_slow (self->topic_len && sz != (size_t) self->topic_len))
+            return -EINVAL;
+        buf += 4 + sz;
+        len -= 4 + sz;
+    }
+    return 0;
+}
+
 int nn_xsub_create (void *hint, struct nn_sockbase **sockbase)
 {
     struct nn_xsub *self;
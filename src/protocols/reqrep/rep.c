@@ -29,14 +29,21 @@
 #include "../../utils/err.h"
 #include "../../utils/cont.h"
 #include "../../utils/alloc.h"
+#include "../../utils/chunk.h"
 #include "../../utils/chunkref.h"
 #include "../../utils/wire.h"
+#include "../../utils/thread.h"
 
 #include <stddef.h>
 #include <string.h>
 
 #define NN_REP_INPROGRESS 1
 
+/*  Type of the empty ancillary property nn_rep_recvctx appends to the
+    context. It tells a reply sent with nn_rep_sendctx apart from a reply
+    that merely carries an SP_HDR property. Not a part of the public API. */
+#define NN_REP_CTX 0x7fff
+
 static const struct nn_sockbase_vfptr nn_rep_sockbase_vfptr = {
     NULL,
     nn_rep_destroy,
@@ -47,8 +54,8 @@ static const struct nn_sockbase_vfptr nn_rep_sockbase_vfptr = {
     nn_rep_events,
     nn_rep_send,
     nn_rep_recv,
-    NULL,
-    NULL
+    nn_xrep_setopt,
+    nn_xrep_getopt
 };
 
 void nn_rep_init (struct nn_rep *self,
@@ -87,6 +94,22 @@ int nn_rep_events (struct nn_sockbase *self)
     return events;
 }
 
+/*  Returns 1 if the message was sent with a context, i.e. its ancillary
+    data ends with the property appended by nn_rep_recvctx. */
+static int nn_rep_isctx (struct nn_msg *msg)
+{
+    size_t sz;
+    struct nn_cmsghdr *cmsg;
+
+    sz = nn_chunkref_size (&msg->hdrs);
+    if (sz < NN_CMSG_SPACE (0))
+        return 0;
+    cmsg = (struct nn_cmsghdr*) ((char*) nn_chunkref_data (&msg->hdrs) +
+        sz - NN_CMSG_SPACE (0));
+    return cmsg->cmsg_len == NN_CMSG_SPACE (0) &&
+        cmsg->cmsg_level == PROTO_SP && cmsg->cmsg_type == NN_REP_CTX;
+}
+
 int nn_rep_send (struct nn_sockbase *self, struct nn_msg *msg)
 {
     int rc;
@@ -94,12 +117,31 @@ int nn_rep_send (struct nn_sockbase *self, struct nn_msg *msg)
 
     rep = nn_cont (self, struct nn_rep, xrep.sockbase);
 
+    /*  The reply carries a context, i.e. it is answering a request received
+        via nn_rep_recvctx. Such a reply may arrive at any time and from any
+        thread. If it happens to answer the request currently in progress,
+        that request is done. */
+    if (nn_chunkref_size (&msg->sphdr) != 0 && nn_rep_isctx (msg)) {
+        if ((rep->flags & NN_REP_INPROGRESS) &&
+              nn_chunkref_size (&msg->sphdr) ==
+              nn_chunkref_size (&rep->backtrace) &&
+              memcmp (nn_chunkref_data (&msg->sphdr),
+              nn_chunkref_data (&rep->backtrace),
+              nn_chunkref_size (&msg->sphdr)) == 0) {
+            nn_chunkref_term (&rep->backtrace);
+            rep->flags &= ~NN_REP_INPROGRESS;
+        }
+        rc = nn_xrep_send (&rep->xrep.sockbase, msg);
+        errnum_assert (rc == 0 || rc == -EAGAIN, -rc);
+        return 0;
+    }
+
     /*  If no request was received, there's nowhere to send the reply to. */
     if (nn_slow (!(rep->flags & NN_REP_INPROGRESS)))
         return -EFSM;
 
-    /*  Move the stored backtrace into the message header. */
-    nn_assert (nn_chunkref_size (&msg->sphdr) == 0);
+    /*  Move the stored backtrace into the message header, replacing any
+        SP_HDR property supplied by the user. */
     nn_chunkref_term (&msg->sphdr);
     nn_chunkref_mv (&msg->sphdr, &rep->backtrace);
     rep->flags &= ~NN_REP_INPROGRESS;
@@ -131,9 +173,9 @@ int nn_rep_recv (struct nn_sockbase *self, struct nn_msg *msg)
         return -EAGAIN;
     errnum_assert (rc == 0, -rc);
 
-    /*  Store the backtrace. */
-    nn_chunkref_mv (&rep->backtrace, &msg->sphdr);
-    nn_chunkref_init (&msg->sphdr, 0);
+    /*  Store the backtrace. A copy is left in the message so that the user
+        can get hold of it as the SP_HDR property and reply later on. */
+    nn_chunkref_cp (&rep->backtrace, &msg->sphdr);
     rep->flags |= NN_REP_INPROGRESS;
 
     return 0;
@@ -158,3 +200,158 @@ struct nn_socktype nn_rep_socktype = {
     nn_rep_create,
     nn_xrep_ispeer,
 };
+
+int nn_rep_recvctx (int s, void **ctx, void *buf, size_t len, int flags)
+{
+    int rc;
+    int err;
+    size_t sz;
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+    struct nn_cmsghdr *cmsg;
+
+    /*  The context is the control chunk holding the request's backtrace. */
+    iov.iov_base = buf;
+    iov.iov_len = len;
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = ctx;
+    hdr.msg_controllen = NN_MSG;
+    rc = nn_recvmsg (s, &hdr, flags);
+    if (nn_slow (rc < 0))
+        return rc;
+
+    /*  Mark the chunk as a context. */
+    sz = nn_chunk_size (*ctx);
+    err = nn_chunk_realloc (sz + NN_CMSG_SPACE (0), ctx);
+    errnum_assert (err == 0, -err);
+    cmsg = (struct nn_cmsghdr*) ((char*) *ctx + sz);
+    cmsg->cmsg_len = NN_CMSG_SPACE (0);
+    cmsg->cmsg_level = PROTO_SP;
+    cmsg->cmsg_type = NN_REP_CTX;
+
+    return rc;
+}
+
+int nn_rep_sendctx (int s, void *ctx, const void *buf, size_t len, int flags)
+{
+    int rc;
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+
+    if (nn_slow (!ctx)) {
+        errno = EFAULT;
+        return -1;
+    }
+
+    iov.iov_base = (void*) buf;
+    iov.iov_len = len;
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = ctx;
+    hdr.msg_controllen = nn_chunk_size (ctx);
+    rc = nn_sendmsg (s, &hdr, flags);
+
+    /*  On failure the context stays valid so that the send can be retried. */
+    if (nn_fast (rc >= 0))
+        nn_chunk_free (ctx);
+    return rc;
+}
+
+void nn_rep_freectx (void *ctx)
+{
+    if (ctx)
+        nn_chunk_free (ctx);
+}
+
+/*  Returns 1 if the failed call can be simply retried. Any other error means
+    that the socket is unusable, so retrying would only spin. */
+static int nn_rep_retry (int err)
+{
+    return err == EAGAIN || err == EINTR || err == ETIMEDOUT;
+}
+
+struct nn_rep_worker {
+    int s;
+    nn_rep_fn *fn;
+    void *arg;
+    int err;
+    struct nn_thread thread;
+};
+
+static void nn_rep_worker_routine (void *arg)
+{
+    int rc;
+    struct nn_rep_worker *self;
+    int err;
+    void *ctx;
+    void *req;
+    void *rep;
+
+    self = (struct nn_rep_worker*) arg;
+
+    while (1) {
+        rc = nn_rep_recvctx (self->s, &ctx, &req, NN_MSG, 0);
+        if (nn_slow (rc < 0)) {
+            if (nn_rep_retry (errno))
+                continue;
+            break;
+        }
+
+        rep = NULL;
+        rc = self->fn (self->arg, req, (size_t) rc, &rep);
+        nn_freemsg (req);
+        if (rc < 0 || !rep) {
+            nn_rep_freectx (ctx);
+            continue;
+        }
+
+        rc = nn_rep_sendctx (self->s, ctx, &rep, NN_MSG, 0);
+        if (nn_slow (rc < 0)) {
+            err = errno;
+            nn_freemsg (rep);
+            nn_rep_freectx (ctx);
+            errno = err;
+            if (!nn_rep_retry (errno))
+                break;
+        }
+    }
+
+    self->err = errno;
+}
+
+int nn_rep_serve (int s, int nthreads, nn_rep_fn *fn, void *arg)
+{
+    int i;
+    int err;
+    struct nn_rep_worker *workers;
+
+    if (nn_slow (nthreads < 1 || !fn)) {
+        errno = EINVAL;
+        return -1;
+    }
+
+    workers = nn_alloc (sizeof (struct nn_rep_worker) * nthreads,
+        "rep workers");
+    alloc_assert (workers);
+    for (i = 0; i != nthreads; ++i) {
+        workers [i].s = s;
+        workers [i].fn = fn;
+        workers [i].arg = arg;
+        workers [i].err = 0;
+    }
+
+    /*  The calling thread is one of the workers. */
+    for (i = 1; i < nthreads; ++i)
+        nn_thread_init (&workers [i].thread, nn_rep_worker_routine,
+            &workers [i]);
+    nn_rep_worker_routine (&workers [0]);
+    for (i = 1; i < nthreads; ++i)
+        nn_thread_term (&workers [i].thread);
+
+    err = workers [0].err;
+    nn_free (workers);
+
+    errno = err;
+    return -1;
+}
@@ -36,6 +36,7 @@
 #include "../../utils/random.h"
 #include "../../utils/wire.h"
 #include "../../utils/attr.h"
+#include "../../utils/clock.h"
 
 #include <stddef.h>
 #include <string.h>
@@ -52,6 +53,7 @@
 #define NN_REQ_STATE_STOPPING_TIMER 7
 #define NN_REQ_STATE_DONE 8
 #define NN_REQ_STATE_STOPPING 9
+#define NN_REQ_STATE_HEDGING 10
 
 #define NN_REQ_ACTION_START 1
 #define NN_REQ_ACTION_IN 2
@@ -61,6 +63,31 @@
 #define NN_REQ_ACTION_PIPE_RM 6
 
 #define NN_REQ_SRC_RESEND_TIMER 1
+#define NN_REQ_SRC_CTX_TIMER 2
+
+#define NN_REQ_CTX_STATE_DELAYED 1
+#define NN_REQ_CTX_STATE_ACTIVE 2
+#define NN_REQ_CTX_STATE_TIMED_OUT 3
+#define NN_REQ_CTX_STATE_STOPPING_TIMER 4
+#define NN_REQ_CTX_STATE_DONE 5
+
+/*  Number of latency samples needed before the hedging delay is derived
+    from them. */
+#define NN_REQ_HEDGE_MIN_SAMPLES 16
+
+/*  Private functions. */
+static int nn_req_hedge_delay (struct nn_req *self);
+static void nn_req_record (struct nn_req *self, struct nn_pipe *pipe,
+    uint64_t latency);
+static int nn_req_gethandle (struct nn_msg *msg, nn_req_handle *hndl);
+static void nn_req_ctx_start (struct nn_req *self, struct nn_msg *msg,
+    nn_req_handle hndl);
+static void nn_req_ctx_send (struct nn_req *self, struct nn_req_ctx *ctx);
+static void nn_req_ctx_reply (struct nn_req *self, struct nn_req_ctx *ctx,
+    struct nn_msg *reply, struct nn_pipe *from);
+static void nn_req_ctx_handler (struct nn_req *self, struct nn_req_ctx *ctx,
+    int type);
+static void nn_req_ctx_destroy (struct nn_req *self, struct nn_req_ctx *ctx);
 
 static const struct nn_sockbase_vfptr nn_req_sockbase_vfptr = {
     nn_req_stop,
@@ -89,20 +116,37 @@ void nn_req_init (struct nn_req *self,
     nn_random_generate (&self->lastid, sizeof (self->lastid));
 
     self->task.sent_to = NULL;
+    self->task.hedged_to = NULL;
+    self->task.hedge = 0;
 
     nn_msg_init (&self->task.request, 0);
     nn_msg_init (&self->task.reply, 0);
     nn_timer_init (&self->task.timer, NN_REQ_SRC_RESEND_TIMER, &self->fsm);
     self->resend_ivl = NN_REQ_DEFAULT_RESEND_IVL;
+    self->hedge_ivl = 0;
+    self->hedge_percentile = 0;
+    self->nlatencies = 0;
 
     nn_task_init (&self->task, self->lastid);
 
+    nn_hash_init (&self->ctxs);
+    nn_list_init (&self->contexts);
+    nn_list_init (&self->delayed);
+    nn_list_init (&self->done);
+
     /*  Start the state machine. */
     nn_fsm_start (&self->fsm);
 }
 
 void nn_req_term (struct nn_req *self)
 {
+    while (!nn_list_empty (&self->contexts))
+        nn_req_ctx_destroy (self, nn_cont (nn_list_begin (&self->contexts),
+            struct nn_req_ctx, item));
+    nn_list_term (&self->done);
+    nn_list_term (&self->delayed);
+    nn_list_term (&self->contexts);
+    nn_hash_term (&self->ctxs);
     nn_timer_term (&self->task.timer);
     nn_task_term (&self->task);
     nn_msg_term (&self->task.reply);
@@ -142,6 +186,9 @@ void nn_req_in (struct nn_sockbase *self, struct nn_pipe *pipe)
 {
     int rc;
     struct nn_req *req;
+    struct nn_msg reply;
+    struct nn_pipe *from;
+    struct nn_hash_item *item;
     uint32_t reqid;
 
     req = nn_cont (self, struct nn_req, xreq.sockbase);
@@ -152,52 +199,67 @@ void nn_req_in (struct nn_sockbase *self, struct nn_pipe *pipe)
     while (1) {
 
         /*  Get new reply. */
-        rc = nn_xreq_recv (&req->xreq.sockbase, &req->task.reply);
+        rc = nn_xreq_recv_from (&req->xreq.sockbase, &reply, &from);
         if (nn_slow (rc == -EAGAIN))
             return;
         errnum_assert (rc == 0, -rc);
 
-        /*  No request was sent. Getting a reply doesn't make sense. */
-        if (nn_slow (!nn_req_inprogress (req))) {
-            nn_msg_term (&req->task.reply);
-            continue;
-        }
-
         /*  Ignore malformed replies. */
-        if (nn_slow (nn_chunkref_size (&req->task.reply.sphdr) !=
-              sizeof (uint32_t))) {
-            nn_msg_term (&req->task.reply);
+        if (nn_slow (nn_chunkref_size (&reply.sphdr) != sizeof (uint32_t))) {
+            nn_msg_term (&reply);
             continue;
         }
 
         /*  Ignore replies with incorrect request IDs. */
-        reqid = nn_getl (nn_chunkref_data (&req->task.reply.sphdr));
+        reqid = nn_getl (nn_chunkref_data (&reply.sphdr));
         if (nn_slow (!(reqid & 0x80000000))) {
-            nn_msg_term (&req->task.reply);
+            nn_msg_term (&reply);
+            continue;
+        }
+
+        /*  Trim the request ID. */
+        nn_chunkref_term (&reply.sphdr);
+        nn_chunkref_init (&reply.sphdr, 0);
+
+        /*  Reply to a request sent by nn_req_send. */
+        if (reqid != (req->task.id | 0x80000000)) {
+            item = nn_hash_get (&req->ctxs, reqid & 0x7fffffff);
+            if (nn_slow (!item)) {
+                nn_msg_term (&reply);
+                continue;
+            }
+            nn_req_ctx_reply (req, nn_cont (item, struct nn_req_ctx,
+                hashitem), &reply, from);
             continue;
         }
-        if (nn_slow (reqid != (req->task.id | 0x80000000))) {
-            nn_msg_term (&req->task.reply);
+
+        /*  The request is not waiting for a reply. This is also the case
+            of the slower of the two replies to a hedged request. */
+        if (nn_slow (req->state != NN_REQ_STATE_ACTIVE &&
+              req->state != NN_REQ_STATE_HEDGING)) {
+            nn_msg_term (&reply);
             continue;
         }
 
-        /*  Trim the request ID. */
-        nn_chunkref_term (&req->task.reply.sphdr);
-        nn_chunkref_init (&req->task.reply.sphdr, 0);
+        nn_msg_term (&req->task.reply);
+        nn_msg_mv (&req->task.reply, &reply);
 
         /*  TODO: Deallocate the request here? */
 
-        /*  Notify the state machine. */
-        if (req->state == NN_REQ_STATE_ACTIVE)
-            nn_fsm_action (&req->fsm, NN_REQ_ACTION_IN);
+        /*  Remember how long it took the peer to reply. */
+        nn_req_record (req, from, nn_clock_us () -
+            (from == req->task.hedged_to ?
+            req->task.hedged_at : req->task.sent_at));
 
-        return;
+        /*  Notify the state machine. */
+        nn_fsm_action (&req->fsm, NN_REQ_ACTION_IN);
     }
 }
 
 void nn_req_out (struct nn_sockbase *self, struct nn_pipe *pipe)
 {
     struct nn_req *req;
+    struct nn_req_ctx *ctx;
 
     req = nn_cont (self, struct nn_req, xreq.sockbase);
 
@@ -207,6 +269,15 @@ void nn_req_out (struct nn_sockbase *self, struct nn_pipe *pipe)
     /*  Notify the state machine. */
     if (req->state == NN_REQ_STATE_DELAYED)
         nn_fsm_action (&req->fsm, NN_REQ_ACTION_OUT);
+
+    /*  Send the requests that are waiting for a pipe. */
+    while (!nn_list_empty (&req->delayed) &&
+          nn_lb_can_send (&req->xreq.lb)) {
+        ctx = nn_cont (nn_list_begin (&req->delayed), struct nn_req_ctx,
+            queue);
+        nn_list_erase (&req->delayed, &ctx->queue);
+        nn_req_ctx_send (req, ctx);
+    }
 }
 
 int nn_req_events (struct nn_sockbase *self)
@@ -221,7 +292,7 @@ int nn_req_events (struct nn_sockbase *self)
     rc = NN_SOCKBASE_EVENT_OUT;
 
     /*  In DONE state the reply is stored in 'reply' field. */
-    if (req->state == NN_REQ_STATE_DONE)
+    if (req->state == NN_REQ_STATE_DONE || !nn_list_empty (&req->done))
         rc |= NN_SOCKBASE_EVENT_IN;
 
     return rc;
@@ -230,13 +301,20 @@ int nn_req_events (struct nn_sockbase *self)
 int nn_req_csend (struct nn_sockbase *self, struct nn_msg *msg)
 {
     struct nn_req *req;
+    nn_req_handle hndl;
 
     req = nn_cont (self, struct nn_req, xreq.sockbase);
 
+    /*  Requests carrying a handle don't affect the current request. */
+    if (nn_req_gethandle (msg, &hndl)) {
+        nn_req_ctx_start (req, msg, hndl);
+        return 0;
+    }
+
     /*  Generate new request ID for the new request and put it into message
         header. The most important bit is set to 1 to indicate that this is
         the bottom of the backtrace stack. */
-    ++req->task.id;
+    req->task.id = ++req->lastid;
     nn_assert (nn_chunkref_size (&msg->sphdr) == 0);
     nn_chunkref_term (&msg->sphdr);
     nn_chunkref_init (&msg->sphdr, 4);
@@ -255,11 +333,30 @@ int nn_req_csend (struct nn_sockbase *self, struct nn_msg *msg)
 int nn_req_crecv (struct nn_sockbase *self, struct nn_msg *msg)
 {
     struct nn_req *req;
+    struct nn_req_ctx *ctx;
+    struct nn_cmsghdr *cmsg;
 
     req = nn_cont (self, struct nn_req, xreq.sockbase);
 
+    /*  Pass a reply to a request sent by nn_req_send, along with the handle
+        the request was sent with. */
+    if (req->state != NN_REQ_STATE_DONE && !nn_list_empty (&req->done)) {
+        ctx = nn_cont (nn_list_begin (&req->done), struct nn_req_ctx, queue);
+        nn_msg_mv (msg, &ctx->task.reply);
+        nn_msg_init (&ctx->task.reply, 0);
+        nn_chunkref_term (&msg->hdrs);
+        nn_chunkref_init (&msg->hdrs, NN_CMSG_SPACE (sizeof (ctx->hndl)));
+        cmsg = nn_chunkref_data (&msg->hdrs);
+        cmsg->cmsg_len = NN_CMSG_LEN (sizeof (ctx->hndl));
+        cmsg->cmsg_level = NN_REQ;
+        cmsg->cmsg_type = NN_REQ_HANDLE;
+        memcpy (NN_CMSG_DATA (cmsg), &ctx->hndl, sizeof (ctx->hndl));
+        nn_req_ctx_destroy (req, ctx);
+        return 0;
+    }
+
     /*  No request was sent. Waiting for a reply doesn't make sense. */
-    if (nn_slow (!nn_req_inprogress (req)))
+    if (nn_slow (!nn_req_inprogress (req) && nn_list_empty (&req->contexts)))
         return -EFSM;
 
     /*  If reply was not yet recieved, wait further. */
@@ -293,7 +390,25 @@ int nn_req_setopt (struct nn_sockbase *self, int level, int option,
         return 0;
     }
 
-    return -ENOPROTOOPT;
+    if (option == NN_REQ_HEDGE_IVL) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        if (nn_slow (*(int*) optval < 0))
+            return -EINVAL;
+        req->hedge_ivl = *(int*) optval;
+        return 0;
+    }
+
+    if (option == NN_REQ_HEDGE_PERCENTILE) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        if (nn_slow (*(int*) optval < 0 || *(int*) optval > 100))
+            return -EINVAL;
+        req->hedge_percentile = *(int*) optval;
+        return 0;
+    }
+
+    return nn_xreq_setopt (self, level, option, optval, optvallen);
 }
 
 int nn_req_getopt (struct nn_sockbase *self, int level, int option,
@@ -314,23 +429,50 @@ int nn_req_getopt (struct nn_sockbase *self, int level, int option,
         return 0;
     }
 
-    return -ENOPROTOOPT;
+    if (option == NN_REQ_HEDGE_IVL) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = req->hedge_ivl;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    if (option == NN_REQ_HEDGE_PERCENTILE) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = req->hedge_percentile;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    return nn_xreq_getopt (self, level, option, optval, optvallen);
 }
 
 void nn_req_shutdown (struct nn_fsm *self, int src, int type,
     NN_UNUSED void *srcptr)
 {
     struct nn_req *req;
+    struct nn_list_item *it;
 
     req = nn_cont (self, struct nn_req, fsm);
 
     if (nn_slow (src == NN_FSM_ACTION && type == NN_FSM_STOP)) {
         nn_timer_stop (&req->task.timer);
+        for (it = nn_list_begin (&req->contexts);
+              it != nn_list_end (&req->contexts);
+              it = nn_list_next (&req->contexts, it))
+            nn_timer_stop (&nn_cont (it, struct nn_req_ctx, item)->task.timer);
         req->state = NN_REQ_STATE_STOPPING;
     }
     if (nn_slow (req->state == NN_REQ_STATE_STOPPING)) {
         if (!nn_timer_isidle (&req->task.timer))
             return;
+        for (it = nn_list_begin (&req->contexts);
+              it != nn_list_end (&req->contexts);
+              it = nn_list_next (&req->contexts, it))
+            if (!nn_timer_isidle (&nn_cont (it, struct nn_req_ctx,
+                  item)->task.timer))
+                return;
         req->state = NN_REQ_STATE_IDLE;
         nn_fsm_stopped_noevent (&req->fsm);
         nn_sockbase_stopped (&req->xreq.sockbase);
@@ -341,12 +483,19 @@ void nn_req_shutdown (struct nn_fsm *self, int src, int type,
 }
 
 void nn_req_handler (struct nn_fsm *self, int src, int type,
-    NN_UNUSED void *srcptr)
+    void *srcptr)
 {
     struct nn_req *req;
 
     req = nn_cont (self, struct nn_req, fsm);
 
+    /*  Requests sent by nn_req_send have state machines of their own. */
+    if (src == NN_REQ_SRC_CTX_TIMER) {
+        nn_req_ctx_handler (req, nn_cont (srcptr, struct nn_req_ctx,
+            task.timer), type);
+        return;
+    }
+
     switch (req->state) {
 
 /******************************************************************************/
@@ -425,9 +574,14 @@ void nn_req_handler (struct nn_fsm *self, int src, int type,
             switch (type) {
             case NN_REQ_ACTION_IN:
 
-                /*  Reply arrived. */
+                /*  Reply arrived. A late reply from the other pipe, if the
+                    request was hedged, will be ignored. */
                 nn_timer_stop (&req->task.timer);
+                nn_xreq_done (&req->xreq.sockbase, req->task.sent_to);
+                if (req->task.hedged_to)
+                    nn_xreq_done (&req->xreq.sockbase, req->task.hedged_to);
                 req->task.sent_to = NULL;
+                req->task.hedged_to = NULL;
                 req->state = NN_REQ_STATE_STOPPING_TIMER;
                 return;
 
@@ -436,7 +590,11 @@ void nn_req_handler (struct nn_fsm *self, int src, int type,
                 /*  New request was sent while the old one was still being
                     processed. Cancel the old request first. */
                 nn_timer_stop (&req->task.timer);
+                nn_xreq_done (&req->xreq.sockbase, req->task.sent_to);
+                if (req->task.hedged_to)
+                    nn_xreq_done (&req->xreq.sockbase, req->task.hedged_to);
                 req->task.sent_to = NULL;
+                req->task.hedged_to = NULL;
                 req->state = NN_REQ_STATE_CANCELLING;
                 return;
 
@@ -444,6 +602,7 @@ void nn_req_handler (struct nn_fsm *self, int src, int type,
                 /*  Pipe that we sent request to is removed  */
                 nn_timer_stop (&req->task.timer);
                 req->task.sent_to = NULL;
+                req->task.hedged_to = NULL;
                 /*  Pretend we timed out so request resent immediately  */
                 req->state = NN_REQ_STATE_TIMED_OUT;
                 return;
@@ -456,7 +615,78 @@ void nn_req_handler (struct nn_fsm *self, int src, int type,
             switch (type) {
             case NN_TIMER_TIMEOUT:
                 nn_timer_stop (&req->task.timer);
+
+                /*  No reply arrived in time. Send the request to a second
+                    pipe and wait for whichever replies first. */
+                if (req->task.hedge) {
+                    nn_req_action_hedge (req);
+                    req->state = NN_REQ_STATE_HEDGING;
+                    return;
+                }
+
+                /*  Count the time waited as a latency sample so that
+                    the unresponsive peer is avoided from now on. */
+                nn_xreq_sample (&req->xreq.sockbase, req->task.sent_to,
+                    nn_clock_us () - req->task.sent_at);
+                nn_xreq_done (&req->xreq.sockbase, req->task.sent_to);
+                if (req->task.hedged_to) {
+                    nn_xreq_sample (&req->xreq.sockbase, req->task.hedged_to,
+                        nn_clock_us () - req->task.hedged_at);
+                    nn_xreq_done (&req->xreq.sockbase, req->task.hedged_to);
+                }
                 req->task.sent_to = NULL;
+                req->task.hedged_to = NULL;
+                req->state = NN_REQ_STATE_TIMED_OUT;
+                return;
+            default:
+                nn_fsm_bad_action (req->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (req->state, src, type);
+        }
+
+/******************************************************************************/
+/*  HEDGING state.                                                            */
+/*  The request was sent to a second pipe. Waiting till the timer is         */
+/*  stopped so that it can be restarted for the rest of the resend interval. */
+/******************************************************************************/
+    case NN_REQ_STATE_HEDGING:
+        switch (src) {
+
+        case NN_REQ_SRC_RESEND_TIMER:
+            switch (type) {
+            case NN_TIMER_STOPPED:
+                nn_timer_start (&req->task.timer,
+                    req->resend_ivl - req->task.hedge);
+                req->task.hedge = 0;
+                req->state = NN_REQ_STATE_ACTIVE;
+                return;
+            default:
+                nn_fsm_bad_action (req->state, src, type);
+            }
+
+        case NN_FSM_ACTION:
+            switch (type) {
+            case NN_REQ_ACTION_IN:
+                nn_xreq_done (&req->xreq.sockbase, req->task.sent_to);
+                if (req->task.hedged_to)
+                    nn_xreq_done (&req->xreq.sockbase, req->task.hedged_to);
+                req->task.sent_to = NULL;
+                req->task.hedged_to = NULL;
+                req->state = NN_REQ_STATE_STOPPING_TIMER;
+                return;
+            case NN_REQ_ACTION_SENT:
+                nn_xreq_done (&req->xreq.sockbase, req->task.sent_to);
+                if (req->task.hedged_to)
+                    nn_xreq_done (&req->xreq.sockbase, req->task.hedged_to);
+                req->task.sent_to = NULL;
+                req->task.hedged_to = NULL;
+                req->state = NN_REQ_STATE_CANCELLING;
+                return;
+            case NN_REQ_ACTION_PIPE_RM:
+                req->task.sent_to = NULL;
+                req->task.hedged_to = NULL;
                 req->state = NN_REQ_STATE_TIMED_OUT;
                 return;
             default:
@@ -623,9 +853,18 @@ void nn_req_action_send (struct nn_req *self, int allow_delay)
         in case the request gets lost somewhere further out
         in the topology. */
     if (nn_fast (rc == 0)) {
-        nn_timer_start (&self->task.timer, self->resend_ivl);
+
+        /*  If hedging is on, wake up early to send the request to a second
+            pipe unless the request is going to be re-sent by then anyway. */
+        self->task.hedge = nn_req_hedge_delay (self);
+        if (self->task.hedge >= self->resend_ivl)
+            self->task.hedge = 0;
+        nn_timer_start (&self->task.timer,
+            self->task.hedge ? self->task.hedge : self->resend_ivl);
         nn_assert (to);
         self->task.sent_to = to;
+        self->task.sent_at = nn_clock_us ();
+        self->task.hedged_to = NULL;
         self->state = NN_REQ_STATE_ACTIVE;
         return;
     }
@@ -634,6 +873,258 @@ void nn_req_action_send (struct nn_req *self, int allow_delay)
     errnum_assert (0, -rc);
 }
 
+void nn_req_action_hedge (struct nn_req *self)
+{
+    int rc;
+    struct nn_msg msg;
+    struct nn_pipe *to;
+
+    /*  Send a copy of the request to a pipe other than the one it was already
+        sent to. If there's none, just keep waiting for the reply. Both
+        copies carry the same request ID so whichever reply comes second
+        is dropped. */
+    nn_msg_cp (&msg, &self->task.request);
+    rc = nn_xreq_send_other (&self->xreq.sockbase, &msg, self->task.sent_to,
+        &to);
+    if (nn_slow (rc == -EAGAIN)) {
+        nn_msg_term (&msg);
+        return;
+    }
+    errnum_assert (rc == 0, -rc);
+    self->task.hedged_to = to;
+    self->task.hedged_at = nn_clock_us ();
+}
+
+/*  Returns the delay, in milliseconds, after which the request is sent to
+    a second pipe, or zero if the request is not to be hedged. */
+static int nn_req_hedge_delay (struct nn_req *self)
+{
+    uint64_t sorted [NN_REQ_HEDGE_WINDOW];
+    uint64_t latency;
+    int count;
+    int rank;
+    int i;
+    int j;
+
+    /*  Without enough latency samples, use the fixed delay. */
+    if (!self->hedge_percentile ||
+          self->nlatencies < NN_REQ_HEDGE_MIN_SAMPLES)
+        return self->hedge_ivl;
+
+    /*  Sort the recent latencies. The window is small, so insertion sort
+        does the job. */
+    count = self->nlatencies < NN_REQ_HEDGE_WINDOW ?
+        self->nlatencies : NN_REQ_HEDGE_WINDOW;
+    for (i = 0; i != count; ++i) {
+        latency = self->latencies [i];
+        for (j = i; j > 0 && sorted [j - 1] > latency; --j)
+            sorted [j] = sorted [j - 1];
+        sorted [j] = latency;
+    }
+
+    /*  Pick the sample at the requested percentile (nearest-rank method)
+        and round it up to whole milliseconds. */
+    rank = (count * self->hedge_percentile + 99) / 100;
+    if (rank < 1)
+        rank = 1;
+    return (int) ((sorted [rank - 1] + 999) / 1000);
+}
+
+/*  Feeds the reply latency to the load balancer and to the window the
+    hedging delay is computed from. */
+static void nn_req_record (struct nn_req *self, struct nn_pipe *pipe,
+    uint64_t latency)
+{
+    nn_xreq_sample (&self->xreq.sockbase, pipe, latency);
+    self->latencies [self->nlatencies % NN_REQ_HEDGE_WINDOW] = latency;
+    ++self->nlatencies;
+    if (self->nlatencies == 2 * NN_REQ_HEDGE_WINDOW)
+        self->nlatencies = NN_REQ_HEDGE_WINDOW;
+}
+
+/*  Looks for NN_REQ_HANDLE property among the message's ancillary data.
+    Returns 1 if found, 0 otherwise. */
+static int nn_req_gethandle (struct nn_msg *msg, nn_req_handle *hndl)
+{
+    uint8_t *data;
+    size_t sz;
+    size_t pos;
+    struct nn_cmsghdr *cmsg;
+
+    data = nn_chunkref_data (&msg->hdrs);
+    sz = nn_chunkref_size (&msg->hdrs);
+    pos = 0;
+    while (pos + NN_CMSG_SPACE (0) <= sz) {
+        cmsg = (struct nn_cmsghdr*) (data + pos);
+        if (nn_slow (cmsg->cmsg_len < NN_CMSG_LEN (0) ||
+              pos + NN_CMSG_ALIGN_ (cmsg->cmsg_len) > sz))
+            return 0;
+        if (cmsg->cmsg_level == NN_REQ && cmsg->cmsg_type == NN_REQ_HANDLE &&
+              cmsg->cmsg_len == NN_CMSG_LEN (sizeof (*hndl))) {
+            memcpy (hndl, NN_CMSG_DATA (cmsg), sizeof (*hndl));
+            return 1;
+        }
+        pos += NN_CMSG_ALIGN_ (cmsg->cmsg_len);
+    }
+    return 0;
+}
+
+static void nn_req_ctx_start (struct nn_req *self, struct nn_msg *msg,
+    nn_req_handle hndl)
+{
+    struct nn_req_ctx *ctx;
+
+    ctx = nn_alloc (sizeof (struct nn_req_ctx), "request context (req)");
+    alloc_assert (ctx);
+    nn_task_init (&ctx->task, ++self->lastid);
+    ctx->hndl = hndl;
+
+    /*  Put the request ID into the header. The handle is of no use to
+        the peer, so drop it. */
+    nn_assert (nn_chunkref_size (&msg->sphdr) == 0);
+    nn_chunkref_term (&msg->sphdr);
+    nn_chunkref_init (&msg->sphdr, 4);
+    nn_putl (nn_chunkref_data (&msg->sphdr), ctx->task.id | 0x80000000);
+    nn_chunkref_term (&msg->hdrs);
+    nn_chunkref_init (&msg->hdrs, 0);
+
+    nn_msg_init (&ctx->task.request, 0);
+    nn_msg_mv (&ctx->task.request, msg);
+    nn_msg_init (&ctx->task.reply, 0);
+    nn_timer_init (&ctx->task.timer, NN_REQ_SRC_CTX_TIMER, &self->fsm);
+    ctx->task.sent_to = NULL;
+    ctx->task.hedged_to = NULL;
+    ctx->task.hedge = 0;
+
+    nn_hash_item_init (&ctx->hashitem);
+    nn_hash_insert (&self->ctxs, ctx->task.id & 0x7fffffff, &ctx->hashitem);
+    nn_list_item_init (&ctx->item);
+    nn_list_insert (&self->contexts, &ctx->item,
+        nn_list_end (&self->contexts));
+    nn_list_item_init (&ctx->queue);
+
+    nn_req_ctx_send (self, ctx);
+}
+
+static void nn_req_ctx_send (struct nn_req *self, struct nn_req_ctx *ctx)
+{
+    int rc;
+    struct nn_msg msg;
+    struct nn_pipe *to;
+
+    /*  If there's no pipe to send the request to, wait for one. */
+    nn_msg_cp (&msg, &ctx->task.request);
+    rc = nn_xreq_send_to (&self->xreq.sockbase, &msg, &to);
+    if (nn_slow (rc == -EAGAIN)) {
+        nn_msg_term (&msg);
+        nn_list_insert (&self->delayed, &ctx->queue,
+            nn_list_end (&self->delayed));
+        ctx->state = NN_REQ_CTX_STATE_DELAYED;
+        return;
+    }
+    errnum_assert (rc == 0, -rc);
+
+    nn_timer_start (&ctx->task.timer, self->resend_ivl);
+    ctx->task.sent_to = to;
+    ctx->task.sent_at = nn_clock_us ();
+    ctx->state = NN_REQ_CTX_STATE_ACTIVE;
+}
+
+static void nn_req_ctx_reply (struct nn_req *self, struct nn_req_ctx *ctx,
+    struct nn_msg *reply, struct nn_pipe *from)
+{
+    nn_hash_erase (&self->ctxs, &ctx->hashitem);
+    nn_msg_term (&ctx->task.reply);
+    nn_msg_mv (&ctx->task.reply, reply);
+
+    switch (ctx->state) {
+    case NN_REQ_CTX_STATE_ACTIVE:
+        nn_req_record (self, from, nn_clock_us () - ctx->task.sent_at);
+        nn_timer_stop (&ctx->task.timer);
+        nn_xreq_done (&self->xreq.sockbase, ctx->task.sent_to);
+        ctx->task.sent_to = NULL;
+        ctx->state = NN_REQ_CTX_STATE_STOPPING_TIMER;
+        return;
+
+    /*  The reply arrived just after the request timed out. */
+    case NN_REQ_CTX_STATE_TIMED_OUT:
+        ctx->state = NN_REQ_CTX_STATE_STOPPING_TIMER;
+        return;
+    case NN_REQ_CTX_STATE_DELAYED:
+        nn_list_erase (&self->delayed, &ctx->queue);
+        nn_list_insert (&self->done, &ctx->queue, nn_list_end (&self->done));
+        ctx->state = NN_REQ_CTX_STATE_DONE;
+        return;
+    default:
+        nn_fsm_bad_state (ctx->state, NN_REQ_SRC_CTX_TIMER, 0);
+    }
+}
+
+static void nn_req_ctx_handler (struct nn_req *self, struct nn_req_ctx *ctx,
+    int type)
+{
+    switch (ctx->state) {
+
+    /*  Request was sent. Waiting for reply. */
+    case NN_REQ_CTX_STATE_ACTIVE:
+        switch (type) {
+        case NN_TIMER_TIMEOUT:
+            nn_timer_stop (&ctx->task.timer);
+            nn_xreq_sample (&self->xreq.sockbase, ctx->task.sent_to,
+                nn_clock_us () - ctx->task.sent_at);
+            nn_xreq_done (&self->xreq.sockbase, ctx->task.sent_to);
+            ctx->task.sent_to = NULL;
+            ctx->state = NN_REQ_CTX_STATE_TIMED_OUT;
+            return;
+        default:
+            nn_fsm_bad_action (ctx->state, NN_REQ_SRC_CTX_TIMER, type);
+        }
+
+    /*  Waiting till the timer is stopped to re-send the request. */
+    case NN_REQ_CTX_STATE_TIMED_OUT:
+        switch (type) {
+        case NN_TIMER_STOPPED:
+            nn_req_ctx_send (self, ctx);
+            return;
+        default:
+            nn_fsm_bad_action (ctx->state, NN_REQ_SRC_CTX_TIMER, type);
+        }
+
+    /*  Reply arrived. Waiting till the timer is stopped. */
+    case NN_REQ_CTX_STATE_STOPPING_TIMER:
+        switch (type) {
+        case NN_TIMER_STOPPED:
+            nn_list_insert (&self->done, &ctx->queue,
+                nn_list_end (&self->done));
+            ctx->state = NN_REQ_CTX_STATE_DONE;
+            return;
+        default:
+            nn_fsm_bad_action (ctx->state, NN_REQ_SRC_CTX_TIMER, type);
+        }
+
+    default:
+        nn_fsm_bad_state (ctx->state, NN_REQ_SRC_CTX_TIMER, type);
+    }
+}
+
+static void nn_req_ctx_destroy (struct nn_req *self, struct nn_req_ctx *ctx)
+{
+    if (nn_list_item_isinlist (&ctx->queue))
+        nn_list_erase (ctx->state == NN_REQ_CTX_STATE_DELAYED ?
+            &self->delayed : &self->done, &ctx->queue);
+    if (nn_hash_item_isinhash (&ctx->hashitem))
+        nn_hash_erase (&self->ctxs, &ctx->hashitem);
+    nn_list_erase (&self->contexts, &ctx->item);
+    nn_list_item_term (&ctx->queue);
+    nn_list_item_term (&ctx->item);
+    nn_hash_item_term (&ctx->hashitem);
+    nn_timer_term (&ctx->task.timer);
+    nn_msg_term (&ctx->task.reply);
+    nn_msg_term (&ctx->task.request);
+    nn_task_term (&ctx->task);
+    nn_free (ctx);
+}
+
 static int nn_req_create (void *hint, struct nn_sockbase **sockbase)
 {
     struct nn_req *self;
@@ -648,10 +1139,39 @@ static int nn_req_create (void *hint, struct nn_sockbase **sockbase)
 
 void nn_req_rm (struct nn_sockbase *self, struct nn_pipe *pipe) {
     struct nn_req *req;
+    struct nn_req_ctx *ctx;
+    struct nn_list_item *it;
 
     req = nn_cont (self, struct nn_req, xreq.sockbase);
 
     nn_xreq_rm (self, pipe);
+
+    /*  Re-send the requests sent by nn_req_send to the pipe once their
+        timers are stopped. */
+    for (it = nn_list_begin (&req->contexts);
+          it != nn_list_end (&req->contexts);
+          it = nn_list_next (&req->contexts, it)) {
+        ctx = nn_cont (it, struct nn_req_ctx, item);
+        if (ctx->state == NN_REQ_CTX_STATE_ACTIVE &&
+              ctx->task.sent_to == pipe) {
+            nn_timer_stop (&ctx->task.timer);
+            ctx->task.sent_to = NULL;
+            ctx->state = NN_REQ_CTX_STATE_TIMED_OUT;
+        }
+    }
+
+    /*  If a hedged request is still waited for on the other pipe, there's
+        no need to re-send it. */
+    if (nn_slow (pipe == req->task.hedged_to)) {
+        req->task.hedged_to = NULL;
+        return;
+    }
+    if (nn_slow (pipe == req->task.sent_to && req->task.hedged_to)) {
+        req->task.sent_to = req->task.hedged_to;
+        req->task.sent_at = req->task.hedged_at;
+        req->task.hedged_to = NULL;
+        return;
+    }
     if (nn_slow (pipe == req->task.sent_to)) {
         nn_fsm_action (&req->fsm, NN_REQ_ACTION_PIPE_RM);
     }
@@ -664,3 +1184,62 @@ struct nn_socktype nn_req_socktype = {
     nn_req_create,
     nn_xreq_ispeer,
 };
+
+int nn_req_send (int s, nn_req_handle hndl, const void *buf, size_t len,
+    int flags)
+{
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+    struct nn_cmsghdr *cmsg;
+    size_t control [NN_CMSG_SPACE (sizeof (nn_req_handle)) / sizeof (size_t)];
+
+    /*  Pass the handle down to the socket as an ancillary property. */
+    memset (control, 0, sizeof (control));
+    cmsg = (struct nn_cmsghdr*) control;
+    cmsg->cmsg_len = NN_CMSG_LEN (sizeof (hndl));
+    cmsg->cmsg_level = NN_REQ;
+    cmsg->cmsg_type = NN_REQ_HANDLE;
+    memcpy (NN_CMSG_DATA (cmsg), &hndl, sizeof (hndl));
+
+    iov.iov_base = (void*) buf;
+    iov.iov_len = len;
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = control;
+    hdr.msg_controllen = sizeof (control);
+    return nn_sendmsg (s, &hdr, flags);
+}
+
+int nn_req_recv (int s, nn_req_handle *hndl, void *buf, size_t len,
+    int flags)
+{
+    int rc;
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+    struct nn_cmsghdr *cmsg;
+    size_t control [(NN_CMSG_SPACE (sizeof (size_t)) +
+        NN_CMSG_SPACE (sizeof (nn_req_handle))) / sizeof (size_t)];
+
+    memset (control, 0, sizeof (control));
+    iov.iov_base = buf;
+    iov.iov_len = len;
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = control;
+    hdr.msg_controllen = sizeof (control);
+    rc = nn_recvmsg (s, &hdr, flags);
+    if (nn_slow (rc < 0))
+        return rc;
+
+    /*  Replies to requests sent by nn_send come with no handle. */
+    memset (hndl, 0, sizeof (*hndl));
+    cmsg = NN_CMSG_FIRSTHDR (&hdr);
+    while (cmsg && cmsg->cmsg_len) {
+        if (cmsg->cmsg_level == NN_REQ && cmsg->cmsg_type == NN_REQ_HANDLE) {
+            memcpy (hndl, NN_CMSG_DATA (cmsg), sizeof (*hndl));
+            break;
+        }
+        cmsg = NN_CMSG_NXTHDR (&hdr, cmsg);
+    }
+    return rc;
+}
@@ -29,6 +29,35 @@
 
 #include "../../protocol.h"
 #include "../../aio/fsm.h"
+#include "../../utils/hash.h"
+#include "../../utils/list.h"
+
+/*  Number of recent reply latencies the hedging delay is computed from. */
+#define NN_REQ_HEDGE_WINDOW 64
+
+/*  A request sent by nn_req_send. Any number of these can be in progress
+    at the same time, independently of the request sent by nn_send. */
+struct nn_req_ctx {
+
+    /*  The request itself, with its own ID and re-send timer. */
+    struct nn_task task;
+    int state;
+
+    /*  User-supplied handle to return along with the reply. */
+    nn_req_handle hndl;
+
+    /*  The context is a member of nn_req's 'ctxs' hash, keyed by the request
+        ID, till the reply arrives. */
+    struct nn_hash_item hashitem;
+
+    /*  The context is a member of nn_req's 'contexts' list. */
+    struct nn_list_item item;
+
+    /*  While waiting for a pipe to become available the context is in
+        nn_req's 'delayed' list. Once the reply arrives it is in the 'done'
+        list till the user retrieves it. */
+    struct nn_list_item queue;
+};
 
 struct nn_req {
 
@@ -44,9 +73,21 @@ struct nn_req {
 
     /*  Protocol-specific socket options. */
     int resend_ivl;
+    int hedge_ivl;
+    int hedge_percentile;
+
+    /*  Ring buffer of the recent reply latencies, in microseconds. */
+    uint64_t latencies [NN_REQ_HEDGE_WINDOW];
+    int nlatencies;
 
     /*  The request being processed. */
     struct nn_task task;
+
+    /*  Requests sent by nn_req_send. */
+    struct nn_hash ctxs;
+    struct nn_list contexts;
+    struct nn_list delayed;
+    struct nn_list done;
 };
 
 /*  Some users may want to extend the REQ protocol similar to how REQ extends XREQ.
@@ -60,6 +101,7 @@ void nn_req_handler (struct nn_fsm *self, int src, int type,
 void nn_req_shutdown (struct nn_fsm *self, int src, int type,
     void *srcptr);
 void nn_req_action_send (struct nn_req *self, int allow_delay);
+void nn_req_action_hedge (struct nn_req *self);
 
 /*  Implementation of nn_sockbase's virtual functions. */
 void nn_req_stop (struct nn_sockbase *self);
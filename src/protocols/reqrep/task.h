@@ -48,6 +48,18 @@ struct nn_task {
     /*  Pipe the current request has been sent to. This is an optimisation so
         that request can be re-sent immediately if the pipe disappears.  */
     struct nn_pipe *sent_to;
+
+    /*  Time, in microseconds, the request was last sent at. */
+    uint64_t sent_at;
+
+    /*  If non-zero, the timer is set to expire after this many milliseconds
+        to send the request to a second pipe. */
+    int hedge;
+
+    /*  Pipe the request was sent to in addition to 'sent_to', if any, and
+        the time it was sent at. */
+    struct nn_pipe *hedged_to;
+    uint64_t hedged_at;
 };
 
 void nn_task_init (struct nn_task *self, uint32_t id);
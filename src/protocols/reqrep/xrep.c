@@ -49,8 +49,8 @@ static const struct nn_sockbase_vfptr nn_xrep_sockbase_vfptr = {
     nn_xrep_events,
     nn_xrep_send,
     nn_xrep_recv,
-    NULL,
-    NULL
+    nn_xrep_setopt,
+    nn_xrep_getopt
 };
 
 void nn_xrep_init (struct nn_xrep *self, const struct nn_sockbase_vfptr *vfptr,
@@ -259,6 +259,65 @@ int nn_xrep_recv (struct nn_sockbase *self, struct nn_msg *msg)
     return 0;
 }
 
+int nn_xrep_setopt (struct nn_sockbase *self, int level, int option,
+    const void *optval, size_t optvallen)
+{
+    struct nn_xrep *xrep;
+
+    xrep = nn_cont (self, struct nn_xrep, sockbase);
+
+    if (level != NN_REP)
+        return -ENOPROTOOPT;
+
+    if (option == NN_REP_BURST) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        return nn_fq_setburst (&xrep->inpipes, *(int*) optval);
+    }
+
+    if (option == NN_REP_BURST_BYTES) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        return nn_fq_setburstbytes (&xrep->inpipes, *(int*) optval);
+    }
+
+    return -ENOPROTOOPT;
+}
+
+int nn_xrep_getopt (struct nn_sockbase *self, int level, int option,
+    void *optval, size_t *optvallen)
+{
+    struct nn_xrep *xrep;
+
+    xrep = nn_cont (self, struct nn_xrep, sockbase);
+
+    if (level != NN_REP)
+        return -ENOPROTOOPT;
+
+    if (option == NN_REP_BURST) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = xrep->inpipes.burst;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    if (option == NN_REP_BURST_BYTES) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = (int) xrep->inpipes.burst_bytes;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    if (option == NN_REP_PIPE_STATS) {
+        nn_fq_getstats (&xrep->inpipes, optval, optvallen);
+        return 0;
+    }
+
+    return -ENOPROTOOPT;
+}
+
 static int nn_xrep_create (void *hint, struct nn_sockbase **sockbase)
 {
     struct nn_xrep *self;
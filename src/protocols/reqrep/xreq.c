@@ -50,8 +50,8 @@ static const struct nn_sockbase_vfptr nn_xreq_sockbase_vfptr = {
     nn_xreq_events,
     nn_xreq_send,
     nn_xreq_recv,
-    NULL,
-    NULL
+    nn_xreq_setopt,
+    nn_xreq_getopt
 };
 
 void nn_xreq_init (struct nn_xreq *self, const struct nn_sockbase_vfptr *vfptr,
@@ -175,15 +175,50 @@ int nn_xreq_send_to (struct nn_sockbase *self, struct nn_msg *msg,
     return 0;
 }
 
+int nn_xreq_send_other (struct nn_sockbase *self, struct nn_msg *msg,
+    struct nn_pipe *except, struct nn_pipe **to)
+{
+    int rc;
+
+    rc = nn_lb_send_other (&nn_cont (self, struct nn_xreq, sockbase)->lb,
+        msg, except, to);
+    if (nn_slow (rc == -EAGAIN))
+        return -EAGAIN;
+    errnum_assert (rc >= 0, -rc);
+
+    return 0;
+}
+
 int nn_xreq_recv (struct nn_sockbase *self, struct nn_msg *msg)
 {
     int rc;
+    struct nn_pipe *pipe;
+
+    rc = nn_xreq_recv_from (self, msg, &pipe);
+    if (nn_slow (rc < 0))
+        return rc;
 
-    rc = nn_fq_recv (&nn_cont (self, struct nn_xreq, sockbase)->fq, msg, NULL);
+    /*  Raw socket can't tell which request the reply belongs to, so any
+        reply means the peer has one request less to work on. */
+    nn_xreq_done (self, pipe);
+
+    return 0;
+}
+
+int nn_xreq_recv_from (struct nn_sockbase *self, struct nn_msg *msg,
+    struct nn_pipe **from)
+{
+    int rc;
+    struct nn_pipe *pipe;
+
+    rc = nn_fq_recv (&nn_cont (self, struct nn_xreq, sockbase)->fq, msg,
+        &pipe);
     if (rc == -EAGAIN)
         return -EAGAIN;
     errnum_assert (rc >= 0, -rc);
 
+    *from = pipe;
+
     if (!(rc & NN_PIPE_PARSED)) {
 
         /*  Ignore malformed replies. */
@@ -204,6 +239,83 @@ int nn_xreq_recv (struct nn_sockbase *self, struct nn_msg *msg)
     return 0;
 }
 
+int nn_xreq_setopt (struct nn_sockbase *self, int level, int option,
+    const void *optval, size_t optvallen)
+{
+    struct nn_xreq *xreq;
+
+    xreq = nn_cont (self, struct nn_xreq, sockbase);
+
+    if (level != NN_REQ)
+        return -ENOPROTOOPT;
+
+    if (option == NN_REQ_LB_POLICY) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        return nn_lb_setpolicy (&xreq->lb, *(int*) optval);
+    }
+
+    if (option == NN_REQ_EXPLORE) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        return nn_lb_setexplore (&xreq->lb, *(int*) optval);
+    }
+
+    return -ENOPROTOOPT;
+}
+
+int nn_xreq_getopt (struct nn_sockbase *self, int level, int option,
+    void *optval, size_t *optvallen)
+{
+    struct nn_xreq *xreq;
+
+    xreq = nn_cont (self, struct nn_xreq, sockbase);
+
+    if (level != NN_REQ)
+        return -ENOPROTOOPT;
+
+    if (option == NN_REQ_LB_POLICY) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = xreq->lb.policy;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    if (option == NN_REQ_EXPLORE) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = xreq->lb.explore;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
+    if (option == NN_REQ_PIPE_LOAD) {
+        nn_lb_getload (&xreq->lb, optval, optvallen);
+        return 0;
+    }
+
+    return -ENOPROTOOPT;
+}
+
+void nn_xreq_done (struct nn_sockbase *self, struct nn_pipe *pipe)
+{
+    struct nn_xreq_data *data;
+
+    data = nn_pipe_getdata (pipe);
+    nn_lb_done (&nn_cont (self, struct nn_xreq, sockbase)->lb, &data->lb);
+}
+
+void nn_xreq_sample (struct nn_sockbase *self, struct nn_pipe *pipe,
+    uint64_t latency)
+{
+    struct nn_xreq_data *data;
+
+    data = nn_pipe_getdata (pipe);
+    nn_lb_sample (&nn_cont (self, struct nn_xreq, sockbase)->lb, &data->lb,
+        latency);
+}
+
 static int nn_xreq_create (void *hint, struct nn_sockbase **sockbase)
 {
     struct nn_xreq *self;
@@ -47,8 +47,29 @@ int nn_xreq_events (struct nn_sockbase *self);
 int nn_xreq_send (struct nn_sockbase *self, struct nn_msg *msg);
 int nn_xreq_send_to (struct nn_sockbase *self, struct nn_msg *msg,
     struct nn_pipe **to);
+int nn_xreq_send_other (struct nn_sockbase *self, struct nn_msg *msg,
+    struct nn_pipe *except, struct nn_pipe **to);
 int nn_xreq_recv (struct nn_sockbase *self, struct nn_msg *msg);
 
+/*  Receives a reply and tells which pipe it came from. Unlike nn_xreq_recv
+    it doesn't call nn_xreq_done; the caller does so once it matched
+    the reply to an outstanding request. */
+int nn_xreq_recv_from (struct nn_sockbase *self, struct nn_msg *msg,
+    struct nn_pipe **from);
+int nn_xreq_setopt (struct nn_sockbase *self, int level, int option,
+    const void *optval, size_t optvallen);
+int nn_xreq_getopt (struct nn_sockbase *self, int level, int option,
+    void *optval, size_t *optvallen);
+
+/*  Tells the load balancer that no reply is expected for a request sent
+    to the pipe anymore. */
+void nn_xreq_done (struct nn_sockbase *self, struct nn_pipe *pipe);
+
+/*  Reports the time, in microseconds, it took the pipe to reply to
+    a request. */
+void nn_xreq_sample (struct nn_sockbase *self, struct nn_pipe *pipe,
+    uint64_t latency);
+
 int nn_xreq_ispeer (int socktype);
 
 #endif
@@ -36,6 +36,8 @@
 #include "../../utils/alloc.h"
 #include "../../utils/random.h"
 #include "../../utils/attr.h"
+#include "../../utils/hash.h"
+#include "../../utils/list.h"
 
 #include <string.h>
 
@@ -47,14 +49,52 @@
 #define NN_SURVEYOR_STATE_CANCELLING 4
 #define NN_SURVEYOR_STATE_STOPPING_TIMER 5
 #define NN_SURVEYOR_STATE_STOPPING 6
+#define NN_SURVEYOR_STATE_COMPLETING 7
 
 #define NN_SURVEYOR_ACTION_START 1
 #define NN_SURVEYOR_ACTION_CANCEL 2
+#define NN_SURVEYOR_ACTION_DONE 3
 
 #define NN_SURVEYOR_SRC_DEADLINE_TIMER 1
+#define NN_SURVEYOR_SRC_CTX_TIMER 2
+
+#define NN_SURVEYOR_CTX_STATE_ACTIVE 1
+#define NN_SURVEYOR_CTX_STATE_STOPPING_TIMER 2
 
 #define NN_SURVEYOR_TIMEDOUT 1
 
+/*  Bit of the survey ID distinguishing surveys sent by nn_survey_send. */
+#define NN_SURVEYOR_CTXID 0x40000000
+
+/*  A survey sent by nn_survey_send. Any number of these can be in progress
+    at the same time, independently of the survey sent by nn_send. */
+struct nn_surveyor_ctx {
+
+    /*  Survey ID of this survey. */
+    uint32_t surveyid;
+
+    /*  The state machine. It is driven by the surveyor's one. */
+    int state;
+
+    /*  User-supplied handle to return along with the responses. */
+    nn_survey_handle hndl;
+
+    /*  Number of responses after which the survey is complete and the number
+        of responses received so far. */
+    int quorum;
+    int responses;
+
+    /*  Timer for timing out the survey. */
+    struct nn_timer timer;
+
+    /*  The context is a member of nn_surveyor's 'ctxs' hash, keyed by the
+        survey ID, till the survey is complete. */
+    struct nn_hash_item hashitem;
+
+    /*  The context is a member of nn_surveyor's 'contexts' list. */
+    struct nn_list_item item;
+};
+
 struct nn_surveyor {
 
     /*  The underlying raw SP socket. */
@@ -64,9 +104,15 @@ struct nn_surveyor {
     struct nn_fsm fsm;
     int state;
 
-    /*  Survey ID of the current survey. */
+    /*  Survey ID of the current survey sent by nn_send. */
     uint32_t surveyid;
 
+    /*  Last survey IDs assigned to the surveys sent by nn_send and to
+        the ones sent by nn_survey_send. The latter have NN_SURVEYOR_CTXID
+        bit set so that the two sequences never collide. */
+    uint32_t lastid;
+    uint32_t lastctxid;
+
     /*  Timer for timing out the survey. */
     struct nn_timer timer;
 
@@ -75,9 +121,19 @@ struct nn_surveyor {
 
     /*  Protocol-specific socket options. */
     int deadline;
+    int quorum;
+
+    /*  Number of responses to the current survey received so far. */
+    int responses;
 
     /*  Flag if surveyor has timed out */
     int timedout;
+
+    /*  Surveys sent by nn_survey_send, and the number of them that are still
+        accepting responses. */
+    struct nn_hash ctxs;
+    struct nn_list contexts;
+    int nctxs;
 };
 
 /*  Private functions. */
@@ -90,6 +146,15 @@ static void nn_surveyor_shutdown (struct nn_fsm *self, int src, int type,
     void *srcptr);
 static int nn_surveyor_inprogress (struct nn_surveyor *self);
 static void nn_surveyor_resend (struct nn_surveyor *self);
+static int nn_surveyor_gethandle (struct nn_msg *msg, nn_survey_handle *hndl);
+static void nn_surveyor_ctx_start (struct nn_surveyor *self,
+    struct nn_msg *msg, nn_survey_handle hndl);
+static void nn_surveyor_ctx_done (struct nn_surveyor *self,
+    struct nn_surveyor_ctx *ctx);
+static void nn_surveyor_ctx_handler (struct nn_surveyor *self,
+    struct nn_surveyor_ctx *ctx, int type);
+static void nn_surveyor_ctx_destroy (struct nn_surveyor *self,
+    struct nn_surveyor_ctx *ctx);
 
 /*  Implementation of nn_sockbase's virtual functions. */
 static void nn_surveyor_stop (struct nn_sockbase *self);
@@ -125,19 +190,32 @@ static void nn_surveyor_init (struct nn_surveyor *self,
 
     /*  Start assigning survey IDs beginning with a random number. This way
         there should be no key clashes even if the executable is re-started. */
-    nn_random_generate (&self->surveyid, sizeof (self->surveyid));
+    nn_random_generate (&self->lastid, sizeof (self->lastid));
+    nn_random_generate (&self->lastctxid, sizeof (self->lastctxid));
+    self->surveyid = 0;
 
     nn_timer_init (&self->timer, NN_SURVEYOR_SRC_DEADLINE_TIMER, &self->fsm);
     nn_msg_init (&self->tosend, 0);
     self->deadline = NN_SURVEYOR_DEFAULT_DEADLINE;
+    self->quorum = 0;
+    self->responses = 0;
     self->timedout = 0;
 
+    nn_hash_init (&self->ctxs);
+    nn_list_init (&self->contexts);
+    self->nctxs = 0;
+
     /*  Start the state machine. */
     nn_fsm_start (&self->fsm);
 }
 
 static void nn_surveyor_term (struct nn_surveyor *self)
 {
+    while (!nn_list_empty (&self->contexts))
+        nn_surveyor_ctx_destroy (self, nn_cont (nn_list_begin (
+            &self->contexts), struct nn_surveyor_ctx, item));
+    nn_list_term (&self->contexts);
+    nn_hash_term (&self->ctxs);
     nn_msg_term (&self->tosend);
     nn_timer_term (&self->timer);
     nn_fsm_term (&self->fsm);
@@ -168,7 +246,8 @@ static int nn_surveyor_inprogress (struct nn_surveyor *self)
     /*  Return 1 if there's a survey going on. 0 otherwise. */
     return self->state == NN_SURVEYOR_STATE_IDLE ||
         self->state == NN_SURVEYOR_STATE_PASSIVE ||
-        self->state == NN_SURVEYOR_STATE_STOPPING ? 0 : 1;
+        self->state == NN_SURVEYOR_STATE_STOPPING ||
+        self->state == NN_SURVEYOR_STATE_COMPLETING ? 0 : 1;
 }
 
 static int nn_surveyor_events (struct nn_sockbase *self)
@@ -183,7 +262,7 @@ static int nn_surveyor_events (struct nn_sockbase *self)
 
     /*  If there's no survey going on we'll signal IN to interrupt polling
         when the survey expires. nn_recv() will return -EFSM afterwards. */
-    if (!nn_surveyor_inprogress (surveyor))
+    if (!nn_surveyor_inprogress (surveyor) && surveyor->nctxs == 0)
         rc |= NN_SOCKBASE_EVENT_IN;
 
     return rc;
@@ -192,17 +271,29 @@ static int nn_surveyor_events (struct nn_sockbase *self)
 static int nn_surveyor_send (struct nn_sockbase *self, struct nn_msg *msg)
 {
     struct nn_surveyor *surveyor;
+    nn_survey_handle hndl;
 
     surveyor = nn_cont (self, struct nn_surveyor, xsurveyor.sockbase);
 
-    /*  Generate new survey ID. */
-    ++surveyor->surveyid;
-    surveyor->surveyid |= 0x80000000;
-
-    /*  Tag the survey body with survey ID. */
+    /*  Surveys sent by nn_survey_send don't cancel the one in progress.
+        They get IDs of their own so that the ID of the survey in progress
+        is left intact. */
     nn_assert (nn_chunkref_size (&msg->sphdr) == 0);
     nn_chunkref_term (&msg->sphdr);
     nn_chunkref_init (&msg->sphdr, 4);
+    if (nn_surveyor_gethandle (msg, &hndl)) {
+        ++surveyor->lastctxid;
+        surveyor->lastctxid |= 0x80000000 | NN_SURVEYOR_CTXID;
+        nn_putl (nn_chunkref_data (&msg->sphdr), surveyor->lastctxid);
+        nn_surveyor_ctx_start (surveyor, msg, hndl);
+        return 0;
+    }
+
+    /*  Generate new survey ID and tag the survey body with it. */
+    ++surveyor->lastid;
+    surveyor->lastid |= 0x80000000;
+    surveyor->lastid &= ~NN_SURVEYOR_CTXID;
+    surveyor->surveyid = surveyor->lastid;
     nn_putl (nn_chunkref_data (&msg->sphdr), surveyor->surveyid);
 
     /*  Store the survey, so that it can be sent later on. */
@@ -235,6 +326,9 @@ static int nn_surveyor_recv (struct nn_sockbase *self, struct nn_msg *msg)
     int rc;
     struct nn_surveyor *surveyor;
     uint32_t surveyid;
+    struct nn_hash_item *item;
+    struct nn_surveyor_ctx *ctx;
+    struct nn_cmsghdr *cmsg;
 
     surveyor = nn_cont (self, struct nn_surveyor, xsurveyor.sockbase);
 
@@ -243,7 +337,7 @@ static int nn_surveyor_recv (struct nn_sockbase *self, struct nn_msg *msg)
         if (surveyor->timedout == NN_SURVEYOR_TIMEDOUT) {
             surveyor->timedout = 0;
             return -ETIMEDOUT;
-        } else
+        } else if (surveyor->nctxs == 0)
             return -EFSM;
     }
 
@@ -260,8 +354,34 @@ static int nn_surveyor_recv (struct nn_sockbase *self, struct nn_msg *msg)
         if (nn_slow (nn_chunkref_size (&msg->sphdr) != sizeof (uint32_t)))
             continue;
         surveyid = nn_getl (nn_chunkref_data (&msg->sphdr));
-        if (nn_slow (surveyid != surveyor->surveyid))
-            continue;
+        if (surveyid == surveyor->surveyid &&
+              nn_surveyor_inprogress (surveyor)) {
+
+            /*  Once enough responses are received, the survey is complete. */
+            ++surveyor->responses;
+            if (surveyor->state == NN_SURVEYOR_STATE_ACTIVE &&
+                  surveyor->responses == surveyor->quorum)
+                nn_fsm_action (&surveyor->fsm, NN_SURVEYOR_ACTION_DONE);
+        }
+        else {
+
+            /*  Response to a survey sent by nn_survey_send. Pass the handle
+                the survey was sent with along with it. */
+            item = nn_hash_get (&surveyor->ctxs, surveyid & 0x7fffffff);
+            if (nn_slow (!item))
+                continue;
+            ctx = nn_cont (item, struct nn_surveyor_ctx, hashitem);
+            nn_chunkref_term (&msg->hdrs);
+            nn_chunkref_init (&msg->hdrs, NN_CMSG_SPACE (sizeof (ctx->hndl)));
+            cmsg = nn_chunkref_data (&msg->hdrs);
+            cmsg->cmsg_len = NN_CMSG_LEN (sizeof (ctx->hndl));
+            cmsg->cmsg_level = NN_SURVEYOR;
+            cmsg->cmsg_type = NN_SURVEYOR_HANDLE;
+            memcpy (NN_CMSG_DATA (cmsg), &ctx->hndl, sizeof (ctx->hndl));
+            ++ctx->responses;
+            if (ctx->responses == ctx->quorum)
+                nn_surveyor_ctx_done (surveyor, ctx);
+        }
 
         /*  Discard the header and return the message to the user. */
         nn_chunkref_term (&msg->sphdr);
@@ -289,6 +409,15 @@ static int nn_surveyor_setopt (struct nn_sockbase *self, int level, int option,
         return 0;
     }
 
+    if (option == NN_SURVEYOR_QUORUM) {
+        if (nn_slow (optvallen != sizeof (int)))
+            return -EINVAL;
+        if (nn_slow (*(int*) optval < 0))
+            return -EINVAL;
+        surveyor->quorum = *(int*) optval;
+        return 0;
+    }
+
     return -ENOPROTOOPT;
 }
 
@@ -310,6 +439,14 @@ static int nn_surveyor_getopt (struct nn_sockbase *self, int level, int option,
         return 0;
     }
 
+    if (option == NN_SURVEYOR_QUORUM) {
+        if (nn_slow (*optvallen < sizeof (int)))
+            return -EINVAL;
+        *(int*) optval = surveyor->quorum;
+        *optvallen = sizeof (int);
+        return 0;
+    }
+
     return -ENOPROTOOPT;
 }
 
@@ -317,16 +454,28 @@ static void nn_surveyor_shutdown (struct nn_fsm *self, int src, int type,
     NN_UNUSED void *srcptr)
 {
     struct nn_surveyor *surveyor;
+    struct nn_list_item *it;
 
     surveyor = nn_cont (self, struct nn_surveyor, fsm);
 
     if (nn_slow (src== NN_FSM_ACTION && type == NN_FSM_STOP)) {
         nn_timer_stop (&surveyor->timer);
+        for (it = nn_list_begin (&surveyor->contexts);
+              it != nn_list_end (&surveyor->contexts);
+              it = nn_list_next (&surveyor->contexts, it))
+            nn_timer_stop (&nn_cont (it, struct nn_surveyor_ctx,
+                item)->timer);
         surveyor->state = NN_SURVEYOR_STATE_STOPPING;
     }
     if (nn_slow (surveyor->state == NN_SURVEYOR_STATE_STOPPING)) {
         if (!nn_timer_isidle (&surveyor->timer))
             return;
+        for (it = nn_list_begin (&surveyor->contexts);
+              it != nn_list_end (&surveyor->contexts);
+              it = nn_list_next (&surveyor->contexts, it))
+            if (!nn_timer_isidle (&nn_cont (it, struct nn_surveyor_ctx,
+                  item)->timer))
+                return;
         surveyor->state = NN_SURVEYOR_STATE_IDLE;
         nn_fsm_stopped_noevent (&surveyor->fsm);
         nn_sockbase_stopped (&surveyor->xsurveyor.sockbase);
@@ -337,12 +486,19 @@ static void nn_surveyor_shutdown (struct nn_fsm *self, int src, int type,
 }
 
 static void nn_surveyor_handler (struct nn_fsm *self, int src, int type,
-    NN_UNUSED void *srcptr)
+    void *srcptr)
 {
     struct nn_surveyor *surveyor;
 
     surveyor = nn_cont (self, struct nn_surveyor, fsm);
 
+    /*  Surveys sent by nn_survey_send have state machines of their own. */
+    if (src == NN_SURVEYOR_SRC_CTX_TIMER) {
+        nn_surveyor_ctx_handler (surveyor, nn_cont (srcptr,
+            struct nn_surveyor_ctx, timer), type);
+        return;
+    }
+
     switch (surveyor->state) {
 
 /******************************************************************************/
@@ -401,6 +557,10 @@ static void nn_surveyor_handler (struct nn_fsm *self, int src, int type,
                 nn_timer_stop (&surveyor->timer);
                 surveyor->state = NN_SURVEYOR_STATE_CANCELLING;
                 return;
+            case NN_SURVEYOR_ACTION_DONE:
+                nn_timer_stop (&surveyor->timer);
+                surveyor->state = NN_SURVEYOR_STATE_COMPLETING;
+                return;
             default:
                 nn_fsm_bad_action (surveyor->state, src, type);
             }
@@ -480,6 +640,35 @@ static void nn_surveyor_handler (struct nn_fsm *self, int src, int type,
             nn_fsm_bad_source (surveyor->state, src, type);
         }
 
+/******************************************************************************/
+/*  COMPLETING state.                                                         */
+/*  Enough responses were received. Now we are stopping the timer.            */
+/******************************************************************************/
+    case NN_SURVEYOR_STATE_COMPLETING:
+        switch (src) {
+
+        case NN_FSM_ACTION:
+            switch (type) {
+            case NN_SURVEYOR_ACTION_START:
+                surveyor->state = NN_SURVEYOR_STATE_CANCELLING;
+                return;
+            default:
+                nn_fsm_bad_action (surveyor->state, src, type);
+            }
+
+        case NN_SURVEYOR_SRC_DEADLINE_TIMER:
+            switch (type) {
+            case NN_TIMER_STOPPED:
+                surveyor->state = NN_SURVEYOR_STATE_PASSIVE;
+                return;
+            default:
+                nn_fsm_bad_action (surveyor->state, src, type);
+            }
+
+        default:
+            nn_fsm_bad_source (surveyor->state, src, type);
+        }
+
 /******************************************************************************/
 /*  Invalid state.                                                            */
 /******************************************************************************/
@@ -496,6 +685,121 @@ static void nn_surveyor_resend (struct nn_surveyor *self)
     nn_msg_cp (&msg, &self->tosend);
     rc = nn_xsurveyor_send (&self->xsurveyor.sockbase, &msg);
     errnum_assert (rc == 0, -rc);
+    self->responses = 0;
+}
+
+/*  Looks for NN_SURVEYOR_HANDLE property among the message's ancillary data.
+    Returns 1 if found, 0 otherwise. */
+static int nn_surveyor_gethandle (struct nn_msg *msg, nn_survey_handle *hndl)
+{
+    uint8_t *data;
+    size_t sz;
+    size_t pos;
+    struct nn_cmsghdr *cmsg;
+
+    data = nn_chunkref_data (&msg->hdrs);
+    sz = nn_chunkref_size (&msg->hdrs);
+    pos = 0;
+    while (pos + NN_CMSG_SPACE (0) <= sz) {
+        cmsg = (struct nn_cmsghdr*) (data + pos);
+        if (nn_slow (cmsg->cmsg_len < NN_CMSG_LEN (0) ||
+              pos + NN_CMSG_ALIGN_ (cmsg->cmsg_len) > sz))
+            return 0;
+        if (cmsg->cmsg_level == NN_SURVEYOR &&
+              cmsg->cmsg_type == NN_SURVEYOR_HANDLE &&
+              cmsg->cmsg_len == NN_CMSG_LEN (sizeof (*hndl))) {
+            memcpy (hndl, NN_CMSG_DATA (cmsg), sizeof (*hndl));
+            return 1;
+        }
+        pos += NN_CMSG_ALIGN_ (cmsg->cmsg_len);
+    }
+    return 0;
+}
+
+static void nn_surveyor_ctx_start (struct nn_surveyor *self,
+    struct nn_msg *msg, nn_survey_handle hndl)
+{
+    int rc;
+    struct nn_surveyor_ctx *ctx;
+
+    ctx = nn_alloc (sizeof (struct nn_surveyor_ctx), "survey context");
+    alloc_assert (ctx);
+    ctx->surveyid = self->lastctxid;
+    ctx->hndl = hndl;
+    ctx->quorum = self->quorum;
+    ctx->responses = 0;
+    nn_timer_init (&ctx->timer, NN_SURVEYOR_SRC_CTX_TIMER, &self->fsm);
+    nn_hash_item_init (&ctx->hashitem);
+    nn_hash_insert (&self->ctxs, ctx->surveyid & 0x7fffffff, &ctx->hashitem);
+    nn_list_item_init (&ctx->item);
+    nn_list_insert (&self->contexts, &ctx->item,
+        nn_list_end (&self->contexts));
+    ++self->nctxs;
+
+    /*  The handle is of no use to the peers, so drop it. */
+    nn_chunkref_term (&msg->hdrs);
+    nn_chunkref_init (&msg->hdrs, 0);
+    rc = nn_xsurveyor_send (&self->xsurveyor.sockbase, msg);
+    errnum_assert (rc == 0, -rc);
+    nn_msg_init (msg, 0);
+
+    nn_timer_start (&ctx->timer, self->deadline);
+    ctx->state = NN_SURVEYOR_CTX_STATE_ACTIVE;
+}
+
+/*  The survey stops accepting responses, either because the deadline expired
+    or because the quorum was reached. */
+static void nn_surveyor_ctx_done (struct nn_surveyor *self,
+    struct nn_surveyor_ctx *ctx)
+{
+    nn_hash_erase (&self->ctxs, &ctx->hashitem);
+    --self->nctxs;
+    nn_timer_stop (&ctx->timer);
+    ctx->state = NN_SURVEYOR_CTX_STATE_STOPPING_TIMER;
+}
+
+static void nn_surveyor_ctx_handler (struct nn_surveyor *self,
+    struct nn_surveyor_ctx *ctx, int type)
+{
+    switch (ctx->state) {
+
+    /*  Survey was sent, waiting for responses. */
+    case NN_SURVEYOR_CTX_STATE_ACTIVE:
+        switch (type) {
+        case NN_TIMER_TIMEOUT:
+            nn_surveyor_ctx_done (self, ctx);
+            return;
+        default:
+            nn_fsm_bad_action (ctx->state, NN_SURVEYOR_SRC_CTX_TIMER, type);
+        }
+
+    /*  Survey is complete. Waiting till the timer is stopped. */
+    case NN_SURVEYOR_CTX_STATE_STOPPING_TIMER:
+        switch (type) {
+        case NN_TIMER_STOPPED:
+            nn_surveyor_ctx_destroy (self, ctx);
+            return;
+        default:
+            nn_fsm_bad_action (ctx->state, NN_SURVEYOR_SRC_CTX_TIMER, type);
+        }
+
+    default:
+        nn_fsm_bad_state (ctx->state, NN_SURVEYOR_SRC_CTX_TIMER, type);
+    }
+}
+
+static void nn_surveyor_ctx_destroy (struct nn_surveyor *self,
+    struct nn_surveyor_ctx *ctx)
+{
+    if (nn_hash_item_isinhash (&ctx->hashitem)) {
+        nn_hash_erase (&self->ctxs, &ctx->hashitem);
+        --self->nctxs;
+    }
+    nn_list_erase (&self->contexts, &ctx->item);
+    nn_list_item_term (&ctx->item);
+    nn_hash_item_term (&ctx->hashitem);
+    nn_timer_term (&ctx->timer);
+    nn_free (ctx);
 }
 
 static int nn_surveyor_create (void *hint, struct nn_sockbase **sockbase)
@@ -517,3 +821,64 @@ struct nn_socktype nn_surveyor_socktype = {
     nn_surveyor_create,
     nn_xsurveyor_ispeer,
 };
+
+int nn_survey_send (int s, nn_survey_handle hndl, const void *buf, size_t len,
+    int flags)
+{
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+    struct nn_cmsghdr *cmsg;
+    size_t control [NN_CMSG_SPACE (sizeof (nn_survey_handle)) /
+        sizeof (size_t)];
+
+    /*  Pass the handle down to the socket as an ancillary property. */
+    memset (control, 0, sizeof (control));
+    cmsg = (struct nn_cmsghdr*) control;
+    cmsg->cmsg_len = NN_CMSG_LEN (sizeof (hndl));
+    cmsg->cmsg_level = NN_SURVEYOR;
+    cmsg->cmsg_type = NN_SURVEYOR_HANDLE;
+    memcpy (NN_CMSG_DATA (cmsg), &hndl, sizeof (hndl));
+
+    iov.iov_base = (void*) buf;
+    iov.iov_len = len;
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = control;
+    hdr.msg_controllen = sizeof (control);
+    return nn_sendmsg (s, &hdr, flags);
+}
+
+int nn_survey_recv (int s, nn_survey_handle *hndl, void *buf, size_t len,
+    int flags)
+{
+    int rc;
+    struct nn_iovec iov;
+    struct nn_msghdr hdr;
+    struct nn_cmsghdr *cmsg;
+    size_t control [(NN_CMSG_SPACE (sizeof (size_t)) +
+        NN_CMSG_SPACE (sizeof (nn_survey_handle))) / sizeof (size_t)];
+
+    memset (control, 0, sizeof (control));
+    iov.iov_base = buf;
+    iov.iov_len = len;
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = control;
+    hdr.msg_controllen = sizeof (control);
+    rc = nn_recvmsg (s, &hdr, flags);
+    if (nn_slow (rc < 0))
+        return rc;
+
+    /*  Responses to the survey sent by nn_send come with no handle. */
+    memset (hndl, 0, sizeof (*hndl));
+    cmsg = NN_CMSG_FIRSTHDR (&hdr);
+    while (cmsg && cmsg->cmsg_len) {
+        if (cmsg->cmsg_level == NN_SURVEYOR &&
+              cmsg->cmsg_type == NN_SURVEYOR_HANDLE) {
+            memcpy (hndl, NN_CMSG_DATA (cmsg), sizeof (*hndl));
+            break;
+        }
+        cmsg = NN_CMSG_NXTHDR (&hdr, cmsg);
+    }
+    return rc;
+}
@@ -56,7 +56,7 @@ void nn_xsurveyor_init (struct nn_xsurveyor *self,
     const struct nn_sockbase_vfptr *vfptr, void *hint)
 {
     nn_sockbase_init (&self->sockbase, vfptr, hint);
-    nn_dist_init (&self->outpipes);
+    nn_dist_init (&self->outpipes, &self->sockbase);
     nn_fq_init (&self->inpipes);
 }
 
@@ -22,57 +22,202 @@
 
 #include "dist.h"
 
+#include "../../nn.h"
+
 #include "../../utils/err.h"
 #include "../../utils/cont.h"
 #include "../../utils/fast.h"
+#include "../../utils/alloc.h"
 #include "../../utils/attr.h"
 
 #include <stddef.h>
+#include <string.h>
+
+/*  Capacity of the last value cache, and of a conflating queue with no
+    length limit, when it's first allocated. */
+#define NN_DIST_CACHE_INITIAL 16
+
+/*  Private functions. */
+static void nn_dist_deliver (struct nn_dist *self, struct nn_dist_data *data,
+    struct nn_msg *msg);
+static int nn_dist_enqueue (struct nn_dist *self, struct nn_dist_data *data,
+    struct nn_msg *msg);
+static void nn_dist_remember (struct nn_dist *self, struct nn_msg *msg);
+static void nn_dist_drop (struct nn_dist *self, struct nn_dist_data *data,
+    struct nn_msg *msg);
+static void nn_dist_discard (struct nn_dist *self, struct nn_dist_data *data,
+    struct nn_msg *msg);
+static void nn_dist_clear (struct nn_dist *self, struct nn_dist_data *data);
+
+static void nn_dist_queue_init (struct nn_dist_queue *self);
+static void nn_dist_queue_term (struct nn_dist_queue *self);
+static void nn_dist_queue_reserve (struct nn_dist_queue *self,
+    size_t capacity, size_t keylen);
+static int nn_dist_queue_replace (struct nn_dist_queue *self,
+    struct nn_msg *msg, size_t keylen);
+static void nn_dist_queue_push (struct nn_dist_queue *self,
+    struct nn_msg *msg, size_t keylen);
+static void nn_dist_queue_pop (struct nn_dist_queue *self,
+    struct nn_msg *msg, size_t keylen);
+static void nn_dist_queue_unindex (struct nn_dist_queue *self, size_t pos,
+    size_t keylen);
+static uint32_t nn_dist_hash (struct nn_msg *msg, size_t keylen);
 
-void nn_dist_init (struct nn_dist *self)
+void nn_dist_init (struct nn_dist *self, struct nn_sockbase *sockbase)
 {
+    self->sockbase = sockbase;
     self->count = 0;
     nn_list_init (&self->pipes);
+    self->qlen = 0;
+    self->policy = NN_DIST_DROP_NEWEST;
+    self->maxdrops = 1;
+    self->keylen = 0;
+    self->lastvalue = 0;
+    nn_dist_queue_init (&self->cache);
 }
 
 void nn_dist_term (struct nn_dist *self)
 {
+    struct nn_msg msg;
+
     nn_assert (self->count == 0);
+    while (self->cache.depth) {
+        nn_dist_queue_pop (&self->cache, &msg, self->keylen);
+        nn_msg_term (&msg);
+    }
+    nn_dist_queue_term (&self->cache);
     nn_list_term (&self->pipes);
 }
 
-void nn_dist_add (NN_UNUSED struct nn_dist *self,
+void nn_dist_add (struct nn_dist *self,
     struct nn_dist_data *data, struct nn_pipe *pipe)
 {
+    size_t i;
+    struct nn_msg msg;
+
     data->pipe = pipe;
+    data->writable = 0;
+    data->closed = 0;
+    nn_dist_queue_init (&data->queue);
+    data->drops = 0;
+    data->sent = 0;
+    data->dropped = 0;
+
+    /*  The pipe is not writable until out() is invoked. Messages sent in
+        the meantime are queued for it. */
+    ++self->count;
     nn_list_item_init (&data->item);
+    nn_list_insert (&self->pipes, &data->item, nn_list_end (&self->pipes));
+
+    /*  Prime the queue with the last known value of every topic. These are
+        delivered irrespective of the queue length limit. */
+    if (self->cache.depth) {
+        nn_dist_queue_reserve (&data->queue, self->cache.depth, self->keylen);
+        for (i = 0; i != self->cache.depth; ++i) {
+            nn_msg_cp (&msg, &self->cache.msgs [(self->cache.head + i) %
+                self->cache.capacity]);
+            nn_dist_queue_push (&data->queue, &msg, self->keylen);
+        }
+    }
 }
 
 void nn_dist_rm (struct nn_dist *self, struct nn_dist_data *data)
 {
-    if (nn_list_item_isinlist (&data->item)) {
-        --self->count;
-        nn_list_erase (&self->pipes, &data->item);
-    }
+    --self->count;
+    nn_list_erase (&self->pipes, &data->item);
     nn_list_item_term (&data->item);
+    nn_dist_clear (self, data);
+    nn_dist_queue_term (&data->queue);
 }
 
 void nn_dist_out (struct nn_dist *self, struct nn_dist_data *data)
 {
-    ++self->count;
-    nn_list_insert (&self->pipes, &data->item, nn_list_end (&self->pipes));
+    int rc;
+    struct nn_msg msg;
+
+    nn_assert (!data->writable);
+
+    if (nn_slow (data->closed))
+        return;
+
+    /*  Flush the backlog for as long as the pipe accepts the messages. */
+    while (data->queue.depth) {
+        nn_dist_queue_pop (&data->queue, &msg, self->keylen);
+        rc = nn_pipe_send (data->pipe, &msg);
+        errnum_assert (rc >= 0, -rc);
+        ++data->sent;
+        if (rc & NN_PIPE_RELEASE)
+            return;
+    }
+
+    /*  The peer has caught up. */
+    data->writable = 1;
+    data->drops = 0;
+}
+
+int nn_dist_setkeylen (struct nn_dist *self, size_t keylen)
+{
+    struct nn_msg msg;
+
+    if (nn_slow (self->count))
+        return -EINVAL;
+
+    /*  The cache is indexed by the old key length. Start afresh. */
+    while (self->cache.depth) {
+        nn_dist_queue_pop (&self->cache, &msg, self->keylen);
+        nn_msg_term (&msg);
+    }
+    nn_dist_queue_term (&self->cache);
+    nn_dist_queue_init (&self->cache);
+    self->keylen = keylen;
+    return 0;
+}
+
+void nn_dist_setlastvalue (struct nn_dist *self, int lastvalue)
+{
+    struct nn_msg msg;
+
+    self->lastvalue = lastvalue;
+    if (!lastvalue) {
+        while (self->cache.depth) {
+            nn_dist_queue_pop (&self->cache, &msg, self->keylen);
+            nn_msg_term (&msg);
+        }
+    }
+}
+
+void nn_dist_getstats (struct nn_dist *self, void *optval, size_t *optvallen)
+{
+    struct nn_list_item *it;
+    struct nn_dist_data *data;
+    struct nn_pipe_send_stats stats;
+    size_t pos;
+
+    pos = 0;
+    for (it = nn_list_begin (&self->pipes); it != nn_list_end (&self->pipes);
+          it = nn_list_next (&self->pipes, it)) {
+        data = nn_cont (it, struct nn_dist_data, item);
+        if (pos + sizeof (stats) <= *optvallen) {
+            stats.sent = data->sent;
+            stats.dropped = data->dropped;
+            stats.queued = data->queue.depth;
+            memcpy ((char*) optval + pos, &stats, sizeof (stats));
+        }
+        pos += sizeof (stats);
+    }
+    *optvallen = pos;
 }
 
 int nn_dist_send (struct nn_dist *self, struct nn_msg *msg,
     struct nn_pipe *exclude)
 {
-    int rc;
     struct nn_list_item *it;
     struct nn_dist_data *data;
     struct nn_msg copy;
 
-    /*  TODO: We can optimise for the case when there's only one outbound
-        pipe here. No message copying is needed in such case. */
+    /*  Remember the message for the future subscribers. */
+    if (self->lastvalue && self->keylen)
+        nn_dist_remember (self, msg);
 
     /*  In the specific case when there are no outbound pipes. There's nowhere
         to send the message to. Deallocate it. */
@@ -81,28 +226,316 @@ int nn_dist_send (struct nn_dist *self, struct nn_msg *msg,
         return 0;
     }
 
+    /*  With a single outbound pipe no copying is needed. The message is
+        handed over as is. */
+    if (self->count == 1) {
+        data = nn_cont (nn_list_begin (&self->pipes), struct nn_dist_data,
+            item);
+        if (nn_fast (data->pipe == exclude))
+            nn_msg_term (msg);
+        else
+            nn_dist_deliver (self, data, msg);
+        return 0;
+    }
+
     /*  Send the message to all the subscribers. */
     nn_msg_bulkcopy_start (msg, self->count);
-    it = nn_list_begin (&self->pipes);
-    while (it != nn_list_end (&self->pipes)) {
+    for (it = nn_list_begin (&self->pipes);
+          it != nn_list_end (&self->pipes);
+          it = nn_list_next (&self->pipes, it)) {
        data = nn_cont (it, struct nn_dist_data, item);
        nn_msg_bulkcopy_cp (&copy, msg);
-       if (nn_fast (data->pipe == exclude)) {
+       if (nn_fast (data->pipe == exclude))
            nn_msg_term (&copy);
-       }
-       else {
-           rc = nn_pipe_send (data->pipe, &copy);
-           errnum_assert (rc >= 0, -rc);
-           if (rc & NN_PIPE_RELEASE) {
-               --self->count;
-               it = nn_list_erase (&self->pipes, it);
-               continue;
-           }
-       }
-       it = nn_list_next (&self->pipes, it);
+       else
+           nn_dist_deliver (self, data, &copy);
+    }
+    nn_msg_term (msg);
+
+    return 0;
+}
+
+static void nn_dist_deliver (struct nn_dist *self, struct nn_dist_data *data,
+    struct nn_msg *msg)
+{
+    int rc;
+
+    if (nn_fast (data->writable)) {
+        rc = nn_pipe_send (data->pipe, msg);
+        errnum_assert (rc >= 0, -rc);
+        ++data->sent;
+        if (rc & NN_PIPE_RELEASE)
+            data->writable = 0;
+        return;
+    }
+
+    /*  The peer is busy. Park the message in its queue. The cost of this
+        doesn't depend on how far behind the peer is. */
+    if (nn_slow (data->closed) || !nn_dist_enqueue (self, data, msg))
+        nn_dist_drop (self, data, msg);
+}
+
+/*  Stores the message to the pipe's queue. Returns 0 if there's no space
+    for it, 1 otherwise. */
+static int nn_dist_enqueue (struct nn_dist *self, struct nn_dist_data *data,
+    struct nn_msg *msg)
+{
+    struct nn_dist_queue *queue;
+    struct nn_msg oldest;
+
+    queue = &data->queue;
+
+    /*  A stale message with the same topic is simply superseded. */
+    if (self->keylen && nn_dist_queue_replace (queue, msg, self->keylen))
+        return 1;
+
+    /*  With no queue length set, conflation still keeps a single slot for
+        each topic, so that the peer gets the latest value of every topic
+        once it catches up. */
+    if (self->keylen && !self->qlen &&
+          nn_chunkref_size (&msg->body) >= self->keylen) {
+        if (queue->depth == queue->capacity)
+            nn_dist_queue_reserve (queue, queue->capacity ?
+                queue->capacity * 2 : NN_DIST_CACHE_INITIAL, self->keylen);
+        nn_dist_queue_push (queue, msg, self->keylen);
+        return 1;
+    }
+
+    if (queue->depth >= (size_t) self->qlen) {
+
+        /*  Make space for the new message by dropping the oldest one. */
+        if (self->policy != NN_DIST_DROP_OLDEST || !queue->depth)
+            return 0;
+        nn_dist_queue_pop (queue, &oldest, self->keylen);
+        nn_dist_discard (self, data, &oldest);
     }
+
+    /*  The queue is (re)allocated to the current maximum length when it's
+        first needed and whenever the length is increased afterwards. */
+    if (nn_slow (queue->depth == queue->capacity))
+        nn_dist_queue_reserve (queue, self->qlen, self->keylen);
+
+    nn_dist_queue_push (queue, msg, self->keylen);
+    return 1;
+}
+
+/*  Stores a copy of the message to the last value cache. */
+static void nn_dist_remember (struct nn_dist *self, struct nn_msg *msg)
+{
+    struct nn_msg copy;
+
+    if (nn_chunkref_size (&msg->body) < self->keylen)
+        return;
+
+    nn_msg_cp (&copy, msg);
+    if (nn_dist_queue_replace (&self->cache, &copy, self->keylen))
+        return;
+    if (self->cache.depth == self->cache.capacity)
+        nn_dist_queue_reserve (&self->cache, self->cache.capacity ?
+            self->cache.capacity * 2 : NN_DIST_CACHE_INITIAL, self->keylen);
+    nn_dist_queue_push (&self->cache, &copy, self->keylen);
+}
+
+static void nn_dist_drop (struct nn_dist *self, struct nn_dist_data *data,
+    struct nn_msg *msg)
+{
+    nn_dist_discard (self, data, msg);
+
+    if (self->policy != NN_DIST_DISCONNECT || data->closed ||
+          ++data->drops < self->maxdrops)
+        return;
+
+    /*  The peer is hopelessly behind. Stop feeding it and ask the transport
+        to drop the connection. Transports that can't close individual
+        connections leave the pipe attached, but it gets no more messages. */
+    data->closed = 1;
+    nn_dist_clear (self, data);
+    nn_pipe_close (data->pipe);
+}
+
+static void nn_dist_discard (struct nn_dist *self, struct nn_dist_data *data,
+    struct nn_msg *msg)
+{
     nn_msg_term (msg);
+    ++data->dropped;
+    nn_sockbase_stat_increment (self->sockbase, NN_STAT_DROPPED_MESSAGES, 1);
+}
+
+/*  Discards all the messages in the queue. */
+static void nn_dist_clear (struct nn_dist *self, struct nn_dist_data *data)
+{
+    struct nn_msg msg;
+
+    while (data->queue.depth) {
+        nn_dist_queue_pop (&data->queue, &msg, self->keylen);
+        nn_dist_discard (self, data, &msg);
+    }
+}
+
+static void nn_dist_queue_init (struct nn_dist_queue *self)
+{
+    self->msgs = NULL;
+    self->capacity = 0;
+    self->head = 0;
+    self->depth = 0;
+    self->index = NULL;
+    self->slots = 0;
+}
+
+static void nn_dist_queue_term (struct nn_dist_queue *self)
+{
+    nn_assert (self->depth == 0);
+    if (self->msgs)
+        nn_free (self->msgs);
+    if (self->index)
+        nn_free (self->index);
+}
+
+/*  Makes sure that the queue can hold 'capacity' messages. Messages are
+    moved to the beginning of the new buffer, so the index is rebuilt. */
+static void nn_dist_queue_reserve (struct nn_dist_queue *self,
+    size_t capacity, size_t keylen)
+{
+    size_t i;
+    size_t slots;
+    uint32_t pos;
+    struct nn_msg *msgs;
+
+    if (capacity <= self->capacity)
+        return;
+
+    msgs = nn_alloc (sizeof (struct nn_msg) * capacity, "dist queue");
+    alloc_assert (msgs);
+    for (i = 0; i != self->depth; ++i)
+        nn_msg_mv (&msgs [i],
+            &self->msgs [(self->head + i) % self->capacity]);
+    if (self->msgs)
+        nn_free (self->msgs);
+    self->msgs = msgs;
+    self->capacity = capacity;
+    self->head = 0;
+
+    if (!keylen)
+        return;
+
+    for (slots = 1; slots < capacity * 2; slots <<= 1)
+        ;
+    if (self->index)
+        nn_free (self->index);
+    self->index = nn_alloc (sizeof (uint32_t) * slots, "dist queue index");
+    alloc_assert (self->index);
+    memset (self->index, 0, sizeof (uint32_t) * slots);
+    self->slots = slots;
+    for (i = 0; i != self->depth; ++i) {
+        if (nn_chunkref_size (&self->msgs [i].body) < keylen)
+            continue;
+        pos = nn_dist_hash (&self->msgs [i], keylen) & (slots - 1);
+        while (self->index [pos])
+            pos = (pos + 1) & (slots - 1);
+        self->index [pos] = (uint32_t) i + 1;
+    }
+}
+
+/*  If a message with the same topic is queued already, replaces it with
+    'msg' and returns 1. Otherwise returns 0 and leaves 'msg' untouched. */
+static int nn_dist_queue_replace (struct nn_dist_queue *self,
+    struct nn_msg *msg, size_t keylen)
+{
+    uint32_t pos;
+    struct nn_msg *queued;
+
+    if (!self->depth || nn_chunkref_size (&msg->body) < keylen)
+        return 0;
 
+    pos = nn_dist_hash (msg, keylen) & (self->slots - 1);
+    while (self->index [pos]) {
+        queued = &self->msgs [self->index [pos] - 1];
+        if (memcmp (nn_chunkref_data (&queued->body),
+              nn_chunkref_data (&msg->body), keylen) == 0) {
+            nn_msg_term (queued);
+            nn_msg_mv (queued, msg);
+            return 1;
+        }
+        pos = (pos + 1) & (self->slots - 1);
+    }
     return 0;
 }
 
+/*  Appends the message to the queue. There must be space for it. */
+static void nn_dist_queue_push (struct nn_dist_queue *self,
+    struct nn_msg *msg, size_t keylen)
+{
+    size_t tail;
+    uint32_t pos;
+
+    nn_assert (self->depth < self->capacity);
+    tail = (self->head + self->depth) % self->capacity;
+    nn_msg_mv (&self->msgs [tail], msg);
+    ++self->depth;
+
+    if (!keylen || nn_chunkref_size (&self->msgs [tail].body) < keylen)
+        return;
+    pos = nn_dist_hash (&self->msgs [tail], keylen) & (self->slots - 1);
+    while (self->index [pos])
+        pos = (pos + 1) & (self->slots - 1);
+    self->index [pos] = (uint32_t) tail + 1;
+}
+
+/*  Removes the oldest message from the queue. */
+static void nn_dist_queue_pop (struct nn_dist_queue *self,
+    struct nn_msg *msg, size_t keylen)
+{
+    nn_assert (self->depth > 0);
+    if (keylen && nn_chunkref_size (&self->msgs [self->head].body) >= keylen)
+        nn_dist_queue_unindex (self, self->head, keylen);
+    nn_msg_mv (msg, &self->msgs [self->head]);
+    self->head = (self->head + 1) % self->capacity;
+    --self->depth;
+}
+
+/*  Removes the message at the specified position from the index. The gap
+    is closed by shifting the subsequent entries of the cluster back. */
+static void nn_dist_queue_unindex (struct nn_dist_queue *self, size_t pos,
+    size_t keylen)
+{
+    uint32_t mask;
+    uint32_t i;
+    uint32_t j;
+    uint32_t k;
+
+    mask = (uint32_t) self->slots - 1;
+    i = nn_dist_hash (&self->msgs [pos], keylen) & mask;
+    while (self->index [i] != pos + 1) {
+        nn_assert (self->index [i]);
+        i = (i + 1) & mask;
+    }
+
+    j = i;
+    while (1) {
+        j = (j + 1) & mask;
+        if (!self->index [j])
+            break;
+        k = nn_dist_hash (&self->msgs [self->index [j] - 1], keylen) & mask;
+        if (i <= j ? (i < k && k <= j) : (i < k || k <= j))
+            continue;
+        self->index [i] = self->index [j];
+        i = j;
+    }
+    self->index [i] = 0;
+}
+
+/*  FNV-1a hash of the message topic. */
+static uint32_t nn_dist_hash (struct nn_msg *msg, size_t keylen)
+{
+    size_t i;
+    uint32_t hash;
+    const uint8_t *key;
+
+    key = nn_chunkref_data (&msg->body);
+    hash = 2166136261u;
+    for (i = 0; i != keylen; ++i) {
+        hash ^= key [i];
+        hash *= 16777619u;
+    }
+    return hash;
+}
@@ -27,25 +27,109 @@
 
 #include "../../utils/list.h"
 
-/*  Distributor. Sends messages to all the pipes. */
+/*  Distributor. Sends messages to all the pipes. Each pipe has a bounded
+    queue of its own, so that a single slow peer doesn't cause messages to be
+    lost for it straight away, while the sender never has to wait for it.
+    What happens when the queue overflows is determined by the policy. */
+
+/*  Discard the message that is being sent. */
+#define NN_DIST_DROP_NEWEST 1
+
+/*  Discard the oldest message in the queue to make room for the new one. */
+#define NN_DIST_DROP_OLDEST 2
+
+/*  Like NN_DIST_DROP_NEWEST, but drop the connection once it has lost
+    'maxdrops' messages since it last caught up. */
+#define NN_DIST_DISCONNECT 3
+
+/*  Ring buffer of messages. When the distributor conflates messages,
+    the queue is indexed by topic so that a newer message replaces the queued
+    one with the same topic in constant time. */
+struct nn_dist_queue {
+    struct nn_msg *msgs;
+    size_t capacity;
+    size_t head;
+    size_t depth;
+
+    /*  Open addressing hash table of the queued messages. Each slot holds
+        the position of the message in the ring plus one, or zero if empty.
+        Its size is a power of two, at least twice the capacity. */
+    uint32_t *index;
+    size_t slots;
+};
 
 struct nn_dist_data {
     struct nn_list_item item;
     struct nn_pipe *pipe;
+
+    /*  1 if the message can be sent to the pipe straight away. */
+    int writable;
+
+    /*  1 if the peer was disconnected because it wasn't able to keep up. */
+    int closed;
+
+    /*  Messages waiting for the pipe to become writable. The buffer is
+        allocated when it's needed for the first time. */
+    struct nn_dist_queue queue;
+
+    /*  Messages dropped since the queue was last empty. */
+    int drops;
+
+    /*  Number of messages handed to the pipe and dropped for it, reported
+        by nn_dist_getstats. */
+    uint64_t sent;
+    uint64_t dropped;
 };
 
 struct nn_dist {
+
+    /*  The socket the distributor belongs to. Used to report statistics. */
+    struct nn_sockbase *sockbase;
+
+    /*  Number of attached pipes. */
     uint32_t count;
     struct nn_list pipes;
+
+    /*  Maximum number of messages queued for a single pipe. */
+    int qlen;
+
+    /*  What to do when the queue is full. One of NN_DIST_* constants. */
+    int policy;
+
+    /*  Number of drops after which the peer is disconnected when the
+        policy is NN_DIST_DISCONNECT. */
+    int maxdrops;
+
+    /*  Number of initial bytes of the message body that identify the topic.
+        If non-zero, a queued message is replaced by a newer one with the
+        same topic rather than sent after it. */
+    size_t keylen;
+
+    /*  If 1, the last message of each topic is kept in 'cache' and handed
+        to every newly attached pipe. Requires 'keylen' to be set. */
+    int lastvalue;
+    struct nn_dist_queue cache;
 };
 
-void nn_dist_init (struct nn_dist *self);
+void nn_dist_init (struct nn_dist *self, struct nn_sockbase *sockbase);
 void nn_dist_term (struct nn_dist *self);
 void nn_dist_add (struct nn_dist *self, 
     struct nn_dist_data *data, struct nn_pipe *pipe);
 void nn_dist_rm (struct nn_dist *self, struct nn_dist_data *data);
 void nn_dist_out (struct nn_dist *self, struct nn_dist_data *data);
 
+/*  Sets the topic length used for conflation. Fails with -EINVAL if there
+    are pipes attached. Changing the length discards the cached values. */
+int nn_dist_setkeylen (struct nn_dist *self, size_t keylen);
+
+/*  Switches the last value cache on or off. */
+void nn_dist_setlastvalue (struct nn_dist *self, int lastvalue);
+
+/*  Fills in an array of nn_pipe_send_stats structures, one for each attached
+    pipe. If the buffer is too small, the output is truncated. '*optvallen'
+    is set to the full size of the array. */
+void nn_dist_getstats (struct nn_dist *self, void *optval, size_t *optvallen);
+
 /*  Sends the message to all the attached pipes except the one specified
     by 'exclude' parameter. If 'exclude' is NULL, message is sent to all
     attached pipes. */
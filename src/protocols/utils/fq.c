@@ -22,18 +22,29 @@
 
 #include "fq.h"
 
+#include "../../nn.h"
+
 #include "../../utils/err.h"
 #include "../../utils/cont.h"
+#include "../../utils/fast.h"
 
 #include <stddef.h>
+#include <string.h>
 
 void nn_fq_init (struct nn_fq *self)
 {
     nn_priolist_init (&self->priolist);
+    nn_list_init (&self->pipes);
+    self->burst = 1;
+    self->burst_bytes = 0;
+    self->current = NULL;
+    self->count = 0;
+    self->bytes = 0;
 }
 
 void nn_fq_term (struct nn_fq *self)
 {
+    nn_list_term (&self->pipes);
     nn_priolist_term (&self->priolist);
 }
 
@@ -41,10 +52,19 @@ void nn_fq_add (struct nn_fq *self, struct nn_fq_data *data,
     struct nn_pipe *pipe, int priority)
 {
     nn_priolist_add (&self->priolist, &data->priodata, pipe, priority);
+    nn_list_item_init (&data->item);
+    nn_list_insert (&self->pipes, &data->item, nn_list_end (&self->pipes));
+    data->received = 0;
+    data->bytes = 0;
+    data->bursts = 0;
 }
 
 void nn_fq_rm (struct nn_fq *self, struct nn_fq_data *data)
 {
+    if (self->current == data)
+        self->current = NULL;
+    nn_list_erase (&self->pipes, &data->item);
+    nn_list_item_term (&data->item);
     nn_priolist_rm (&self->priolist, &data->priodata);
 }
 
@@ -61,24 +81,84 @@ int nn_fq_can_recv (struct nn_fq *self)
 int nn_fq_recv (struct nn_fq *self, struct nn_msg *msg, struct nn_pipe **pipe)
 {
     int rc;
-    struct nn_pipe *p;
+    struct nn_priolist_data *pd;
+    struct nn_fq_data *data;
+    size_t sz;
 
-    /*  Pipe is NULL only when there are no avialable pipes. */
-    p = nn_priolist_getpipe (&self->priolist);
-    if (nn_slow (!p))
+    /*  Pipe data is NULL only when there are no avialable pipes. */
+    pd = nn_priolist_getdata (&self->priolist);
+    if (nn_slow (!pd))
         return -EAGAIN;
+    data = nn_cont (pd, struct nn_fq_data, priodata);
+
+    /*  The current pipe may have changed under our hands, e.g. because
+        a pipe with higher priority became readable. Start a new burst. */
+    if (nn_slow (data != self->current)) {
+        self->current = data;
+        self->count = 0;
+        self->bytes = 0;
+        ++data->bursts;
+    }
 
     /*  Receive the messsage. */
-    rc = nn_pipe_recv (p, msg);
+    rc = nn_pipe_recv (pd->pipe, msg);
     errnum_assert (rc >= 0, -rc);
+    sz = nn_chunkref_size (&msg->sphdr) + nn_chunkref_size (&msg->body);
+    ++data->received;
+    data->bytes += sz;
+    ++self->count;
+    self->bytes += sz;
 
     /*  Return the pipe data to the user, if required. */
     if (pipe)
-        *pipe = p;
+        *pipe = pd->pipe;
 
-    /*  Move to the next pipe. */
-    nn_priolist_advance (&self->priolist, rc & NN_PIPE_RELEASE);
+    /*  Move to the next pipe once the burst is over or there's nothing more
+        to receive from this one. */
+    if (rc & NN_PIPE_RELEASE || self->count >= self->burst ||
+          (self->burst_bytes && self->bytes >= self->burst_bytes)) {
+        nn_priolist_advance (&self->priolist, rc & NN_PIPE_RELEASE);
+        self->current = NULL;
+    }
 
     return rc & ~NN_PIPE_RELEASE;
 }
 
+int nn_fq_setburst (struct nn_fq *self, int burst)
+{
+    if (nn_slow (burst < 1))
+        return -EINVAL;
+    self->burst = burst;
+    return 0;
+}
+
+int nn_fq_setburstbytes (struct nn_fq *self, int burst_bytes)
+{
+    if (nn_slow (burst_bytes < 0))
+        return -EINVAL;
+    self->burst_bytes = (size_t) burst_bytes;
+    return 0;
+}
+
+void nn_fq_getstats (struct nn_fq *self, void *optval, size_t *optvallen)
+{
+    struct nn_list_item *it;
+    struct nn_fq_data *data;
+    struct nn_pipe_recv_stats stats;
+    size_t pos;
+
+    pos = 0;
+    for (it = nn_list_begin (&self->pipes); it != nn_list_end (&self->pipes);
+          it = nn_list_next (&self->pipes, it)) {
+        data = nn_cont (it, struct nn_fq_data, item);
+        if (pos + sizeof (stats) <= *optvallen) {
+            stats.priority = data->priodata.priority;
+            stats.received = data->received;
+            stats.bytes = data->bytes;
+            stats.bursts = data->bursts;
+            memcpy ((char*) optval + pos, &stats, sizeof (stats));
+        }
+        pos += sizeof (stats);
+    }
+    *optvallen = pos;
+}
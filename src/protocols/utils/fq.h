@@ -27,15 +27,44 @@
 
 #include "priolist.h"
 
+#include "../../utils/list.h"
+
 /*  Fair-queuer. Retrieves messages from a set of pipes in round-robin
-    manner. */
+    manner. By default it moves to the next pipe after each message. With
+    a burst size set, it keeps receiving from the same pipe till the burst
+    size in messages or bytes is reached or the pipe runs dry. This makes
+    the scheduling fair over a window of several messages rather than one
+    and spares switching between the pipes on every receive. */
 
 struct nn_fq_data {
     struct nn_priolist_data priodata;
+
+    /*  The structure is a member of nn_fq's 'pipes' list. */
+    struct nn_list_item item;
+
+    /*  Messages and bytes received from the pipe and the number of bursts
+        they were received in. */
+    uint64_t received;
+    uint64_t bytes;
+    uint64_t bursts;
 };
 
 struct nn_fq {
     struct nn_priolist priolist;
+
+    /*  All the attached pipes, whether they are readable or not. */
+    struct nn_list pipes;
+
+    /*  Maximum number of messages and bytes to receive from a single pipe
+        before moving to the next one. Zero bytes means no limit. */
+    int burst;
+    size_t burst_bytes;
+
+    /*  The pipe the current burst is being received from, and how much of
+        the burst was used so far. */
+    struct nn_fq_data *current;
+    int count;
+    size_t bytes;
 };
 
 void nn_fq_init (struct nn_fq *self);
@@ -47,4 +76,16 @@ void nn_fq_in (struct nn_fq *self, struct nn_fq_data *data);
 int nn_fq_can_recv (struct nn_fq *self);
 int nn_fq_recv (struct nn_fq *self, struct nn_msg *msg, struct nn_pipe **pipe);
 
+/*  Sets the burst size in messages. Returns -EINVAL if it's less than 1. */
+int nn_fq_setburst (struct nn_fq *self, int burst);
+
+/*  Sets the burst size in bytes. Zero means no limit. Returns -EINVAL if
+    the value is negative. */
+int nn_fq_setburstbytes (struct nn_fq *self, int burst_bytes);
+
+/*  Fills in an array of nn_pipe_recv_stats structures, one for each attached
+    pipe. Follows the getsockopt semantics, i.e. the output is truncated if
+    the buffer is too small and the full length is stored in 'optvallen'. */
+void nn_fq_getstats (struct nn_fq *self, void *optval, size_t *optvallen);
+
 #endif
@@ -22,18 +22,56 @@
 
 #include "lb.h"
 
+#include "../../nn.h"
+
 #include "../../utils/err.h"
 #include "../../utils/cont.h"
+#include "../../utils/fast.h"
+#include "../../utils/attr.h"
+#include "../../utils/alloc.h"
+#include "../../utils/random.h"
 
 #include <stddef.h>
+#include <string.h>
+
+/*  Default percentage of messages round-robined in the lowest-latency
+    mode. */
+#define NN_LB_DEFAULT_EXPLORE 5
+
+/*  Weight of a new latency sample in the moving average, expressed as
+    a right shift, i.e. the new sample accounts for 1/8 of the average. */
+#define NN_LB_LATENCY_SHIFT 3
+
+/*  Private functions. */
+static int nn_lb_cmp (struct nn_lb_data *a, struct nn_lb_data *b);
+static struct nn_priolist_data *nn_lb_least_loaded (struct nn_lb *self,
+    struct nn_priolist_data *current);
+static struct nn_priolist_data *nn_lb_candidate (struct nn_lb *self,
+    size_t index, struct nn_priolist_data *current);
+static struct nn_priolist_data *nn_lb_fastest (struct nn_lb *self,
+    struct nn_pipe *except);
+static int nn_lb_deliver (struct nn_lb *self, struct nn_priolist_data *current,
+    struct nn_priolist_data *chosen, struct nn_msg *msg, struct nn_pipe **to);
+static uint64_t nn_lb_cost (struct nn_lb_data *data);
 
 void nn_lb_init (struct nn_lb *self)
 {
     nn_priolist_init (&self->priolist);
+    nn_list_init (&self->pipes);
+    self->all = NULL;
+    self->count = 0;
+    self->capacity = 0;
+    nn_random_generate (&self->seed, sizeof (self->seed));
+    self->policy = NN_LB_ROUND_ROBIN;
+    self->explore = NN_LB_DEFAULT_EXPLORE;
+    self->credit = 0;
 }
 
 void nn_lb_term (struct nn_lb *self)
 {
+    nn_assert (self->count == 0);
+    nn_free (self->all);
+    nn_list_term (&self->pipes);
     nn_priolist_term (&self->priolist);
 }
 
@@ -41,10 +79,31 @@ void nn_lb_add (struct nn_lb *self, struct nn_lb_data *data,
     struct nn_pipe *pipe, int priority)
 {
     nn_priolist_add (&self->priolist, &data->priodata, pipe, priority);
+    data->outstanding = 0;
+    data->sent = 0;
+    data->latency = 0;
+    nn_list_item_init (&data->item);
+    nn_list_insert (&self->pipes, &data->item, nn_list_end (&self->pipes));
+
+    if (nn_slow (self->count == self->capacity)) {
+        self->capacity = self->capacity ? self->capacity * 2 : 8;
+        self->all = nn_realloc (self->all,
+            sizeof (struct nn_lb_data*) * self->capacity);
+        alloc_assert (self->all);
+    }
+    data->index = self->count;
+    self->all [self->count++] = data;
 }
 
 void nn_lb_rm (struct nn_lb *self, struct nn_lb_data *data)
 {
+    /*  Move the last pipe into the gap. */
+    --self->count;
+    self->all [data->index] = self->all [self->count];
+    self->all [data->index]->index = data->index;
+
+    nn_list_erase (&self->pipes, &data->item);
+    nn_list_item_term (&data->item);
     nn_priolist_rm (&self->priolist, &data->priodata);
 }
 
@@ -65,24 +124,247 @@ int nn_lb_get_priority (struct nn_lb *self)
 
 int nn_lb_send (struct nn_lb *self, struct nn_msg *msg, struct nn_pipe **to)
 {
-    int rc;
-    struct nn_pipe *pipe;
+    struct nn_priolist_data *current;
+    struct nn_priolist_data *chosen;
+
+    /*  Current is NULL only when there are no avialable pipes. */
+    current = nn_priolist_getdata (&self->priolist);
+    if (nn_slow (!current))
+        return -EAGAIN;
+
+    chosen = current;
+    if (self->policy == NN_LB_LEAST_LOADED)
+        chosen = nn_lb_least_loaded (self, current);
+
+    /*  Send to the fastest pipe unless it's time to explore. Exploring
+        follows the round-robin order so that every pipe gets its turn. */
+    if (self->policy == NN_LB_LOWEST_LATENCY) {
+        self->credit += self->explore;
+        if (self->credit >= 100)
+            self->credit -= 100;
+        else
+            chosen = nn_lb_fastest (self, NULL);
+    }
+
+    return nn_lb_deliver (self, current, chosen, msg, to);
+}
+
+int nn_lb_send_other (struct nn_lb *self, struct nn_msg *msg,
+    struct nn_pipe *except, struct nn_pipe **to)
+{
+    struct nn_priolist_data *current;
+    struct nn_priolist_data *chosen;
 
-    /*  Pipe is NULL only when there are no avialable pipes. */
-    pipe = nn_priolist_getpipe (&self->priolist);
-    if (nn_slow (!pipe))
+    current = nn_priolist_getdata (&self->priolist);
+    if (nn_slow (!current))
         return -EAGAIN;
 
+    if (self->policy == NN_LB_LOWEST_LATENCY)
+        chosen = nn_lb_fastest (self, except);
+    else if (current->pipe == except)
+        chosen = nn_priolist_peek (&self->priolist);
+    else
+        chosen = current;
+    if (nn_slow (!chosen))
+        return -EAGAIN;
+
+    return nn_lb_deliver (self, current, chosen, msg, to);
+}
+
+/*  Sends the message to the chosen pipe, 'current' being the round-robin
+    candidate. */
+static int nn_lb_deliver (struct nn_lb *self, struct nn_priolist_data *current,
+    struct nn_priolist_data *chosen, struct nn_msg *msg, struct nn_pipe **to)
+{
+    int rc;
+    struct nn_lb_data *data;
+
+    data = nn_cont (chosen, struct nn_lb_data, priodata);
+
     /*  Send the messsage. */
-    rc = nn_pipe_send (pipe, msg);
+    rc = nn_pipe_send (chosen->pipe, msg);
     errnum_assert (rc >= 0, -rc);
+    ++data->outstanding;
+    ++data->sent;
 
-    /*  Move to the next pipe. */
-    nn_priolist_advance (&self->priolist, rc & NN_PIPE_RELEASE);
+    /*  Move to the next pipe. If some other pipe was chosen, the round-robin
+        order is left as it is. */
+    if (chosen == current)
+        nn_priolist_advance (&self->priolist, rc & NN_PIPE_RELEASE);
+    else if (rc & NN_PIPE_RELEASE)
+        nn_priolist_deactivate (&self->priolist, chosen);
 
     if (to != NULL)
-        *to = pipe;
+        *to = chosen->pipe;
 
     return rc & ~NN_PIPE_RELEASE;
 }
 
+void nn_lb_done (NN_UNUSED struct nn_lb *self, struct nn_lb_data *data)
+{
+    /*  Replies to requests that were already given up on may still arrive. */
+    if (data->outstanding)
+        --data->outstanding;
+}
+
+void nn_lb_sample (NN_UNUSED struct nn_lb *self, struct nn_lb_data *data,
+    uint64_t latency)
+{
+    /*  Zero is reserved for pipes with no samples. */
+    if (nn_slow (latency == 0))
+        latency = 1;
+
+    /*  The first sample initialises the average. */
+    if (nn_slow (data->latency == 0)) {
+        data->latency = latency;
+        return;
+    }
+
+    data->latency = data->latency - (data->latency >> NN_LB_LATENCY_SHIFT) +
+        (latency >> NN_LB_LATENCY_SHIFT);
+    if (nn_slow (data->latency == 0))
+        data->latency = 1;
+}
+
+int nn_lb_setpolicy (struct nn_lb *self, int policy)
+{
+    if (nn_slow (policy != NN_LB_ROUND_ROBIN &&
+          policy != NN_LB_LEAST_LOADED && policy != NN_LB_LOWEST_LATENCY))
+        return -EINVAL;
+    self->policy = policy;
+    return 0;
+}
+
+int nn_lb_setexplore (struct nn_lb *self, int explore)
+{
+    if (nn_slow (explore < 0 || explore > 100))
+        return -EINVAL;
+    self->explore = explore;
+    self->credit = 0;
+    return 0;
+}
+
+void nn_lb_getload (struct nn_lb *self, void *optval, size_t *optvallen)
+{
+    struct nn_list_item *it;
+    struct nn_lb_data *data;
+    struct nn_pipe_load load;
+    size_t pos;
+
+    pos = 0;
+    for (it = nn_list_begin (&self->pipes); it != nn_list_end (&self->pipes);
+          it = nn_list_next (&self->pipes, it)) {
+        data = nn_cont (it, struct nn_lb_data, item);
+        if (pos + sizeof (load) <= *optvallen) {
+            load.priority = data->priodata.priority;
+            load.outstanding = data->outstanding;
+            load.backlog = nn_pipe_backlog (data->priodata.pipe);
+            load.sent = data->sent;
+            load.latency = data->latency;
+            memcpy ((char*) optval + pos, &load, sizeof (load));
+        }
+        pos += sizeof (load);
+    }
+    *optvallen = pos;
+}
+
+/*  Picks two distinct pipes at random and returns the less loaded one.
+    The round-robin candidate 'current' stands in for a pipe that can't be
+    sent to at the moment, i.e. one that is not writable or has lower
+    priority than the current one. */
+static struct nn_priolist_data *nn_lb_least_loaded (struct nn_lb *self,
+    struct nn_priolist_data *current)
+{
+    size_t i;
+    size_t j;
+    struct nn_priolist_data *a;
+    struct nn_priolist_data *b;
+
+    if (nn_slow (self->count < 2))
+        return current;
+
+    self->seed = self->seed * 1103515245 + 12345;
+    i = (self->seed >> 8) % self->count;
+    self->seed = self->seed * 1103515245 + 12345;
+    j = (self->seed >> 8) % (self->count - 1);
+    if (j >= i)
+        ++j;
+
+    a = nn_lb_candidate (self, i, current);
+    b = nn_lb_candidate (self, j, current);
+    if (nn_lb_cmp (nn_cont (b, struct nn_lb_data, priodata),
+          nn_cont (a, struct nn_lb_data, priodata)) < 0)
+        return b;
+    return a;
+}
+
+static struct nn_priolist_data *nn_lb_candidate (struct nn_lb *self,
+    size_t index, struct nn_priolist_data *current)
+{
+    struct nn_priolist_data *data;
+
+    data = &self->all [index]->priodata;
+    if (data->priority != self->priolist.current ||
+          !nn_list_item_isinlist (&data->item))
+        return current;
+    return data;
+}
+
+/*  Returns a negative number if pipe 'a' is less loaded than pipe 'b'. */
+static int nn_lb_cmp (struct nn_lb_data *a, struct nn_lb_data *b)
+{
+    size_t backlog_a;
+    size_t backlog_b;
+
+    if (a->outstanding != b->outstanding)
+        return a->outstanding < b->outstanding ? -1 : 1;
+    backlog_a = nn_pipe_backlog (a->priodata.pipe);
+    backlog_b = nn_pipe_backlog (b->priodata.pipe);
+    if (backlog_a != backlog_b)
+        return backlog_a < backlog_b ? -1 : 1;
+    return 0;
+}
+
+/*  Returns the pipe in the current priority level with the lowest cost,
+    other than 'except'. Ties are resolved in favour of the round-robin
+    candidate. Returns NULL if there's no such pipe. */
+static struct nn_priolist_data *nn_lb_fastest (struct nn_lb *self,
+    struct nn_pipe *except)
+{
+    struct nn_priolist_slot *slot;
+    struct nn_list_item *it;
+    struct nn_priolist_data *best;
+    struct nn_lb_data *data;
+    uint64_t cost;
+    uint64_t best_cost;
+
+    slot = &self->priolist.slots [self->priolist.current - 1];
+    best = NULL;
+    best_cost = 0;
+    if (slot->current->pipe != except) {
+        best = slot->current;
+        best_cost = nn_lb_cost (nn_cont (best, struct nn_lb_data, priodata));
+    }
+    for (it = nn_list_begin (&slot->pipes); it != nn_list_end (&slot->pipes);
+          it = nn_list_next (&slot->pipes, it)) {
+        data = nn_cont (it, struct nn_lb_data, priodata.item);
+        if (data->priodata.pipe == except)
+            continue;
+        cost = nn_lb_cost (data);
+        if (!best || cost < best_cost) {
+            best = &data->priodata;
+            best_cost = cost;
+        }
+    }
+    return best;
+}
+
+/*  Expected latency of a message sent to the pipe, i.e. the average latency
+    multiplied by the number of messages waiting in front. A pipe with no
+    samples yet is tried first, but only with a single message at a time. */
+static uint64_t nn_lb_cost (struct nn_lb_data *data)
+{
+    if (nn_slow (data->latency == 0))
+        return data->outstanding ? (uint64_t) -1 : 0;
+    return data->latency * (data->outstanding + 1);
+}
@@ -27,14 +27,62 @@
 
 #include "priolist.h"
 
-/*  A load balancer. Round-robins messages to a set of pipes. */
+#include "../../utils/list.h"
+
+/*  A load balancer. By default it round-robins messages to a set of pipes.
+    In the least-loaded mode it considers two pipes picked at random for each
+    message and sends it to the less loaded one (the power of two choices).
+    Load of a pipe is the number of outstanding messages, i.e. messages sent
+    but not yet reported as done by the protocol, and then the number of
+    bytes that the transport holds waiting to be sent. In the
+    lowest-latency mode it sends to the pipe in the current priority level
+    with the best moving average of the reply latency reported by the
+    protocol, except for a configurable fraction of messages which are
+    round-robined so that peers that have recovered get noticed. */
 
 struct nn_lb_data {
     struct nn_priolist_data priodata;
+
+    /*  The structure is a member of nn_lb's 'pipes' list. */
+    struct nn_list_item item;
+
+    /*  Position of the structure in nn_lb's 'all' array. */
+    size_t index;
+
+    /*  Messages sent to the pipe and not yet completed. */
+    uint32_t outstanding;
+
+    /*  Total number of messages sent to the pipe. */
+    uint64_t sent;
+
+    /*  Moving average of the reply latency, in microseconds. Zero if no
+        reply was observed yet. */
+    uint64_t latency;
 };
 
 struct nn_lb {
     struct nn_priolist priolist;
+
+    /*  All the attached pipes, whether they are writable or not. */
+    struct nn_list pipes;
+
+    /*  The same pipes in an array, so that they can be picked at random in
+        the least-loaded mode. */
+    struct nn_lb_data **all;
+    size_t count;
+    size_t capacity;
+
+    /*  State of the pseudo-random generator used to pick the pipes. */
+    uint32_t seed;
+
+    /*  One of NN_LB_ROUND_ROBIN, NN_LB_LEAST_LOADED or
+        NN_LB_LOWEST_LATENCY. */
+    int policy;
+
+    /*  Percentage of messages to round-robin in the lowest-latency mode
+        and the accumulator used to spread them evenly. */
+    int explore;
+    int credit;
 };
 
 void nn_lb_init (struct nn_lb *self);
@@ -47,4 +95,30 @@ int nn_lb_can_send (struct nn_lb *self);
 int nn_lb_get_priority (struct nn_lb *self);
 int nn_lb_send (struct nn_lb *self, struct nn_msg *msg, struct nn_pipe **to);
 
+/*  Same as above, but the message is sent to some other pipe than 'except'.
+    Returns -EAGAIN if there's no such pipe available. */
+int nn_lb_send_other (struct nn_lb *self, struct nn_msg *msg,
+    struct nn_pipe *except, struct nn_pipe **to);
+
+/*  Tells the load balancer that a message sent to the pipe was processed,
+    e.g. that a reply to a request has arrived. */
+void nn_lb_done (struct nn_lb *self, struct nn_lb_data *data);
+
+/*  Reports the time it took for the pipe to process a message, e.g. the
+    time between sending a request and getting the reply. */
+void nn_lb_sample (struct nn_lb *self, struct nn_lb_data *data,
+    uint64_t latency);
+
+/*  Sets the policy. Returns -EINVAL if the policy is not known. */
+int nn_lb_setpolicy (struct nn_lb *self, int policy);
+
+/*  Sets the percentage of messages sent round-robin in the lowest-latency
+    mode. Returns -EINVAL if the value is out of the 0-100 range. */
+int nn_lb_setexplore (struct nn_lb *self, int explore);
+
+/*  Fills in an array of nn_pipe_load structures, one for each attached
+    pipe. Follows the getsockopt semantics, i.e. the output is truncated if
+    the buffer is too small and the full length is stored in 'optvallen'. */
+void nn_lb_getload (struct nn_lb *self, void *optval, size_t *optvallen);
+
 #endif
@@ -83,6 +83,11 @@ void nn_priolist_rm (struct nn_priolist *self, struct nn_priolist_data *data);
     calling this function. */
 void nn_priolist_activate (struct nn_priolist *self, struct nn_priolist_data *data);
 
+/*  Deactivates an active pipe, whether it is the current one or not. The
+    pipe stays in the list and can be re-activated later on. */
+void nn_priolist_deactivate (struct nn_priolist *self,
+    struct nn_priolist_data *data);
+
 /*  Returns 1 if there's at least a single active pipe in the list,
     0 otherwise. */
 int nn_priolist_is_active (struct nn_priolist *self);
@@ -91,6 +96,15 @@ int nn_priolist_is_active (struct nn_priolist *self);
     NULL is returned. */
 struct nn_pipe *nn_priolist_getpipe (struct nn_priolist *self);
 
+/*  Same as above, but returns the whole structure associated with the current
+    pipe. If there's no pipe in the list, NULL is returned. */
+struct nn_priolist_data *nn_priolist_getdata (struct nn_priolist *self);
+
+/*  Returns the pipe that will become current after the current one on the
+    same priority level. If the current pipe is the only one, NULL is
+    returned. */
+struct nn_priolist_data *nn_priolist_peek (struct nn_priolist *self);
+
 /*  Moves to the next pipe in the list. If 'release' is set to 1, the current
     pipe is removed from the list. To re-insert it into the list use
     nn_priolist_activate function. */
@@ -34,6 +34,24 @@ extern "C" {
 
 #define NN_SUB_SUBSCRIBE 1
 #define NN_SUB_UNSUBSCRIBE 2
+#define NN_SUB_SUBSCRIBE_BULK 3
+#define NN_SUB_UNSUBSCRIBE_BULK 4
+#define NN_SUB_EXACT_TOPIC_LEN 5
+#define NN_SUB_BURST 6
+#define NN_SUB_BURST_BYTES 7
+#define NN_SUB_PIPE_STATS 8
+
+#define NN_PUB_QUEUE_LEN 1
+#define NN_PUB_OVERFLOW 2
+#define NN_PUB_MAX_DROPS 3
+#define NN_PUB_CONFLATE 4
+#define NN_PUB_LAST_VALUE 5
+#define NN_PUB_PIPE_STATS 6
+
+/*  Values of NN_PUB_OVERFLOW option. */
+#define NN_PUB_DROP_NEWEST 1
+#define NN_PUB_DROP_OLDEST 2
+#define NN_PUB_DISCONNECT 3
 
 #ifdef __cplusplus
 }
@@ -36,12 +36,44 @@ extern "C" {
 #define NN_REP (NN_PROTO_REQREP * 16 + 1)
 
 #define NN_REQ_RESEND_IVL 1
+#define NN_REQ_LB_POLICY 2
+#define NN_REQ_PIPE_LOAD 3
+#define NN_REQ_EXPLORE 4
+#define NN_REQ_HEDGE_IVL 5
+#define NN_REQ_HEDGE_PERCENTILE 6
+
+#define NN_REP_BURST 1
+#define NN_REP_BURST_BYTES 2
+#define NN_REP_PIPE_STATS 3
+
+/*  Type of the ancillary property carrying nn_req_handle. */
+#define NN_REQ_HANDLE 1
 
 typedef union nn_req_handle {
     int i;
     void *ptr;
 } nn_req_handle;
 
+NN_EXPORT int nn_req_send (int s, nn_req_handle hndl, const void *buf,
+    size_t len, int flags);
+NN_EXPORT int nn_req_recv (int s, nn_req_handle *hndl, void *buf,
+    size_t len, int flags);
+
+/*  Request contexts on REP socket. A context is returned along with each
+    request and can be used to send the reply later on, from any thread. */
+NN_EXPORT int nn_rep_recvctx (int s, void **ctx, void *buf,
+    size_t len, int flags);
+NN_EXPORT int nn_rep_sendctx (int s, void *ctx, const void *buf,
+    size_t len, int flags);
+NN_EXPORT void nn_rep_freectx (void *ctx);
+
+/*  Handler invoked by nn_rep_serve for each request. To reply, store a message
+    allocated by nn_allocmsg into *rep and return 0. Return -1 to send no
+    reply. */
+typedef int nn_rep_fn (void *arg, const void *req, size_t len, void **rep);
+
+NN_EXPORT int nn_rep_serve (int s, int nthreads, nn_rep_fn *fn, void *arg);
+
 #ifdef __cplusplus
 }
 #endif
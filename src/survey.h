@@ -24,6 +24,8 @@
 #ifndef SURVEY_H_INCLUDED
 #define SURVEY_H_INCLUDED
 
+#include "nn.h"
+
 #ifdef __cplusplus
 extern "C" {
 #endif
@@ -37,6 +39,20 @@ extern "C" {
 #define NN_RESPONDENT (NN_PROTO_SURVEY * 16 + 3)
 
 #define NN_SURVEYOR_DEADLINE 1
+#define NN_SURVEYOR_QUORUM 2
+
+/*  Type of the ancillary property carrying nn_survey_handle. */
+#define NN_SURVEYOR_HANDLE 1
+
+typedef union nn_survey_handle {
+    int i;
+    void *ptr;
+} nn_survey_handle;
+
+NN_EXPORT int nn_survey_send (int s, nn_survey_handle hndl, const void *buf,
+    size_t len, int flags);
+NN_EXPORT int nn_survey_recv (int s, nn_survey_handle *hndl, void *buf,
+    size_t len, int flags);
 
 #ifdef __cplusplus
 }
@@ -30,6 +30,12 @@ extern "C" {
 #define NN_TCP -3
 
 #define NN_TCP_NODELAY 1
+#define NN_TCP_LISTENERS 2
+#define NN_TCP_CONNECTIONS 3
+#define NN_TCP_COMPRESS 4
+#define NN_TCP_BATCH 5
+#define NN_TCP_VARINT 6
+#define NN_TCP_REUSEPORT 7
 
 #ifdef __cplusplus
 }
@@ -143,6 +143,17 @@ struct nn_pipebase_vfptr {
     /*  Receive a message from the network. The function can return either error
         (negative number) or any combination of the flags defined above. */
     int (*recv) (struct nn_pipebase *self, struct nn_msg *msg);
+
+    /*  Forcefully tear down the connection, e.g. when the protocol decides
+        that the peer is too slow to keep up. The pipe is removed from the
+        socket asynchronously, the same way as when the peer disconnects.
+        This function is optional and may be NULL. */
+    void (*close) (struct nn_pipebase *self);
+
+    /*  Returns the number of bytes the transport holds waiting to be sent.
+        Used by load balancing to spot congested connections.
+        This function is optional and may be NULL. */
+    size_t (*backlog) (struct nn_pipebase *self);
 };
 
 /*  Endpoint specific options. Same restrictions as for nn_pipebase apply  */
@@ -195,6 +206,10 @@ void nn_pipebase_getopt (struct nn_pipebase *self, int level, int option,
     or 0 otherwise. */
 int nn_pipebase_ispeer (struct nn_pipebase *self, int socktype);
 
+/*  Increments statistics counters in the socket structure. */
+void nn_pipebase_stat_increment (struct nn_pipebase *self, int name,
+    int increment);
+
 /******************************************************************************/
 /*  The transport class.                                                      */
 /******************************************************************************/
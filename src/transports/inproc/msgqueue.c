@@ -32,8 +32,8 @@ void nn_msgqueue_init (struct nn_msgqueue *self, size_t maxmem)
 {
     struct nn_msgqueue_chunk *chunk;
 
-    self->count = 0;
-    self->mem = 0;
+    nn_atomic_init (&self->count, 0);
+    nn_atomic_init (&self->waiting, 0);
     self->maxmem = maxmem;
 
     chunk = nn_alloc (sizeof (struct nn_msgqueue_chunk), "msgqueue chunk");
@@ -42,10 +42,10 @@ void nn_msgqueue_init (struct nn_msgqueue *self, size_t maxmem)
 
     self->out.chunk = chunk;
     self->out.pos = 0;
+    self->out.mem = 0;
     self->in.chunk = chunk;
     self->in.pos = 0;
-
-    self->cache = NULL;
+    self->in.mem = 0;
 }
 
 void nn_msgqueue_term (struct nn_msgqueue *self)
@@ -67,59 +67,61 @@ void nn_msgqueue_term (struct nn_msgqueue *self)
     nn_assert (self->in.chunk == self->out.chunk);
     nn_free (self->in.chunk);
 
-    /*  Deallocate the cached chunk, if any. */
-    if (self->cache)
-        nn_free (self->cache);
+    nn_atomic_term (&self->waiting);
+    nn_atomic_term (&self->count);
 }
 
 int nn_msgqueue_empty (struct nn_msgqueue *self)
 {
-    return self->count == 0 ? 1 : 0;
+    return nn_atomic_load (&self->count) == 0 ? 1 : 0;
 }
 
 int nn_msgqueue_send (struct nn_msgqueue *self, struct nn_msg *msg)
 {
     size_t msgsz;
+    struct nn_msgqueue_chunk *chunk;
 
     /*  By allowing one message of arbitrary size to be written to the queue,
         we allow even messages that exceed max buffer size to pass through.
-        Beyond that we'll apply the buffer limit as specified by the user. */
+        Beyond that we'll apply the buffer limit as specified by the user.
+        The reader may be just releasing some memory, in which case
+        the queue is deemed to be a bit fuller than it actually is. */
     msgsz = nn_chunkref_size (&msg->sphdr) + nn_chunkref_size (&msg->body);
-    if (nn_slow (self->count > 0 && self->mem + msgsz >= self->maxmem))
+    if (nn_slow (nn_atomic_load (&self->count) > 0 &&
+          self->out.mem - self->in.mem + msgsz >= self->maxmem))
         return -EAGAIN;
 
-    /*  Adjust the statistics. */
-    ++self->count;
-    self->mem += msgsz;
-
     /*  Move the content of the message to the pipe. */
     nn_msg_mv (&self->out.chunk->msgs [self->out.pos], msg);
     ++self->out.pos;
+    self->out.mem += msgsz;
 
-    /*  If there's no space for a new message in the pipe, either re-use
-        the cache chunk or allocate a new chunk if it does not exist. */
+    /*  If there's no space for a new message in the pipe, allocate a new
+        chunk. It has to be linked before the message is published to
+        the reader. */
     if (nn_slow (self->out.pos == NN_MSGQUEUE_GRANULARITY)) {
-        if (nn_slow (!self->cache)) {
-            self->cache = nn_alloc (sizeof (struct nn_msgqueue_chunk),
-                "msgqueue chunk");
-            alloc_assert (self->cache);
-            self->cache->next = NULL;
-        }
-        self->out.chunk->next = self->cache;
-        self->out.chunk = self->cache;
-        self->cache = NULL;
+        chunk = nn_alloc (sizeof (struct nn_msgqueue_chunk),
+            "msgqueue chunk");
+        alloc_assert (chunk);
+        chunk->next = NULL;
+        self->out.chunk->next = chunk;
+        self->out.chunk = chunk;
         self->out.pos = 0;
     }
 
-    return 0;
+    /*  Publish the message. The increment is a release, so the reader
+        sees the message once it sees the new count. */
+    return nn_atomic_inc (&self->count, 1) == 0 ? 1 : 0;
 }
 
 int nn_msgqueue_recv (struct nn_msgqueue *self, struct nn_msg *msg)
 {
     struct nn_msgqueue_chunk *o;
 
-    /*  If there is no message in the queue. */
-    if (nn_slow (!self->count))
+    /*  If there is no message in the queue. The acquire pairs with
+        the release in nn_msgqueue_send so that the message published
+        by the writer is fully visible here. */
+    if (nn_slow (!nn_atomic_load (&self->count)))
         return -EAGAIN;
 
     /*  Move the message from the pipe to the user. */
@@ -131,17 +133,30 @@ int nn_msgqueue_recv (struct nn_msgqueue *self, struct nn_msg *msg)
         o = self->in.chunk;
         self->in.chunk = self->in.chunk->next;
         self->in.pos = 0;
-        if (nn_fast (!self->cache))
-            self->cache = o;
-        else
-            nn_free (o);
+        nn_free (o);
     }
 
-    /*  Adjust the statistics. */
-    --self->count;
-    self->mem -= (nn_chunkref_size (&msg->sphdr) +
-        nn_chunkref_size (&msg->body));
+    /*  Release the memory and the slot. */
+    self->in.mem += nn_chunkref_size (&msg->sphdr) +
+        nn_chunkref_size (&msg->body);
+    return nn_atomic_dec (&self->count, 1) > 1 ? 1 : 0;
+}
+
+void nn_msgqueue_wait (struct nn_msgqueue *self)
+{
+    uint32_t old;
 
-    return 0;
+    old = nn_atomic_inc (&self->waiting, 1);
+    nn_assert (old == 0);
 }
 
+int nn_msgqueue_waiting (struct nn_msgqueue *self)
+{
+    /*  Only the reader clears the flag and the writer sets it only once
+        it was notified, so there's no race between the check and
+        the decrement. */
+    if (nn_fast (!nn_atomic_load (&self->waiting)))
+        return 0;
+    nn_atomic_dec (&self->waiting, 1);
+    return 1;
+}
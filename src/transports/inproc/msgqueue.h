@@ -24,10 +24,15 @@
 #define NN_MSGQUEUE_INCLUDED
 
 #include "../../utils/msg.h"
+#include "../../utils/atomic.h"
 
 #include <stddef.h>
 
-/*  This class is a simple uni-directional message queue. */
+/*  This class is a simple uni-directional message queue. It can be written
+    to by one thread and read from by another thread at the same time without
+    any locking. The writer and the reader find out about the transitions
+    between the empty and non-empty (and full and non-full) states of
+    the queue so that they can notify each other only when needed. */
 
 /*  It's not 128 so that chunk including its footer fits into a memory page. */
 #define NN_MSGQUEUE_GRANULARITY 126
@@ -40,30 +45,31 @@ struct nn_msgqueue_chunk {
 struct nn_msgqueue {
 
     /*  Pointer to the position where next message should be written into
-        the message queue. */
+        the message queue, and the total amount of memory written so far.
+        Accessed only by the writer. */
     struct {
         struct nn_msgqueue_chunk *chunk;
         int pos;
+        size_t mem;
     } out;
 
-    /*  Pointer to the first unread message in the message queue. */
+    /*  Pointer to the first unread message in the message queue, and
+        the total amount of memory read so far. Written only by the reader. */
     struct {
         struct nn_msgqueue_chunk *chunk;
         int pos;
+        volatile size_t mem;
     } in;
 
     /*  Number of messages in the queue. */
-    size_t count;
+    struct nn_atomic count;
 
-    /*  Amount of memory used by messages in the queue. */
-    size_t mem;
+    /*  Set by the writer when it finds the queue full and wants to be
+        notified once there's space again. */
+    struct nn_atomic waiting;
 
     /*   Maximal queue size (in bytes). */
     size_t maxmem;
-
-    /*  One empty chunk is always cached so that in case of steady stream
-        of messages through the pipe there are no memory allocations. */
-    struct nn_msgqueue_chunk *cache;
 };
 
 /*  Initialise the message pipe. maxmem is the maximal queue size in bytes. */
@@ -76,11 +82,22 @@ void nn_msgqueue_term (struct nn_msgqueue *self);
 int nn_msgqueue_empty (struct nn_msgqueue *self);
 
 /*  Writes a message to the pipe. -EAGAIN is returned if the message cannot
-    be sent because the queue is full. */
+    be sent because the queue is full. Otherwise, 1 is returned if the queue
+    was empty, i.e. if the reader has to be notified, 0 if it was not. */
 int nn_msgqueue_send (struct nn_msgqueue *self, struct nn_msg *msg);
 
 /*  Reads a message from the pipe. -EAGAIN is returned if there's no message
-    to receive. */
+    to receive. Otherwise, 1 is returned if there are more messages in
+    the queue, 0 if the queue is empty now. */
 int nn_msgqueue_recv (struct nn_msgqueue *self, struct nn_msg *msg);
 
+/*  Called by the writer after the queue was found full. Asks the reader to
+    notify the writer once it reads a message. The writer must not call this
+    function again until it's notified. */
+void nn_msgqueue_wait (struct nn_msgqueue *self);
+
+/*  Called by the reader after reading a message. Returns 1 if the writer
+    asked to be notified, 0 otherwise. The request is cleared. */
+int nn_msgqueue_waiting (struct nn_msgqueue *self);
+
 #endif
@@ -40,26 +40,28 @@
 #define NN_SINPROC_ACTION_READY 1
 #define NN_SINPROC_ACTION_ACCEPTED 2
 
-/*  Set when SENT event was sent to the peer but RECEIVED haven't been
-    passed back yet. */
+/*  Set when the message being sent couldn't be written to the peer's queue
+    because it was full. The message is held in 'msg' in the meantime. */
 #define NN_SINPROC_FLAG_SENDING 1
 
-/*  Set when SENT event was received, but the new message cannot be written
-    to the queue yet, i.e. RECEIVED event haven't been returned
-    to the peer yet. */
-#define NN_SINPROC_FLAG_RECEIVING 2
+/*  Set when the peer was asked to send RECEIVED event once it reads
+    a message from its queue, but the event haven't arrived yet. */
+#define NN_SINPROC_FLAG_WAITING 2
 
 /*  Private functions. */
 static void nn_sinproc_handler (struct nn_fsm *self, int src, int type,
     void *srcptr);
 static void nn_sinproc_shutdown (struct nn_fsm *self, int src, int type,
     void *srcptr);
+static void nn_sinproc_flush (struct nn_sinproc *self);
 
 static int nn_sinproc_send (struct nn_pipebase *self, struct nn_msg *msg);
 static int nn_sinproc_recv (struct nn_pipebase *self, struct nn_msg *msg);
 const struct nn_pipebase_vfptr nn_sinproc_pipebase_vfptr = {
     nn_sinproc_send,
-    nn_sinproc_recv
+    nn_sinproc_recv,
+    NULL,
+    NULL
 };
 
 void nn_sinproc_init (struct nn_sinproc *self, int src,
@@ -162,19 +164,46 @@ static int nn_sinproc_send (struct nn_pipebase *self, struct nn_msg *msg)
         nn_chunkref_size (&msg->body));
     nn_msg_term (msg);
 
-    /*  Expose the message to the peer. */
+    /*  Write the message directly to the peer's queue. The peer has to be
+        notified only if the queue was empty. */
     nn_msg_term (&sinproc->msg);
     nn_msg_mv (&sinproc->msg, &nmsg);
-
-    /*  Notify the peer that there's a message to get. */
     sinproc->flags |= NN_SINPROC_FLAG_SENDING;
-    nn_fsm_raiseto (&sinproc->fsm, &sinproc->peer->fsm,
-        &sinproc->peer->event_sent, NN_SINPROC_SRC_PEER,
-        NN_SINPROC_SENT, sinproc);
+    nn_sinproc_flush (sinproc);
 
     return 0;
 }
 
+static void nn_sinproc_flush (struct nn_sinproc *self)
+{
+    int rc;
+
+    nn_assert (self->flags & NN_SINPROC_FLAG_SENDING);
+
+    while (1) {
+        rc = nn_msgqueue_send (&self->peer->msgqueue, &self->msg);
+        if (nn_fast (rc >= 0)) {
+            nn_msg_init (&self->msg, 0);
+            self->flags &= ~NN_SINPROC_FLAG_SENDING;
+            if (rc == 1)
+                nn_fsm_raiseto (&self->fsm, &self->peer->fsm,
+                    &self->peer->event_sent, NN_SINPROC_SRC_PEER,
+                    NN_SINPROC_SENT, self);
+            nn_pipebase_sent (&self->pipebase);
+            return;
+        }
+        errnum_assert (rc == -EAGAIN, -rc);
+
+        /*  The queue is full. Ask the peer to notify us once it reads
+            a message, then try once again in case it did so in
+            the meantime. */
+        if (self->flags & NN_SINPROC_FLAG_WAITING)
+            return;
+        nn_msgqueue_wait (&self->peer->msgqueue);
+        self->flags |= NN_SINPROC_FLAG_WAITING;
+    }
+}
+
 static int nn_sinproc_recv (struct nn_pipebase *self, struct nn_msg *msg)
 {
     int rc;
@@ -188,26 +217,18 @@ static int nn_sinproc_recv (struct nn_pipebase *self, struct nn_msg *msg)
 
     /*  Move the message to the caller. */
     rc = nn_msgqueue_recv (&sinproc->msgqueue, msg);
-    errnum_assert (rc == 0, -rc);
-
-    /*  If there was a message from peer lingering because of the exceeded
-        buffer limit, try to enqueue it once again. */
-    if (sinproc->state != NN_SINPROC_STATE_DISCONNECTED) {
-        if (nn_slow (sinproc->flags & NN_SINPROC_FLAG_RECEIVING)) {
-            rc = nn_msgqueue_send (&sinproc->msgqueue, &sinproc->peer->msg);
-            nn_assert (rc == 0 || rc == -EAGAIN);
-            if (rc == 0) {
-                errnum_assert (rc == 0, -rc);
-                nn_msg_init (&sinproc->peer->msg, 0);
-                nn_fsm_raiseto (&sinproc->fsm, &sinproc->peer->fsm,
-                    &sinproc->peer->event_received, NN_SINPROC_SRC_PEER,
-                    NN_SINPROC_RECEIVED, sinproc);
-                sinproc->flags &= ~NN_SINPROC_FLAG_RECEIVING;
-            }
-        }
-    }
-
-    if (!nn_msgqueue_empty (&sinproc->msgqueue))
+    errnum_assert (rc >= 0, -rc);
+
+    /*  If the peer is waiting for space in the queue, notify it. */
+    if (sinproc->state != NN_SINPROC_STATE_DISCONNECTED &&
+          nn_slow (nn_msgqueue_waiting (&sinproc->msgqueue)))
+        nn_fsm_raiseto (&sinproc->fsm, &sinproc->peer->fsm,
+            &sinproc->peer->event_received, NN_SINPROC_SRC_PEER,
+            NN_SINPROC_RECEIVED, sinproc);
+
+    /*  If the queue became empty the peer will notify us once it writes
+        a new message to it. */
+    if (rc == 1)
        nn_pipebase_received (&sinproc->pipebase);
 
     return 0;
@@ -239,6 +260,7 @@ static void nn_sinproc_shutdown_events (struct nn_sinproc *self, int src,
         }
     case NN_SINPROC_SRC_PEER:
         switch (type) {
+        case NN_SINPROC_SENT:
         case NN_SINPROC_RECEIVED:
             return;
         }
@@ -310,7 +332,6 @@ static void nn_sinproc_handler (struct nn_fsm *self, int src, int type,
 {
     int rc;
     struct nn_sinproc *sinproc;
-    int empty;
 
     sinproc = nn_cont (self, struct nn_sinproc, fsm);
 
@@ -420,33 +441,19 @@ static void nn_sinproc_handler (struct nn_fsm *self, int src, int type,
             switch (type) {
             case NN_SINPROC_SENT:
 
-                empty = nn_msgqueue_empty (&sinproc->msgqueue);
-
-                /*  Push the message to the inbound message queue. */
-                rc = nn_msgqueue_send (&sinproc->msgqueue,
-                    &sinproc->peer->msg);
-                if (rc == -EAGAIN) {
-                    sinproc->flags |= NN_SINPROC_FLAG_RECEIVING;
-                    return;
-                }
-                errnum_assert (rc == 0, -rc);
-                nn_msg_init (&sinproc->peer->msg, 0);
-
-                /*  Notify the user that there's a message to receive. */
-                if (empty)
-                    nn_pipebase_received (&sinproc->pipebase);
-
-                /*  Notify the peer that the message was received. */
-                nn_fsm_raiseto (&sinproc->fsm, &sinproc->peer->fsm,
-                    &sinproc->peer->event_received, NN_SINPROC_SRC_PEER,
-                    NN_SINPROC_RECEIVED, sinproc);
-
+                /*  The peer wrote a message to the empty inbound queue.
+                    Notify the user that there's a message to receive. */
+                nn_pipebase_received (&sinproc->pipebase);
                 return;
 
             case NN_SINPROC_RECEIVED:
-                nn_assert (sinproc->flags & NN_SINPROC_FLAG_SENDING);
-                nn_pipebase_sent (&sinproc->pipebase);
-                sinproc->flags &= ~NN_SINPROC_FLAG_SENDING;
+
+                /*  The peer made some space in its queue. Try to write
+                    the pending message once again. */
+                nn_assert (sinproc->flags & NN_SINPROC_FLAG_WAITING);
+                sinproc->flags &= ~NN_SINPROC_FLAG_WAITING;
+                if (sinproc->flags & NN_SINPROC_FLAG_SENDING)
+                    nn_sinproc_flush (sinproc);
                 return;
 
             case NN_SINPROC_DISCONNECT:
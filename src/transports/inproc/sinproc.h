@@ -61,12 +61,14 @@ struct nn_sinproc {
     struct nn_pipebase pipebase;
 
     /*  Inbound message queue. The messages contained are meant to be received
-        by the user later on. */
+        by the user later on. It is written to directly by the peer session;
+        the two sessions exchange events only when the queue stops being
+        empty or full. */
     struct nn_msgqueue msgqueue;
 
     /*  This message is the one being sent from this session to the peer
-        session. It holds the data only temporarily, until the peer moves
-        it to its msgqueue. */
+        session. It holds the data only temporarily, while the peer's
+        msgqueue is full. */
     struct nn_msg msg;
 
     /*  Outbound events. I.e. event sent by this sinproc to the peer sinproc. */
@@ -71,7 +71,7 @@ struct nn_aipc {
 };
 
 void nn_aipc_init (struct nn_aipc *self, int src,
-    struct nn_ep *ep, struct nn_fsm *owner);
+    struct nn_ep *ep, int rings, struct nn_fsm *owner);
 void nn_aipc_term (struct nn_aipc *self);
 
 int nn_aipc_isidle (struct nn_aipc *self);
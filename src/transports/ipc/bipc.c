@@ -70,6 +70,10 @@ struct nn_bipc {
 
     /*  List of accepted connections. */
     struct nn_list aipcs;
+
+    /*  If set, the accepted connections pass messages via shared memory
+        rings. */
+    int rings;
 };
 
 /*  nn_ep virtual interface implementation. */
@@ -88,7 +92,7 @@ static void nn_bipc_shutdown (struct nn_fsm *self, int src, int type,
 static int nn_bipc_listen (struct nn_bipc *self);
 static void nn_bipc_start_accepting (struct nn_bipc *self);
 
-int nn_bipc_create (struct nn_ep *ep)
+int nn_bipc_create (struct nn_ep *ep, int rings)
 {
     struct nn_bipc *self;
     int rc;
@@ -106,6 +110,7 @@ int nn_bipc_create (struct nn_ep *ep)
     self->state = NN_BIPC_STATE_IDLE;
     self->aipc = NULL;
     nn_list_init (&self->aipcs);
+    self->rings = rings;
 
     /*  Start the state machine. */
     nn_fsm_start (&self->fsm);
@@ -347,7 +352,8 @@ static void nn_bipc_start_accepting (struct nn_bipc *self)
     /*  Allocate new aipc state machine. */
     self->aipc = nn_alloc (sizeof (struct nn_aipc), "aipc");
     alloc_assert (self->aipc);
-    nn_aipc_init (self->aipc, NN_BIPC_SRC_AIPC, self->ep, &self->fsm);
+    nn_aipc_init (self->aipc, NN_BIPC_SRC_AIPC, self->ep, self->rings,
+        &self->fsm);
 
     /*  Start waiting for a new incoming connection. */
     nn_aipc_start (self->aipc, &self->usock);
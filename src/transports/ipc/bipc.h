@@ -26,8 +26,9 @@
 
 #include "../../transport.h"
 
-/*  State machine managing bound IPC socket. */
+/*  State machine managing bound IPC socket. If 'rings' is set, messages
+    are passed via shared memory rings rather than via the socket. */
 
-int nn_bipc_create (struct nn_ep *);
+int nn_bipc_create (struct nn_ep *ep, int rings);
 
 #endif
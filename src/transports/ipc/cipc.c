@@ -91,7 +91,7 @@ static void nn_cipc_shutdown (struct nn_fsm *self, int src, int type,
     void *srcptr);
 static void nn_cipc_start_connecting (struct nn_cipc *self);
 
-int nn_cipc_create (struct nn_ep *ep)
+int nn_cipc_create (struct nn_ep *ep, int rings)
 {
     struct nn_cipc *self;
     int reconnect_ivl;
@@ -120,7 +120,7 @@ int nn_cipc_create (struct nn_ep *ep)
         reconnect_ivl_max = reconnect_ivl;
     nn_backoff_init (&self->retry, NN_CIPC_SRC_RECONNECT_TIMER,
         reconnect_ivl, reconnect_ivl_max, &self->fsm);
-    nn_sipc_init (&self->sipc, NN_CIPC_SRC_SIPC, ep, &self->fsm);
+    nn_sipc_init (&self->sipc, NN_CIPC_SRC_SIPC, ep, rings, &self->fsm);
 
     /*  Start the state machine. */
     nn_fsm_start (&self->fsm);
@@ -28,6 +28,6 @@
 
 /*  State machine managing connected IPC socket. */
 
-int nn_cipc_create (struct nn_ep *ep);
+int nn_cipc_create (struct nn_ep *ep, int rings);
 
 #endif
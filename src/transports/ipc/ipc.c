@@ -50,6 +50,11 @@ struct nn_ipc_optset {
 
     int outbuffersz;
     int inbuffersz;
+
+    /*  Messages this large or larger are passed via shared memory. */
+    int shmem_threshold;
+    int batch;
+    int varint;
 };
 
 static void nn_ipc_optset_destroy (struct nn_optset *self);
@@ -80,12 +85,12 @@ struct nn_transport nn_ipc = {
 
 static int nn_ipc_bind (struct nn_ep *ep)
 {
-    return nn_bipc_create (ep);
+    return nn_bipc_create (ep, 0);
 }
 
 static int nn_ipc_connect (struct nn_ep *ep)
 {
-    return nn_cipc_create (ep);
+    return nn_cipc_create (ep, 0);
 }
 
 static struct nn_optset *nn_ipc_optset ()
@@ -100,6 +105,9 @@ static struct nn_optset *nn_ipc_optset ()
     optset->sec_attr = NULL;
     optset->outbuffersz = 4096;
     optset->inbuffersz = 4096;
+    optset->shmem_threshold = -1;
+    optset->batch = 0;
+    optset->varint = 0;
 
     return &optset->base;   
 }
@@ -132,6 +140,21 @@ static int nn_ipc_optset_setopt (struct nn_optset *self, int option,
     case NN_IPC_INBUFSZ:
         optset->inbuffersz = *(int *)optval;
         return 0;
+    case NN_IPC_SHMEM_THRESHOLD:
+        if (*(int *)optval < -1)
+            return -EINVAL;
+        optset->shmem_threshold = *(int *)optval;
+        return 0;
+    case NN_IPC_BATCH:
+        if (*(int *)optval != 0 && *(int *)optval != 1)
+            return -EINVAL;
+        optset->batch = *(int *)optval;
+        return 0;
+    case NN_IPC_VARINT:
+        if (*(int *)optval != 0 && *(int *)optval != 1)
+            return -EINVAL;
+        optset->varint = *(int *)optval;
+        return 0;
     default:
         return -ENOPROTOOPT;
     }
@@ -157,6 +180,18 @@ static int nn_ipc_optset_getopt (struct nn_optset *self, int option,
         *(int *)optval = optset->inbuffersz;
         *optvallen = sizeof (int);
         return 0;
+    case NN_IPC_SHMEM_THRESHOLD:
+        *(int *)optval = optset->shmem_threshold;
+        *optvallen = sizeof (int);
+        return 0;
+    case NN_IPC_BATCH:
+        *(int *)optval = optset->batch;
+        *optvallen = sizeof (int);
+        return 0;
+    case NN_IPC_VARINT:
+        *(int *)optval = optset->varint;
+        *optvallen = sizeof (int);
+        return 0;
     default:
         return -ENOPROTOOPT;
     }
@@ -23,15 +23,24 @@
 
 #include "sipc.h"
 
+#include "../utils/varint.h"
+
+#include "../../ipc.h"
+#include "../../shm.h"
+
 #include "../../utils/err.h"
 #include "../../utils/cont.h"
 #include "../../utils/fast.h"
 #include "../../utils/wire.h"
 #include "../../utils/attr.h"
+#include "../../utils/shmem.h"
+#include "../../utils/closefd.h"
 
 /*  Types of messages passed via IPC transport. */
 #define NN_SIPC_MSG_NORMAL 1
 #define NN_SIPC_MSG_SHMEM 2
+#define NN_SIPC_MSG_RING 3
+#define NN_SIPC_MSG_BATCH 4
 
 /*  States of the object as a whole. */
 #define NN_SIPC_STATE_IDLE 1
@@ -41,6 +50,7 @@
 #define NN_SIPC_STATE_SHUTTING_DOWN 5
 #define NN_SIPC_STATE_DONE 6
 #define NN_SIPC_STATE_STOPPING 7
+#define NN_SIPC_STATE_SETUP 8
 
 /*  Subordinated srcptr objects. */
 #define NN_SIPC_SRC_USOCK 1
@@ -50,17 +60,35 @@
 #define NN_SIPC_INSTATE_HDR 1
 #define NN_SIPC_INSTATE_BODY 2
 #define NN_SIPC_INSTATE_HASMSG 3
+#define NN_SIPC_INSTATE_RING 4
+#define NN_SIPC_INSTATE_BATCH 5
+#define NN_SIPC_INSTATE_VARINT 6
+#define NN_SIPC_INSTATE_VARINT2 7
 
 /*  Possible states of the outbound part of the object. */
 #define NN_SIPC_OUTSTATE_IDLE 1
 #define NN_SIPC_OUTSTATE_SENDING 2
+#define NN_SIPC_OUTSTATE_BATCHING 3
+
+/*  Progress of the exchange of the rings. */
+#define NN_SIPC_SETUP_SENT 1
+#define NN_SIPC_SETUP_RECEIVED 2
+
+/*  Possible states of the wake-up messages sent to the peer. */
+#define NN_SIPC_BELLSTATE_IDLE 1
+#define NN_SIPC_BELLSTATE_SENDING 2
+#define NN_SIPC_BELLSTATE_AGAIN 3
 
 /*  Stream is a special type of pipe. Implementation of the virtual pipe API. */
 static int nn_sipc_send (struct nn_pipebase *self, struct nn_msg *msg);
 static int nn_sipc_recv (struct nn_pipebase *self, struct nn_msg *msg);
+static void nn_sipc_close (struct nn_pipebase *self);
+static size_t nn_sipc_backlog (struct nn_pipebase *self);
 const struct nn_pipebase_vfptr nn_sipc_pipebase_vfptr = {
     nn_sipc_send,
-    nn_sipc_recv
+    nn_sipc_recv,
+    nn_sipc_close,
+    nn_sipc_backlog
 };
 
 /*  Private functions. */
@@ -68,9 +96,20 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
     void *srcptr);
 static void nn_sipc_shutdown (struct nn_fsm *self, int src, int type,
     void *srcptr);
+static void nn_sipc_closeoutfd (struct nn_sipc *self);
+static size_t nn_sipc_puthdr (struct nn_sipc *self, uint8_t type,
+    uint64_t size);
+static void nn_sipc_send_msg (struct nn_sipc *self);
+static void nn_sipc_recv_hdr (struct nn_sipc *self);
+static int nn_sipc_recv_msg (struct nn_sipc *self, uint64_t size);
+static void nn_sipc_sent (struct nn_sipc *self);
+static void nn_sipc_closerings (struct nn_sipc *self);
+static void nn_sipc_ringsend (struct nn_sipc *self);
+static void nn_sipc_ringrecv (struct nn_sipc *self);
+static void nn_sipc_bell (struct nn_sipc *self);
 
 void nn_sipc_init (struct nn_sipc *self, int src,
-    struct nn_ep *ep, struct nn_fsm *owner)
+    struct nn_ep *ep, int rings, struct nn_fsm *owner)
 {
     nn_fsm_init (&self->fsm, nn_sipc_handler, nn_sipc_shutdown,
         src, self, owner);
@@ -81,9 +120,28 @@ void nn_sipc_init (struct nn_sipc *self, int src,
     self->usock_owner.fsm = NULL;
     nn_pipebase_init (&self->pipebase, &nn_sipc_pipebase_vfptr, ep);
     self->instate = -1;
+    self->varint = 0;
     nn_msg_init (&self->inmsg, 0);
+    nn_batch_init (&self->inbatch);
     self->outstate = -1;
     nn_msg_init (&self->outmsg, 0);
+    self->batch = 0;
+    nn_batch_init (&self->outbatch);
+    nn_batch_init (&self->sendbatch);
+    nn_msg_init (&self->outnext, 0);
+    self->hasnext = 0;
+    self->outbytes = 0;
+    self->outfd = -1;
+    self->shmem_threshold = -1;
+    self->rings = rings;
+    nn_ring_init (&self->rxring);
+    nn_ring_init (&self->txring);
+    self->inpos = 0;
+    self->outpos = 0;
+    self->setup = 0;
+    self->bellin = 0;
+    self->bellout = 0;
+    self->bellstate = NN_SIPC_BELLSTATE_IDLE;
     nn_fsm_event_init (&self->done);
 }
 
@@ -92,7 +150,14 @@ void nn_sipc_term (struct nn_sipc *self)
     nn_assert_state (self, NN_SIPC_STATE_IDLE);
 
     nn_fsm_event_term (&self->done);
+    nn_sipc_closeoutfd (self);
+    nn_ring_term (&self->txring);
+    nn_ring_term (&self->rxring);
+    nn_msg_term (&self->outnext);
+    nn_batch_term (&self->sendbatch);
+    nn_batch_term (&self->outbatch);
     nn_msg_term (&self->outmsg);
+    nn_batch_term (&self->inbatch);
     nn_msg_term (&self->inmsg);
     nn_pipebase_term (&self->pipebase);
     nn_streamhdr_term (&self->streamhdr);
@@ -106,6 +171,22 @@ int nn_sipc_isidle (struct nn_sipc *self)
 
 void nn_sipc_start (struct nn_sipc *self, struct nn_usock *usock)
 {
+    size_t sz;
+
+    /*  The segment of the last message sent over the previous connection
+        is not needed any more. */
+    nn_sipc_closeoutfd (self);
+    nn_sipc_closerings (self);
+
+    /*  Find out which messages should be passed via shared memory. With
+        the rings all of them are. */
+    sz = sizeof (self->shmem_threshold);
+    nn_pipebase_getopt (&self->pipebase, NN_IPC, NN_IPC_SHMEM_THRESHOLD,
+        &self->shmem_threshold, &sz);
+    nn_assert (sz == sizeof (self->shmem_threshold));
+    if (self->rings || !nn_shmem_supported ())
+        self->shmem_threshold = -1;
+
     /*  Take ownership of the underlying socket. */
     nn_assert (self->usock == NULL && self->usock_owner.fsm == NULL);
     self->usock_owner.src = NN_SIPC_SRC_USOCK;
@@ -124,33 +205,223 @@ void nn_sipc_stop (struct nn_sipc *self)
 
 static int nn_sipc_send (struct nn_pipebase *self, struct nn_msg *msg)
 {
+    int rc;
     struct nn_sipc *sipc;
-    struct nn_iovec iov [3];
 
     sipc = nn_cont (self, struct nn_sipc, pipebase);
 
     nn_assert_state (sipc, NN_SIPC_STATE_ACTIVE);
+
+    /*  A frame is being sent at the moment. Small messages are gathered
+        into a batch to be sent as soon as the frame is out, other messages
+        have to wait for that. */
+    if (sipc->outstate == NN_SIPC_OUTSTATE_BATCHING) {
+        rc = -EMSGSIZE;
+        if (sipc->shmem_threshold < 0 ||
+              nn_chunkref_size (&msg->sphdr) + nn_chunkref_size (&msg->body) <
+              (size_t) sipc->shmem_threshold)
+            rc = nn_batch_add (&sipc->outbatch, msg);
+        if (nn_fast (rc == 0)) {
+            nn_msg_term (msg);
+            if (nn_batch_full (&sipc->outbatch))
+                sipc->outstate = NN_SIPC_OUTSTATE_SENDING;
+            else
+                nn_pipebase_sent (&sipc->pipebase);
+            return 0;
+        }
+        nn_msg_term (&sipc->outnext);
+        nn_msg_mv (&sipc->outnext, msg);
+        sipc->hasnext = 1;
+        sipc->outstate = NN_SIPC_OUTSTATE_SENDING;
+        return 0;
+    }
+
     nn_assert (sipc->outstate == NN_SIPC_OUTSTATE_IDLE);
 
     /*  Move the message to the local storage. */
     nn_msg_term (&sipc->outmsg);
     nn_msg_mv (&sipc->outmsg, msg);
 
+    /*  Write the message into the ring. */
+    if (sipc->rings) {
+        sipc->outpos = 0;
+        sipc->outstate = NN_SIPC_OUTSTATE_SENDING;
+        nn_sipc_ringsend (sipc);
+        return 0;
+    }
+
+    nn_sipc_send_msg (sipc);
+
+    /*  If the peer accepts batches, the pipe remains writable while
+        the message is being sent. */
+    if (sipc->batch) {
+        sipc->outstate = NN_SIPC_OUTSTATE_BATCHING;
+        nn_pipebase_sent (&sipc->pipebase);
+    }
+    else
+        sipc->outstate = NN_SIPC_OUTSTATE_SENDING;
+
+    return 0;
+}
+
+/*  Starts sending the message stored in 'outmsg' via the socket. */
+static void nn_sipc_send_msg (struct nn_sipc *self)
+{
+    struct nn_iovec iov [3];
+    size_t size;
+
+    size = nn_chunkref_size (&self->outmsg.sphdr) +
+        nn_chunkref_size (&self->outmsg.body);
+    self->outbytes = size;
+
+    iov [0].iov_base = self->outhdr;
+    iov [1].iov_base = nn_chunkref_data (&self->outmsg.sphdr);
+    iov [1].iov_len = nn_chunkref_size (&self->outmsg.sphdr);
+    iov [2].iov_base = nn_chunkref_data (&self->outmsg.body);
+    iov [2].iov_len = nn_chunkref_size (&self->outmsg.body);
+
+#if !defined NN_HAVE_WINDOWS
+    /*  Large messages are copied into a shared memory segment. Only the header
+        goes through the socket, along with the file descriptor of the segment.
+        If the segment can't be created, fall back to sending the message
+        inline. */
+    if (self->shmem_threshold >= 0 && size > 0 &&
+          size >= (size_t) self->shmem_threshold) {
+        self->outfd = nn_shmem_create (iov + 1, 2, size);
+        if (nn_fast (self->outfd >= 0)) {
+            iov [0].iov_len = nn_sipc_puthdr (self, NN_SIPC_MSG_SHMEM, size);
+            nn_usock_send_fd (self->usock, iov, 1, self->outfd);
+            return;
+        }
+        self->outfd = -1;
+    }
+#endif
+
     /*  Serialise the message header. */
-    sipc->outhdr [0] = NN_SIPC_MSG_NORMAL;
-    nn_putll (sipc->outhdr + 1, nn_chunkref_size (&sipc->outmsg.sphdr) +
-        nn_chunkref_size (&sipc->outmsg.body));
+    iov [0].iov_len = nn_sipc_puthdr (self, NN_SIPC_MSG_NORMAL, size);
 
     /*  Start async sending. */
-    iov [0].iov_base = sipc->outhdr;
-    iov [0].iov_len = sizeof (sipc->outhdr);
-    iov [1].iov_base = nn_chunkref_data (&sipc->outmsg.sphdr);
-    iov [1].iov_len = nn_chunkref_size (&sipc->outmsg.sphdr);
-    iov [2].iov_base = nn_chunkref_data (&sipc->outmsg.body);
-    iov [2].iov_len = nn_chunkref_size (&sipc->outmsg.body);
-    nn_usock_send (sipc->usock, iov, 3);
+    nn_usock_send (self->usock, iov, 3);
+}
+
+/*  Writes the header of a frame of given type into 'outhdr'. With compact
+    headers, regular messages are described compactly if possible, other
+    frames are preceded by the escape byte. Returns the size of the header. */
+static size_t nn_sipc_puthdr (struct nn_sipc *self, uint8_t type,
+    uint64_t size)
+{
+    size_t sz;
+
+    if (!self->varint) {
+        self->outhdr [0] = type;
+        nn_putll (self->outhdr + 1, size);
+        return 9;
+    }
+
+    if (type == NN_SIPC_MSG_NORMAL) {
+        sz = nn_varint_put (self->outhdr, size);
+        if (nn_fast (sz > 0))
+            return sz;
+    }
+    self->outhdr [0] = NN_VARINT_ESCAPE;
+    self->outhdr [1] = type;
+    nn_putll (self->outhdr + 2, size);
+    return 10;
+}
+
+/*  Invoked when the frame was sent via the socket. Sends the batch or
+    the message waiting for it and unblocks the pipe if it was blocked. */
+static void nn_sipc_sent (struct nn_sipc *self)
+{
+    int blocked;
+    struct nn_batch tmp;
+    struct nn_iovec iov [2];
+
+    nn_assert (self->outstate == NN_SIPC_OUTSTATE_SENDING ||
+        self->outstate == NN_SIPC_OUTSTATE_BATCHING);
+    blocked = self->outstate == NN_SIPC_OUTSTATE_SENDING;
+    self->outbytes = 0;
+    nn_sipc_closeoutfd (self);
+    nn_msg_term (&self->outmsg);
+    nn_msg_init (&self->outmsg, 0);
+
+    if (!nn_batch_empty (&self->outbatch)) {
+
+        /*  Send the batch. New messages are gathered into the other
+            buffer in the meantime. */
+        tmp = self->sendbatch;
+        self->sendbatch = self->outbatch;
+        self->outbatch = tmp;
+        nn_batch_reset (&self->outbatch);
+        iov [0].iov_base = self->outhdr;
+        iov [0].iov_len = nn_sipc_puthdr (self, NN_SIPC_MSG_BATCH,
+            self->sendbatch.size);
+        iov [1].iov_base = self->sendbatch.data;
+        iov [1].iov_len = self->sendbatch.size;
+        self->outbytes = self->sendbatch.size;
+        nn_usock_send (self->usock, iov, 2);
+        nn_pipebase_stat_increment (&self->pipebase, NN_STAT_BATCHES_SENT, 1);
+
+        /*  The message that didn't fit into the batch goes next. */
+        if (self->hasnext)
+            return;
+        self->outstate = NN_SIPC_OUTSTATE_BATCHING;
+    }
+    else if (self->hasnext) {
+        nn_msg_mv (&self->outmsg, &self->outnext);
+        nn_msg_init (&self->outnext, 0);
+        self->hasnext = 0;
+        nn_sipc_send_msg (self);
+        self->outstate = NN_SIPC_OUTSTATE_BATCHING;
+    }
+    else
+        self->outstate = NN_SIPC_OUTSTATE_IDLE;
 
-    sipc->outstate = NN_SIPC_OUTSTATE_SENDING;
+    if (blocked)
+        nn_pipebase_sent (&self->pipebase);
+}
+
+/*  Starts receiving the header of the next frame. */
+static void nn_sipc_recv_hdr (struct nn_sipc *self)
+{
+    if (self->varint) {
+        self->instate = NN_SIPC_INSTATE_VARINT;
+        nn_usock_recv (self->usock, self->inhdr, 1, NULL);
+        return;
+    }
+
+    self->instate = NN_SIPC_INSTATE_HDR;
+    nn_usock_recv (self->usock, self->inhdr, sizeof (self->inhdr), NULL);
+}
+
+/*  Header of a regular message was received. Check that message size
+    is acceptable by comparing with NN_RCVMAXSIZE and start receiving
+    the message body. Returns -EMSGSIZE if the message is too large. */
+static int nn_sipc_recv_msg (struct nn_sipc *self, uint64_t size)
+{
+    int opt;
+    size_t opt_sz = sizeof (opt);
+
+    nn_pipebase_getopt (&self->pipebase, NN_SOL_SOCKET, NN_RCVMAXSIZE,
+        &opt, &opt_sz);
+    if (opt >= 0 && size > (unsigned) opt)
+        return -EMSGSIZE;
+
+    /*  Allocate memory for the message. */
+    nn_msg_term (&self->inmsg);
+    nn_msg_init (&self->inmsg, (size_t) size);
+
+    /*  Special case when size of the message body is 0. */
+    if (!size) {
+        self->instate = NN_SIPC_INSTATE_HASMSG;
+        nn_pipebase_received (&self->pipebase);
+        return 0;
+    }
+
+    /*  Start receiving the message body. */
+    self->instate = NN_SIPC_INSTATE_BODY;
+    nn_usock_recv (self->usock, nn_chunkref_data (&self->inmsg.body),
+        (size_t) size, NULL);
 
     return 0;
 }
@@ -168,13 +439,58 @@ static int nn_sipc_recv (struct nn_pipebase *self, struct nn_msg *msg)
     nn_msg_mv (msg, &sipc->inmsg);
     nn_msg_init (&sipc->inmsg, 0);
 
+    /*  Hand out the rest of the batch before receiving new frame. */
+    if (!nn_batch_empty (&sipc->inbatch)) {
+        nn_batch_get (&sipc->inbatch, &sipc->inmsg);
+        nn_pipebase_received (&sipc->pipebase);
+        return 0;
+    }
+
+    /*  Read ahead the next message from the ring, if there's one. */
+    if (sipc->rings) {
+        sipc->instate = NN_SIPC_INSTATE_RING;
+        nn_sipc_ringrecv (sipc);
+        return 0;
+    }
+
     /*  Start receiving new message. */
-    sipc->instate = NN_SIPC_INSTATE_HDR;
-    nn_usock_recv (sipc->usock, sipc->inhdr, sizeof (sipc->inhdr), NULL);
+    nn_sipc_recv_hdr (sipc);
 
     return 0;
 }
 
+static void nn_sipc_close (struct nn_pipebase *self)
+{
+    struct nn_sipc *sipc;
+
+    sipc = nn_cont (self, struct nn_sipc, pipebase);
+
+    /*  If the connection is already failing there's nothing to do. */
+    if (sipc->state != NN_SIPC_STATE_ACTIVE)
+        return;
+
+    /*  Drop the connection the same way as if it was broken. The owner
+        will stop this object which in turn removes the pipe from
+        the socket. */
+    sipc->state = NN_SIPC_STATE_DONE;
+    nn_fsm_raise (&sipc->fsm, &sipc->done, NN_SIPC_ERROR);
+}
+
+static size_t nn_sipc_backlog (struct nn_pipebase *self)
+{
+    struct nn_sipc *sipc;
+
+    sipc = nn_cont (self, struct nn_sipc, pipebase);
+
+    if (sipc->state != NN_SIPC_STATE_ACTIVE)
+        return 0;
+    if (sipc->rings)
+        return nn_ring_used (&sipc->txring);
+    return sipc->outbytes + sipc->outbatch.size + (sipc->hasnext ?
+        nn_chunkref_size (&sipc->outnext.sphdr) +
+        nn_chunkref_size (&sipc->outnext.body) : 0);
+}
+
 static void nn_sipc_shutdown (struct nn_fsm *self, int src, int type,
     NN_UNUSED void *srcptr)
 {
@@ -193,6 +509,7 @@ static void nn_sipc_shutdown (struct nn_fsm *self, int src, int type,
             sipc->usock = NULL;
             sipc->usock_owner.src = -1;
             sipc->usock_owner.fsm = NULL;
+            nn_sipc_closerings (sipc);
             sipc->state = NN_SIPC_STATE_IDLE;
             nn_fsm_stopped (&sipc->fsm, NN_SIPC_STOPPED);
             return;
@@ -211,6 +528,12 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
     uint64_t size;
     int opt;
     size_t opt_sz = sizeof (opt);
+    int features;
+#if !defined NN_HAVE_WINDOWS
+    int fd;
+    void *chunk;
+    struct nn_iovec iov;
+#endif
 
     sipc = nn_cont (self, struct nn_sipc, fsm);
 
@@ -226,8 +549,21 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
         case NN_FSM_ACTION:
             switch (type) {
             case NN_FSM_START:
+
+                /*  The features are offered only if they were asked for. */
+                features = 0;
+                nn_pipebase_getopt (&sipc->pipebase, NN_IPC, NN_IPC_BATCH,
+                    &opt, &opt_sz);
+                nn_assert (opt_sz == sizeof (opt));
+                if (opt)
+                    features |= NN_STREAMHDR_BATCH;
+                nn_pipebase_getopt (&sipc->pipebase, NN_IPC, NN_IPC_VARINT,
+                    &opt, &opt_sz);
+                nn_assert (opt_sz == sizeof (opt));
+                if (opt)
+                    features |= NN_STREAMHDR_VARINT;
                 nn_streamhdr_start (&sipc->streamhdr, sipc->usock,
-                    &sipc->pipebase);
+                    &sipc->pipebase, sipc->rings ? 0 : features);
                 sipc->state = NN_SIPC_STATE_PROTOHDR;
                 return;
             default:
@@ -280,6 +616,33 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
             switch (type) {
             case NN_STREAMHDR_STOPPED:
 
+#if !defined NN_HAVE_WINDOWS
+                 /*  Create the ring to receive messages from and pass it
+                     to the peer. At the same time, start waiting for
+                     the ring from the peer. */
+                 if (sipc->rings) {
+                    opt_sz = sizeof (opt);
+                    nn_pipebase_getopt (&sipc->pipebase, NN_SHM,
+                        NN_SHM_RINGSZ, &opt, &opt_sz);
+                    rc = nn_ring_create (&sipc->rxring, (size_t) opt);
+                    if (nn_slow (rc < 0)) {
+                        sipc->state = NN_SIPC_STATE_DONE;
+                        nn_fsm_raise (&sipc->fsm, &sipc->done,
+                            NN_SIPC_ERROR);
+                        return;
+                    }
+                    iov.iov_base = sipc->outhdr;
+                    iov.iov_len = nn_sipc_puthdr (sipc, NN_SIPC_MSG_RING,
+                        (uint64_t) opt);
+                    nn_usock_send_fd (sipc->usock, &iov, 1, sipc->rxring.fd);
+                    nn_usock_recv (sipc->usock, sipc->inhdr,
+                        sizeof (sipc->inhdr), NULL);
+                    sipc->setup = 0;
+                    sipc->state = NN_SIPC_STATE_SETUP;
+                    return;
+                 }
+#endif
+
                  /*  Start the pipe. */
                  rc = nn_pipebase_start (&sipc->pipebase);
                  if (nn_slow (rc < 0)) {
@@ -288,10 +651,19 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
                     return;
                  }
 
+                 sipc->batch = !!(sipc->streamhdr.features &
+                     NN_STREAMHDR_BATCH);
+                 nn_batch_reset (&sipc->inbatch);
+                 nn_batch_reset (&sipc->outbatch);
+                 nn_msg_term (&sipc->outnext);
+                 nn_msg_init (&sipc->outnext, 0);
+                 sipc->hasnext = 0;
+                 sipc->outbytes = 0;
+                 sipc->varint = !!(sipc->streamhdr.features &
+                     NN_STREAMHDR_VARINT);
+
                  /*  Start receiving a message in asynchronous manner. */
-                 sipc->instate = NN_SIPC_INSTATE_HDR;
-                 nn_usock_recv (sipc->usock, &sipc->inhdr,
-                     sizeof (sipc->inhdr), NULL);
+                 nn_sipc_recv_hdr (sipc);
 
                  /*  Mark the pipe as available for sending. */
                  sipc->outstate = NN_SIPC_OUTSTATE_IDLE;
@@ -307,6 +679,85 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
             nn_fsm_bad_source (sipc->state, src, type);
         }
 
+/******************************************************************************/
+/*  SETUP state.                                                              */
+/*  The rings are being exchanged with the peer.                              */
+/******************************************************************************/
+#if !defined NN_HAVE_WINDOWS
+    case NN_SIPC_STATE_SETUP:
+        switch (src) {
+
+        case NN_SIPC_SRC_USOCK:
+            switch (type) {
+            case NN_USOCK_SENT:
+
+                /*  The peer has its own copy of the file descriptor now. */
+                nn_ring_closefd (&sipc->rxring);
+                sipc->setup |= NN_SIPC_SETUP_SENT;
+                break;
+
+            case NN_USOCK_RECEIVED:
+
+                /*  Map the ring the peer is going to read messages from. */
+                rc = -EPROTO;
+                fd = nn_usock_recvfd (sipc->usock);
+                if (fd >= 0) {
+                    size = nn_getll (sipc->inhdr + 1);
+                    if (sipc->inhdr [0] == NN_SIPC_MSG_RING &&
+                          size <= NN_RING_MAXSIZE)
+                        rc = nn_ring_attach (&sipc->txring, fd,
+                            (size_t) size);
+                    nn_closefd (fd);
+                }
+                if (nn_slow (rc < 0)) {
+                    sipc->state = NN_SIPC_STATE_DONE;
+                    nn_fsm_raise (&sipc->fsm, &sipc->done, NN_SIPC_ERROR);
+                    return;
+                }
+                sipc->setup |= NN_SIPC_SETUP_RECEIVED;
+                break;
+
+            case NN_USOCK_SHUTDOWN:
+                sipc->state = NN_SIPC_STATE_SHUTTING_DOWN;
+                return;
+
+            case NN_USOCK_ERROR:
+                sipc->state = NN_SIPC_STATE_DONE;
+                nn_fsm_raise (&sipc->fsm, &sipc->done, NN_SIPC_ERROR);
+                return;
+
+            default:
+                nn_fsm_bad_action (sipc->state, src, type);
+            }
+
+            if (sipc->setup != (NN_SIPC_SETUP_SENT | NN_SIPC_SETUP_RECEIVED))
+                return;
+
+            /*  Both rings are in place. Start the pipe. */
+            rc = nn_pipebase_start (&sipc->pipebase);
+            if (nn_slow (rc < 0)) {
+               sipc->state = NN_SIPC_STATE_DONE;
+               nn_fsm_raise (&sipc->fsm, &sipc->done, NN_SIPC_ERROR);
+               return;
+            }
+
+            /*  From now on, the socket carries only wake-up messages. */
+            nn_usock_recv (sipc->usock, &sipc->bellin,
+                sizeof (sipc->bellin), NULL);
+            sipc->bellstate = NN_SIPC_BELLSTATE_IDLE;
+            sipc->outstate = NN_SIPC_OUTSTATE_IDLE;
+            sipc->state = NN_SIPC_STATE_ACTIVE;
+
+            /*  The peer may have written some messages already. */
+            sipc->instate = NN_SIPC_INSTATE_RING;
+            nn_sipc_ringrecv (sipc);
+            return;
+
+        default:
+            nn_fsm_bad_source (sipc->state, src, type);
+        }
+#endif
+
 /******************************************************************************/
 /*  ACTIVE state.                                                             */
 /******************************************************************************/
@@ -314,15 +765,34 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
         switch (src) {
 
         case NN_SIPC_SRC_USOCK:
+
+            /*  With the rings, the socket is used only to wake up
+                the peer. Whenever woken up, check both of the rings. */
+            if (sipc->rings && type == NN_USOCK_SENT) {
+                if (sipc->bellstate == NN_SIPC_BELLSTATE_AGAIN) {
+                    sipc->bellstate = NN_SIPC_BELLSTATE_IDLE;
+                    nn_sipc_bell (sipc);
+                    return;
+                }
+                sipc->bellstate = NN_SIPC_BELLSTATE_IDLE;
+                return;
+            }
+            if (sipc->rings && type == NN_USOCK_RECEIVED) {
+                nn_usock_recv (sipc->usock, &sipc->bellin,
+                    sizeof (sipc->bellin), NULL);
+                if (sipc->instate == NN_SIPC_INSTATE_RING)
+                    nn_sipc_ringrecv (sipc);
+                if (sipc->state == NN_SIPC_STATE_ACTIVE &&
+                      sipc->outstate == NN_SIPC_OUTSTATE_SENDING)
+                    nn_sipc_ringsend (sipc);
+                return;
+            }
+
             switch (type) {
             case NN_USOCK_SENT:
 
-                /*  The message is now fully sent. */
-                nn_assert (sipc->outstate == NN_SIPC_OUTSTATE_SENDING);
-                sipc->outstate = NN_SIPC_OUTSTATE_IDLE;
-                nn_msg_term (&sipc->outmsg);
-                nn_msg_init (&sipc->outmsg, 0);
-                nn_pipebase_sent (&sipc->pipebase);
+                /*  The frame is now fully sent. */
+                nn_sipc_sent (sipc);
                 return;
 
             case NN_USOCK_RECEIVED:
@@ -333,9 +803,25 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
                     /*  Message header was received. Check that message size
                         is acceptable by comparing with NN_RCVMAXSIZE;
                         if it's too large, drop the connection. */
-                    nn_assert (sipc->inhdr [0] == NN_SIPC_MSG_NORMAL);
                     size = nn_getll (sipc->inhdr + 1);
 
+                    /*  Batch of messages is received as a whole. Batches
+                        are accepted only if they were agreed on. */
+                    if (sipc->inhdr [0] == NN_SIPC_MSG_BATCH) {
+                        if (nn_slow (!sipc->batch || size == 0 ||
+                              size > NN_BATCH_MAXSIZE)) {
+                            sipc->state = NN_SIPC_STATE_DONE;
+                            nn_fsm_raise (&sipc->fsm, &sipc->done,
+                                NN_SIPC_ERROR);
+                            return;
+                        }
+                        sipc->instate = NN_SIPC_INSTATE_BATCH;
+                        nn_usock_recv (sipc->usock,
+                            nn_batch_recvbuf (&sipc->inbatch, (size_t) size),
+                            (size_t) size, NULL);
+                        return;
+                    }
+
                     nn_pipebase_getopt (&sipc->pipebase, NN_SOL_SOCKET,
                         NN_RCVMAXSIZE, &opt, &opt_sz);
 
@@ -345,23 +831,81 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
                         return;
                     }
 
-                    /*  Allocate memory for the message. */
-                    nn_msg_term (&sipc->inmsg);
-                    nn_msg_init (&sipc->inmsg, (size_t) size);
-
-                    /*  Special case when size of the message body is 0. */
-                    if (!size) {
+#if !defined NN_HAVE_WINDOWS
+                    /*  The message body lives in a shared memory segment
+                        passed along with the header. Map it into the memory
+                        instead of receiving it. */
+                    if (sipc->inhdr [0] == NN_SIPC_MSG_SHMEM) {
+                        fd = nn_usock_recvfd (sipc->usock);
+                        rc = -EPROTO;
+                        if (fd >= 0) {
+                            rc = nn_shmem_map (fd, (size_t) size, &chunk);
+                            nn_closefd (fd);
+                        }
+                        if (nn_slow (rc < 0)) {
+                            sipc->state = NN_SIPC_STATE_DONE;
+                            nn_fsm_raise (&sipc->fsm, &sipc->done,
+                                NN_SIPC_ERROR);
+                            return;
+                        }
+                        nn_msg_term (&sipc->inmsg);
+                        nn_msg_init_chunk (&sipc->inmsg, chunk);
                         sipc->instate = NN_SIPC_INSTATE_HASMSG;
                         nn_pipebase_received (&sipc->pipebase);
                         return;
                     }
+#endif
+
+                    /*  Drop the connection if the peer sends something
+                        unknown. */
+                    if (nn_slow (sipc->inhdr [0] != NN_SIPC_MSG_NORMAL)) {
+                        sipc->state = NN_SIPC_STATE_DONE;
+                        nn_fsm_raise (&sipc->fsm, &sipc->done, NN_SIPC_ERROR);
+                        return;
+                    }
+
+                    rc = nn_sipc_recv_msg (sipc, size);
+                    errnum_assert (rc == 0, -rc);
+                    return;
 
-                    /*  Start receiving the message body. */
-                    sipc->instate = NN_SIPC_INSTATE_BODY;
-                    nn_usock_recv (sipc->usock,
-                        nn_chunkref_data (&sipc->inmsg.body),
-                        (size_t) size, NULL);
+                case NN_SIPC_INSTATE_VARINT:
 
+                    /*  First byte of the compact header was received. It
+                        tells how many bytes of the header follow, if any. */
+                    rc = nn_varint_len (sipc->inhdr [0]);
+                    if (nn_slow (rc < 0)) {
+                        sipc->state = NN_SIPC_STATE_DONE;
+                        nn_fsm_raise (&sipc->fsm, &sipc->done, NN_SIPC_ERROR);
+                        return;
+                    }
+                    if (rc == 0) {
+                        sipc->instate = NN_SIPC_INSTATE_HDR;
+                        nn_usock_recv (sipc->usock, sipc->inhdr,
+                            sizeof (sipc->inhdr), NULL);
+                        return;
+                    }
+                    if (rc == 2) {
+                        sipc->instate = NN_SIPC_INSTATE_VARINT2;
+                        nn_usock_recv (sipc->usock, sipc->inhdr + 1, 1, NULL);
+                        return;
+                    }
+                    rc = nn_sipc_recv_msg (sipc, nn_varint_get (sipc->inhdr));
+                    if (nn_slow (rc < 0)) {
+                        sipc->state = NN_SIPC_STATE_DONE;
+                        nn_fsm_raise (&sipc->fsm, &sipc->done, NN_SIPC_ERROR);
+                        return;
+                    }
+                    return;
+
+                case NN_SIPC_INSTATE_VARINT2:
+
+                    /*  The rest of the compact header was received. */
+                    rc = nn_sipc_recv_msg (sipc, nn_varint_get (sipc->inhdr));
+                    if (nn_slow (rc < 0)) {
+                        sipc->state = NN_SIPC_STATE_DONE;
+                        nn_fsm_raise (&sipc->fsm, &sipc->done, NN_SIPC_ERROR);
+                        return;
+                    }
                     return;
 
                 case NN_SIPC_INSTATE_BODY:
@@ -373,6 +917,24 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
 
                     return;
 
+                case NN_SIPC_INSTATE_BATCH:
+
+                    /*  Batch was received. Check it as a whole so that
+                        the connection can't fail while the messages are
+                        being handed to the user. */
+                    nn_pipebase_getopt (&sipc->pipebase, NN_SOL_SOCKET,
+                        NN_RCVMAXSIZE, &opt, &opt_sz);
+                    rc = nn_batch_check (&sipc->inbatch, opt);
+                    if (nn_slow (rc < 0)) {
+                        sipc->state = NN_SIPC_STATE_DONE;
+                        nn_fsm_raise (&sipc->fsm, &sipc->done, NN_SIPC_ERROR);
+                        return;
+                    }
+                    nn_batch_get (&sipc->inbatch, &sipc->inmsg);
+                    sipc->instate = NN_SIPC_INSTATE_HASMSG;
+                    nn_pipebase_received (&sipc->pipebase);
+                    return;
+
                 default:
                     nn_assert (0);
                 }
@@ -435,3 +997,122 @@ static void nn_sipc_handler (struct nn_fsm *self, int src, int type,
         nn_fsm_bad_state (sipc->state, src, type);
     }
 }
+
+static void nn_sipc_closeoutfd (struct nn_sipc *self)
+{
+    if (self->outfd >= 0) {
+        nn_closefd (self->outfd);
+        self->outfd = -1;
+    }
+}
+
+static void nn_sipc_closerings (struct nn_sipc *self)
+{
+    nn_ring_close (&self->rxring);
+    nn_ring_close (&self->txring);
+    self->inpos = 0;
+    self->outpos = 0;
+    self->setup = 0;
+    self->bellstate = NN_SIPC_BELLSTATE_IDLE;
+}
+
+static void nn_sipc_ringsend (struct nn_sipc *self)
+{
+    int rc;
+    size_t pos;
+    struct nn_iovec iov [2];
+
+    nn_assert (self->outstate == NN_SIPC_OUTSTATE_SENDING);
+
+    iov [0].iov_base = nn_chunkref_data (&self->outmsg.sphdr);
+    iov [0].iov_len = nn_chunkref_size (&self->outmsg.sphdr);
+    iov [1].iov_base = nn_chunkref_data (&self->outmsg.body);
+    iov [1].iov_len = nn_chunkref_size (&self->outmsg.body);
+
+    for (;;) {
+        pos = self->outpos;
+        rc = nn_ring_send (&self->txring, iov, 2, &self->outpos);
+        if (nn_slow (rc < 0)) {
+            self->state = NN_SIPC_STATE_DONE;
+            nn_fsm_raise (&self->fsm, &self->done, NN_SIPC_ERROR);
+            return;
+        }
+
+        /*  Wake up the peer if it's waiting for new messages. */
+        if ((rc == 1 || self->outpos != pos) &&
+              nn_ring_wakereader (&self->txring))
+            nn_sipc_bell (self);
+
+        /*  The message is now fully sent. */
+        if (rc == 1) {
+            self->outstate = NN_SIPC_OUTSTATE_IDLE;
+            nn_msg_term (&self->outmsg);
+            nn_msg_init (&self->outmsg, 0);
+            nn_pipebase_sent (&self->pipebase);
+            return;
+        }
+
+        /*  The ring is full. Wait till the peer makes some space. */
+        if (nn_ring_wait (&self->txring))
+            return;
+    }
+}
+
+static void nn_sipc_ringrecv (struct nn_sipc *self)
+{
+    int rc;
+    int maxsize;
+    size_t sz;
+    uint64_t pos;
+
+    nn_assert (self->instate == NN_SIPC_INSTATE_RING);
+
+    sz = sizeof (maxsize);
+    nn_pipebase_getopt (&self->pipebase, NN_SOL_SOCKET, NN_RCVMAXSIZE,
+        &maxsize, &sz);
+
+    for (;;) {
+        pos = self->rxring.pos;
+        rc = nn_ring_recv (&self->rxring, &self->inmsg, &self->inpos,
+            maxsize);
+
+        /*  Wake up the peer if it's waiting for space in the ring. */
+        if (self->rxring.pos != pos && nn_ring_wakewriter (&self->rxring))
+            nn_sipc_bell (self);
+
+        if (nn_slow (rc < 0)) {
+            self->state = NN_SIPC_STATE_DONE;
+            nn_fsm_raise (&self->fsm, &self->done, NN_SIPC_ERROR);
+            return;
+        }
+
+        /*  Whole message was read. Notify the owner that it can receive
+            it. */
+        if (rc == 1) {
+            self->instate = NN_SIPC_INSTATE_HASMSG;
+            nn_pipebase_received (&self->pipebase);
+            return;
+        }
+
+        /*  The ring is empty. Wait till the peer writes more data. */
+        if (nn_ring_sleep (&self->rxring))
+            return;
+    }
+}
+
+static void nn_sipc_bell (struct nn_sipc *self)
+{
+    struct nn_iovec iov;
+
+    /*  Only one send can be in progress at a time. If there's one already,
+        send another wake-up message once it's done. */
+    if (self->bellstate != NN_SIPC_BELLSTATE_IDLE) {
+        self->bellstate = NN_SIPC_BELLSTATE_AGAIN;
+        return;
+    }
+
+    iov.iov_base = &self->bellout;
+    iov.iov_len = sizeof (self->bellout);
+    nn_usock_send (self->usock, &iov, 1);
+    self->bellstate = NN_SIPC_BELLSTATE_SENDING;
+}
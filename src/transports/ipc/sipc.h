@@ -30,6 +30,8 @@
 #include "../../aio/usock.h"
 
 #include "../utils/streamhdr.h"
+#include "../utils/ring.h"
+#include "../utils/batch.h"
 
 #include "../../utils/msg.h"
 
@@ -60,27 +62,83 @@ struct nn_sipc {
     /*  State of inbound state machine. */
     int instate;
 
+    /*  1 if the peers agreed on compact frame headers. */
+    int varint;
+
     /*  Buffer used to store the header of incoming message. */
     uint8_t inhdr [9];
 
     /*  Message being received at the moment. */
     struct nn_msg inmsg;
 
+    /*  Batch of messages being received or handed to the user. */
+    struct nn_batch inbatch;
+
     /*  State of the outbound state machine. */
     int outstate;
 
-    /*  Buffer used to store the header of outgoing message. */
-    uint8_t outhdr [9];
+    /*  Buffer used to store the header of outgoing message, preceded by
+        the escape byte in case of compact headers. */
+    uint8_t outhdr [10];
 
     /*  Message being sent at the moment. */
     struct nn_msg outmsg;
 
+    /*  Shared memory segment holding the message being sent at the moment,
+        or -1 if the message is sent inline. */
+    int outfd;
+
+    /*  1 if the peer accepts batches of messages. */
+    int batch;
+
+    /*  Small messages gathered while a frame is being sent and the batch
+        being sent at the moment. */
+    struct nn_batch outbatch;
+    struct nn_batch sendbatch;
+
+    /*  Message that couldn't be batched and waits for the batch to be sent,
+        if 'hasnext' is set. */
+    struct nn_msg outnext;
+    int hasnext;
+
+    /*  Size of the frame being sent at the moment, or of the message being
+        prepared to be sent. Together with the above it makes up the amount
+        of data waiting in the pipe. */
+    size_t outbytes;
+
+    /*  Messages of this size or larger are passed via shared memory.
+        Negative value means that shared memory is not used. */
+    int shmem_threshold;
+
+    /*  If set, messages are passed via a pair of shared memory rings and
+        the socket is only used to wake up the peer when it's idle. */
+    int rings;
+
+    /*  The ring messages are received from (created by this side) and
+        the ring messages are sent to (created by the peer). */
+    struct nn_ring rxring;
+    struct nn_ring txring;
+
+    /*  Number of bytes of the inbound and outbound message transferred via
+        the rings so far. */
+    size_t inpos;
+    size_t outpos;
+
+    /*  Progress of the exchange of the rings with the peer. */
+    int setup;
+
+    /*  Wake-up messages received from and sent to the peer, and the state of
+        the latter. */
+    uint8_t bellin;
+    uint8_t bellout;
+    int bellstate;
+
     /*  Event raised when the state machine ends. */
     struct nn_fsm_event done;
 };
 
 void nn_sipc_init (struct nn_sipc *self, int src,
-    struct nn_ep *ep, struct nn_fsm *owner);
+    struct nn_ep *ep, int rings, struct nn_fsm *owner);
 void nn_sipc_term (struct nn_sipc *self);
 
 int nn_sipc_isidle (struct nn_sipc *self);
@@ -0,0 +1,153 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "../ipc/bipc.h"
+#include "../ipc/cipc.h"
+#include "../utils/ring.h"
+
+#include "../../shm.h"
+
+#include "../../utils/err.h"
+#include "../../utils/alloc.h"
+#include "../../utils/cont.h"
+
+#include <string.h>
+
+/*  The shm transport uses the same connection establishment as the ipc
+    transport. Once connected, the peers map a pair of shared memory rings
+    and the IPC connection is used only to wake up an idle peer. */
+
+/*  Default size of the ring in which the messages are received. */
+#define NN_SHM_DEFAULT_RINGSZ (1024 * 1024)
+
+/*  shm-specific socket options. */
+struct nn_shm_optset {
+    struct nn_optset base;
+    int ringsz;
+};
+
+static void nn_shm_optset_destroy (struct nn_optset *self);
+static int nn_shm_optset_setopt (struct nn_optset *self, int option,
+    const void *optval, size_t optvallen);
+static int nn_shm_optset_getopt (struct nn_optset *self, int option,
+    void *optval, size_t *optvallen);
+static const struct nn_optset_vfptr nn_shm_optset_vfptr = {
+    nn_shm_optset_destroy,
+    nn_shm_optset_setopt,
+    nn_shm_optset_getopt
+};
+
+/*  nn_transport interface. */
+static int nn_shm_bind (struct nn_ep *ep);
+static int nn_shm_connect (struct nn_ep *ep);
+static struct nn_optset *nn_shm_optset (void);
+
+struct nn_transport nn_shm = {
+    "shm",
+    NN_SHM,
+    NULL,
+    NULL,
+    nn_shm_bind,
+    nn_shm_connect,
+    nn_shm_optset,
+};
+
+static int nn_shm_bind (struct nn_ep *ep)
+{
+    if (!nn_ring_supported ())
+        return -EPROTONOSUPPORT;
+    return nn_bipc_create (ep, 1);
+}
+
+static int nn_shm_connect (struct nn_ep *ep)
+{
+    if (!nn_ring_supported ())
+        return -EPROTONOSUPPORT;
+    return nn_cipc_create (ep, 1);
+}
+
+static struct nn_optset *nn_shm_optset ()
+{
+    struct nn_shm_optset *optset;
+
+    optset = nn_alloc (sizeof (struct nn_shm_optset), "optset (shm)");
+    alloc_assert (optset);
+    optset->base.vfptr = &nn_shm_optset_vfptr;
+
+    /*  Default values for the shm options. */
+    optset->ringsz = NN_SHM_DEFAULT_RINGSZ;
+
+    return &optset->base;
+}
+
+static void nn_shm_optset_destroy (struct nn_optset *self)
+{
+    struct nn_shm_optset *optset;
+
+    optset = nn_cont (self, struct nn_shm_optset, base);
+    nn_free (optset);
+}
+
+static int nn_shm_optset_setopt (struct nn_optset *self, int option,
+    const void *optval, size_t optvallen)
+{
+    struct nn_shm_optset *optset;
+    int val;
+
+    optset = nn_cont (self, struct nn_shm_optset, base);
+    if (optvallen != sizeof (int))
+        return -EINVAL;
+    val = *(int*) optval;
+
+    switch (option) {
+    case NN_SHM_RINGSZ:
+        if (val < NN_RING_MINSIZE || val > NN_RING_MAXSIZE ||
+              (val & (val - 1)))
+            return -EINVAL;
+        optset->ringsz = val;
+        return 0;
+    default:
+        return -ENOPROTOOPT;
+    }
+}
+
+static int nn_shm_optset_getopt (struct nn_optset *self, int option,
+    void *optval, size_t *optvallen)
+{
+    struct nn_shm_optset *optset;
+    int intval;
+
+    optset = nn_cont (self, struct nn_shm_optset, base);
+
+    switch (option) {
+    case NN_SHM_RINGSZ:
+        intval = optset->ringsz;
+        break;
+    default:
+        return -ENOPROTOOPT;
+    }
+    memcpy (optval, &intval,
+        *optvallen < sizeof (int) ? *optvallen : sizeof (int));
+    *optvallen = sizeof (int);
+    return 0;
+}
@@ -24,6 +24,8 @@
 #include "btcp.h"
 #include "atcp.h"
 
+#include "../../tcp.h"
+
 #include "../utils/port.h"
 #include "../utils/iface.h"
 
@@ -45,11 +47,17 @@
 #else
 #include <unistd.h>
 #include <netinet/in.h>
+#include <sys/socket.h>
 #endif
 
 /*  The backlog is set relatively high so that there are not too many failed
-    connection attemps during re-connection storms. */
-#define NN_BTCP_BACKLOG 100
+    connection attemps during re-connection storms. Each connection that
+    doesn't fit into the backlog costs the client a SYN retransmission, i.e.
+    a second or more. The OS caps the value at its own limit (somaxconn). */
+#define NN_BTCP_BACKLOG 1024
+
+/*  Maximal number of stopped atcp objects kept for re-use. */
+#define NN_BTCP_MAXIDLE 32
 
 #define NN_BTCP_STATE_IDLE 1
 #define NN_BTCP_STATE_ACTIVE 2
@@ -60,6 +68,15 @@
 #define NN_BTCP_SRC_USOCK 1
 #define NN_BTCP_SRC_ATCP 2
 
+struct nn_btcp_listener {
+
+    /*  The underlying listening TCP socket. */
+    struct nn_usock usock;
+
+    /*  The connection being accepted at the moment. */
+    struct nn_atcp *atcp;
+};
+
 struct nn_btcp {
 
     /*  The state machine. */
@@ -68,14 +85,26 @@ struct nn_btcp {
 
     struct nn_ep *ep;
 
-    /*  The underlying listening TCP socket. */
-    struct nn_usock usock;
+    /*  The listening sockets. If there's more than one (NN_TCP_LISTENERS),
+        they are all bound to the same address using SO_REUSEPORT and the
+        kernel spreads the incoming connections among them. The listeners
+        are spread across the worker threads of the pool and the accepted
+        connections stay with the worker thread of their listener. */
+    struct nn_btcp_listener *listeners;
+    int nlisteners;
 
-    /*  The connection being accepted at the moment. */
-    struct nn_atcp *atcp;
+    /*  If set (NN_TCP_REUSEPORT), the address can be shared with other
+        sockets even if there's a single listener. */
+    int reuseport;
 
     /*  List of accepted connections. */
     struct nn_list atcps;
+
+    /*  Stopped atcp objects kept for accepting new connections, so that
+        a burst of reconnections doesn't have to allocate and initialise
+        a new state machine per connection. */
+    struct nn_list idle;
+    int nidle;
 };
 
 /*  nn_ep virtual interface implementation. */
@@ -92,7 +121,10 @@ static void nn_btcp_handler (struct nn_fsm *self, int src, int type,
 static void nn_btcp_shutdown (struct nn_fsm *self, int src, int type,
     void *srcptr);
 static int nn_btcp_listen (struct nn_btcp *self);
-static void nn_btcp_start_accepting (struct nn_btcp *self);
+static int nn_btcp_listen_usock (struct nn_btcp *self, struct nn_usock *usock,
+    struct sockaddr_storage *ss, size_t sslen);
+static void nn_btcp_start_accepting (struct nn_btcp *self,
+    struct nn_btcp_listener *listener);
 
 int nn_btcp_create (struct nn_ep *ep)
 {
@@ -105,6 +137,11 @@ int nn_btcp_create (struct nn_ep *ep)
     size_t sslen;
     int ipv4only;
     size_t ipv4onlylen;
+    int nlisteners;
+    size_t nlistenerslen;
+    int reuseport;
+    size_t reuseportlen;
+    int i;
 
     /*  Allocate the new endpoint object. */
     self = nn_alloc (sizeof (struct nn_btcp), "btcp");
@@ -140,17 +177,43 @@ int nn_btcp_create (struct nn_ep *ep)
         return -ENODEV;
     }
 
+    /*  Check how many listening sockets are to be opened. */
+    nlistenerslen = sizeof (nlisteners);
+    nn_ep_getopt (ep, NN_TCP, NN_TCP_LISTENERS, &nlisteners, &nlistenerslen);
+    nn_assert (nlistenerslen == sizeof (nlisteners));
+    reuseportlen = sizeof (reuseport);
+    nn_ep_getopt (ep, NN_TCP, NN_TCP_REUSEPORT, &reuseport, &reuseportlen);
+    nn_assert (reuseportlen == sizeof (reuseport));
+#if !defined SO_REUSEPORT
+    if (nlisteners > 1 || reuseport) {
+        nn_free (self);
+        return -ENOTSUP;
+    }
+#endif
+
     /*  Initialise the structure. */
     nn_fsm_init_root (&self->fsm, nn_btcp_handler, nn_btcp_shutdown,
         nn_ep_getctx (ep));
     self->state = NN_BTCP_STATE_IDLE;
-    self->atcp = NULL;
+    self->listeners = nn_alloc (sizeof (struct nn_btcp_listener) * nlisteners,
+        "btcp listeners");
+    alloc_assert (self->listeners);
+    self->nlisteners = nlisteners;
+    self->reuseport = reuseport;
     nn_list_init (&self->atcps);
+    nn_list_init (&self->idle);
+    self->nidle = 0;
 
     /*  Start the state machine. */
     nn_fsm_start (&self->fsm);
 
-    nn_usock_init (&self->usock, NN_BTCP_SRC_USOCK, &self->fsm);
+    for (i = 0; i != nlisteners; ++i) {
+        nn_usock_init (&self->listeners [i].usock, NN_BTCP_SRC_USOCK,
+            &self->fsm);
+        if (nlisteners > 1)
+            nn_usock_spread (&self->listeners [i].usock);
+        self->listeners [i].atcp = NULL;
+    }
 
     rc = nn_btcp_listen (self);
     if (rc != 0) {
@@ -171,11 +234,23 @@ static void nn_btcp_stop (void *self)
 static void nn_btcp_destroy (void *self)
 {
     struct nn_btcp *btcp = self;
+    struct nn_atcp *atcp;
+    int i;
 
     nn_assert_state (btcp, NN_BTCP_STATE_IDLE);
+    while (!nn_list_empty (&btcp->idle)) {
+        atcp = nn_cont (nn_list_begin (&btcp->idle), struct nn_atcp, item);
+        nn_list_erase (&btcp->idle, &atcp->item);
+        nn_atcp_term (atcp);
+        nn_free (atcp);
+    }
+    nn_list_term (&btcp->idle);
     nn_list_term (&btcp->atcps);
-    nn_assert (btcp->atcp == NULL);
-    nn_usock_term (&btcp->usock);
+    for (i = 0; i != btcp->nlisteners; ++i) {
+        nn_assert (btcp->listeners [i].atcp == NULL);
+        nn_usock_term (&btcp->listeners [i].usock);
+    }
+    nn_free (btcp->listeners);
     nn_fsm_term (&btcp->fsm);
 
     nn_free (btcp);
@@ -187,30 +262,37 @@ static void nn_btcp_shutdown (struct nn_fsm *self, int src, int type,
     struct nn_btcp *btcp;
     struct nn_list_item *it;
     struct nn_atcp *atcp;
+    struct nn_btcp_listener *listener;
+    int i;
 
     btcp = nn_cont (self, struct nn_btcp, fsm);
 
     if (nn_slow (src == NN_FSM_ACTION && type == NN_FSM_STOP)) {
-        if (btcp->atcp) {
-            nn_atcp_stop (btcp->atcp);
-            btcp->state = NN_BTCP_STATE_STOPPING_ATCP;
-        }
-        else {
-            btcp->state = NN_BTCP_STATE_STOPPING_USOCK;
-        }
+        for (i = 0; i != btcp->nlisteners; ++i)
+            if (btcp->listeners [i].atcp)
+                nn_atcp_stop (btcp->listeners [i].atcp);
+        btcp->state = NN_BTCP_STATE_STOPPING_ATCP;
     }
     if (nn_slow (btcp->state == NN_BTCP_STATE_STOPPING_ATCP)) {
-        if (!nn_atcp_isidle (btcp->atcp))
-            return;
-        nn_atcp_term (btcp->atcp);
-        nn_free (btcp->atcp);
-        btcp->atcp = NULL;
-        nn_usock_stop (&btcp->usock);
+        for (i = 0; i != btcp->nlisteners; ++i)
+            if (btcp->listeners [i].atcp &&
+                  !nn_atcp_isidle (btcp->listeners [i].atcp))
+                return;
+        for (i = 0; i != btcp->nlisteners; ++i) {
+            listener = &btcp->listeners [i];
+            if (listener->atcp) {
+                nn_atcp_term (listener->atcp);
+                nn_free (listener->atcp);
+                listener->atcp = NULL;
+            }
+            nn_usock_stop (&listener->usock);
+        }
         btcp->state = NN_BTCP_STATE_STOPPING_USOCK;
     }
     if (nn_slow (btcp->state == NN_BTCP_STATE_STOPPING_USOCK)) {
-       if (!nn_usock_isidle (&btcp->usock))
-            return;
+        for (i = 0; i != btcp->nlisteners; ++i)
+            if (!nn_usock_isidle (&btcp->listeners [i].usock))
+                return;
         for (it = nn_list_begin (&btcp->atcps);
               it != nn_list_end (&btcp->atcps);
               it = nn_list_next (&btcp->atcps, it)) {
@@ -248,6 +330,8 @@ static void nn_btcp_handler (struct nn_fsm *self, int src, int type,
 {
     struct nn_btcp *btcp;
     struct nn_atcp *atcp;
+    struct nn_btcp_listener *listener;
+    int i;
 
     btcp = nn_cont (self, struct nn_btcp, fsm);
 
@@ -278,17 +362,27 @@ static void nn_btcp_handler (struct nn_fsm *self, int src, int type,
         atcp = (struct nn_atcp*) srcptr;
         switch (type) {
         case NN_ATCP_ACCEPTED:
-            nn_assert (btcp->atcp == atcp) ;
+            listener = NULL;
+            for (i = 0; i != btcp->nlisteners; ++i)
+                if (btcp->listeners [i].atcp == atcp)
+                    listener = &btcp->listeners [i];
+            nn_assert (listener);
             nn_list_insert (&btcp->atcps, &atcp->item,
                 nn_list_end (&btcp->atcps));
-            btcp->atcp = NULL;
-            nn_btcp_start_accepting (btcp);
+            listener->atcp = NULL;
+            nn_btcp_start_accepting (btcp, listener);
             return;
         case NN_ATCP_ERROR:
             nn_atcp_stop (atcp);
             return;
         case NN_ATCP_STOPPED:
             nn_list_erase (&btcp->atcps, &atcp->item);
+            if (btcp->nidle < NN_BTCP_MAXIDLE) {
+                nn_list_insert (&btcp->idle, &atcp->item,
+                    nn_list_end (&btcp->idle));
+                ++btcp->nidle;
+                return;
+            }
             nn_atcp_term (atcp);
             nn_free (atcp);
             return;
@@ -315,6 +409,7 @@ static int nn_btcp_listen (struct nn_btcp *self)
     const char *end;
     const char *pos;
     uint16_t port;
+    int i;
 
     /*  First, resolve the IP address. */
     addr = nn_ep_getaddr (self->ep);
@@ -357,23 +452,58 @@ static int nn_btcp_listen (struct nn_btcp *self)
     }
 
     /*  Start listening for incoming connections. */
-    rc = nn_usock_start (&self->usock, ss.ss_family, SOCK_STREAM, 0);
+    for (i = 0; i != self->nlisteners; ++i) {
+        rc = nn_btcp_listen_usock (self, &self->listeners [i].usock,
+            &ss, sslen);
+        if (rc < 0) {
+            while (i--)
+                nn_usock_stop (&self->listeners [i].usock);
+            return rc;
+        }
+    }
+    for (i = 0; i != self->nlisteners; ++i)
+        nn_btcp_start_accepting (self, &self->listeners [i]);
+
+    return 0;
+}
+
+static int nn_btcp_listen_usock (struct nn_btcp *self, struct nn_usock *usock,
+    struct sockaddr_storage *ss, size_t sslen)
+{
+    int rc;
+#if defined SO_REUSEPORT
+    int opt;
+#endif
+
+    rc = nn_usock_start (usock, ss->ss_family, SOCK_STREAM, 0);
     if (rc < 0) {
         return rc;
     }
 
-    rc = nn_usock_bind (&self->usock, (struct sockaddr*) &ss, (size_t) sslen);
+#if defined SO_REUSEPORT
+    /*  Let all the listeners bind to the same address. */
+    if (self->nlisteners > 1 || self->reuseport) {
+        opt = 1;
+        rc = nn_usock_setsockopt (usock, SOL_SOCKET, SO_REUSEPORT,
+            &opt, sizeof (opt));
+        if (rc < 0) {
+            nn_usock_stop (usock);
+            return rc;
+        }
+    }
+#endif
+
+    rc = nn_usock_bind (usock, (struct sockaddr*) ss, sslen);
     if (rc < 0) {
-       nn_usock_stop (&self->usock);
+       nn_usock_stop (usock);
        return rc;
     }
 
-    rc = nn_usock_listen (&self->usock, NN_BTCP_BACKLOG);
+    rc = nn_usock_listen (usock, NN_BTCP_BACKLOG);
     if (rc < 0) {
-        nn_usock_stop (&self->usock);
+        nn_usock_stop (usock);
         return rc;
     }
-    nn_btcp_start_accepting(self);
 
     return 0;
 }
@@ -382,15 +512,25 @@ static int nn_btcp_listen (struct nn_btcp *self)
 /*  State machine actions.                                                    */
 /******************************************************************************/
 
-static void nn_btcp_start_accepting (struct nn_btcp *self)
+static void nn_btcp_start_accepting (struct nn_btcp *self,
+    struct nn_btcp_listener *listener)
 {
-    nn_assert (self->atcp == NULL);
-
-    /*  Allocate new atcp state machine. */
-    self->atcp = nn_alloc (sizeof (struct nn_atcp), "atcp");
-    alloc_assert (self->atcp);
-    nn_atcp_init (self->atcp, NN_BTCP_SRC_ATCP, self->ep, &self->fsm);
+    nn_assert (listener->atcp == NULL);
+
+    /*  Re-use a stopped atcp state machine if there's one. Allocate a new
+        one otherwise. */
+    if (!nn_list_empty (&self->idle)) {
+        listener->atcp = nn_cont (nn_list_begin (&self->idle),
+            struct nn_atcp, item);
+        nn_list_erase (&self->idle, &listener->atcp->item);
+        --self->nidle;
+    }
+    else {
+        listener->atcp = nn_alloc (sizeof (struct nn_atcp), "atcp");
+        alloc_assert (listener->atcp);
+        nn_atcp_init (listener->atcp, NN_BTCP_SRC_ATCP, self->ep, &self->fsm);
+    }
 
     /*  Start waiting for a new incoming connection. */
-    nn_atcp_start (self->atcp, &self->usock);
+    nn_atcp_start (listener->atcp, &listener->usock);
 }
@@ -25,6 +25,8 @@
 #include "stcp.h"
 
 #include "../../tcp.h"
+#include "../../pipeline.h"
+#include "../../reqrep.h"
 
 #include "../utils/dns.h"
 #include "../utils/port.h"
@@ -68,6 +70,22 @@
 #define NN_CTCP_SRC_DNS 3
 #define NN_CTCP_SRC_STCP 4
 
+/*  The connecting endpoint. It opens NN_TCP_CONNECTIONS connections to the
+    same address. Each of them is handled by its own ctcp state machine and
+    yields a pipe of its own, so that the protocol spreads the messages
+    among them. */
+struct nn_ctcps {
+
+    struct nn_ep *ep;
+
+    /*  The connections. */
+    struct nn_ctcp *ctcps;
+    int nctcps;
+
+    /*  Number of ctcp state machines that already stopped. */
+    int nstopped;
+};
+
 struct nn_ctcp {
 
     /*  The state machine. */
@@ -76,6 +94,9 @@ struct nn_ctcp {
 
     struct nn_ep *ep;
 
+    /*  The endpoint this connection belongs to. */
+    struct nn_ctcps *owner;
+
     /*  The underlying TCP socket. */
     struct nn_usock usock;
 
@@ -101,6 +122,9 @@ const struct nn_ep_ops nn_ctcp_ep_ops = {
 };
 
 /*  Private functions. */
+static void nn_ctcp_init (struct nn_ctcp *self, struct nn_ctcps *owner,
+    int spread);
+static void nn_ctcp_term (struct nn_ctcp *self);
 static void nn_ctcp_handler (struct nn_fsm *self, int src, int type,
     void *srcptr);
 static void nn_ctcp_shutdown (struct nn_fsm *self, int src, int type,
@@ -122,13 +146,13 @@ int nn_ctcp_create (struct nn_ep *ep)
     size_t sslen;
     int ipv4only;
     size_t ipv4onlylen;
-    struct nn_ctcp *self;
-    int reconnect_ivl;
-    int reconnect_ivl_max;
+    struct nn_ctcps *self;
+    int nctcps;
     size_t sz;
+    int i;
 
     /*  Allocate the new endpoint object. */
-    self = nn_alloc (sizeof (struct nn_ctcp), "ctcp");
+    self = nn_alloc (sizeof (struct nn_ctcps), "ctcps");
     alloc_assert (self);
 
     /*  Initalise the endpoint. */
@@ -177,11 +201,54 @@ int nn_ctcp_create (struct nn_ep *ep)
         }
     }
 
+    /*  Check how many connections are to be opened. */
+    sz = sizeof (nctcps);
+    nn_ep_getopt (ep, NN_TCP, NN_TCP_CONNECTIONS, &nctcps, &sz);
+    nn_assert (sz == sizeof (nctcps));
+
+    /*  Each connection is a pipe of its own. Only the sockets that
+        load-balance the outgoing messages (PUSH, REQ and DEALER) treat
+        them as a single peer. Others would e.g. duplicate the messages
+        or refuse the extra connections. */
+    if (nctcps > 1 && !nn_ep_ispeer (ep, NN_PULL) &&
+          !nn_ep_ispeer (ep, NN_REP)) {
+        nn_free (self);
+        return -EINVAL;
+    }
+
     /*  Initialise the structure. */
+    self->ctcps = nn_alloc (sizeof (struct nn_ctcp) * nctcps, "ctcp");
+    alloc_assert (self->ctcps);
+    self->nctcps = nctcps;
+    self->nstopped = 0;
+
+    /*  Start the state machines. Parallel connections are spread across
+        the worker threads. */
+    for (i = 0; i != nctcps; ++i) {
+        nn_ctcp_init (&self->ctcps [i], self, nctcps > 1);
+        nn_fsm_start (&self->ctcps [i].fsm);
+    }
+
+    return 0;
+}
+
+static void nn_ctcp_init (struct nn_ctcp *self, struct nn_ctcps *owner,
+    int spread)
+{
+    struct nn_ep *ep;
+    int reconnect_ivl;
+    int reconnect_ivl_max;
+    size_t sz;
+
+    ep = owner->ep;
+    self->ep = ep;
+    self->owner = owner;
     nn_fsm_init_root (&self->fsm, nn_ctcp_handler, nn_ctcp_shutdown,
         nn_ep_getctx (ep));
     self->state = NN_CTCP_STATE_IDLE;
     nn_usock_init (&self->usock, NN_CTCP_SRC_USOCK, &self->fsm);
+    if (spread)
+        nn_usock_spread (&self->usock);
     sz = sizeof (reconnect_ivl);
     nn_ep_getopt (ep, NN_SOL_SOCKET, NN_RECONNECT_IVL, &reconnect_ivl, &sz);
     nn_assert (sz == sizeof (reconnect_ivl));
@@ -195,31 +262,37 @@ int nn_ctcp_create (struct nn_ep *ep)
         reconnect_ivl, reconnect_ivl_max, &self->fsm);
     nn_stcp_init (&self->stcp, NN_CTCP_SRC_STCP, ep, &self->fsm);
     nn_dns_init (&self->dns, NN_CTCP_SRC_DNS, &self->fsm);
+}
 
-    /*  Start the state machine. */
-    nn_fsm_start (&self->fsm);
-
-    return 0;
+static void nn_ctcp_term (struct nn_ctcp *self)
+{
+    nn_dns_term (&self->dns);
+    nn_stcp_term (&self->stcp);
+    nn_backoff_term (&self->retry);
+    nn_usock_term (&self->usock);
+    nn_fsm_term (&self->fsm);
 }
 
 static void nn_ctcp_stop (void *self)
 {
-    struct nn_ctcp *ctcp = self;
+    struct nn_ctcps *ctcps = self;
+    int i;
 
-    nn_fsm_stop (&ctcp->fsm);
+    for (i = 0; i != ctcps->nctcps; ++i)
+        nn_fsm_stop (&ctcps->ctcps [i].fsm);
 }
 
 static void nn_ctcp_destroy (void *self)
 {
-    struct nn_ctcp *ctcp = self;
+    struct nn_ctcps *ctcps = self;
+    int i;
 
-    nn_dns_term (&ctcp->dns);
-    nn_stcp_term (&ctcp->stcp);
-    nn_backoff_term (&ctcp->retry);
-    nn_usock_term (&ctcp->usock);
-    nn_fsm_term (&ctcp->fsm);
+    nn_assert (ctcps->nstopped == ctcps->nctcps);
+    for (i = 0; i != ctcps->nctcps; ++i)
+        nn_ctcp_term (&ctcps->ctcps [i]);
+    nn_free (ctcps->ctcps);
 
-    nn_free (ctcp);
+    nn_free (ctcps);
 }
 
 static void nn_ctcp_shutdown (struct nn_fsm *self, int src, int type,
@@ -251,7 +324,10 @@ static void nn_ctcp_shutdown (struct nn_fsm *self, int src, int type,
             return;
         ctcp->state = NN_CTCP_STATE_IDLE;
         nn_fsm_stopped_noevent (&ctcp->fsm);
-        nn_ep_stopped (ctcp->ep);
+
+        /*  The endpoint is stopped once all its connections are. */
+        if (++ctcp->owner->nstopped == ctcp->owner->nctcps)
+            nn_ep_stopped (ctcp->ep);
         return;
     }
 
@@ -599,11 +675,15 @@ static void nn_ctcp_start_connecting (struct nn_ctcp *self,
     nn_usock_setsockopt (&self->usock, SOL_SOCKET, SO_RCVBUF,
         &val, sizeof (val));
 
-    /*  Bind the socket to the local network interface. */
+    /*  Bind the socket to the local network interface. This fails e.g. when
+        a storm of connections runs out of ephemeral ports. The socket has
+        to be closed before the next attempt. */
     rc = nn_usock_bind (&self->usock, (struct sockaddr*) &local, locallen);
     if (nn_slow (rc != 0)) {
-        nn_backoff_start (&self->retry);
-        self->state = NN_CTCP_STATE_WAITING;
+        nn_ep_set_error (self->ep, -rc);
+        nn_usock_stop (&self->usock);
+        self->state = NN_CTCP_STATE_STOPPING_USOCK;
+        nn_ep_stat_increment (self->ep, NN_STAT_CONNECT_ERRORS, 1);
         return;
     }
 
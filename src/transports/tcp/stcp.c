@@ -23,11 +23,19 @@
 
 #include "stcp.h"
 
+#include "../utils/varint.h"
+
+#include "../../tcp.h"
+
 #include "../../utils/err.h"
 #include "../../utils/cont.h"
 #include "../../utils/fast.h"
 #include "../../utils/wire.h"
 #include "../../utils/attr.h"
+#include "../../utils/alloc.h"
+#include "../../utils/lz.h"
+
+#include <string.h>
 
 /*  States of the object as a whole. */
 #define NN_STCP_STATE_IDLE 1
@@ -42,21 +50,45 @@
 #define NN_STCP_INSTATE_HDR 1
 #define NN_STCP_INSTATE_BODY 2
 #define NN_STCP_INSTATE_HASMSG 3
+#define NN_STCP_INSTATE_ZHDR 4
+#define NN_STCP_INSTATE_ZBODY 5
+#define NN_STCP_INSTATE_BATCH 6
+#define NN_STCP_INSTATE_VARINT 7
+#define NN_STCP_INSTATE_VARINT2 8
 
 /*  Possible states of the outbound part of the object. */
 #define NN_STCP_OUTSTATE_IDLE 1
 #define NN_STCP_OUTSTATE_SENDING 2
+#define NN_STCP_OUTSTATE_BATCHING 3
+
+/*  If this bit is set in the message header the message is compressed.
+    Such a message is sent only if both peers have agreed on compression
+    in the protocol header. The message header is then followed by
+    NN_STCP_ZHDR_SIZE bytes holding the size of the decompressed message
+    (8 bytes) and the size of the protocol header (4 bytes). The protocol
+    header itself is sent uncompressed and is followed by the compressed
+    body. */
+#define NN_STCP_COMPRESSED (((uint64_t) 1) << 63)
+
+/*  If this bit is set in the message header the frame holds a batch of
+    messages (see batch.h) rather than a single message. */
+#define NN_STCP_BATCH (((uint64_t) 1) << 62)
 
 /*  Subordinate srcptr objects. */
 #define NN_STCP_SRC_USOCK 1
 #define NN_STCP_SRC_STREAMHDR 2
+#define NN_STCP_SRC_COMPRESSOR 3
 
 /*  Stream is a special type of pipe. Implementation of the virtual pipe API. */
 static int nn_stcp_send (struct nn_pipebase *self, struct nn_msg *msg);
 static int nn_stcp_recv (struct nn_pipebase *self, struct nn_msg *msg);
+static void nn_stcp_close (struct nn_pipebase *self);
+static size_t nn_stcp_backlog (struct nn_pipebase *self);
 const struct nn_pipebase_vfptr nn_stcp_pipebase_vfptr = {
     nn_stcp_send,
-    nn_stcp_recv
+    nn_stcp_recv,
+    nn_stcp_close,
+    nn_stcp_backlog
 };
 
 /*  Private functions. */
@@ -64,6 +96,14 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
     void *srcptr);
 static void nn_stcp_shutdown (struct nn_fsm *self, int src, int type,
     void *srcptr);
+static size_t nn_stcp_puthdr (struct nn_stcp *self, uint64_t hdr);
+static void nn_stcp_send_msg (struct nn_stcp *self);
+static void nn_stcp_send_frame (struct nn_stcp *self);
+static void nn_stcp_recv_hdr (struct nn_stcp *self);
+static int nn_stcp_recv_msg (struct nn_stcp *self, uint64_t size);
+static void nn_stcp_sent (struct nn_stcp *self);
+static void nn_stcp_compress (struct nn_worker_task *task);
+static int nn_stcp_recv_zhdr (struct nn_stcp *self);
 
 void nn_stcp_init (struct nn_stcp *self, int src,
     struct nn_ep *ep, struct nn_fsm *owner)
@@ -77,9 +117,28 @@ void nn_stcp_init (struct nn_stcp *self, int src,
     self->usock_owner.fsm = NULL;
     nn_pipebase_init (&self->pipebase, &nn_stcp_pipebase_vfptr, ep);
     self->instate = -1;
+    self->varint = 0;
     nn_msg_init (&self->inmsg, 0);
+    self->inzlen = 0;
+    self->inz = NULL;
+    self->inzsize = 0;
+    nn_batch_init (&self->inbatch);
     self->outstate = -1;
     nn_msg_init (&self->outmsg, 0);
+    self->compress = 0;
+    self->outz = NULL;
+    self->outzsize = 0;
+    self->outzlen = 0;
+    nn_worker_task_init (&self->compressor, NN_STCP_SRC_COMPRESSOR,
+        &self->fsm);
+    nn_worker_task_setfn (&self->compressor, nn_stcp_compress);
+    self->compressing = 0;
+    self->batch = 0;
+    nn_batch_init (&self->outbatch);
+    nn_batch_init (&self->sendbatch);
+    nn_msg_init (&self->outnext, 0);
+    self->hasnext = 0;
+    self->outbytes = 0;
     nn_fsm_event_init (&self->done);
 }
 
@@ -88,7 +147,14 @@ void nn_stcp_term (struct nn_stcp *self)
     nn_assert_state (self, NN_STCP_STATE_IDLE);
 
     nn_fsm_event_term (&self->done);
+    nn_msg_term (&self->outnext);
+    nn_batch_term (&self->sendbatch);
+    nn_batch_term (&self->outbatch);
+    nn_worker_task_term (&self->compressor);
+    nn_free (self->outz);
     nn_msg_term (&self->outmsg);
+    nn_batch_term (&self->inbatch);
+    nn_free (self->inz);
     nn_msg_term (&self->inmsg);
     nn_pipebase_term (&self->pipebase);
     nn_streamhdr_term (&self->streamhdr);
@@ -120,34 +186,164 @@ void nn_stcp_stop (struct nn_stcp *self)
 
 static int nn_stcp_send (struct nn_pipebase *self, struct nn_msg *msg)
 {
+    int rc;
     struct nn_stcp *stcp;
-    struct nn_iovec iov [3];
 
     stcp = nn_cont (self, struct nn_stcp, pipebase);
 
     nn_assert_state (stcp, NN_STCP_STATE_ACTIVE);
+
+    /*  A frame is being sent at the moment. Small messages are gathered
+        into a batch to be sent as soon as the frame is out, other messages
+        have to wait for that. */
+    if (stcp->outstate == NN_STCP_OUTSTATE_BATCHING) {
+        rc = nn_batch_add (&stcp->outbatch, msg);
+        if (nn_fast (rc == 0)) {
+            nn_msg_term (msg);
+            if (nn_batch_full (&stcp->outbatch))
+                stcp->outstate = NN_STCP_OUTSTATE_SENDING;
+            else
+                nn_pipebase_sent (&stcp->pipebase);
+            return 0;
+        }
+        nn_msg_term (&stcp->outnext);
+        nn_msg_mv (&stcp->outnext, msg);
+        stcp->hasnext = 1;
+        stcp->outstate = NN_STCP_OUTSTATE_SENDING;
+        return 0;
+    }
+
     nn_assert (stcp->outstate == NN_STCP_OUTSTATE_IDLE);
 
     /*  Move the message to the local storage. */
     nn_msg_term (&stcp->outmsg);
     nn_msg_mv (&stcp->outmsg, msg);
+    nn_stcp_send_msg (stcp);
+
+    /*  If the peer accepts batches, the pipe remains writable while
+        the message is being sent. */
+    if (stcp->batch) {
+        stcp->outstate = NN_STCP_OUTSTATE_BATCHING;
+        nn_pipebase_sent (&stcp->pipebase);
+    }
+    else
+        stcp->outstate = NN_STCP_OUTSTATE_SENDING;
+
+    return 0;
+}
+
+/*  Starts sending the message stored in 'outmsg'. */
+static void nn_stcp_send_msg (struct nn_stcp *self)
+{
+    size_t sz;
+
+    /*  Large enough messages are compressed in a worker thread so that
+        neither the sender nor anything else using the socket has to wait
+        for it. The frame is sent once the compression is done. */
+    self->outzlen = 0;
+    sz = nn_chunkref_size (&self->outmsg.sphdr) +
+        nn_chunkref_size (&self->outmsg.body);
+    self->outbytes = sz;
+    if (self->compress > 0 && sz >= (size_t) self->compress) {
+        self->compressing = 1;
+        nn_worker_execute (nn_fsm_spread_worker (&self->fsm),
+            &self->compressor);
+        return;
+    }
+
+    nn_stcp_send_frame (self);
+}
+
+/*  Sends 'outmsg' as a single frame. The body is sent compressed if
+    the compressor produced any output. */
+static void nn_stcp_send_frame (struct nn_stcp *self)
+{
+    struct nn_iovec iov [3];
+    size_t sphdrsz;
+    size_t bodysz;
+    size_t hdrsz;
+
+    sphdrsz = nn_chunkref_size (&self->outmsg.sphdr);
+    bodysz = nn_chunkref_size (&self->outmsg.body);
+
+    if (self->outzlen > 0) {
+        hdrsz = nn_stcp_puthdr (self,
+            (NN_STCP_ZHDR_SIZE + sphdrsz + self->outzlen) |
+            NN_STCP_COMPRESSED);
+        nn_putll (self->outhdr + hdrsz, sphdrsz + bodysz);
+        nn_putl (self->outhdr + hdrsz + 8, (uint32_t) sphdrsz);
+        iov [0].iov_base = self->outhdr;
+        iov [0].iov_len = hdrsz + NN_STCP_ZHDR_SIZE;
+        iov [1].iov_base = nn_chunkref_data (&self->outmsg.sphdr);
+        iov [1].iov_len = sphdrsz;
+        iov [2].iov_base = self->outz;
+        iov [2].iov_len = self->outzlen;
+        nn_usock_send (self->usock, iov, 3);
+        return;
+    }
 
     /*  Serialise the message header. */
-    nn_putll (stcp->outhdr, nn_chunkref_size (&stcp->outmsg.sphdr) +
-        nn_chunkref_size (&stcp->outmsg.body));
+    hdrsz = nn_stcp_puthdr (self, sphdrsz + bodysz);
 
     /*  Start async sending. */
-    iov [0].iov_base = stcp->outhdr;
-    iov [0].iov_len = sizeof (stcp->outhdr);
-    iov [1].iov_base = nn_chunkref_data (&stcp->outmsg.sphdr);
-    iov [1].iov_len = nn_chunkref_size (&stcp->outmsg.sphdr);
-    iov [2].iov_base = nn_chunkref_data (&stcp->outmsg.body);
-    iov [2].iov_len = nn_chunkref_size (&stcp->outmsg.body);
-    nn_usock_send (stcp->usock, iov, 3);
+    iov [0].iov_base = self->outhdr;
+    iov [0].iov_len = hdrsz;
+    iov [1].iov_base = nn_chunkref_data (&self->outmsg.sphdr);
+    iov [1].iov_len = sphdrsz;
+    iov [2].iov_base = nn_chunkref_data (&self->outmsg.body);
+    iov [2].iov_len = bodysz;
+    nn_usock_send (self->usock, iov, 3);
+}
 
-    stcp->outstate = NN_STCP_OUTSTATE_SENDING;
+/*  Invoked when the frame was sent. Sends the batch or the message waiting
+    for it and unblocks the pipe if it was blocked. */
+static void nn_stcp_sent (struct nn_stcp *self)
+{
+    int blocked;
+    struct nn_batch tmp;
+    struct nn_iovec iov [2];
+
+    nn_assert (self->outstate == NN_STCP_OUTSTATE_SENDING ||
+        self->outstate == NN_STCP_OUTSTATE_BATCHING);
+    blocked = self->outstate == NN_STCP_OUTSTATE_SENDING;
+    self->outbytes = 0;
+    nn_msg_term (&self->outmsg);
+    nn_msg_init (&self->outmsg, 0);
 
-    return 0;
+    if (!nn_batch_empty (&self->outbatch)) {
+
+        /*  Send the batch. New messages are gathered into the other
+            buffer in the meantime. */
+        tmp = self->sendbatch;
+        self->sendbatch = self->outbatch;
+        self->outbatch = tmp;
+        nn_batch_reset (&self->outbatch);
+        iov [0].iov_base = self->outhdr;
+        iov [0].iov_len = nn_stcp_puthdr (self,
+            self->sendbatch.size | NN_STCP_BATCH);
+        iov [1].iov_base = self->sendbatch.data;
+        iov [1].iov_len = self->sendbatch.size;
+        self->outbytes = self->sendbatch.size;
+        nn_usock_send (self->usock, iov, 2);
+        nn_pipebase_stat_increment (&self->pipebase, NN_STAT_BATCHES_SENT, 1);
+
+        /*  The message that didn't fit into the batch goes next. */
+        if (self->hasnext)
+            return;
+        self->outstate = NN_STCP_OUTSTATE_BATCHING;
+    }
+    else if (self->hasnext) {
+        nn_msg_mv (&self->outmsg, &self->outnext);
+        nn_msg_init (&self->outnext, 0);
+        self->hasnext = 0;
+        nn_stcp_send_msg (self);
+        self->outstate = NN_STCP_OUTSTATE_BATCHING;
+    }
+    else
+        self->outstate = NN_STCP_OUTSTATE_IDLE;
+
+    if (blocked)
+        nn_pipebase_sent (&self->pipebase);
 }
 
 static int nn_stcp_recv (struct nn_pipebase *self, struct nn_msg *msg)
@@ -163,13 +359,49 @@ static int nn_stcp_recv (struct nn_pipebase *self, struct nn_msg *msg)
     nn_msg_mv (msg, &stcp->inmsg);
     nn_msg_init (&stcp->inmsg, 0);
 
+    /*  Hand out the rest of the batch before receiving new frame. */
+    if (!nn_batch_empty (&stcp->inbatch)) {
+        nn_batch_get (&stcp->inbatch, &stcp->inmsg);
+        nn_pipebase_received (&stcp->pipebase);
+        return 0;
+    }
+
     /*  Start receiving new message. */
-    stcp->instate = NN_STCP_INSTATE_HDR;
-    nn_usock_recv (stcp->usock, stcp->inhdr, sizeof (stcp->inhdr), NULL);
+    nn_stcp_recv_hdr (stcp);
 
     return 0;
 }
 
+static void nn_stcp_close (struct nn_pipebase *self)
+{
+    struct nn_stcp *stcp;
+
+    stcp = nn_cont (self, struct nn_stcp, pipebase);
+
+    /*  If the connection is already failing there's nothing to do. */
+    if (stcp->state != NN_STCP_STATE_ACTIVE)
+        return;
+
+    /*  Drop the connection the same way as if it was broken. The owner
+        will stop this object which in turn removes the pipe from
+        the socket. */
+    stcp->state = NN_STCP_STATE_DONE;
+    nn_fsm_raise (&stcp->fsm, &stcp->done, NN_STCP_ERROR);
+}
+
+static size_t nn_stcp_backlog (struct nn_pipebase *self)
+{
+    struct nn_stcp *stcp;
+
+    stcp = nn_cont (self, struct nn_stcp, pipebase);
+
+    if (stcp->state != NN_STCP_STATE_ACTIVE)
+        return 0;
+    return stcp->outbytes + stcp->outbatch.size + (stcp->hasnext ?
+        nn_chunkref_size (&stcp->outnext.sphdr) +
+        nn_chunkref_size (&stcp->outnext.body) : 0);
+}
+
 static void nn_stcp_shutdown (struct nn_fsm *self, int src, int type,
     NN_UNUSED void *srcptr)
 {
@@ -182,8 +414,14 @@ static void nn_stcp_shutdown (struct nn_fsm *self, int src, int type,
         nn_streamhdr_stop (&stcp->streamhdr);
         stcp->state = NN_STCP_STATE_STOPPING;
     }
+    if (nn_slow (src == NN_STCP_SRC_COMPRESSOR)) {
+        nn_assert (type == NN_WORKER_TASK_EXECUTE);
+        stcp->compressing = 0;
+    }
     if (nn_slow (stcp->state == NN_STCP_STATE_STOPPING)) {
-        if (nn_streamhdr_isidle (&stcp->streamhdr)) {
+
+        /*  The compressor has to finish before the object can go away. */
+        if (nn_streamhdr_isidle (&stcp->streamhdr) && !stcp->compressing) {
             nn_usock_swap_owner (stcp->usock, &stcp->usock_owner);
             stcp->usock = NULL;
             stcp->usock_owner.src = -1;
@@ -206,6 +444,7 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
     uint64_t size;
     int opt;
     size_t opt_sz = sizeof (opt);
+    int features;
 
     stcp = nn_cont (self, struct nn_stcp, fsm);
 
@@ -220,8 +459,26 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
         case NN_FSM_ACTION:
             switch (type) {
             case NN_FSM_START:
+
+                /*  Offer the features only if they were asked for so that
+                    the reserved header byte stays zero by default. */
+                nn_pipebase_getopt (&stcp->pipebase, NN_TCP,
+                    NN_TCP_COMPRESS, &opt, &opt_sz);
+                nn_assert (opt_sz == sizeof (opt));
+                stcp->compress = opt;
+                features = opt > 0 ? NN_STREAMHDR_COMPRESS : 0;
+                nn_pipebase_getopt (&stcp->pipebase, NN_TCP,
+                    NN_TCP_BATCH, &opt, &opt_sz);
+                nn_assert (opt_sz == sizeof (opt));
+                if (opt)
+                    features |= NN_STREAMHDR_BATCH;
+                nn_pipebase_getopt (&stcp->pipebase, NN_TCP,
+                    NN_TCP_VARINT, &opt, &opt_sz);
+                nn_assert (opt_sz == sizeof (opt));
+                if (opt)
+                    features |= NN_STREAMHDR_VARINT;
                 nn_streamhdr_start (&stcp->streamhdr, stcp->usock,
-                    &stcp->pipebase);
+                    &stcp->pipebase, features);
                 stcp->state = NN_STCP_STATE_PROTOHDR;
                 return;
             default:
@@ -282,10 +539,23 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
                     return;
                  }
 
+                 /*  Compress outgoing messages only if the peer is able to
+                     decompress them. */
+                 if (!(stcp->streamhdr.features & NN_STREAMHDR_COMPRESS))
+                     stcp->compress = 0;
+                 stcp->batch = !!(stcp->streamhdr.features &
+                     NN_STREAMHDR_BATCH);
+                 nn_batch_reset (&stcp->inbatch);
+                 nn_batch_reset (&stcp->outbatch);
+                 nn_msg_term (&stcp->outnext);
+                 nn_msg_init (&stcp->outnext, 0);
+                 stcp->hasnext = 0;
+                 stcp->outbytes = 0;
+                 stcp->varint = !!(stcp->streamhdr.features &
+                     NN_STREAMHDR_VARINT);
+
                  /*  Start receiving a message in asynchronous manner. */
-                 stcp->instate = NN_STCP_INSTATE_HDR;
-                 nn_usock_recv (stcp->usock, &stcp->inhdr,
-                     sizeof (stcp->inhdr), NULL);
+                 nn_stcp_recv_hdr (stcp);
 
                  /*  Mark the pipe as available for sending. */
                  stcp->outstate = NN_STCP_OUTSTATE_IDLE;
@@ -311,12 +581,8 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
             switch (type) {
             case NN_USOCK_SENT:
 
-                /*  The message is now fully sent. */
-                nn_assert (stcp->outstate == NN_STCP_OUTSTATE_SENDING);
-                stcp->outstate = NN_STCP_OUTSTATE_IDLE;
-                nn_msg_term (&stcp->outmsg);
-                nn_msg_init (&stcp->outmsg, 0);
-                nn_pipebase_sent (&stcp->pipebase);
+                /*  The frame is now fully sent. */
+                nn_stcp_sent (stcp);
                 return;
 
             case NN_USOCK_RECEIVED:
@@ -329,32 +595,93 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
                         if it's too large, drop the connection. */
                     size = nn_getll (stcp->inhdr);
 
-                    nn_pipebase_getopt (&stcp->pipebase, NN_SOL_SOCKET,
-                        NN_RCVMAXSIZE, &opt, &opt_sz);
+                    /*  Batch of messages is received as a whole. Batches
+                        are accepted only if they were agreed on. */
+                    if (size & NN_STCP_BATCH) {
+                        size &= ~NN_STCP_BATCH;
+                        if (nn_slow (!(stcp->streamhdr.features &
+                              NN_STREAMHDR_BATCH) || size == 0 ||
+                              size > NN_BATCH_MAXSIZE)) {
+                            stcp->state = NN_STCP_STATE_DONE;
+                            nn_fsm_raise (&stcp->fsm, &stcp->done,
+                                NN_STCP_ERROR);
+                            return;
+                        }
+                        stcp->instate = NN_STCP_INSTATE_BATCH;
+                        nn_usock_recv (stcp->usock,
+                            nn_batch_recvbuf (&stcp->inbatch, (size_t) size),
+                            (size_t) size, NULL);
+                        return;
+                    }
 
-                    if (opt >= 0 && size > (unsigned)opt) {
+                    /*  Compressed message is followed by the compression
+                        header. Receive it first. Compressed messages are
+                        accepted only if compression was agreed on. */
+                    if (size & NN_STCP_COMPRESSED) {
+                        size &= ~NN_STCP_COMPRESSED;
+                        if (nn_slow (!(stcp->streamhdr.features &
+                              NN_STREAMHDR_COMPRESS) ||
+                              size <= NN_STCP_ZHDR_SIZE)) {
+                            stcp->state = NN_STCP_STATE_DONE;
+                            nn_fsm_raise (&stcp->fsm, &stcp->done,
+                                NN_STCP_ERROR);
+                            return;
+                        }
+                        stcp->inzlen = (size_t) size - NN_STCP_ZHDR_SIZE;
+                        stcp->instate = NN_STCP_INSTATE_ZHDR;
+                        nn_usock_recv (stcp->usock, stcp->inzhdr,
+                            sizeof (stcp->inzhdr), NULL);
+                        return;
+                    }
+
+                    rc = nn_stcp_recv_msg (stcp, size);
+                    if (nn_slow (rc < 0)) {
                         stcp->state = NN_STCP_STATE_DONE;
                         nn_fsm_raise (&stcp->fsm, &stcp->done, NN_STCP_ERROR);
                         return;
                     }
+                    return;
 
-                    /*  Allocate memory for the message. */
-                    nn_msg_term (&stcp->inmsg);
-                    nn_msg_init (&stcp->inmsg, (size_t) size);
+                case NN_STCP_INSTATE_VARINT:
 
-                    /*  Special case when size of the message body is 0. */
-                    if (!size) {
-                        stcp->instate = NN_STCP_INSTATE_HASMSG;
-                        nn_pipebase_received (&stcp->pipebase);
+                    /*  First byte of the compact header was received. It
+                        tells how many bytes of the header follow, if any. */
+                    rc = nn_varint_len (stcp->inhdr [0]);
+                    if (nn_slow (rc < 0)) {
+                        stcp->state = NN_STCP_STATE_DONE;
+                        nn_fsm_raise (&stcp->fsm, &stcp->done, NN_STCP_ERROR);
+                        return;
+                    }
+                    if (rc == 0) {
+                        stcp->instate = NN_STCP_INSTATE_HDR;
+                        nn_usock_recv (stcp->usock, stcp->inhdr,
+                            sizeof (stcp->inhdr), NULL);
+                        return;
+                    }
+                    if (rc == 2) {
+                        stcp->instate = NN_STCP_INSTATE_VARINT2;
+                        nn_usock_recv (stcp->usock, stcp->inhdr + 1, 1, NULL);
+                        return;
+                    }
+                    rc = nn_stcp_recv_msg (stcp, nn_varint_get (stcp->inhdr));
+                    if (nn_slow (rc < 0)) {
+                        stcp->state = NN_STCP_STATE_DONE;
+                        nn_fsm_raise (&stcp->fsm, &stcp->done, NN_STCP_ERROR);
                         return;
                     }
+                    return;
 
-                    /*  Start receiving the message body. */
-                    stcp->instate = NN_STCP_INSTATE_BODY;
-                    nn_usock_recv (stcp->usock,
-                        nn_chunkref_data (&stcp->inmsg.body),
-                       (size_t) size, NULL);
+                case NN_STCP_INSTATE_VARINT2:
 
+                    /*  The rest of the compact header was received. Being
+                        tiny, the reads of the header are served from the
+                        usock's receive buffer without extra syscalls. */
+                    rc = nn_stcp_recv_msg (stcp, nn_varint_get (stcp->inhdr));
+                    if (nn_slow (rc < 0)) {
+                        stcp->state = NN_STCP_STATE_DONE;
+                        nn_fsm_raise (&stcp->fsm, &stcp->done, NN_STCP_ERROR);
+                        return;
+                    }
                     return;
 
                 case NN_STCP_INSTATE_BODY:
@@ -366,6 +693,60 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
 
                     return;
 
+                case NN_STCP_INSTATE_BATCH:
+
+                    /*  Batch was received. Check it as a whole so that
+                        the connection can't fail while the messages are
+                        being handed to the user. */
+                    nn_pipebase_getopt (&stcp->pipebase, NN_SOL_SOCKET,
+                        NN_RCVMAXSIZE, &opt, &opt_sz);
+                    rc = nn_batch_check (&stcp->inbatch, opt);
+                    if (nn_slow (rc < 0)) {
+                        stcp->state = NN_STCP_STATE_DONE;
+                        nn_fsm_raise (&stcp->fsm, &stcp->done, NN_STCP_ERROR);
+                        return;
+                    }
+                    nn_batch_get (&stcp->inbatch, &stcp->inmsg);
+                    stcp->instate = NN_STCP_INSTATE_HASMSG;
+                    nn_pipebase_received (&stcp->pipebase);
+                    return;
+
+                case NN_STCP_INSTATE_ZHDR:
+
+                    /*  Compression header was received. Allocate memory
+                        for the message and start receiving the compressed
+                        data. */
+                    rc = nn_stcp_recv_zhdr (stcp);
+                    if (nn_slow (rc < 0)) {
+                        stcp->state = NN_STCP_STATE_DONE;
+                        nn_fsm_raise (&stcp->fsm, &stcp->done, NN_STCP_ERROR);
+                        return;
+                    }
+                    stcp->instate = NN_STCP_INSTATE_ZBODY;
+                    nn_usock_recv (stcp->usock, stcp->inz, stcp->inzlen, NULL);
+                    return;
+
+                case NN_STCP_INSTATE_ZBODY:
+
+                    /*  Compressed data were received. The protocol header
+                        is stored as is, the body has to be decompressed. If
+                        the data are malformed, drop the connection. */
+                    size = nn_getl (stcp->inzhdr + 8);
+                    memcpy (nn_chunkref_data (&stcp->inmsg.body), stcp->inz,
+                        (size_t) size);
+                    rc = nn_lz_decompress (stcp->inz + size,
+                        stcp->inzlen - (size_t) size,
+                        (uint8_t*) nn_chunkref_data (&stcp->inmsg.body) + size,
+                        nn_chunkref_size (&stcp->inmsg.body) - (size_t) size);
+                    if (nn_slow (rc < 0)) {
+                        stcp->state = NN_STCP_STATE_DONE;
+                        nn_fsm_raise (&stcp->fsm, &stcp->done, NN_STCP_ERROR);
+                        return;
+                    }
+                    stcp->instate = NN_STCP_INSTATE_HASMSG;
+                    nn_pipebase_received (&stcp->pipebase);
+                    return;
+
                 default:
                     nn_fsm_error("Unexpected socket instate",
                         stcp->state, src, type);
@@ -386,6 +767,19 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
                 nn_fsm_bad_action (stcp->state, src, type);
             }
 
+        case NN_STCP_SRC_COMPRESSOR:
+            switch (type) {
+            case NN_WORKER_TASK_EXECUTE:
+
+                /*  The message is compressed. Send it. */
+                stcp->compressing = 0;
+                nn_stcp_send_frame (stcp);
+                return;
+
+            default:
+                nn_fsm_bad_action (stcp->state, src, type);
+            }
+
         default:
             nn_fsm_bad_source (stcp->state, src, type);
         }
@@ -408,6 +802,12 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
                 nn_fsm_bad_action (stcp->state, src, type);
             }
 
+        case NN_STCP_SRC_COMPRESSOR:
+
+            /*  There's no connection to send the message to. */
+            stcp->compressing = 0;
+            return;
+
         default:
             nn_fsm_bad_source (stcp->state, src, type);
         }
@@ -419,6 +819,10 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
 /*  this state except stopping the object.                                    */
 /******************************************************************************/
     case NN_STCP_STATE_DONE:
+        if (src == NN_STCP_SRC_COMPRESSOR) {
+            stcp->compressing = 0;
+            return;
+        }
         nn_fsm_bad_source (stcp->state, src, type);
 
 /******************************************************************************/
@@ -429,3 +833,130 @@ static void nn_stcp_handler (struct nn_fsm *self, int src, int type,
     }
 }
 
+
+/*  Compresses body of the outgoing message into the 'outz' buffer and sets
+    'outzlen' to the size of the compressed data, or to zero if the message
+    doesn't compress well enough to be worth it. Runs in a worker thread. */
+static void nn_stcp_compress (struct nn_worker_task *task)
+{
+    struct nn_stcp *self;
+    size_t bodysz;
+
+    self = nn_cont (task, struct nn_stcp, compressor);
+    bodysz = nn_chunkref_size (&self->outmsg.body);
+
+    if (self->outzsize < bodysz) {
+        nn_free (self->outz);
+        self->outz = nn_alloc (bodysz, "stcp compression buffer");
+        alloc_assert (self->outz);
+        self->outzsize = bodysz;
+    }
+
+    /*  Require at least 1/8 of the body to be saved. Otherwise the work
+        the peer has to do to decompress the message is wasted. */
+    self->outzlen = nn_lz_compress (nn_chunkref_data (&self->outmsg.body),
+        bodysz, self->outz, bodysz - bodysz / 8);
+}
+
+/*  Validates the compression header of the incoming message and prepares
+    the buffers to receive it. Returns -EINVAL if the header is malformed or
+    the message is too large. */
+static int nn_stcp_recv_zhdr (struct nn_stcp *self)
+{
+    uint64_t size;
+    size_t sphdrsz;
+    int opt;
+    size_t opt_sz = sizeof (opt);
+
+    size = nn_getll (self->inzhdr);
+    sphdrsz = nn_getl (self->inzhdr + 8);
+
+    nn_pipebase_getopt (&self->pipebase, NN_SOL_SOCKET, NN_RCVMAXSIZE,
+        &opt, &opt_sz);
+    if (opt >= 0 && size > (unsigned) opt)
+        return -EINVAL;
+
+    /*  Sanity checks. Compressed body can't be larger than the compressor
+        is able to produce from the announced size of the message. */
+    if (nn_slow (sphdrsz > size || sphdrsz >= self->inzlen))
+        return -EINVAL;
+    if (nn_slow (self->inzlen - sphdrsz > NN_LZ_BOUND ((size_t) size - sphdrsz)))
+        return -EINVAL;
+
+    if (self->inzsize < self->inzlen) {
+        nn_free (self->inz);
+        self->inz = nn_alloc (self->inzlen, "stcp decompression buffer");
+        alloc_assert (self->inz);
+        self->inzsize = self->inzlen;
+    }
+
+    nn_msg_term (&self->inmsg);
+    nn_msg_init (&self->inmsg, (size_t) size);
+
+    return 0;
+}
+
+/*  Writes the header of the frame into 'outhdr'. With compact headers
+    the frames that can't be described compactly are preceded by the escape
+    byte. Returns the size of the header. */
+static size_t nn_stcp_puthdr (struct nn_stcp *self, uint64_t hdr)
+{
+    size_t sz;
+
+    if (!self->varint) {
+        nn_putll (self->outhdr, hdr);
+        return 8;
+    }
+
+    sz = nn_varint_put (self->outhdr, hdr);
+    if (nn_fast (sz > 0))
+        return sz;
+    self->outhdr [0] = NN_VARINT_ESCAPE;
+    nn_putll (self->outhdr + 1, hdr);
+    return 9;
+}
+
+/*  Starts receiving the header of the next frame. */
+static void nn_stcp_recv_hdr (struct nn_stcp *self)
+{
+    if (self->varint) {
+        self->instate = NN_STCP_INSTATE_VARINT;
+        nn_usock_recv (self->usock, self->inhdr, 1, NULL);
+        return;
+    }
+
+    self->instate = NN_STCP_INSTATE_HDR;
+    nn_usock_recv (self->usock, self->inhdr, sizeof (self->inhdr), NULL);
+}
+
+/*  Header of a regular message was received. Check that message size
+    is acceptable by comparing with NN_RCVMAXSIZE and start receiving
+    the message body. Returns -EMSGSIZE if the message is too large. */
+static int nn_stcp_recv_msg (struct nn_stcp *self, uint64_t size)
+{
+    int opt;
+    size_t opt_sz = sizeof (opt);
+
+    nn_pipebase_getopt (&self->pipebase, NN_SOL_SOCKET, NN_RCVMAXSIZE,
+        &opt, &opt_sz);
+    if (opt >= 0 && size > (unsigned) opt)
+        return -EMSGSIZE;
+
+    /*  Allocate memory for the message. */
+    nn_msg_term (&self->inmsg);
+    nn_msg_init (&self->inmsg, (size_t) size);
+
+    /*  Special case when size of the message body is 0. */
+    if (!size) {
+        self->instate = NN_STCP_INSTATE_HASMSG;
+        nn_pipebase_received (&self->pipebase);
+        return 0;
+    }
+
+    /*  Start receiving the message body. */
+    self->instate = NN_STCP_INSTATE_BODY;
+    nn_usock_recv (self->usock, nn_chunkref_data (&self->inmsg.body),
+        (size_t) size, NULL);
+
+    return 0;
+}
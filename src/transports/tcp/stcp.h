@@ -28,8 +28,10 @@
 
 #include "../../aio/fsm.h"
 #include "../../aio/usock.h"
+#include "../../aio/worker.h"
 
 #include "../utils/streamhdr.h"
+#include "../utils/batch.h"
 
 #include "../../utils/msg.h"
 
@@ -39,6 +41,10 @@
 #define NN_STCP_ERROR 1
 #define NN_STCP_STOPPED 2
 
+/*  Size of the header following the message header of a compressed
+    message. */
+#define NN_STCP_ZHDR_SIZE 12
+
 struct nn_stcp {
 
     /*  The state machine. */
@@ -60,21 +66,71 @@ struct nn_stcp {
     /*  State of inbound state machine. */
     int instate;
 
+    /*  1 if the peers agreed on compact frame headers. */
+    int varint;
+
     /*  Buffer used to store the header of incoming message. */
     uint8_t inhdr [8];
 
     /*  Message being received at the moment. */
     struct nn_msg inmsg;
 
+    /*  Header of the compressed message being received at the moment and
+        the buffer the compressed data are received into before they are
+        decompressed into 'inmsg'. */
+    uint8_t inzhdr [NN_STCP_ZHDR_SIZE];
+    size_t inzlen;
+    uint8_t *inz;
+    size_t inzsize;
+
+    /*  Batch of messages being received or handed to the user. */
+    struct nn_batch inbatch;
+
     /*  State of the outbound state machine. */
     int outstate;
 
-    /*  Buffer used to store the header of outgoing message. */
-    uint8_t outhdr [8];
+    /*  Buffer used to store the header of outgoing message, preceded by
+        the escape byte in case of compact headers. In case of a compressed
+        message it's followed by the compression header. */
+    uint8_t outhdr [9 + NN_STCP_ZHDR_SIZE];
 
     /*  Message being sent at the moment. */
     struct nn_msg outmsg;
 
+    /*  Messages at least this large are sent compressed, provided that
+        the peer supports it. Zero if messages are not to be compressed. */
+    int compress;
+
+    /*  Buffer to hold the compressed body of the message being sent and
+        the size of the compressed data, zero if the message is to be sent
+        uncompressed. */
+    uint8_t *outz;
+    size_t outzsize;
+    size_t outzlen;
+
+    /*  The message is compressed by a worker task, outside of the socket's
+        context. 'compressing' is set while the task is in progress. */
+    struct nn_worker_task compressor;
+    int compressing;
+
+    /*  1 if the peer accepts batches of messages. */
+    int batch;
+
+    /*  Small messages gathered while a frame is being sent and the batch
+        being sent at the moment. */
+    struct nn_batch outbatch;
+    struct nn_batch sendbatch;
+
+    /*  Message that couldn't be batched and waits for the batch to be sent,
+        if 'hasnext' is set. */
+    struct nn_msg outnext;
+    int hasnext;
+
+    /*  Size of the frame being sent at the moment, or of the message being
+        prepared to be sent. Together with the above it makes up the amount
+        of data waiting in the pipe. */
+    size_t outbytes;
+
     /*  Event raised when the state machine ends. */
     struct nn_fsm_event done;
 };
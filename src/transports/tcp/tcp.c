@@ -43,11 +43,23 @@
 #include <unistd.h>
 #endif
 
+/*  Maximal number of listening sockets opened by a bound endpoint. */
+#define NN_TCP_MAXLISTENERS 64
+
+/*  Maximal number of parallel connections opened by a connected endpoint. */
+#define NN_TCP_MAXCONNECTIONS 64
+
 /*  TCP-specific socket options. */
 
 struct nn_tcp_optset {
     struct nn_optset base;
     int nodelay;
+    int listeners;
+    int connections;
+    int compress;
+    int batch;
+    int varint;
+    int reuseport;
 };
 
 static void nn_tcp_optset_destroy (struct nn_optset *self);
@@ -96,6 +108,12 @@ static struct nn_optset *nn_tcp_optset ()
 
     /*  Default values for TCP socket options. */
     optset->nodelay = 0;
+    optset->listeners = 1;
+    optset->connections = 1;
+    optset->compress = 0;
+    optset->batch = 0;
+    optset->varint = 0;
+    optset->reuseport = 0;
 
     return &optset->base;   
 }
@@ -127,6 +145,36 @@ static int nn_tcp_optset_setopt (struct nn_optset *self, int option,
             return -EINVAL;
         optset->nodelay = val;
         return 0;
+    case NN_TCP_LISTENERS:
+        if (nn_slow (val < 1 || val > NN_TCP_MAXLISTENERS))
+            return -EINVAL;
+        optset->listeners = val;
+        return 0;
+    case NN_TCP_CONNECTIONS:
+        if (nn_slow (val < 1 || val > NN_TCP_MAXCONNECTIONS))
+            return -EINVAL;
+        optset->connections = val;
+        return 0;
+    case NN_TCP_COMPRESS:
+        if (nn_slow (val < 0))
+            return -EINVAL;
+        optset->compress = val;
+        return 0;
+    case NN_TCP_BATCH:
+        if (nn_slow (val != 0 && val != 1))
+            return -EINVAL;
+        optset->batch = val;
+        return 0;
+    case NN_TCP_VARINT:
+        if (nn_slow (val != 0 && val != 1))
+            return -EINVAL;
+        optset->varint = val;
+        return 0;
+    case NN_TCP_REUSEPORT:
+        if (nn_slow (val != 0 && val != 1))
+            return -EINVAL;
+        optset->reuseport = val;
+        return 0;
     default:
         return -ENOPROTOOPT;
     }
@@ -144,6 +192,24 @@ static int nn_tcp_optset_getopt (struct nn_optset *self, int option,
     case NN_TCP_NODELAY:
         intval = optset->nodelay;
         break;
+    case NN_TCP_LISTENERS:
+        intval = optset->listeners;
+        break;
+    case NN_TCP_CONNECTIONS:
+        intval = optset->connections;
+        break;
+    case NN_TCP_COMPRESS:
+        intval = optset->compress;
+        break;
+    case NN_TCP_BATCH:
+        intval = optset->batch;
+        break;
+    case NN_TCP_VARINT:
+        intval = optset->varint;
+        break;
+    case NN_TCP_REUSEPORT:
+        intval = optset->reuseport;
+        break;
     default:
         return -ENOPROTOOPT;
     }
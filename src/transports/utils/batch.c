@@ -0,0 +1,132 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "batch.h"
+
+#include "../../utils/err.h"
+#include "../../utils/fast.h"
+#include "../../utils/wire.h"
+#include "../../utils/alloc.h"
+
+#include <string.h>
+
+static void nn_batch_alloc (struct nn_batch *self)
+{
+    if (nn_fast (self->data != NULL))
+        return;
+    self->data = nn_alloc (NN_BATCH_MAXSIZE, "message batch");
+    alloc_assert (self->data);
+}
+
+void nn_batch_init (struct nn_batch *self)
+{
+    self->data = NULL;
+    self->size = 0;
+    self->pos = 0;
+}
+
+void nn_batch_term (struct nn_batch *self)
+{
+    nn_free (self->data);
+}
+
+void nn_batch_reset (struct nn_batch *self)
+{
+    self->size = 0;
+    self->pos = 0;
+}
+
+int nn_batch_empty (struct nn_batch *self)
+{
+    return self->pos == self->size;
+}
+
+int nn_batch_full (struct nn_batch *self)
+{
+    return self->size + 2 + NN_BATCH_MAXMSG > NN_BATCH_MAXSIZE;
+}
+
+int nn_batch_add (struct nn_batch *self, struct nn_msg *msg)
+{
+    size_t sphdrsz;
+    size_t bodysz;
+
+    sphdrsz = nn_chunkref_size (&msg->sphdr);
+    bodysz = nn_chunkref_size (&msg->body);
+    if (nn_slow (sphdrsz + bodysz > NN_BATCH_MAXMSG ||
+          self->size + 2 + sphdrsz + bodysz > NN_BATCH_MAXSIZE))
+        return -EMSGSIZE;
+
+    nn_batch_alloc (self);
+    nn_puts (self->data + self->size, (uint16_t) (sphdrsz + bodysz));
+    self->size += 2;
+    memcpy (self->data + self->size, nn_chunkref_data (&msg->sphdr), sphdrsz);
+    self->size += sphdrsz;
+    memcpy (self->data + self->size, nn_chunkref_data (&msg->body), bodysz);
+    self->size += bodysz;
+
+    return 0;
+}
+
+void *nn_batch_recvbuf (struct nn_batch *self, size_t size)
+{
+    nn_assert (size <= NN_BATCH_MAXSIZE);
+    nn_batch_alloc (self);
+    self->size = size;
+    self->pos = 0;
+    return self->data;
+}
+
+int nn_batch_check (struct nn_batch *self, int maxsize)
+{
+    size_t pos;
+    size_t sz;
+
+    pos = self->pos;
+    while (pos != self->size) {
+        if (nn_slow (self->size - pos < 2))
+            return -EINVAL;
+        sz = nn_gets (self->data + pos);
+        pos += 2;
+        if (nn_slow (sz > self->size - pos))
+            return -EINVAL;
+        if (nn_slow (maxsize >= 0 && sz > (size_t) maxsize))
+            return -EMSGSIZE;
+        pos += sz;
+    }
+
+    return 0;
+}
+
+void nn_batch_get (struct nn_batch *self, struct nn_msg *msg)
+{
+    size_t sz;
+
+    nn_assert (self->size - self->pos >= 2);
+    sz = nn_gets (self->data + self->pos);
+    self->pos += 2;
+    nn_msg_term (msg);
+    nn_msg_init (msg, sz);
+    memcpy (nn_chunkref_data (&msg->body), self->data + self->pos, sz);
+    self->pos += sz;
+}
@@ -0,0 +1,88 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#ifndef NN_BATCH_INCLUDED
+#define NN_BATCH_INCLUDED
+
+#include "../../utils/msg.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*  Buffer to pack several small messages into a single frame of a stream
+    transport. While a frame is being sent, small messages handed to the
+    pipe are appended to the batch instead of waiting for the connection,
+    and the whole batch is then sent as a single frame. The receiver splits
+    the frame back into individual messages. Each message in the batch is
+    prefixed by its size (2 bytes, network byte order). The batch is used
+    only if both peers agreed on it in the protocol header. */
+
+/*  Largest message that is added to a batch. */
+#define NN_BATCH_MAXMSG 1024
+
+/*  Largest size of a batch. */
+#define NN_BATCH_MAXSIZE 65536
+
+struct nn_batch {
+
+    /*  Buffer holding the messages, allocated on the first use. */
+    uint8_t *data;
+
+    /*  Number of bytes in the batch. */
+    size_t size;
+
+    /*  Position of the next message to be read from the batch. */
+    size_t pos;
+};
+
+void nn_batch_init (struct nn_batch *self);
+void nn_batch_term (struct nn_batch *self);
+
+/*  Drops all the messages in the batch. */
+void nn_batch_reset (struct nn_batch *self);
+
+/*  Returns 1 if there are no (more) messages in the batch. */
+int nn_batch_empty (struct nn_batch *self);
+
+/*  Returns 1 if the batch may not be able to accommodate another message. */
+int nn_batch_full (struct nn_batch *self);
+
+/*  Appends the message to the batch. Returns -EMSGSIZE if the message is too
+    large to be batched or doesn't fit into the batch. The message is left
+    intact, it's up to the caller to dispose of it. */
+int nn_batch_add (struct nn_batch *self, struct nn_msg *msg);
+
+/*  Returns a buffer to receive a batch of 'size' bytes into. 'size' must not
+    exceed NN_BATCH_MAXSIZE. */
+void *nn_batch_recvbuf (struct nn_batch *self, size_t size);
+
+/*  Checks that the received batch is well-formed and none of the messages
+    exceeds 'maxsize' bytes, unless 'maxsize' is negative. Returns -EINVAL
+    or -EMSGSIZE otherwise. */
+int nn_batch_check (struct nn_batch *self, int maxsize);
+
+/*  Moves the next message of a checked batch into 'msg'. The batch must not
+    be empty. */
+void nn_batch_get (struct nn_batch *self, struct nn_msg *msg);
+
+#endif
@@ -0,0 +1,448 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "ring.h"
+
+#include "../../utils/err.h"
+#include "../../utils/fast.h"
+#include "../../utils/attr.h"
+
+#include <string.h>
+
+#if defined NN_HAVE_MEMFD && defined NN_HAVE_GCC_ATOMIC_BUILTINS
+
+#include "../../utils/closefd.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+
+/*  The ring can't be shrunk, otherwise accessing it would raise SIGBUS.
+    Unlike shared memory segments used for individual messages it can't be
+    sealed against writes, obviously. */
+#define NN_RING_SEALS (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_SEAL)
+
+/*  Each fragment of a message is preceded by this header. The data are
+    padded to the multiple of 8 bytes. */
+#define NN_RING_FRAGHDR 16
+#define NN_RING_ALIGN(len) (((len) + 7) & ~((uint64_t) 7))
+
+static void nn_ring_put (struct nn_ring *self, uint64_t pos,
+    const void *buf, size_t len);
+static void nn_ring_get (struct nn_ring *self, uint64_t pos,
+    void *buf, size_t len);
+
+int nn_ring_supported (void)
+{
+    return 1;
+}
+
+void nn_ring_init (struct nn_ring *self)
+{
+    self->hdr = NULL;
+    self->data = NULL;
+    self->size = 0;
+    self->fd = -1;
+    self->pos = 0;
+    self->peerpos = 0;
+}
+
+void nn_ring_term (struct nn_ring *self)
+{
+    nn_ring_close (self);
+}
+
+void nn_ring_close (struct nn_ring *self)
+{
+    int rc;
+
+    if (self->hdr) {
+        rc = munmap (self->hdr, sizeof (struct nn_ring_hdr) + self->size);
+        errno_assert (rc == 0);
+    }
+    if (self->fd >= 0)
+        nn_closefd (self->fd);
+    nn_ring_init (self);
+}
+
+void nn_ring_closefd (struct nn_ring *self)
+{
+    if (self->fd >= 0) {
+        nn_closefd (self->fd);
+        self->fd = -1;
+    }
+}
+
+int nn_ring_create (struct nn_ring *self, size_t size)
+{
+    int rc;
+    int fd;
+    void *mem;
+
+    nn_assert (self->hdr == NULL);
+    nn_assert (size >= NN_RING_MINSIZE && size <= NN_RING_MAXSIZE &&
+        !(size & (size - 1)));
+
+    fd = memfd_create ("nanomsg-ring", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (nn_slow (fd < 0))
+        return -errno;
+    rc = ftruncate (fd, sizeof (struct nn_ring_hdr) + size);
+    if (nn_slow (rc < 0))
+        goto fail;
+    rc = fcntl (fd, F_ADD_SEALS, NN_RING_SEALS);
+    if (nn_slow (rc < 0))
+        goto fail;
+    mem = mmap (NULL, sizeof (struct nn_ring_hdr) + size,
+        PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (nn_slow (mem == MAP_FAILED))
+        goto fail;
+
+    /*  The segment is zero-filled. Until the first message arrives
+        the consumer is idle and has to be woken up. */
+    self->hdr = (struct nn_ring_hdr*) mem;
+    self->data = ((uint8_t*) mem) + sizeof (struct nn_ring_hdr);
+    self->size = size;
+    self->fd = fd;
+    self->hdr->size = size;
+    self->hdr->reader_sleeping = 1;
+    return 0;
+
+fail:
+    rc = -errno;
+    nn_closefd (fd);
+    return rc;
+}
+
+int nn_ring_attach (struct nn_ring *self, int fd, size_t size)
+{
+    int rc;
+    void *mem;
+    struct stat st;
+
+    nn_assert (self->hdr == NULL);
+
+    if (nn_slow (size < NN_RING_MINSIZE || size > NN_RING_MAXSIZE ||
+          (size & (size - 1))))
+        return -EPROTO;
+    rc = fcntl (fd, F_GET_SEALS);
+    if (nn_slow (rc < 0))
+        return -errno;
+    if (nn_slow (!(rc & F_SEAL_SHRINK)))
+        return -EPROTO;
+    rc = fstat (fd, &st);
+    if (nn_slow (rc < 0))
+        return -errno;
+    if (nn_slow ((size_t) st.st_size < sizeof (struct nn_ring_hdr) + size))
+        return -EPROTO;
+    mem = mmap (NULL, sizeof (struct nn_ring_hdr) + size,
+        PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+    if (nn_slow (mem == MAP_FAILED))
+        return -errno;
+
+    self->hdr = (struct nn_ring_hdr*) mem;
+    self->data = ((uint8_t*) mem) + sizeof (struct nn_ring_hdr);
+    self->size = size;
+    self->pos = self->hdr->tail;
+    self->peerpos = self->hdr->head;
+    return 0;
+}
+
+int nn_ring_send (struct nn_ring *self, const struct nn_iovec *iov,
+    int iovcnt, size_t *pos)
+{
+    int i;
+    size_t msgsize;
+    size_t fraglen;
+    size_t skip;
+    size_t len;
+    uint64_t used;
+    uint64_t tail;
+    uint8_t fraghdr [NN_RING_FRAGHDR];
+
+    msgsize = 0;
+    for (i = 0; i != iovcnt; ++i)
+        msgsize += iov [i].iov_len;
+    nn_assert (*pos <= msgsize);
+
+    for (;;) {
+
+        /*  Find out how much free space there is. */
+        self->peerpos = self->hdr->head;
+        used = self->pos - self->peerpos;
+        if (nn_slow (used > self->size))
+            return -EPROTO;
+        if (self->size - used <= NN_RING_FRAGHDR)
+            return 0;
+
+        /*  Write the fragment header. */
+        fraglen = msgsize - *pos;
+        if (fraglen > self->size - used - NN_RING_FRAGHDR)
+            fraglen = self->size - used - NN_RING_FRAGHDR;
+        memcpy (fraghdr, &msgsize, sizeof (uint64_t));
+        memcpy (fraghdr + 8, &fraglen, sizeof (uint32_t));
+        memset (fraghdr + 12, 0, 4);
+        tail = self->pos;
+        nn_ring_put (self, tail, fraghdr, NN_RING_FRAGHDR);
+        tail += NN_RING_FRAGHDR;
+
+        /*  Copy the data of the fragment. */
+        skip = *pos;
+        len = fraglen;
+        for (i = 0; len && i != iovcnt; ++i) {
+            if (skip >= iov [i].iov_len) {
+                skip -= iov [i].iov_len;
+                continue;
+            }
+            if (iov [i].iov_len - skip < len) {
+                nn_ring_put (self, tail, ((uint8_t*) iov [i].iov_base) + skip,
+                    iov [i].iov_len - skip);
+                tail += iov [i].iov_len - skip;
+                len -= iov [i].iov_len - skip;
+            }
+            else {
+                nn_ring_put (self, tail, ((uint8_t*) iov [i].iov_base) + skip,
+                    len);
+                tail += len;
+                len = 0;
+            }
+            skip = 0;
+        }
+
+        /*  Publish the fragment. */
+        self->pos += NN_RING_FRAGHDR + NN_RING_ALIGN (fraglen);
+        __sync_synchronize ();
+        self->hdr->tail = self->pos;
+
+        *pos += fraglen;
+        if (*pos == msgsize)
+            return 1;
+    }
+}
+
+int nn_ring_recv (struct nn_ring *self, struct nn_msg *msg, size_t *pos,
+    int maxsize)
+{
+    uint64_t avail;
+    uint64_t msgsize;
+    uint32_t fraglen;
+    uint64_t foot;
+    uint8_t fraghdr [NN_RING_FRAGHDR];
+
+    for (;;) {
+
+        /*  Check whether there is a fragment to read. */
+        self->peerpos = self->hdr->tail;
+        __sync_synchronize ();
+        avail = self->peerpos - self->pos;
+        if (!avail)
+            return 0;
+        if (nn_slow (avail > self->size || avail < NN_RING_FRAGHDR))
+            return -EPROTO;
+
+        /*  Check the fragment header. Whatever the peer wrote there can't
+            be trusted. */
+        nn_ring_get (self, self->pos, fraghdr, NN_RING_FRAGHDR);
+        memcpy (&msgsize, fraghdr, sizeof (uint64_t));
+        memcpy (&fraglen, fraghdr + 8, sizeof (uint32_t));
+        foot = NN_RING_FRAGHDR + NN_RING_ALIGN ((uint64_t) fraglen);
+        if (nn_slow (foot > avail || (!fraglen && msgsize)))
+            return -EPROTO;
+        if (*pos == 0) {
+            if (nn_slow (maxsize >= 0 && msgsize > (uint64_t) maxsize))
+                return -EMSGSIZE;
+            if (nn_slow (msgsize != (size_t) msgsize))
+                return -EMSGSIZE;
+            nn_msg_term (msg);
+            nn_msg_init (msg, (size_t) msgsize);
+        }
+        else if (nn_slow (msgsize != nn_chunkref_size (&msg->body)))
+            return -EPROTO;
+        if (nn_slow (*pos + fraglen > msgsize))
+            return -EPROTO;
+
+        /*  Copy the data out and release the space. */
+        nn_ring_get (self, self->pos + NN_RING_FRAGHDR,
+            ((uint8_t*) nn_chunkref_data (&msg->body)) + *pos, fraglen);
+        self->pos += foot;
+        __sync_synchronize ();
+        self->hdr->head = self->pos;
+
+        *pos += fraglen;
+        if (*pos == msgsize) {
+            *pos = 0;
+            return 1;
+        }
+    }
+}
+
+int nn_ring_sleep (struct nn_ring *self)
+{
+    /*  Announce the intent to sleep first, then check for the data. Either
+        the producer sees the flag or we see the data. */
+    self->hdr->reader_sleeping = 1;
+    __sync_synchronize ();
+    if (self->hdr->tail != self->pos) {
+        self->hdr->reader_sleeping = 0;
+        return 0;
+    }
+    return 1;
+}
+
+int nn_ring_wait (struct nn_ring *self)
+{
+    self->hdr->writer_waiting = 1;
+    __sync_synchronize ();
+    if (self->hdr->head != self->peerpos) {
+        self->hdr->writer_waiting = 0;
+        return 0;
+    }
+    return 1;
+}
+
+int nn_ring_wakereader (struct nn_ring *self)
+{
+    __sync_synchronize ();
+    if (nn_fast (!self->hdr->reader_sleeping))
+        return 0;
+    return __sync_bool_compare_and_swap (&self->hdr->reader_sleeping, 1, 0);
+}
+
+int nn_ring_wakewriter (struct nn_ring *self)
+{
+    __sync_synchronize ();
+    if (nn_fast (!self->hdr->writer_waiting))
+        return 0;
+    return __sync_bool_compare_and_swap (&self->hdr->writer_waiting, 1, 0);
+}
+
+size_t nn_ring_used (struct nn_ring *self)
+{
+    if (!self->hdr)
+        return 0;
+    return (size_t) (self->pos - self->peerpos);
+}
+
+static void nn_ring_put (struct nn_ring *self, uint64_t pos,
+    const void *buf, size_t len)
+{
+    size_t off;
+    size_t first;
+
+    off = (size_t) (pos & (self->size - 1));
+    first = self->size - off < len ? self->size - off : len;
+    memcpy (self->data + off, buf, first);
+    memcpy (self->data, ((const uint8_t*) buf) + first, len - first);
+}
+
+static void nn_ring_get (struct nn_ring *self, uint64_t pos,
+    void *buf, size_t len)
+{
+    size_t off;
+    size_t first;
+
+    off = (size_t) (pos & (self->size - 1));
+    first = self->size - off < len ? self->size - off : len;
+    memcpy (buf, self->data + off, first);
+    memcpy (((uint8_t*) buf) + first, self->data, len - first);
+}
+
+#else
+
+int nn_ring_supported (void)
+{
+    return 0;
+}
+
+void nn_ring_init (struct nn_ring *self)
+{
+    self->hdr = NULL;
+    self->data = NULL;
+    self->size = 0;
+    self->fd = -1;
+    self->pos = 0;
+    self->peerpos = 0;
+}
+
+void nn_ring_term (NN_UNUSED struct nn_ring *self)
+{
+}
+
+void nn_ring_close (NN_UNUSED struct nn_ring *self)
+{
+}
+
+void nn_ring_closefd (NN_UNUSED struct nn_ring *self)
+{
+}
+
+int nn_ring_create (NN_UNUSED struct nn_ring *self, NN_UNUSED size_t size)
+{
+    return -ENOTSUP;
+}
+
+int nn_ring_attach (NN_UNUSED struct nn_ring *self, NN_UNUSED int fd,
+    NN_UNUSED size_t size)
+{
+    return -ENOTSUP;
+}
+
+int nn_ring_send (NN_UNUSED struct nn_ring *self,
+    NN_UNUSED const struct nn_iovec *iov, NN_UNUSED int iovcnt,
+    NN_UNUSED size_t *pos)
+{
+    return -ENOTSUP;
+}
+
+int nn_ring_recv (NN_UNUSED struct nn_ring *self, NN_UNUSED struct nn_msg *msg,
+    NN_UNUSED size_t *pos, NN_UNUSED int maxsize)
+{
+    return -ENOTSUP;
+}
+
+int nn_ring_sleep (NN_UNUSED struct nn_ring *self)
+{
+    return 1;
+}
+
+int nn_ring_wait (NN_UNUSED struct nn_ring *self)
+{
+    return 1;
+}
+
+int nn_ring_wakereader (NN_UNUSED struct nn_ring *self)
+{
+    return 0;
+}
+
+int nn_ring_wakewriter (NN_UNUSED struct nn_ring *self)
+{
+    return 0;
+}
+
+size_t nn_ring_used (NN_UNUSED struct nn_ring *self)
+{
+    return 0;
+}
+
+#endif
@@ -0,0 +1,142 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#ifndef NN_RING_INCLUDED
+#define NN_RING_INCLUDED
+
+#include "../../nn.h"
+
+#include "../../utils/msg.h"
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*  Single-producer/single-consumer byte ring living in a shared memory
+    segment. It is used to pass messages between two processes on the same
+    host without going through the kernel. Each message is stored as one or
+    more fragments, so that messages larger than the ring can be passed as
+    well. The consumer creates the ring and passes its file descriptor to
+    the producer. The ring itself never blocks; the flags in the header let
+    the two sides find out when the peer has to be woken up. */
+
+/*  Smallest and largest allowed size of the data area of the ring. */
+#define NN_RING_MINSIZE 4096
+#define NN_RING_MAXSIZE (1 << 30)
+
+/*  Layout of the header at the beginning of the segment. The indices grow
+    monotonically and are taken modulo the size of the data area. The members
+    written by the consumer and by the producer live on separate cache lines.
+    The layout is part of the wire protocol and thus must not be changed. */
+struct nn_ring_hdr {
+
+    /*  Written by the consumer. */
+    volatile uint64_t head;
+    volatile uint32_t reader_sleeping;
+    uint8_t pad1 [52];
+
+    /*  Written by the producer. */
+    volatile uint64_t tail;
+    volatile uint32_t writer_waiting;
+    uint8_t pad2 [52];
+
+    /*  Size of the data area. Set by the consumer on creation. */
+    uint64_t size;
+    uint8_t pad3 [56];
+};
+
+struct nn_ring {
+
+    /*  The mapping, or NULL if the ring isn't open. */
+    struct nn_ring_hdr *hdr;
+    uint8_t *data;
+    size_t size;
+
+    /*  File descriptor of the segment. Kept only by the consumer until it is
+        passed to the producer. */
+    int fd;
+
+    /*  Local copy of our own index (head for the consumer, tail for
+        the producer) and the last seen value of the peer's index. The shared
+        copies are never trusted as the peer may overwrite them. */
+    uint64_t pos;
+    uint64_t peerpos;
+};
+
+/*  Returns 1 if the rings are supported on this platform. */
+int nn_ring_supported (void);
+
+void nn_ring_init (struct nn_ring *self);
+void nn_ring_term (struct nn_ring *self);
+
+/*  Unmaps the ring and closes the file descriptor, if any. */
+void nn_ring_close (struct nn_ring *self);
+
+/*  Closes the file descriptor of the segment once it was passed to
+    the producer. The mapping stays intact. */
+void nn_ring_closefd (struct nn_ring *self);
+
+/*  Creates a new ring with data area of 'size' bytes, to be read from by
+    this process. 'size' must be a power of two between NN_RING_MINSIZE
+    and NN_RING_MAXSIZE. Returns 0 or a negative error code. */
+int nn_ring_create (struct nn_ring *self, size_t size);
+
+/*  Maps a ring created by the peer, to be written to by this process.
+    The function checks that the segment is sealed against shrinking and is
+    of the expected size. 'fd' is not needed once the function returns. */
+int nn_ring_attach (struct nn_ring *self, int fd, size_t size);
+
+/*  Writes as much of the message gathered from 'iov' as fits into the ring.
+    '*pos' is the number of bytes already written; it should be zero when
+    the function is called for a new message. Returns 1 when the message was
+    fully written, 0 if the ring is full, or a negative error code. */
+int nn_ring_send (struct nn_ring *self, const struct nn_iovec *iov,
+    int iovcnt, size_t *pos);
+
+/*  Reads as much of the next message as available into 'msg'. '*pos' is
+    the number of bytes already read; it should be zero when the function
+    is called for a new message. Messages larger than 'maxsize' are rejected
+    unless 'maxsize' is negative. Returns 1 when the message was fully read,
+    0 if the ring is empty, or a negative error code. */
+int nn_ring_recv (struct nn_ring *self, struct nn_msg *msg, size_t *pos,
+    int maxsize);
+
+/*  Called by the consumer once the ring was found empty. Returns 1 if
+    the producer will wake it up when new data arrive, 0 if new data have
+    arrived in the meantime and the ring should be read again. */
+int nn_ring_sleep (struct nn_ring *self);
+
+/*  Called by the producer once the ring was found full. Returns 1 if
+    the consumer will wake it up when space is released, 0 if space was
+    released in the meantime and the write should be tried again. */
+int nn_ring_wait (struct nn_ring *self);
+
+/*  Return 1 if the peer asked to be woken up, i.e. the consumer is sleeping
+    (called by the producer) or the producer is waiting (called by
+    the consumer). The request is cleared. */
+int nn_ring_wakereader (struct nn_ring *self);
+int nn_ring_wakewriter (struct nn_ring *self);
+
+/*  Number of bytes written by the producer but not yet read. */
+size_t nn_ring_used (struct nn_ring *self);
+
+#endif
@@ -63,6 +63,7 @@ void nn_streamhdr_init (struct nn_streamhdr *self, int src,
     self->usock_owner.src = -1;
     self->usock_owner.fsm = NULL;
     self->pipebase = NULL;
+    self->features = 0;
 }
 
 void nn_streamhdr_term (struct nn_streamhdr *self)
@@ -80,7 +81,7 @@ int nn_streamhdr_isidle (struct nn_streamhdr *self)
 }
 
 void nn_streamhdr_start (struct nn_streamhdr *self, struct nn_usock *usock,
-    struct nn_pipebase *pipebase)
+    struct nn_pipebase *pipebase, int features)
 {
     size_t sz;
     int protocol;
@@ -101,6 +102,8 @@ void nn_streamhdr_start (struct nn_streamhdr *self, struct nn_usock *usock,
     /*  Compose the protocol header. */
     memcpy (self->protohdr, "\0SP\0\0\0\0\0", 8);
     nn_puts (self->protohdr + 4, (uint16_t) protocol);
+    self->protohdr [6] = (uint8_t) features;
+    self->features = features;
 
     /*  Launch the state machine. */
     nn_fsm_start (&self->fsm);
@@ -223,6 +226,7 @@ static void nn_streamhdr_handler (struct nn_fsm *self, int src, int type,
                 protocol = nn_gets (streamhdr->protohdr + 4);
                 if (!nn_pipebase_ispeer (streamhdr->pipebase, protocol))
                     goto invalidhdr;
+                streamhdr->features &= streamhdr->protohdr [6];
                 nn_timer_stop (&streamhdr->timer);
                 streamhdr->state = NN_STREAMHDR_STATE_STOPPING_TIMER_DONE;
                 return;
@@ -260,8 +264,11 @@ invalidhdr:
 
         case NN_STREAMHDR_SRC_USOCK:
             /*  It's safe to ignore usock event when we are stopping, but there
-                is only a subset of events that are plausible. */
-            nn_assert (type == NN_USOCK_ERROR);
+                is only a subset of events that are plausible. If the timer
+                fired, the send or receive that was under way may still
+                complete. */
+            nn_assert (type == NN_USOCK_ERROR || type == NN_USOCK_SHUTDOWN ||
+                type == NN_USOCK_SENT || type == NN_USOCK_RECEIVED);
             return;
 
         case NN_STREAMHDR_SRC_TIMER:
@@ -292,7 +299,7 @@ invalidhdr:
         case NN_STREAMHDR_SRC_USOCK:
             /*  It's safe to ignore usock event when we are stopping, but there
                 is only a subset of events that are plausible. */
-            nn_assert (type == NN_USOCK_ERROR);
+            nn_assert (type == NN_USOCK_ERROR || type == NN_USOCK_SHUTDOWN);
             return;
 
         case NN_STREAMHDR_SRC_TIMER:
@@ -36,6 +36,20 @@
 #define NN_STREAMHDR_ERROR 2
 #define NN_STREAMHDR_STOPPED 3
 
+/*  Optional features of the stream. Each peer offers the features it
+    supports in the reserved byte of the protocol header and a feature is
+    used only if both peers offer it. Peers unaware of the features send
+    zero there. The values are part of the wire protocol. */
+
+/*  The peer accepts compressed messages. */
+#define NN_STREAMHDR_COMPRESS 0x01
+
+/*  The peer accepts batches of small messages packed into a single frame. */
+#define NN_STREAMHDR_BATCH 0x02
+
+/*  The peer accepts compact frame headers (see varint.h). */
+#define NN_STREAMHDR_VARINT 0x04
+
 struct nn_streamhdr {
 
     /*  The state machine. */
@@ -57,6 +71,10 @@ struct nn_streamhdr {
     /*  Protocol header. */
     uint8_t protohdr [8];
 
+    /*  Features offered by this side. Once the protocol headers were
+        exchanged, the features supported by both peers. */
+    int features;
+
     /*  Event fired when the state machine ends. */
     struct nn_fsm_event done;
 };
@@ -67,7 +85,7 @@ void nn_streamhdr_term (struct nn_streamhdr *self);
 
 int nn_streamhdr_isidle (struct nn_streamhdr *self);
 void nn_streamhdr_start (struct nn_streamhdr *self, struct nn_usock *usock,
-    struct nn_pipebase *pipebase);
+    struct nn_pipebase *pipebase, int features);
 void nn_streamhdr_stop (struct nn_streamhdr *self);
 
 #endif
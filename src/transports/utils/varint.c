@@ -0,0 +1,58 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "varint.h"
+
+#include "../../utils/err.h"
+
+size_t nn_varint_put (uint8_t *buf, uint64_t size)
+{
+    if (size < 0x80) {
+        buf [0] = (uint8_t) size;
+        return 1;
+    }
+    if (size <= NN_VARINT_MAX) {
+        buf [0] = (uint8_t) (0x80 | (size >> 8));
+        buf [1] = (uint8_t) (size & 0xff);
+        return 2;
+    }
+    return 0;
+}
+
+int nn_varint_len (uint8_t first)
+{
+    if (!(first & 0x80))
+        return 1;
+    if ((first & 0xc0) == 0x80)
+        return 2;
+    if (first == NN_VARINT_ESCAPE)
+        return 0;
+    return -EINVAL;
+}
+
+uint64_t nn_varint_get (const uint8_t *buf)
+{
+    if (!(buf [0] & 0x80))
+        return buf [0];
+    return (((uint64_t) (buf [0] & 0x3f)) << 8) | buf [1];
+}
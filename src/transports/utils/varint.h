@@ -0,0 +1,60 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#ifndef NN_VARINT_INCLUDED
+#define NN_VARINT_INCLUDED
+
+#include <stddef.h>
+#include <stdint.h>
+
+/*  Compact encoding of the frame header used by the stream transports if
+    both peers agreed on it in the protocol header. The first byte tells
+    the size of the header:
+
+        0xxxxxxx                  message of 0-127 bytes
+        10xxxxxx xxxxxxxx         message of up to 16383 bytes (big-endian)
+        11000000 <header>         any other frame; the regular header of
+                                  the transport follows
+
+    The encoding is part of the wire protocol and thus must not be
+    changed. */
+
+/*  Largest message size that can be encoded compactly. */
+#define NN_VARINT_MAX 16383
+
+/*  First byte of the header announcing that the regular header follows. */
+#define NN_VARINT_ESCAPE 0xc0
+
+/*  Writes compact header for a message of 'size' bytes into 'buf'. Returns
+    the size of the header (1 or 2 bytes) or zero if the size can't be
+    encoded compactly. */
+size_t nn_varint_put (uint8_t *buf, uint64_t size);
+
+/*  Returns the size of the compact header given its first byte, zero if
+    the regular header follows, or -EINVAL if the byte is malformed. */
+int nn_varint_len (uint8_t first);
+
+/*  Decodes the message size from the complete compact header. */
+uint64_t nn_varint_get (const uint8_t *buf);
+
+#endif
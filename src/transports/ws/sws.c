@@ -104,7 +104,9 @@ static int nn_sws_send (struct nn_pipebase *self, struct nn_msg *msg);
 static int nn_sws_recv (struct nn_pipebase *self, struct nn_msg *msg);
 const struct nn_pipebase_vfptr nn_sws_pipebase_vfptr = {
     nn_sws_send,
-    nn_sws_recv
+    nn_sws_recv,
+    NULL,
+    NULL
 };
 
 /*  Private functions. */
@@ -52,14 +52,9 @@ void nn_alloc_term (void)
     nn_mutex_term (&nn_alloc_sync);
 }
 
-void *nn_alloc_ (size_t size, const char *name)
+static void *nn_alloc_register (uint8_t *chunk, size_t size,
+    const char *name)
 {
-    uint8_t *chunk;
-
-    chunk = malloc (sizeof (struct nn_alloc_hdr) + size);
-    if (!chunk)
-        return NULL;
-
     nn_mutex_lock (&nn_alloc_sync);
     ((struct nn_alloc_hdr*) chunk)->size = size;
     ((struct nn_alloc_hdr*) chunk)->name = name;
@@ -73,6 +68,26 @@ void *nn_alloc_ (size_t size, const char *name)
     return chunk + sizeof (struct nn_alloc_hdr);
 }
 
+void *nn_alloc_ (size_t size, const char *name)
+{
+    uint8_t *chunk;
+
+    chunk = malloc (sizeof (struct nn_alloc_hdr) + size);
+    if (!chunk)
+        return NULL;
+    return nn_alloc_register (chunk, size, name);
+}
+
+void *nn_calloc_ (size_t size, const char *name)
+{
+    uint8_t *chunk;
+
+    chunk = calloc (1, sizeof (struct nn_alloc_hdr) + size);
+    if (!chunk)
+        return NULL;
+    return nn_alloc_register (chunk, size, name);
+}
+
 void *nn_realloc (void *ptr, size_t size)
 {
     struct nn_alloc_hdr *oldchunk;
@@ -134,6 +149,11 @@ void *nn_alloc_ (size_t size)
     return malloc (size);
 }
 
+void *nn_calloc_ (size_t size)
+{
+    return calloc (1, size);
+}
+
 void *nn_realloc (void *ptr, size_t size)
 {
     return realloc (ptr, size);
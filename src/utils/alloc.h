@@ -33,12 +33,18 @@ void nn_alloc_term (void);
 void *nn_realloc (void *ptr, size_t size);
 void nn_free (void *ptr);
 
+/*  nn_calloc returns zero-filled memory. Large blocks come straight from
+    the OS that way, so it's cheaper than nn_alloc followed by memset. */
 #if defined NN_ALLOC_MONITOR
 #define nn_alloc(size, name) nn_alloc_ (size, name)
+#define nn_calloc(size, name) nn_calloc_ (size, name)
 void *nn_alloc_ (size_t size, const char *name);
+void *nn_calloc_ (size_t size, const char *name);
 #else
 #define nn_alloc(size, name) nn_alloc_(size)
+#define nn_calloc(size, name) nn_calloc_(size)
 void *nn_alloc_ (size_t size);
+void *nn_calloc_ (size_t size);
 #endif
 
 #endif
@@ -43,6 +43,7 @@ uint32_t nn_atomic_inc (struct nn_atomic *self, uint32_t n)
 #if defined NN_ATOMIC_WINAPI
     return (uint32_t) InterlockedExchangeAdd ((LONG*) &self->n, n);
 #elif defined NN_ATOMIC_SOLARIS
+    membar_exit ();
     return atomic_add_32_nv (&self->n, n) - n;
 #elif defined NN_ATOMIC_GCC_BUILTINS
     return (uint32_t) __sync_fetch_and_add (&self->n, n);
@@ -63,6 +64,7 @@ uint32_t nn_atomic_dec (struct nn_atomic *self, uint32_t n)
 #if defined NN_ATOMIC_WINAPI
     return (uint32_t) InterlockedExchangeAdd ((LONG*) &self->n, -((LONG) n));
 #elif defined NN_ATOMIC_SOLARIS
+    membar_exit ();
     return atomic_add_32_nv (&self->n, -((int32_t) n)) + n;
 #elif defined NN_ATOMIC_GCC_BUILTINS
     return (uint32_t) __sync_fetch_and_sub (&self->n, n);
@@ -78,3 +80,32 @@ uint32_t nn_atomic_dec (struct nn_atomic *self, uint32_t n)
 #endif
 }
 
+uint32_t nn_atomic_load (struct nn_atomic *self)
+{
+#if defined NN_ATOMIC_WINAPI
+    return (uint32_t) InterlockedCompareExchange ((LONG*) &self->n, 0, 0);
+#elif defined NN_ATOMIC_SOLARIS
+    uint32_t res;
+    res = self->n;
+    membar_consumer ();
+    return res;
+#elif defined NN_ATOMIC_GCC_BUILTINS
+#if defined __ATOMIC_ACQUIRE
+    return __atomic_load_n (&self->n, __ATOMIC_ACQUIRE);
+#else
+    uint32_t res;
+    res = self->n;
+    __sync_synchronize ();
+    return res;
+#endif
+#elif defined NN_ATOMIC_MUTEX
+    uint32_t res;
+    nn_mutex_lock (&self->sync);
+    res = self->n;
+    nn_mutex_unlock (&self->sync);
+    return res;
+#else
+#error
+#endif
+}
+
@@ -51,11 +51,18 @@ void nn_atomic_init (struct nn_atomic *self, uint32_t n);
 /*  Destroy the object. */
 void nn_atomic_term (struct nn_atomic *self);
 
-/*  Atomically add n to the object, return old value of the object. */
+/*  Atomically add n to the object, return old value of the object.
+    Writes preceding the call are visible to anyone who loads the new
+    value (release semantics). */
 uint32_t nn_atomic_inc (struct nn_atomic *self, uint32_t n);
 
-/*  Atomically subtract n from the object, return old value of the object. */
+/*  Atomically subtract n from the object, return old value of the object.
+    Release semantics, same as with nn_atomic_inc. */
 uint32_t nn_atomic_dec (struct nn_atomic *self, uint32_t n);
 
+/*  Return current value of the object. Writes that preceded the inc/dec
+    producing the value are visible after the call (acquire semantics). */
+uint32_t nn_atomic_load (struct nn_atomic *self);
+
 #endif
 
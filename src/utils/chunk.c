@@ -33,8 +33,6 @@
 #define NN_CHUNK_TAG 0xdeadcafe
 #define NN_CHUNK_TAG_DEALLOCATED 0xbeadfeed
 
-typedef void (*nn_chunk_free_fn) (void *p);
-
 struct nn_chunk {
 
     /*  Number of places the chunk is referenced from. */
@@ -55,7 +53,6 @@ struct nn_chunk {
 static struct nn_chunk *nn_chunk_getptr (void *p);
 static void *nn_chunk_getdata (struct nn_chunk *c);
 static void nn_chunk_default_free (void *p);
-static size_t nn_chunk_hdrsize ();
 
 int nn_chunk_alloc (size_t size, int type, void **result)
 {
@@ -95,6 +92,20 @@ int nn_chunk_alloc (size_t size, int type, void **result)
     return 0;
 }
 
+void *nn_chunk_init (void *mem, size_t size, nn_chunk_free_fn ffn)
+{
+    struct nn_chunk *self;
+
+    self = mem;
+    nn_atomic_init (&self->refcount, 1);
+    self->size = size;
+    self->ffn = ffn;
+    nn_putl ((uint8_t*) ((uint32_t*) (self + 1)), 0);
+    nn_putl ((uint8_t*) ((((uint32_t*) (self + 1))) + 1), NN_CHUNK_TAG);
+
+    return nn_chunk_getdata (self);
+}
+
 int nn_chunk_realloc (size_t size, void **chunk)
 {
     struct nn_chunk *self;
@@ -107,8 +118,8 @@ int nn_chunk_realloc (size_t size, void **chunk)
     self = nn_chunk_getptr (*chunk);
 
     /*  Check if we only have one reference to this object, in that case we can
-        reallocate the memory chunk. */
-    if (self->refcount.n == 1) {
+        reallocate the memory chunk, unless it wasn't allocated by us. */
+    if (self->refcount.n == 1 && self->ffn == nn_chunk_default_free) {
 
         /* Compute new size, check for overflow. */
         hdr_size = nn_chunk_hdrsize ();
@@ -135,9 +146,9 @@ int nn_chunk_realloc (size_t size, void **chunk)
             return rc;
         }
 
-        memcpy (new_ptr, nn_chunk_getdata (self), self->size);
+        memcpy (new_ptr, *chunk, self->size < size ? self->size : size);
+        nn_chunk_free (*chunk);
         *chunk = new_ptr;
-        nn_atomic_dec (&self->refcount, 1);
     }
 
     return 0;
@@ -225,7 +236,7 @@ static void nn_chunk_default_free (void *p)
     nn_free (p);
 }
 
-static size_t nn_chunk_hdrsize ()
+size_t nn_chunk_hdrsize (void)
 {
     return sizeof (struct nn_chunk) + 2 * sizeof (uint32_t);
 }
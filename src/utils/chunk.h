@@ -26,9 +26,23 @@
 #include <stddef.h>
 #include <stdint.h>
 
+/*  Function deallocating the memory block the chunk lives in. */
+typedef void (*nn_chunk_free_fn) (void *p);
+
 /*  Allocates the chunk using the allocation mechanism specified by 'type'. */
 int nn_chunk_alloc (size_t size, int type, void **result);
 
+/*  Sets up a chunk in a memory block that was obtained by other means than
+    nn_chunk_alloc, e.g. mapped from a file. The block has to start with
+    nn_chunk_hdrsize () bytes reserved for the chunk header, followed by
+    'size' bytes of data. Once the chunk is deallocated, 'ffn' is invoked
+    with 'mem' as an argument. Returns the pointer to the data. */
+void *nn_chunk_init (void *mem, size_t size, nn_chunk_free_fn ffn);
+
+/*  Returns the number of bytes the chunk header occupies in front of
+    the data. */
+size_t nn_chunk_hdrsize (void);
+
 /*  Resizes a chunk previously allocated with nn_chunk_alloc. */
 int nn_chunk_realloc (size_t size, void **chunk);
 
@@ -38,17 +38,23 @@
 #include "attr.h"
 
 uint64_t nn_clock_ms (void)
+{
+    return nn_clock_us () / 1000;
+}
+
+uint64_t nn_clock_us (void)
 {
 #if defined NN_HAVE_WINDOWS
 
     LARGE_INTEGER tps;
     LARGE_INTEGER time;
-    double tpms;
 
+    /*  Split the conversion so that the multiplication doesn't overflow
+        on machines that have been running for a long time. */
     QueryPerformanceFrequency (&tps);
     QueryPerformanceCounter (&time);
-    tpms = (double) (tps.QuadPart / 1000);
-    return (uint64_t) (time.QuadPart / tpms);
+    return (uint64_t) (time.QuadPart / tps.QuadPart) * 1000000 +
+        (uint64_t) (time.QuadPart % tps.QuadPart) * 1000000 / tps.QuadPart;
 
 #elif defined NN_HAVE_OSX
 
@@ -61,11 +67,11 @@ uint64_t nn_clock_ms (void)
 
     ticks = mach_absolute_time ();
     return ticks * nn_clock_timebase_info.numer /
-        nn_clock_timebase_info.denom / 1000000;
+        nn_clock_timebase_info.denom / 1000;
 
 #elif defined NN_HAVE_GETHRTIME
 
-    return gethrtime () / 1000000;
+    return gethrtime () / 1000;
 
 #elif defined NN_HAVE_CLOCK_MONOTONIC
 
@@ -74,7 +80,7 @@ uint64_t nn_clock_ms (void)
 
     rc = clock_gettime (CLOCK_MONOTONIC, &tv);
     errno_assert (rc == 0);
-    return tv.tv_sec * (uint64_t) 1000 + tv.tv_nsec / 1000000;
+    return tv.tv_sec * (uint64_t) 1000000 + tv.tv_nsec / 1000;
 
 #else
 
@@ -85,7 +91,7 @@ uint64_t nn_clock_ms (void)
         monotonic. Thus, it's used as a last resort mechanism. */
     rc = gettimeofday (&tv, NULL);
     errno_assert (rc == 0);
-    return tv.tv_sec * (uint64_t) 1000 + tv.tv_usec / 1000;
+    return tv.tv_sec * (uint64_t) 1000000 + tv.tv_usec;
 
 #endif
 }
@@ -28,5 +28,8 @@
 /*  Returns current time in milliseconds. */
 uint64_t nn_clock_ms (void);
 
+/*  Returns current time in microseconds. */
+uint64_t nn_clock_us (void);
+
 #endif
 
@@ -23,120 +23,219 @@
 #include "hash.h"
 #include "fast.h"
 #include "alloc.h"
-#include "cont.h"
 #include "err.h"
 
 #define NN_HASH_INITIAL_SLOTS 32
 
+/*  Number of slots of the old table moved to the new one per operation
+    while growing. The new table is twice the size of the old one and the
+    next growth starts once it's half full, so anything above 2 guarantees
+    the old table is gone by then. */
+#define NN_HASH_MOVE_STEP 8
+
+/*  Marks a slot in the old table whose item was moved or erased. Lookups
+    have to skip it rather than stop at it. */
+static struct nn_hash_item nn_hash_moved = NN_HASH_ITEM_INITIALIZER;
+
 static uint32_t nn_hash_key (uint32_t key);
+static struct nn_hash_slot *nn_hash_alloc (uint32_t slots);
+static void nn_hash_place (struct nn_hash *self, uint32_t key,
+    struct nn_hash_item *item);
+static void nn_hash_remove (struct nn_hash *self, uint32_t slot);
+static void nn_hash_move (struct nn_hash *self, uint32_t steps);
 
 void nn_hash_init (struct nn_hash *self)
 {
-    uint32_t i;
-
     self->slots = NN_HASH_INITIAL_SLOTS;
     self->items = 0;
-    self->array = nn_alloc (sizeof (struct nn_list) * NN_HASH_INITIAL_SLOTS,
-        "hash map");
-    alloc_assert (self->array);
-    for (i = 0; i != NN_HASH_INITIAL_SLOTS; ++i)
-        nn_list_init (&self->array [i]);
+    self->array = nn_hash_alloc (NN_HASH_INITIAL_SLOTS);
+    self->oldslots = 0;
+    self->olditems = 0;
+    self->oldpos = 0;
+    self->oldarray = NULL;
 }
 
 void nn_hash_term (struct nn_hash *self)
 {
-    uint32_t i;
-
-    for (i = 0; i != self->slots; ++i)
-        nn_list_term (&self->array [i]);
+    if (self->oldarray)
+        nn_free (self->oldarray);
     nn_free (self->array);
 }
 
-static void nn_hash_rehash (struct nn_hash *self) {
-    uint32_t i;
-    uint32_t oldslots;
-    struct nn_list *oldarray;
-    struct nn_hash_item *hitm;
-    uint32_t newslot;
-
-    /*  Allocate new double-sized array of slots. */
-    oldslots = self->slots;
-    oldarray = self->array;
-    self->slots *= 2;
-    self->array = nn_alloc (sizeof (struct nn_list) * self->slots, "hash map");
-    alloc_assert (self->array);
-    for (i = 0; i != self->slots; ++i)
-    nn_list_init (&self->array [i]);
-
-    /*  Move the items from old slot array to new slot array. */
-    for (i = 0; i != oldslots; ++i) {
-    while (!nn_list_empty (&oldarray [i])) {
-        hitm = nn_cont (nn_list_begin (&oldarray [i]),
-                struct nn_hash_item, list);
-        nn_list_erase (&oldarray [i], &hitm->list);
-        newslot = nn_hash_key (hitm->key) % self->slots;
-        nn_list_insert (&self->array [newslot], &hitm->list,
-                nn_list_end (&self->array [newslot]));
+void nn_hash_insert (struct nn_hash *self, uint32_t key,
+    struct nn_hash_item *item)
+{
+    nn_assert (!nn_hash_get (self, key));
+
+    /*  If the hash is getting full, start moving the items to a table with
+        double the amount of slots. */
+    if (nn_slow (self->items * 2 >= self->slots &&
+          self->slots < 0x80000000)) {
+
+        /*  Should not happen, but if the previous growth hasn't finished
+            yet, finish it now. */
+        if (nn_slow (self->oldarray != NULL))
+            nn_hash_move (self, self->oldslots);
+
+        self->oldslots = self->slots;
+        self->olditems = self->items;
+        self->oldpos = 0;
+        self->oldarray = self->array;
+        self->slots *= 2;
+        self->array = nn_hash_alloc (self->slots);
     }
 
-    nn_list_term (&oldarray [i]);
-    }
+    item->key = key;
+    item->inhash = 1;
+    nn_hash_place (self, key, item);
+    ++self->items;
 
-    /*  Deallocate the old array of slots. */
-    nn_free (oldarray);
+    if (self->oldarray)
+        nn_hash_move (self, NN_HASH_MOVE_STEP);
 }
 
-
-void nn_hash_insert (struct nn_hash *self, uint32_t key,
-    struct nn_hash_item *item)
+void nn_hash_erase (struct nn_hash *self, struct nn_hash_item *item)
 {
-    struct nn_list_item *it;
+    uint32_t mask;
     uint32_t i;
 
-    i = nn_hash_key (key) % self->slots;
+    nn_assert (item->inhash);
+    item->inhash = 0;
+    --self->items;
+
+    /*  Look for the item in the new table first. */
+    mask = self->slots - 1;
+    i = nn_hash_key (item->key) & mask;
+    while (self->array [i].item) {
+        if (self->array [i].item == item) {
+            nn_hash_remove (self, i);
+            if (self->oldarray)
+                nn_hash_move (self, NN_HASH_MOVE_STEP);
+            return;
+        }
+        i = (i + 1) & mask;
+    }
 
-    for (it = nn_list_begin (&self->array [i]);
-          it != nn_list_end (&self->array [i]);
-          it = nn_list_next (&self->array [i], it))
-        nn_assert (nn_cont (it, struct nn_hash_item, list)->key != key);
+    /*  It must be in the old one then. */
+    nn_assert (self->oldarray);
+    mask = self->oldslots - 1;
+    i = nn_hash_key (item->key) & mask;
+    while (self->oldarray [i].item != item) {
+        nn_assert (self->oldarray [i].item);
+        i = (i + 1) & mask;
+    }
+    self->oldarray [i].item = &nn_hash_moved;
+    --self->olditems;
+    nn_hash_move (self, NN_HASH_MOVE_STEP);
+}
 
-    item->key = key;
-    nn_list_insert (&self->array [i], &item->list,
-        nn_list_end (&self->array [i]));
-    ++self->items;
+struct nn_hash_item *nn_hash_get (struct nn_hash *self, uint32_t key)
+{
+    uint32_t mask;
+    uint32_t i;
+    struct nn_hash_slot *slot;
+
+    mask = self->slots - 1;
+    i = nn_hash_key (key) & mask;
+    while (1) {
+        slot = &self->array [i];
+        if (!slot->item)
+            break;
+        if (slot->key == key)
+            return slot->item;
+        i = (i + 1) & mask;
+    }
 
-    /*  If the hash is getting full, double the amount of slots and
-        re-hash all the items. */
-    if (nn_slow (self->items * 2 > self->slots && self->slots < 0x80000000))
-    nn_hash_rehash(self);
+    if (nn_fast (!self->oldarray))
+        return NULL;
+
+    mask = self->oldslots - 1;
+    i = nn_hash_key (key) & mask;
+    while (1) {
+        slot = &self->oldarray [i];
+        if (!slot->item)
+            return NULL;
+        if (slot->key == key && slot->item != &nn_hash_moved)
+            return slot->item;
+        i = (i + 1) & mask;
+    }
 }
 
-void nn_hash_erase (struct nn_hash *self, struct nn_hash_item *item)
+static struct nn_hash_slot *nn_hash_alloc (uint32_t slots)
 {
-    uint32_t slot;
+    struct nn_hash_slot *array;
 
-    slot = nn_hash_key (item->key) % self->slots;
-    nn_list_erase (&self->array [slot], &item->list);
-	--self->items;
+    array = nn_calloc (sizeof (struct nn_hash_slot) * slots, "hash map");
+    alloc_assert (array);
+    return array;
 }
 
-struct nn_hash_item *nn_hash_get (struct nn_hash *self, uint32_t key)
+/*  Puts the item into the first free slot of its probe sequence in the
+    new table. */
+static void nn_hash_place (struct nn_hash *self, uint32_t key,
+    struct nn_hash_item *item)
 {
-    uint32_t slot;
-    struct nn_list_item *it;
-    struct nn_hash_item *item;
-
-    slot = nn_hash_key (key) % self->slots;
-
-    for (it = nn_list_begin (&self->array [slot]);
-          it != nn_list_end (&self->array [slot]);
-          it = nn_list_next (&self->array [slot], it)) {
-        item = nn_cont (it, struct nn_hash_item, list);
-        if (item->key == key)
-            return item;
+    uint32_t mask;
+    uint32_t i;
+
+    mask = self->slots - 1;
+    i = nn_hash_key (key) & mask;
+    while (self->array [i].item)
+        i = (i + 1) & mask;
+    self->array [i].key = key;
+    self->array [i].item = item;
+}
+
+/*  Empties the slot in the new table. The items following it in the same
+    run of occupied slots are shifted back so that no probe sequence is
+    broken, i.e. the table never contains tombstones. */
+static void nn_hash_remove (struct nn_hash *self, uint32_t slot)
+{
+    uint32_t mask;
+    uint32_t i;
+    uint32_t home;
+
+    mask = self->slots - 1;
+    i = slot;
+    while (1) {
+        i = (i + 1) & mask;
+        if (!self->array [i].item)
+            break;
+
+        /*  The item can fill the gap unless its home slot lies cyclically
+            within (slot, i]. */
+        home = nn_hash_key (self->array [i].key) & mask;
+        if (((i - home) & mask) >= ((i - slot) & mask)) {
+            self->array [slot] = self->array [i];
+            slot = i;
+        }
+    }
+    self->array [slot].item = NULL;
+}
+
+/*  Moves items from the old table to the new one, examining at most 'steps'
+    slots. Once the old table is empty, it is deallocated. */
+static void nn_hash_move (struct nn_hash *self, uint32_t steps)
+{
+    struct nn_hash_slot *slot;
+
+    while (steps && self->olditems) {
+        slot = &self->oldarray [self->oldpos];
+        if (slot->item && slot->item != &nn_hash_moved) {
+            nn_hash_place (self, slot->key, slot->item);
+            slot->item = &nn_hash_moved;
+            --self->olditems;
+        }
+        ++self->oldpos;
+        --steps;
     }
 
-    return NULL;
+    if (!self->olditems) {
+        nn_free (self->oldarray);
+        self->oldslots = 0;
+        self->oldpos = 0;
+        self->oldarray = NULL;
+    }
 }
 
 uint32_t nn_hash_key (uint32_t key)
@@ -154,11 +253,15 @@ uint32_t nn_hash_key (uint32_t key)
 
 void nn_hash_item_init (struct nn_hash_item *self)
 {
-    nn_list_item_init (&self->list);
+    self->inhash = 0;
 }
 
 void nn_hash_item_term (struct nn_hash_item *self)
 {
-    nn_list_item_term (&self->list);
+    nn_assert (!self->inhash);
 }
 
+int nn_hash_item_isinhash (struct nn_hash_item *self)
+{
+    return self->inhash;
+}
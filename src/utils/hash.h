@@ -23,23 +23,45 @@
 #ifndef NN_HASH_INCLUDED
 #define NN_HASH_INCLUDED
 
-#include "list.h"
-
 #include <stddef.h>
 #include <stdint.h>
 
+/*  Open-addressing hash table with linear probing. The items are not owned
+    by the table; it only stores pointers to them.
+
+    When the table gets half full, a table with twice as many slots is
+    allocated. The items are then moved to it a few at a time by subsequent
+    insertions and erasures rather than all at once, so that growing the
+    table never stalls a single operation for long. Till all the items are
+    moved, lookups search both tables. */
+
 /*  Use for initialising a hash item statically. */
-#define NN_HASH_ITEM_INITIALIZER {0xffff, NN_LIST_ITEM_INITILIZER}
+#define NN_HASH_ITEM_INITIALIZER {0xffff, 0}
 
 struct nn_hash_item {
     uint32_t key;
-    struct nn_list_item list;
+    int inhash;
+};
+
+struct nn_hash_slot {
+    uint32_t key;
+    struct nn_hash_item *item;
 };
 
 struct nn_hash {
+
+    /*  The table new items are inserted into. Number of slots is always
+        a power of two. 'items' counts the items in both tables. */
     uint32_t slots;
     uint32_t items;
-    struct nn_list *array;
+    struct nn_hash_slot *array;
+
+    /*  The table being emptied while growing, if any. Slots below 'oldpos'
+        have already been moved to the new table. */
+    uint32_t oldslots;
+    uint32_t olditems;
+    uint32_t oldpos;
+    struct nn_hash_slot *oldarray;
 };
 
 /*  Initialise the hash table. */
@@ -67,4 +89,7 @@ void nn_hash_item_init (struct nn_hash_item *self);
     this call. */
 void nn_hash_item_term (struct nn_hash_item *self);
 
+/*  Returns 1 if the item is part of a hash table, 0 otherwise. */
+int nn_hash_item_isinhash (struct nn_hash_item *self);
+
 #endif
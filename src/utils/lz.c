@@ -0,0 +1,239 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "lz.h"
+#include "err.h"
+#include "fast.h"
+
+#include <stdint.h>
+#include <string.h>
+
+/*  Size of the hash table used to find matches, as a power of two. */
+#define NN_LZ_HASHLOG 12
+
+/*  Matches shorter than this are not encoded. */
+#define NN_LZ_MINMATCH 4
+
+/*  Farthest back reference. */
+#define NN_LZ_MAXOFFSET 65535
+
+/*  No match starts within this many bytes from the end of the input, and
+    matches never reach into the last NN_LZ_LASTLITERALS bytes. This lets the
+    compressor read 4 bytes at a time without checking the bounds. */
+#define NN_LZ_MFLIMIT 12
+#define NN_LZ_LASTLITERALS 5
+
+/*  Private functions. */
+static uint32_t nn_lz_read32 (const uint8_t *p);
+static uint32_t nn_lz_hash (uint32_t val);
+static uint8_t *nn_lz_putlen (uint8_t *op, size_t len);
+static int nn_lz_getlen (const uint8_t **ip, const uint8_t *iend,
+    size_t *len);
+
+size_t nn_lz_compress (const void *src, size_t srclen, void *dst,
+    size_t dstlen)
+{
+    const uint8_t *base;
+    const uint8_t *ip;
+    const uint8_t *anchor;
+    const uint8_t *iend;
+    const uint8_t *ilimit;
+    const uint8_t *mlimit;
+    const uint8_t *match;
+    uint8_t *op;
+    uint8_t *oend;
+    uint8_t *token;
+    uint32_t table [1 << NN_LZ_HASHLOG];
+    uint32_t h;
+    size_t litlen;
+    size_t mlen;
+    size_t offset;
+
+    base = (const uint8_t*) src;
+    ip = base;
+    anchor = base;
+    iend = base + srclen;
+    op = (uint8_t*) dst;
+    oend = op + dstlen;
+
+    if (srclen > NN_LZ_MFLIMIT) {
+        ilimit = iend - NN_LZ_MFLIMIT;
+        mlimit = iend - NN_LZ_LASTLITERALS;
+        memset (table, 0, sizeof (table));
+
+        while (ip < ilimit) {
+
+            /*  Look up the last position with the same 4 bytes prefix. */
+            h = nn_lz_hash (nn_lz_read32 (ip));
+            match = base + table [h];
+            table [h] = (uint32_t) (ip - base);
+            offset = (size_t) (ip - match);
+            if (offset == 0 || offset > NN_LZ_MAXOFFSET ||
+                  nn_lz_read32 (match) != nn_lz_read32 (ip)) {
+
+                /*  Skip faster over data that don't compress. */
+                ip += 1 + ((ip - anchor) >> 6);
+                continue;
+            }
+
+            /*  Extend the match as far as possible. */
+            mlen = NN_LZ_MINMATCH;
+            while (ip + mlen < mlimit && match [mlen] == ip [mlen])
+                ++mlen;
+
+            /*  Emit the sequence. The worst case size is checked upfront. */
+            litlen = (size_t) (ip - anchor);
+            if (nn_slow ((size_t) (oend - op) <
+                  1 + litlen / 255 + 1 + litlen + 2 + mlen / 255 + 1))
+                return 0;
+            token = op++;
+            *token = (uint8_t) ((litlen < 15 ? litlen : 15) << 4);
+            if (litlen >= 15)
+                op = nn_lz_putlen (op, litlen - 15);
+            memcpy (op, anchor, litlen);
+            op += litlen;
+            *op++ = (uint8_t) (offset & 0xff);
+            *op++ = (uint8_t) (offset >> 8);
+            mlen -= NN_LZ_MINMATCH;
+            *token |= (uint8_t) (mlen < 15 ? mlen : 15);
+            if (mlen >= 15)
+                op = nn_lz_putlen (op, mlen - 15);
+
+            ip += mlen + NN_LZ_MINMATCH;
+            anchor = ip;
+        }
+    }
+
+    /*  The rest of the input is emitted as literals. */
+    litlen = (size_t) (iend - anchor);
+    if (nn_slow ((size_t) (oend - op) < 1 + litlen / 255 + 1 + litlen))
+        return 0;
+    token = op++;
+    *token = (uint8_t) ((litlen < 15 ? litlen : 15) << 4);
+    if (litlen >= 15)
+        op = nn_lz_putlen (op, litlen - 15);
+    memcpy (op, anchor, litlen);
+    op += litlen;
+
+    return (size_t) (op - (uint8_t*) dst);
+}
+
+int nn_lz_decompress (const void *src, size_t srclen, void *dst,
+    size_t dstlen)
+{
+    const uint8_t *ip;
+    const uint8_t *iend;
+    uint8_t *op;
+    uint8_t *oend;
+    const uint8_t *match;
+    size_t len;
+    size_t offset;
+    uint8_t token;
+
+    ip = (const uint8_t*) src;
+    iend = ip + srclen;
+    op = (uint8_t*) dst;
+    oend = op + dstlen;
+
+    while (ip < iend) {
+
+        /*  Copy the literals. */
+        token = *ip++;
+        len = token >> 4;
+        if (len == 15 && nn_slow (nn_lz_getlen (&ip, iend, &len) < 0))
+            return -EINVAL;
+        if (nn_slow ((size_t) (iend - ip) < len ||
+              (size_t) (oend - op) < len))
+            return -EINVAL;
+        memcpy (op, ip, len);
+        ip += len;
+        op += len;
+
+        /*  The last sequence has no back reference. */
+        if (ip == iend)
+            break;
+
+        /*  Copy the back reference. It may overlap the data being
+            produced. */
+        if (nn_slow (iend - ip < 2))
+            return -EINVAL;
+        offset = ip [0] | ((size_t) ip [1] << 8);
+        ip += 2;
+        if (nn_slow (offset == 0 || offset > (size_t) (op - (uint8_t*) dst)))
+            return -EINVAL;
+        len = token & 15;
+        if (len == 15 && nn_slow (nn_lz_getlen (&ip, iend, &len) < 0))
+            return -EINVAL;
+        len += NN_LZ_MINMATCH;
+        if (nn_slow ((size_t) (oend - op) < len))
+            return -EINVAL;
+        match = op - offset;
+        if (offset >= len) {
+            memcpy (op, match, len);
+            op += len;
+        }
+        else {
+            while (len--)
+                *op++ = *match++;
+        }
+    }
+
+    return op == oend ? 0 : -EINVAL;
+}
+
+static uint32_t nn_lz_read32 (const uint8_t *p)
+{
+    uint32_t val;
+
+    memcpy (&val, p, sizeof (val));
+    return val;
+}
+
+static uint32_t nn_lz_hash (uint32_t val)
+{
+    return (val * 2654435761U) >> (32 - NN_LZ_HASHLOG);
+}
+
+static uint8_t *nn_lz_putlen (uint8_t *op, size_t len)
+{
+    while (len >= 255) {
+        *op++ = 255;
+        len -= 255;
+    }
+    *op++ = (uint8_t) len;
+    return op;
+}
+
+static int nn_lz_getlen (const uint8_t **ip, const uint8_t *iend,
+    size_t *len)
+{
+    uint8_t byte;
+
+    do {
+        if (nn_slow (*ip == iend))
+            return -EINVAL;
+        byte = *(*ip)++;
+        *len += byte;
+    } while (byte == 255);
+    return 0;
+}
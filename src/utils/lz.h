@@ -0,0 +1,49 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#ifndef NN_LZ_INCLUDED
+#define NN_LZ_INCLUDED
+
+#include <stddef.h>
+
+/*  A fast LZ77 compressor in the vein of LZ4. The compressed data are
+    a sequence of tokens, each carrying a run of literals followed by a back
+    reference of at least 4 bytes within the preceding 64kB. The format is
+    part of the wire protocol and thus must not be changed. */
+
+/*  Maximal size of the data produced by compressing 'len' bytes. */
+#define NN_LZ_BOUND(len) ((len) + (len) / 255 + 16)
+
+/*  Compresses 'srclen' bytes from 'src' into 'dst' that can hold 'dstlen'
+    bytes. Returns the size of the compressed data, or zero if they don't fit
+    into 'dst'. */
+size_t nn_lz_compress (const void *src, size_t srclen, void *dst,
+    size_t dstlen);
+
+/*  Decompresses 'srclen' bytes from 'src' into 'dst'. The decompressed data
+    must be exactly 'dstlen' bytes long. Returns zero in case of success or
+    -EINVAL if the compressed data are malformed. */
+int nn_lz_decompress (const void *src, size_t srclen, void *dst,
+    size_t dstlen);
+
+#endif
@@ -0,0 +1,166 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "shmem.h"
+#include "chunk.h"
+#include "err.h"
+#include "fast.h"
+#include "attr.h"
+
+#if defined NN_HAVE_MEMFD
+
+#include "closefd.h"
+
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <stdint.h>
+
+/*  Seals that guarantee the segment can't be modified once created. */
+#define NN_SHMEM_SEALS \
+    (F_SEAL_SHRINK | F_SEAL_GROW | F_SEAL_WRITE | F_SEAL_SEAL)
+
+static void nn_shmem_unmap (void *p);
+
+int nn_shmem_supported (void)
+{
+    return 1;
+}
+
+int nn_shmem_create (const struct nn_iovec *iov, int iovcnt, size_t size)
+{
+    int rc;
+    int fd;
+    int i;
+    size_t pos;
+    size_t done;
+    ssize_t nbytes;
+
+    fd = memfd_create ("nanomsg", MFD_CLOEXEC | MFD_ALLOW_SEALING);
+    if (nn_slow (fd < 0))
+        return -errno;
+    rc = ftruncate (fd, NN_SHMEM_OFFSET + size);
+    if (nn_slow (rc < 0))
+        goto fail;
+
+    /*  Write the data. Going through the file rather than through a mapping
+        allows the segment to be sealed against writes afterwards. */
+    pos = NN_SHMEM_OFFSET;
+    for (i = 0; i != iovcnt; ++i) {
+        done = 0;
+        while (done < iov [i].iov_len) {
+            nbytes = pwrite (fd, ((uint8_t*) iov [i].iov_base) + done,
+                iov [i].iov_len - done, pos);
+            if (nn_slow (nbytes < 0)) {
+                if (errno == EINTR)
+                    continue;
+                goto fail;
+            }
+            done += nbytes;
+            pos += nbytes;
+        }
+    }
+    nn_assert (pos == NN_SHMEM_OFFSET + size);
+
+    rc = fcntl (fd, F_ADD_SEALS, NN_SHMEM_SEALS);
+    if (nn_slow (rc < 0))
+        goto fail;
+
+    return fd;
+
+fail:
+    rc = -errno;
+    nn_closefd (fd);
+    return rc;
+}
+
+int nn_shmem_map (int fd, size_t size, void **chunk)
+{
+    int rc;
+    size_t len;
+    uint8_t *mem;
+    struct stat st;
+    const size_t hdrsz = nn_chunk_hdrsize ();
+
+    nn_assert (sizeof (size_t) + hdrsz <= NN_SHMEM_OFFSET);
+
+    /*  Accessing the mapping beyond the end of the file would raise SIGBUS.
+        Thus, make sure that the sender can't shrink the segment. */
+    rc = fcntl (fd, F_GET_SEALS);
+    if (nn_slow (rc < 0))
+        return -errno;
+    if (nn_slow ((rc & NN_SHMEM_SEALS) != NN_SHMEM_SEALS))
+        return -EPROTO;
+    rc = fstat (fd, &st);
+    if (nn_slow (rc < 0))
+        return -errno;
+    len = NN_SHMEM_OFFSET + size;
+    if (nn_slow (len < size || (size_t) st.st_size < len))
+        return -EPROTO;
+
+    /*  The mapping is private so that the chunk header (and whatever
+        the user does to the data) touches only the local copies of
+        the pages. */
+    mem = mmap (NULL, len, PROT_READ | PROT_WRITE, MAP_PRIVATE, fd, 0);
+    if (nn_slow (mem == MAP_FAILED))
+        return -errno;
+
+    /*  Remember the length of the mapping at its very beginning and place
+        the chunk header right in front of the data. */
+    *(size_t*) mem = len;
+    *chunk = nn_chunk_init (mem + NN_SHMEM_OFFSET - hdrsz, size,
+        nn_shmem_unmap);
+
+    return 0;
+}
+
+static void nn_shmem_unmap (void *p)
+{
+    int rc;
+    uint8_t *mem;
+
+    mem = ((uint8_t*) p) - (NN_SHMEM_OFFSET - nn_chunk_hdrsize ());
+    rc = munmap (mem, *(size_t*) mem);
+    errno_assert (rc == 0);
+}
+
+#else
+
+int nn_shmem_supported (void)
+{
+    return 0;
+}
+
+int nn_shmem_create (NN_UNUSED const struct nn_iovec *iov,
+    NN_UNUSED int iovcnt, NN_UNUSED size_t size)
+{
+    return -ENOTSUP;
+}
+
+int nn_shmem_map (NN_UNUSED int fd, NN_UNUSED size_t size,
+    NN_UNUSED void **chunk)
+{
+    return -ENOTSUP;
+}
+
+#endif
@@ -0,0 +1,54 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#ifndef NN_SHMEM_INCLUDED
+#define NN_SHMEM_INCLUDED
+
+/*  Import the definition of nn_iovec. */
+#include "../nn.h"
+
+#include <stddef.h>
+
+/*  Anonymous shared memory segments used to pass message data between
+    processes on the same host. A segment is identified by a file descriptor
+    that can be passed to the other process. The data start at offset
+    NN_SHMEM_OFFSET within the segment; the space in front of them is used
+    by the receiving side to hold the chunk header. The value is part of
+    the wire protocol and thus must not be changed. */
+#define NN_SHMEM_OFFSET 4096
+
+/*  Returns 1 if shared memory segments are supported on this platform. */
+int nn_shmem_supported (void);
+
+/*  Creates a new segment holding 'size' bytes of data gathered from 'iov'.
+    The segment is sealed so that its content can't be changed afterwards.
+    Returns the file descriptor of the segment or a negative error code. */
+int nn_shmem_create (const struct nn_iovec *iov, int iovcnt, size_t size);
+
+/*  Maps the segment 'fd' with 'size' bytes of data into the memory and
+    returns it as a message chunk. Nothing is copied. The file descriptor
+    is not needed once the function returns. Returns 0 in case of success,
+    or a negative error code, e.g. if the segment isn't sealed or is smaller
+    than expected. */
+int nn_shmem_map (int fd, size_t size, void **chunk);
+
+#endif
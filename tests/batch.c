@@ -0,0 +1,130 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "../src/nn.h"
+#include "../src/pipeline.h"
+#include "../src/tcp.h"
+#include "../src/ipc.h"
+
+#include "testutil.h"
+
+#include <string.h>
+
+/*  Tests batching of small messages over the stream transports. Messages
+    are batched while the connection is busy, so fill it up before
+    receiving anything. The same traffic is sent with batching switched
+    off to check that the messages arrive intact either way. */
+
+#define ROUNDS 5
+#define MAX_MESSAGES 20000
+#define LARGE_SIZE 3000
+
+static char buf [LARGE_SIZE];
+
+static size_t msgsize (int i)
+{
+    /*  Each 1000th message is too large to be batched. */
+    return i % 1000 == 999 ? LARGE_SIZE : 16 + i % 49;
+}
+
+static void test_batch (char *addr, int level, int option, int batch)
+{
+    int rc;
+    int sb;
+    int sc;
+    int opt;
+    int i;
+    int j;
+    int count;
+    void *msg;
+    size_t sz;
+
+    sb = test_socket (AF_SP, NN_PULL);
+    sc = test_socket (AF_SP, NN_PUSH);
+    opt = 4096;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_RCVBUF, &opt, sizeof (opt));
+    test_setsockopt (sc, NN_SOL_SOCKET, NN_SNDBUF, &opt, sizeof (opt));
+
+    /*  Check the option. Batching is used only if both peers ask for it. */
+    sz = sizeof (opt);
+    rc = nn_getsockopt (sc, level, option, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (opt));
+    nn_assert (opt == 0);
+    opt = 2;
+    rc = nn_setsockopt (sc, level, option, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    test_setsockopt (sb, level, option, &batch, sizeof (batch));
+    test_setsockopt (sc, level, option, &batch, sizeof (batch));
+
+    test_bind (sb, addr);
+    test_connect (sc, addr);
+
+    /*  Make sure the connection is established. */
+    test_send (sc, "ABC");
+    test_recv (sb, "ABC");
+
+    for (j = 0; j != ROUNDS; ++j) {
+        for (count = 0; count != MAX_MESSAGES; ++count) {
+            memset (buf, count, sizeof (buf));
+            rc = nn_send (sc, buf, msgsize (count), NN_DONTWAIT);
+            if (rc < 0 && nn_errno () == EAGAIN)
+                break;
+            errno_assert (rc >= 0);
+            nn_assert ((size_t) rc == msgsize (count));
+        }
+        nn_assert (count > 0);
+        for (i = 0; i != count; ++i) {
+            rc = nn_recv (sb, &msg, NN_MSG, 0);
+            errno_assert (rc >= 0);
+            nn_assert ((size_t) rc == msgsize (i));
+            memset (buf, i, sizeof (buf));
+            nn_assert (memcmp (msg, buf, rc) == 0);
+            rc = nn_freemsg (msg);
+            errno_assert (rc == 0);
+        }
+    }
+
+    /*  Make sure the messages were actually batched, or not. */
+    if (batch)
+        nn_assert (nn_get_statistic (sc, NN_STAT_BATCHES_SENT) > 0);
+    else
+        nn_assert (nn_get_statistic (sc, NN_STAT_BATCHES_SENT) == 0);
+
+    test_close (sc);
+    test_close (sb);
+}
+
+int main (int argc, const char *argv[])
+{
+    char socket_address [128];
+
+    test_addr_from (socket_address, "tcp", "127.0.0.1",
+            get_test_port (argc, argv));
+    test_batch (socket_address, NN_TCP, NN_TCP_BATCH, 1);
+    test_batch (socket_address, NN_TCP, NN_TCP_BATCH, 0);
+    test_batch ("ipc://test_batch.ipc", NN_IPC, NN_IPC_BATCH, 1);
+    test_batch ("ipc://test_batch.ipc", NN_IPC, NN_IPC_BATCH, 0);
+
+    return 0;
+}
@@ -25,6 +25,7 @@
 #include "../src/bus.h"
 #include "../src/pair.h"
 #include "../src/pipeline.h"
+#include "../src/reqrep.h"
 #include "../src/inproc.h"
 
 #include "testutil.h"
@@ -36,6 +37,7 @@
 #define SOCKET_ADDRESS_C "inproc://c"
 #define SOCKET_ADDRESS_D "inproc://d"
 #define SOCKET_ADDRESS_E "inproc://e"
+#define SOCKET_ADDRESS_H "inproc://h"
 
 void device1 (NN_UNUSED void *arg)
 {
@@ -96,7 +98,33 @@ void device3 (NN_UNUSED void *arg)
     test_close (deve);
 }
 
-int main ()
+void device4 (void *arg)
+{
+    int rc;
+    int devf [2];
+    int devh [2];
+
+    /*  Intialise the device sockets, one pair per shard. The front-end
+        sockets are bound to the shared address by the device itself. */
+    devf [0] = test_socket (AF_SP_RAW, NN_REP);
+    devf [1] = test_socket (AF_SP_RAW, NN_REP);
+    devh [0] = test_socket (AF_SP_RAW, NN_REQ);
+    test_connect (devh [0], SOCKET_ADDRESS_H);
+    devh [1] = test_socket (AF_SP_RAW, NN_REQ);
+    test_connect (devh [1], SOCKET_ADDRESS_H);
+
+    /*  Run the device. */
+    rc = nn_device_shards (devf, devh, 2, (const char*) arg);
+    nn_assert (rc < 0 && nn_errno () == EBADF);
+
+    /*  Clean up. */
+    test_close (devh [1]);
+    test_close (devh [0]);
+    test_close (devf [1]);
+    test_close (devf [0]);
+}
+
+int main (int argc, const char *argv[])
 {
     int enda;
     int endb;
@@ -107,7 +135,15 @@ int main ()
     struct nn_thread thread1;
     struct nn_thread thread2;
     struct nn_thread thread3;
+    struct nn_thread thread4;
+    int endf;
+    int endg;
+    int endh;
+    int rc;
+    int dummy;
     int timeo;
+    int i;
+    char socket_address_f [128];
 
     /*  Test the bi-directional device. */
 
@@ -145,6 +181,12 @@ int main ()
     test_send (endc, "XYZ");
     test_recv (endd, "XYZ");
 
+    /*  Pass a burst of messages that the device has to move in batches. */
+    for (i = 0; i != 1000; ++i)
+        test_send (endc, "XYZ");
+    for (i = 0; i != 1000; ++i)
+        test_recv (endd, "XYZ");
+
     /*  Clean up. */
     test_close (endd);
     test_close (endc);
@@ -178,11 +220,52 @@ int main ()
     test_close (ende2);
     test_close (ende1);
 
+    /*  Test the sharded device. */
+
+    /*  Check the arguments are validated. */
+    rc = nn_device_shards (&dummy, &dummy, 0, NULL);
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    endf = test_socket (AF_SP_RAW, NN_REP);
+    rc = nn_device_shards (&endf, &endf, 1, "tcp://127.0.0.1");
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    test_close (endf);
+
+    /*  Start the device. */
+    test_addr_from (socket_address_f, "tcp", "127.0.0.1",
+        get_test_port (argc, argv));
+    nn_thread_init (&thread4, device4, socket_address_f);
+
+    /*  Create a server and two clients of the single sharded endpoint. */
+    endh = test_socket (AF_SP, NN_REP);
+    test_bind (endh, SOCKET_ADDRESS_H);
+    endf = test_socket (AF_SP, NN_REQ);
+    test_connect (endf, socket_address_f);
+    endg = test_socket (AF_SP, NN_REQ);
+    test_connect (endg, socket_address_f);
+
+    /*  Replies are routed back through the shard the request came from. */
+    for (i = 0; i != 10; ++i) {
+        test_send (endf, "ABC");
+        test_recv (endh, "ABC");
+        test_send (endh, "abc");
+        test_recv (endf, "abc");
+        test_send (endg, "DEF");
+        test_recv (endh, "DEF");
+        test_send (endh, "def");
+        test_recv (endg, "def");
+    }
+
+    /*  Clean up. */
+    test_close (endg);
+    test_close (endf);
+    test_close (endh);
+
     /*  Shut down the devices. */
     nn_term ();
     nn_thread_term (&thread1);
     nn_thread_term (&thread2);
     nn_thread_term (&thread3);
+    nn_thread_term (&thread4);
 
     return 0;
 }
@@ -31,6 +31,7 @@ int main ()
     uint32_t k;
     struct nn_hash_item *item;
     struct nn_hash_item *item5000 = NULL;
+    struct nn_hash_item *items;
 
     nn_hash_init (&hash);
 
@@ -55,6 +56,35 @@ int main ()
     }
     nn_hash_term (&hash);
 
+    /*  Erase and re-insert items while the table is growing. */
+    items = nn_alloc (sizeof (struct nn_hash_item) * 20000, "items");
+    nn_assert (items);
+    nn_hash_init (&hash);
+    for (k = 0; k != 20000; ++k) {
+        nn_hash_item_init (&items [k]);
+        nn_hash_insert (&hash, k * 7919, &items [k]);
+        if (k % 3 == 0) {
+            nn_hash_erase (&hash, &items [k / 2]);
+            nn_assert (!nn_hash_item_isinhash (&items [k / 2]));
+            nn_assert (!nn_hash_get (&hash, (k / 2) * 7919));
+            nn_hash_insert (&hash, (k / 2) * 7919, &items [k / 2]);
+        }
+    }
+    for (k = 0; k != 20000; ++k)
+        nn_assert (nn_hash_get (&hash, k * 7919) == &items [k]);
+    nn_assert (!nn_hash_get (&hash, 20000 * 7919));
+    for (k = 0; k != 20000; k += 2)
+        nn_hash_erase (&hash, &items [k]);
+    for (k = 0; k != 20000; ++k)
+        nn_assert (nn_hash_get (&hash, k * 7919) ==
+            (k % 2 ? &items [k] : NULL));
+    for (k = 1; k < 20000; k += 2)
+        nn_hash_erase (&hash, &items [k]);
+    for (k = 0; k != 20000; ++k)
+        nn_hash_item_term (&items [k]);
+    nn_hash_term (&hash);
+    nn_free (items);
+
     return 0;
 }
 
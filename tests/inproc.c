@@ -27,11 +27,27 @@
 #include "../src/inproc.h"
 
 #include "testutil.h"
+#include "../src/utils/thread.c"
 
 /*  Tests inproc transport. */
 
 #define SOCKET_ADDRESS "inproc://test"
 
+#define STREAM_COUNT 10000
+
+static void stream_worker (NN_UNUSED void *arg)
+{
+    int s;
+    int i;
+
+    s = test_socket (AF_SP, NN_PAIR);
+    test_connect (s, SOCKET_ADDRESS);
+    for (i = 0; i != STREAM_COUNT; ++i)
+        test_send (s, "0123456789");
+    test_recv (s, "DONE");
+    test_close (s);
+}
+
 int main ()
 {
     int rc;
@@ -43,6 +59,7 @@ int main ()
     int val;
     struct nn_msghdr hdr;
     struct nn_iovec iovec;
+    struct nn_thread thread;
     unsigned char body [3];
     void *control;
     struct nn_cmsghdr *cmsg;
@@ -217,6 +234,19 @@ int main ()
     test_close (sc);
     test_close (s2);
 
+    /*  Stream messages from another thread through a small queue so that
+        it fills up and drains many times over. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    val = 200;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_RCVBUF, &val, sizeof (val));
+    test_bind (sb, SOCKET_ADDRESS);
+    nn_thread_init (&thread, stream_worker, NULL);
+    for (i = 0; i != STREAM_COUNT; ++i)
+        test_recv (sb, "0123456789");
+    test_send (sb, "DONE");
+    nn_thread_term (&thread);
+    test_close (sb);
+
     return 0;
 }
 
@@ -156,6 +156,45 @@ int main ()
     errno_assert (nn_errno () == EINVAL);
     test_close (sb);
 
+#if !defined(NN_HAVE_WINDOWS)
+    /*  Test passing large messages via shared memory. */
+    sc = test_socket (AF_SP, NN_PAIR);
+    opt = -2;
+    rc = nn_setsockopt (sc, NN_IPC, NN_IPC_SHMEM_THRESHOLD, &opt, opt_sz);
+    nn_assert (rc < 0);
+    errno_assert (nn_errno () == EINVAL);
+    opt = 1000;
+    test_setsockopt (sc, NN_IPC, NN_IPC_SHMEM_THRESHOLD, &opt, opt_sz);
+    rc = nn_getsockopt (sc, NN_IPC, NN_IPC_SHMEM_THRESHOLD, &opt, &opt_sz);
+    errno_assert (rc == 0);
+    nn_assert (opt_sz == sizeof (opt) && opt == 1000);
+    test_connect (sc, SOCKET_ADDRESS);
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, SOCKET_ADDRESS);
+    nn_sleep (100);
+
+    size = 512 * 1024;
+    buf = malloc (size);
+    for (i = 0; i < size; ++i) {
+        buf[i] = 48 + i % 10;
+    }
+    buf[size-1] = '\0';
+    for (i = 0; i != 3; ++i) {
+        test_send (sc, "ABC");
+        test_send (sc, buf);
+    }
+    for (i = 0; i != 3; ++i) {
+        test_recv (sb, "ABC");
+        test_recv (sb, buf);
+    }
+    test_send (sb, buf);
+    test_recv (sc, buf);
+    free (buf);
+
+    test_close (sc);
+    test_close (sb);
+#endif
+
     /*  Test closing a socket that is waiting to connect. */
     sc = test_socket (AF_SP, NN_PAIR);
     test_connect (sc, SOCKET_ADDRESS);
@@ -25,6 +25,8 @@
 #include "../src/pipeline.h"
 #include "testutil.h"
 
+#include <string.h>
+
 #define SOCKET_ADDRESS "inproc://a"
 
 int main ()
@@ -33,6 +35,19 @@ int main ()
     int push2;
     int pull1;
     int pull2;
+    int rc;
+    int policy;
+    size_t sz;
+    struct nn_pipe_load load [2];
+    int burst;
+    int i;
+    char buf [3];
+    struct nn_pipe_recv_stats stats [2];
+    int first;
+    static const char *seq [2][6] = {
+        {"ABC", "DEF", "JKL", "MNO", "GHI", "PQR"},
+        {"JKL", "MNO", "ABC", "DEF", "PQR", "GHI"}
+    };
 
     /*  Test fan-out. */
 
@@ -76,6 +91,100 @@ int main ()
     test_close (push1);
     test_close (push2);
 
+    /*  Test least-loaded fan-out. */
+
+    push1 = test_socket (AF_SP, NN_PUSH);
+    sz = sizeof (policy);
+    rc = nn_getsockopt (push1, NN_PUSH, NN_PUSH_LB_POLICY, &policy, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (policy) && policy == NN_LB_ROUND_ROBIN);
+    policy = NN_LB_LOWEST_LATENCY;
+    rc = nn_setsockopt (push1, NN_PUSH, NN_PUSH_LB_POLICY, &policy,
+        sizeof (policy));
+    nn_assert (rc == -1 && nn_errno () == EINVAL);
+    policy = NN_LB_LEAST_LOADED;
+    test_setsockopt (push1, NN_PUSH, NN_PUSH_LB_POLICY, &policy,
+        sizeof (policy));
+    test_bind (push1, SOCKET_ADDRESS);
+    pull1 = test_socket (AF_SP, NN_PULL);
+    test_connect (pull1, SOCKET_ADDRESS);
+    pull2 = test_socket (AF_SP, NN_PULL);
+    test_connect (pull2, SOCKET_ADDRESS);
+    nn_sleep (10);
+
+    test_send (push1, "ABC");
+    test_send (push1, "DEF");
+    test_send (push1, "GHI");
+    test_send (push1, "JKL");
+
+    sz = sizeof (load);
+    rc = nn_getsockopt (push1, NN_PUSH, NN_PUSH_PIPE_LOAD, load, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (load));
+    nn_assert (load [0].outstanding == 0 && load [1].outstanding == 0);
+    nn_assert (load [0].sent + load [1].sent == 4);
+    sz = sizeof (load [0]);
+    rc = nn_getsockopt (push1, NN_PUSH, NN_PUSH_PIPE_LOAD, load, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (load));
+
+    test_close (push1);
+    test_close (pull1);
+    test_close (pull2);
+
+    /*  Test burst draining in fan-in. */
+
+    pull1 = test_socket (AF_SP, NN_PULL);
+    sz = sizeof (burst);
+    rc = nn_getsockopt (pull1, NN_PULL, NN_PULL_BURST, &burst, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (burst) && burst == 1);
+    burst = 0;
+    rc = nn_setsockopt (pull1, NN_PULL, NN_PULL_BURST, &burst, sizeof (burst));
+    nn_assert (rc == -1 && nn_errno () == EINVAL);
+    burst = 2;
+    test_setsockopt (pull1, NN_PULL, NN_PULL_BURST, &burst, sizeof (burst));
+    test_bind (pull1, SOCKET_ADDRESS);
+    push1 = test_socket (AF_SP, NN_PUSH);
+    test_connect (push1, SOCKET_ADDRESS);
+    push2 = test_socket (AF_SP, NN_PUSH);
+    test_connect (push2, SOCKET_ADDRESS);
+    nn_sleep (10);
+
+    test_send (push1, "ABC");
+    test_send (push1, "DEF");
+    test_send (push1, "GHI");
+    test_send (push2, "JKL");
+    test_send (push2, "MNO");
+    test_send (push2, "PQR");
+    nn_sleep (10);
+
+    /*  Two messages are read from each pipe in turn, then the remaining
+        one from each. Each pipe's messages arrive in order. */
+    for (i = 0; i != 6; ++i) {
+        rc = nn_recv (pull1, buf, sizeof (buf), 0);
+        errno_assert (rc == 3);
+        if (i == 0)
+            first = buf [0] == 'A' ? 0 : 1;
+        nn_assert (memcmp (buf, seq [first][i], 3) == 0);
+    }
+
+    sz = sizeof (stats);
+    rc = nn_getsockopt (pull1, NN_PULL, NN_PULL_PIPE_STATS, stats, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (stats));
+    nn_assert (stats [0].received == 3 && stats [1].received == 3);
+    nn_assert (stats [0].bytes == 9 && stats [1].bytes == 9);
+    nn_assert (stats [0].bursts == 2 && stats [1].bursts == 2);
+    sz = sizeof (stats [0]);
+    rc = nn_getsockopt (pull1, NN_PULL, NN_PULL_PIPE_STATS, stats, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (stats));
+
+    test_close (pull1);
+    test_close (push1);
+    test_close (push2);
+
     return 0;
 }
 
@@ -25,9 +25,13 @@
 
 #include "testutil.h"
 
+#include <string.h>
+#include <stdlib.h>
+
 #define SOCKET_ADDRESS "inproc://a"
+#define LARGE_SIZE 65536
 
-int main ()
+int main (int argc, const char *argv[])
 {
     int rc;
     int pub1;
@@ -35,7 +39,13 @@ int main ()
     int sub1;
     int sub2;
     char buf [8];
+    char topics [20];
+    int val;
+    int i;
+    char *large;
+    char socket_address_tcp [128];
     size_t sz;
+    struct nn_pipe_send_stats stats;
 
     pub1 = test_socket (AF_SP, NN_PUB);
     test_bind (pub1, SOCKET_ADDRESS);
@@ -83,6 +93,323 @@ int main ()
     test_close (pub1);
     test_close (sub1);
 
+    /*  Check bulk subscriptions. */
+
+    pub1 = test_socket (AF_SP, NN_PUB);
+    test_bind (pub1, SOCKET_ADDRESS);
+    sub1 = test_socket (AF_SP, NN_SUB);
+    memcpy (topics, "\0\0\0\3ABC\0\0\0\2DE\0\0\0\3XYZ", 20);
+    rc = nn_setsockopt (sub1, NN_SUB, NN_SUB_SUBSCRIBE_BULK, topics, 19);
+    nn_assert (rc == -1 && nn_errno () == EINVAL);
+    rc = nn_setsockopt (sub1, NN_SUB, NN_SUB_SUBSCRIBE_BULK, topics, 20);
+    errno_assert (rc == 0);
+    test_connect (sub1, SOCKET_ADDRESS);
+    nn_sleep (10);
+
+    test_send (pub1, "ABC1");
+    test_send (pub1, "XY");
+    test_send (pub1, "DEF");
+    test_recv (sub1, "ABC1");
+    test_recv (sub1, "DEF");
+
+    rc = nn_setsockopt (sub1, NN_SUB, NN_SUB_UNSUBSCRIBE_BULK, topics, 13);
+    errno_assert (rc == 0);
+    rc = nn_setsockopt (sub1, NN_SUB, NN_SUB_UNSUBSCRIBE_BULK, topics, 20);
+    errno_assert (rc == 0);
+    rc = nn_setsockopt (sub1, NN_SUB, NN_SUB_UNSUBSCRIBE, "QRS", 3);
+    errno_assert (rc == 0);
+    rc = nn_setsockopt (sub1, NN_SUB, NN_SUB_SUBSCRIBE, "DE", 2);
+    errno_assert (rc == 0);
+
+    test_send (pub1, "ABC2");
+    test_send (pub1, "XYZ");
+    test_send (pub1, "DEF");
+    test_recv (sub1, "DEF");
+
+    test_close (pub1);
+    test_close (sub1);
+
+    /*  Check exact-match topics. */
+
+    pub1 = test_socket (AF_SP, NN_PUB);
+    test_bind (pub1, SOCKET_ADDRESS);
+    sub1 = test_socket (AF_SP, NN_SUB);
+    val = 3;
+    rc = nn_setsockopt (sub1, NN_SUB, NN_SUB_EXACT_TOPIC_LEN, &val,
+        sizeof (val));
+    errno_assert (rc == 0);
+    val = 0;
+    sz = sizeof (val);
+    rc = nn_getsockopt (sub1, NN_SUB, NN_SUB_EXACT_TOPIC_LEN, &val, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (val) && val == 3);
+    rc = nn_setsockopt (sub1, NN_SUB, NN_SUB_SUBSCRIBE, "AB", 2);
+    nn_assert (rc == -1 && nn_errno () == EINVAL);
+    rc = nn_setsockopt (sub1, NN_SUB, NN_SUB_SUBSCRIBE, "ABC", 3);
+    errno_assert (rc == 0);
+    rc = nn_setsockopt (sub1, NN_SUB, NN_SUB_SUBSCRIBE_BULK, topics, 20);
+    nn_assert (rc == -1 && nn_errno () == EINVAL);
+    rc = nn_setsockopt (sub1, NN_SUB, NN_SUB_UNSUBSCRIBE, "XYZ", 3);
+    errno_assert (rc == 0);
+    rc = nn_setsockopt (sub1, NN_SUB, NN_SUB_UNSUBSCRIBE, "XY", 2);
+    nn_assert (rc == -1 && nn_errno () == EINVAL);
+    val = 0;
+    rc = nn_setsockopt (sub1, NN_SUB, NN_SUB_EXACT_TOPIC_LEN, &val,
+        sizeof (val));
+    nn_assert (rc == -1 && nn_errno () == EINVAL);
+    test_connect (sub1, SOCKET_ADDRESS);
+    nn_sleep (10);
+
+    test_send (pub1, "AB");
+    test_send (pub1, "ABD");
+    test_send (pub1, "ABC1");
+    test_recv (sub1, "ABC1");
+
+    test_close (pub1);
+    test_close (sub1);
+
+    /*  Test slow subscriber handling. The subscriber's buffer fits a single
+        message so the next one stays in flight and blocks the pipe. */
+    pub1 = test_socket (AF_SP, NN_PUB);
+    sz = sizeof (val);
+    rc = nn_getsockopt (pub1, NN_PUB, NN_PUB_OVERFLOW, &val, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (val) && val == NN_PUB_DROP_NEWEST);
+    val = -1;
+    rc = nn_setsockopt (pub1, NN_PUB, NN_PUB_QUEUE_LEN, &val, sizeof (val));
+    nn_assert (rc == -1 && nn_errno () == EINVAL);
+    val = 0;
+    rc = nn_setsockopt (pub1, NN_PUB, NN_PUB_OVERFLOW, &val, sizeof (val));
+    nn_assert (rc == -1 && nn_errno () == EINVAL);
+    rc = nn_setsockopt (pub1, NN_PUB, NN_PUB_MAX_DROPS, &val, sizeof (val));
+    nn_assert (rc == -1 && nn_errno () == EINVAL);
+    test_bind (pub1, SOCKET_ADDRESS);
+    sub1 = test_socket (AF_SP, NN_SUB);
+    val = 1;
+    test_setsockopt (sub1, NN_SOL_SOCKET, NN_RCVBUF, &val, sizeof (val));
+    test_setsockopt (sub1, NN_SUB, NN_SUB_SUBSCRIBE, "", 0);
+    test_connect (sub1, SOCKET_ADDRESS);
+    nn_sleep (10);
+
+    /*  Without a queue the messages are dropped while the pipe is busy. */
+    test_send (pub1, "0");
+    nn_sleep (10);
+    test_send (pub1, "1");
+    nn_sleep (10);
+    test_send (pub1, "2");
+    test_send (pub1, "3");
+    nn_assert (nn_get_statistic (pub1, NN_STAT_DROPPED_MESSAGES) == 2);
+    test_recv (sub1, "0");
+    test_recv (sub1, "1");
+
+    /*  Keep the newest messages. */
+    val = 2;
+    test_setsockopt (pub1, NN_PUB, NN_PUB_QUEUE_LEN, &val, sizeof (val));
+    val = NN_PUB_DROP_OLDEST;
+    test_setsockopt (pub1, NN_PUB, NN_PUB_OVERFLOW, &val, sizeof (val));
+    test_send (pub1, "4");
+    nn_sleep (10);
+    test_send (pub1, "5");
+    nn_sleep (10);
+    test_send (pub1, "6");
+    test_send (pub1, "7");
+    test_send (pub1, "8");
+    test_send (pub1, "9");
+    nn_assert (nn_get_statistic (pub1, NN_STAT_DROPPED_MESSAGES) == 4);
+    test_recv (sub1, "4");
+    test_recv (sub1, "5");
+    test_recv (sub1, "8");
+    test_recv (sub1, "9");
+
+    /*  Check the per-subscriber counters. */
+    sz = 0;
+    rc = nn_getsockopt (pub1, NN_PUB, NN_PUB_PIPE_STATS, &stats, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (stats));
+    rc = nn_getsockopt (pub1, NN_PUB, NN_PUB_PIPE_STATS, &stats, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (stats));
+    nn_assert (stats.sent == 6 && stats.dropped == 4 && stats.queued == 0);
+
+    /*  Inproc connections can't be closed, so the subscriber is just cut
+        off once it has lost too many messages. */
+    val = 0;
+    test_setsockopt (pub1, NN_PUB, NN_PUB_QUEUE_LEN, &val, sizeof (val));
+    val = NN_PUB_DISCONNECT;
+    test_setsockopt (pub1, NN_PUB, NN_PUB_OVERFLOW, &val, sizeof (val));
+    val = 2;
+    test_setsockopt (pub1, NN_PUB, NN_PUB_MAX_DROPS, &val, sizeof (val));
+    test_send (pub1, "A");
+    nn_sleep (10);
+    test_send (pub1, "B");
+    nn_sleep (10);
+    test_send (pub1, "C");
+    test_send (pub1, "D");
+    test_recv (sub1, "A");
+    test_recv (sub1, "B");
+    test_send (pub1, "E");
+    val = 100;
+    test_setsockopt (sub1, NN_SOL_SOCKET, NN_RCVTIMEO, &val, sizeof (val));
+    rc = nn_recv (sub1, buf, sizeof (buf), 0);
+    nn_assert (rc < 0 && nn_errno () == ETIMEDOUT);
+
+    test_close (pub1);
+    test_close (sub1);
+
+    /*  TCP connection of a subscriber that doesn't read is dropped once
+        the subscriber loses too many messages. It then reconnects and
+        gets the messages again. */
+    test_addr_from (socket_address_tcp, "tcp", "127.0.0.1",
+        get_test_port (argc, argv));
+    pub1 = test_socket (AF_SP, NN_PUB);
+    val = NN_PUB_DISCONNECT;
+    test_setsockopt (pub1, NN_PUB, NN_PUB_OVERFLOW, &val, sizeof (val));
+    val = 10;
+    test_setsockopt (pub1, NN_PUB, NN_PUB_MAX_DROPS, &val, sizeof (val));
+    test_bind (pub1, socket_address_tcp);
+    sub1 = test_socket (AF_SP, NN_SUB);
+    test_setsockopt (sub1, NN_SUB, NN_SUB_SUBSCRIBE, "", 0);
+    test_connect (sub1, socket_address_tcp);
+    for (i = 0; i != 200; ++i) {
+        if (nn_get_statistic (pub1, NN_STAT_CURRENT_CONNECTIONS) == 1)
+            break;
+        nn_sleep (10);
+    }
+    nn_assert (nn_get_statistic (pub1, NN_STAT_CURRENT_CONNECTIONS) == 1);
+
+    /*  Fill the socket buffers until the subscriber is cut off. */
+    large = malloc (LARGE_SIZE);
+    alloc_assert (large);
+    memset (large, 'x', LARGE_SIZE);
+    for (i = 0; i != 10000; ++i) {
+        rc = nn_send (pub1, large, LARGE_SIZE, 0);
+        errno_assert (rc == LARGE_SIZE);
+        if (nn_get_statistic (pub1, NN_STAT_BROKEN_CONNECTIONS) == 1)
+            break;
+    }
+    free (large);
+    nn_assert (nn_get_statistic (pub1, NN_STAT_BROKEN_CONNECTIONS) == 1);
+    nn_assert (nn_get_statistic (pub1, NN_STAT_DROPPED_MESSAGES) >= 10);
+
+    /*  The subscriber notices the disconnection once it reads the messages
+        it has already got. Then it reconnects. */
+    val = 100;
+    test_setsockopt (sub1, NN_SOL_SOCKET, NN_RCVTIMEO, &val, sizeof (val));
+    do {
+        rc = nn_recv (sub1, buf, sizeof (buf), 0);
+        nn_assert (rc >= 0 || nn_errno () == ETIMEDOUT);
+    } while (rc >= 0);
+    for (i = 0; i != 200; ++i) {
+        if (nn_get_statistic (pub1, NN_STAT_CURRENT_CONNECTIONS) == 1 &&
+              nn_get_statistic (pub1, NN_STAT_ACCEPTED_CONNECTIONS) == 2)
+            break;
+        nn_sleep (10);
+    }
+    nn_assert (nn_get_statistic (pub1, NN_STAT_CURRENT_CONNECTIONS) == 1);
+    nn_assert (nn_get_statistic (pub1, NN_STAT_ACCEPTED_CONNECTIONS) == 2);
+    val = -1;
+    test_setsockopt (sub1, NN_SOL_SOCKET, NN_RCVTIMEO, &val, sizeof (val));
+    nn_sleep (10);
+    test_send (pub1, "F");
+    test_recv (sub1, "F");
+
+    test_close (pub1);
+    test_close (sub1);
+
+    /*  Test conflation of the messages queued for a slow subscriber. */
+    pub1 = test_socket (AF_SP, NN_PUB);
+    val = 1;
+    test_setsockopt (pub1, NN_PUB, NN_PUB_CONFLATE, &val, sizeof (val));
+    val = 10;
+    test_setsockopt (pub1, NN_PUB, NN_PUB_QUEUE_LEN, &val, sizeof (val));
+    test_bind (pub1, SOCKET_ADDRESS);
+    sub1 = test_socket (AF_SP, NN_SUB);
+    val = 1;
+    test_setsockopt (sub1, NN_SOL_SOCKET, NN_RCVBUF, &val, sizeof (val));
+    test_setsockopt (sub1, NN_SUB, NN_SUB_SUBSCRIBE, "", 0);
+    test_connect (sub1, SOCKET_ADDRESS);
+    nn_sleep (10);
+    val = 3;
+    rc = nn_setsockopt (pub1, NN_PUB, NN_PUB_CONFLATE, &val, sizeof (val));
+    nn_assert (rc == -1 && nn_errno () == EINVAL);
+
+    test_send (pub1, "A0");
+    nn_sleep (10);
+    test_send (pub1, "B0");
+    nn_sleep (10);
+    test_send (pub1, "A1");
+    test_send (pub1, "B1");
+    test_send (pub1, "A2");
+    test_send (pub1, "");
+    test_send (pub1, "C1");
+    test_send (pub1, "");
+    test_send (pub1, "C2");
+    test_recv (sub1, "A0");
+    test_recv (sub1, "B0");
+    test_recv (sub1, "A2");
+    test_recv (sub1, "B1");
+    test_recv (sub1, "");
+    test_recv (sub1, "C2");
+    test_recv (sub1, "");
+    nn_assert (nn_get_statistic (pub1, NN_STAT_DROPPED_MESSAGES) == 0);
+
+    test_close (sub1);
+    test_close (pub1);
+
+    /*  With no queue length set, conflation keeps one message per topic. */
+    pub1 = test_socket (AF_SP, NN_PUB);
+    val = 1;
+    test_setsockopt (pub1, NN_PUB, NN_PUB_CONFLATE, &val, sizeof (val));
+    test_bind (pub1, SOCKET_ADDRESS);
+    sub1 = test_socket (AF_SP, NN_SUB);
+    val = 1;
+    test_setsockopt (sub1, NN_SOL_SOCKET, NN_RCVBUF, &val, sizeof (val));
+    test_setsockopt (sub1, NN_SUB, NN_SUB_SUBSCRIBE, "", 0);
+    test_connect (sub1, SOCKET_ADDRESS);
+    nn_sleep (10);
+
+    test_send (pub1, "A0");
+    nn_sleep (10);
+    test_send (pub1, "B0");
+    nn_sleep (10);
+    test_send (pub1, "A1");
+    test_send (pub1, "B1");
+    test_send (pub1, "A2");
+    test_send (pub1, "");
+    test_send (pub1, "C1");
+    test_send (pub1, "C2");
+    test_recv (sub1, "A0");
+    test_recv (sub1, "B0");
+    test_recv (sub1, "A2");
+    test_recv (sub1, "B1");
+    test_recv (sub1, "C2");
+    nn_assert (nn_get_statistic (pub1, NN_STAT_DROPPED_MESSAGES) == 1);
+
+    test_close (sub1);
+    test_close (pub1);
+
+    /*  Test that a new subscriber gets the last value of each topic. */
+    pub1 = test_socket (AF_SP, NN_PUB);
+    val = 1;
+    test_setsockopt (pub1, NN_PUB, NN_PUB_CONFLATE, &val, sizeof (val));
+    val = 1;
+    test_setsockopt (pub1, NN_PUB, NN_PUB_LAST_VALUE, &val, sizeof (val));
+    test_bind (pub1, SOCKET_ADDRESS);
+    test_send (pub1, "A0");
+    test_send (pub1, "B0");
+    test_send (pub1, "A1");
+    sub1 = test_socket (AF_SP, NN_SUB);
+    test_setsockopt (sub1, NN_SUB, NN_SUB_SUBSCRIBE, "", 0);
+    test_connect (sub1, SOCKET_ADDRESS);
+    nn_sleep (10);
+    test_send (pub1, "B1");
+    test_recv (sub1, "A1");
+    test_recv (sub1, "B0");
+    test_recv (sub1, "B1");
+
+    test_close (sub1);
+    test_close (pub1);
+
     return 0;
 }
 
@@ -22,11 +22,33 @@
 
 #include "../src/nn.h"
 #include "../src/reqrep.h"
+#include "../src/pipeline.h"
+
+#include <string.h>
 
 #include "testutil.h"
+#include "../src/utils/attr.h"
+#include "../src/utils/thread.c"
 
 #define SOCKET_ADDRESS "inproc://test"
 
+static int serve_rc;
+static int serve_errno;
+
+static int echo (NN_UNUSED void *arg, const void *req, size_t len, void **rep)
+{
+    *rep = nn_allocmsg (len, 0);
+    alloc_assert (*rep);
+    memcpy (*rep, req, len);
+    return 0;
+}
+
+static void serve (void *arg)
+{
+    serve_rc = nn_rep_serve (*(int*) arg, 3, echo, NULL);
+    serve_errno = nn_errno ();
+}
+
 int main ()
 {
     int rc;
@@ -37,6 +59,25 @@ int main ()
     int resend_ivl;
     char buf [7];
     int timeo;
+    int policy;
+    size_t sz;
+    struct nn_pipe_load load [2];
+    struct nn_pipe_load *busy;
+    struct nn_pipe_load *idle;
+    int fast;
+    int slow;
+    int first;
+    int second;
+    nn_req_handle hndl;
+    struct nn_msghdr hdr;
+    struct nn_iovec iov;
+    void *ctrl [3];
+    char body [3];
+    char backtrace [64];
+    int i;
+    int s;
+    void *ctx [3];
+    struct nn_thread thread;
 
     /*  Test req/rep with full socket types. */
     rep1 = test_socket (AF_SP, NN_REP);
@@ -173,6 +214,412 @@ int main ()
     test_close (req1);
     test_close (rep1);
 
+    /*  Test least-loaded peer selection. One of the peers never replies
+        so it should get no more requests once it has one outstanding. */
+    req1 = test_socket (AF_SP_RAW, NN_REQ);
+    sz = sizeof (policy);
+    rc = nn_getsockopt (req1, NN_REQ, NN_REQ_LB_POLICY, &policy, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (policy) && policy == NN_LB_ROUND_ROBIN);
+    policy = 0;
+    rc = nn_setsockopt (req1, NN_REQ, NN_REQ_LB_POLICY, &policy,
+        sizeof (policy));
+    nn_assert (rc == -1 && nn_errno () == EINVAL);
+    policy = NN_LB_LEAST_LOADED;
+    test_setsockopt (req1, NN_REQ, NN_REQ_LB_POLICY, &policy,
+        sizeof (policy));
+    test_bind (req1, SOCKET_ADDRESS);
+    rep1 = test_socket (AF_SP, NN_REP);
+    test_connect (rep1, SOCKET_ADDRESS);
+    rep2 = test_socket (AF_SP, NN_REP);
+    test_connect (rep2, SOCKET_ADDRESS);
+    nn_sleep (10);
+
+    /*  The peer that gets the first request won't reply to it. */
+    rc = nn_send (req1, "\x80\0\0\1ABC", 7, 0);
+    errno_assert (rc == 7);
+    nn_sleep (10);
+    rc = nn_recv (rep1, buf, sizeof (buf), NN_DONTWAIT);
+    if (rc < 0) {
+        nn_assert (nn_errno () == EAGAIN);
+        test_recv (rep2, "ABC");
+        fast = rep1;
+    }
+    else {
+        errno_assert (rc == 3);
+        fast = rep2;
+    }
+
+    /*  All the subsequent requests go to the other peer. */
+    for (i = 2; i != 5; ++i) {
+        buf [0] = (char) 0x80;
+        buf [1] = buf [2] = 0;
+        buf [3] = (char) i;
+        memcpy (buf + 4, "ABC", 3);
+        rc = nn_send (req1, buf, 7, 0);
+        errno_assert (rc == 7);
+        test_recv (fast, "ABC");
+        test_send (fast, "XYZ");
+        rc = nn_recv (req1, buf, sizeof (buf), 0);
+        errno_assert (rc == 3);
+    }
+
+    sz = sizeof (load);
+    rc = nn_getsockopt (req1, NN_REQ, NN_REQ_PIPE_LOAD, load, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (load));
+    busy = load [0].outstanding > load [1].outstanding ? &load [0] : &load [1];
+    idle = busy == &load [0] ? &load [1] : &load [0];
+    nn_assert (busy->outstanding == 1 && busy->sent == 1);
+    nn_assert (idle->outstanding == 0 && idle->sent == 3);
+    sz = sizeof (load [0]);
+    rc = nn_getsockopt (req1, NN_REQ, NN_REQ_PIPE_LOAD, load, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (load));
+
+    test_close (req1);
+    test_close (rep1);
+    test_close (rep2);
+
+    /*  Test lowest-latency peer selection. */
+    req1 = test_socket (AF_SP, NN_REQ);
+    policy = NN_LB_LOWEST_LATENCY;
+    test_setsockopt (req1, NN_REQ, NN_REQ_LB_POLICY, &policy,
+        sizeof (policy));
+    sz = sizeof (policy);
+    rc = nn_getsockopt (req1, NN_REQ, NN_REQ_EXPLORE, &policy, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (policy) && policy == 5);
+    policy = 101;
+    rc = nn_setsockopt (req1, NN_REQ, NN_REQ_EXPLORE, &policy,
+        sizeof (policy));
+    nn_assert (rc == -1 && nn_errno () == EINVAL);
+    policy = 0;
+    test_setsockopt (req1, NN_REQ, NN_REQ_EXPLORE, &policy, sizeof (policy));
+    test_bind (req1, SOCKET_ADDRESS);
+    rep1 = test_socket (AF_SP, NN_REP);
+    test_connect (rep1, SOCKET_ADDRESS);
+    rep2 = test_socket (AF_SP, NN_REP);
+    test_connect (rep2, SOCKET_ADDRESS);
+    timeo = 1000;
+    test_setsockopt (rep1, NN_SOL_SOCKET, NN_RCVTIMEO, &timeo, sizeof (timeo));
+    test_setsockopt (rep2, NN_SOL_SOCKET, NN_RCVTIMEO, &timeo, sizeof (timeo));
+    nn_sleep (10);
+
+    /*  The peer that gets the first request replies slowly. */
+    test_send (req1, "ABC");
+    nn_sleep (10);
+    rc = nn_recv (rep1, buf, sizeof (buf), NN_DONTWAIT);
+    if (rc < 0) {
+        nn_assert (nn_errno () == EAGAIN);
+        test_recv (rep2, "ABC");
+        slow = rep2;
+        fast = rep1;
+    }
+    else {
+        errno_assert (rc == 3);
+        slow = rep1;
+        fast = rep2;
+    }
+    nn_sleep (30);
+    test_send (slow, "XYZ");
+    test_recv (req1, "XYZ");
+
+    /*  The other peer is tried next and, being faster, gets all the
+        subsequent requests. */
+    for (i = 0; i != 5; ++i) {
+        test_send (req1, "ABC");
+        test_recv (fast, "ABC");
+        test_send (fast, "XYZ");
+        test_recv (req1, "XYZ");
+    }
+
+    sz = sizeof (load);
+    rc = nn_getsockopt (req1, NN_REQ, NN_REQ_PIPE_LOAD, load, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (load));
+    busy = load [0].sent == 1 ? &load [0] : &load [1];
+    idle = busy == &load [0] ? &load [1] : &load [0];
+    nn_assert (busy->sent == 1 && idle->sent == 5);
+    nn_assert (busy->latency >= 30000 && idle->latency < busy->latency);
+
+    /*  When exploring, the slow peer gets its turn. */
+    policy = 100;
+    test_setsockopt (req1, NN_REQ, NN_REQ_EXPLORE, &policy, sizeof (policy));
+    test_send (req1, "ABC");
+    test_recv (slow, "ABC");
+    test_send (slow, "XYZ");
+    test_recv (req1, "XYZ");
+
+    test_close (req1);
+    test_close (rep1);
+    test_close (rep2);
+
+    /*  Test hedged requests. */
+    req1 = test_socket (AF_SP, NN_REQ);
+    sz = sizeof (policy);
+    rc = nn_getsockopt (req1, NN_REQ, NN_REQ_HEDGE_IVL, &policy, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (policy) && policy == 0);
+    policy = -1;
+    rc = nn_setsockopt (req1, NN_REQ, NN_REQ_HEDGE_IVL, &policy,
+        sizeof (policy));
+    nn_assert (rc == -1 && nn_errno () == EINVAL);
+    policy = 101;
+    rc = nn_setsockopt (req1, NN_REQ, NN_REQ_HEDGE_PERCENTILE, &policy,
+        sizeof (policy));
+    nn_assert (rc == -1 && nn_errno () == EINVAL);
+    policy = 20;
+    test_setsockopt (req1, NN_REQ, NN_REQ_HEDGE_IVL, &policy,
+        sizeof (policy));
+    test_bind (req1, SOCKET_ADDRESS);
+    rep1 = test_socket (AF_SP, NN_REP);
+    test_connect (rep1, SOCKET_ADDRESS);
+    rep2 = test_socket (AF_SP, NN_REP);
+    test_connect (rep2, SOCKET_ADDRESS);
+    test_setsockopt (rep1, NN_SOL_SOCKET, NN_RCVTIMEO, &timeo, sizeof (timeo));
+    test_setsockopt (rep2, NN_SOL_SOCKET, NN_RCVTIMEO, &timeo, sizeof (timeo));
+    nn_sleep (10);
+
+    /*  The peer that gets the request doesn't reply in time, so the request
+        goes to the other peer as well. Its reply wins. */
+    test_send (req1, "ABC");
+    nn_sleep (10);
+    rc = nn_recv (rep1, buf, sizeof (buf), NN_DONTWAIT);
+    if (rc < 0) {
+        nn_assert (nn_errno () == EAGAIN);
+        test_recv (rep2, "ABC");
+        first = rep2;
+        second = rep1;
+    }
+    else {
+        errno_assert (rc == 3);
+        first = rep1;
+        second = rep2;
+    }
+    test_recv (second, "ABC");
+    test_send (second, "XYZ");
+    test_recv (req1, "XYZ");
+
+    /*  The late reply is dropped. */
+    test_send (first, "LATE");
+    test_send (req1, "DEF");
+    test_recv (first, "DEF");
+    test_send (first, "UVW");
+    test_recv (req1, "UVW");
+
+    /*  Once there are enough samples, the delay is derived from them. */
+    policy = 0;
+    test_setsockopt (req1, NN_REQ, NN_REQ_HEDGE_IVL, &policy,
+        sizeof (policy));
+    policy = 50;
+    test_setsockopt (req1, NN_REQ, NN_REQ_HEDGE_PERCENTILE, &policy,
+        sizeof (policy));
+    for (i = 0; i != 16; ++i) {
+        test_send (req1, "ABC");
+        while (1) {
+            rc = nn_recv (rep1, buf, sizeof (buf), NN_DONTWAIT);
+            if (rc >= 0) {
+                test_send (rep1, "XYZ");
+                break;
+            }
+            rc = nn_recv (rep2, buf, sizeof (buf), NN_DONTWAIT);
+            if (rc >= 0) {
+                test_send (rep2, "XYZ");
+                break;
+            }
+            nn_assert (nn_errno () == EAGAIN);
+            nn_sleep (1);
+        }
+        test_recv (req1, "XYZ");
+    }
+    test_send (req1, "ABC");
+    nn_sleep (50);
+    test_recv (rep1, "ABC");
+    test_recv (rep2, "ABC");
+
+    test_close (req1);
+    test_close (rep1);
+    test_close (rep2);
+
+    /*  Late and duplicate replies don't count as finished requests. */
+    req1 = test_socket (AF_SP, NN_REQ);
+    test_bind (req1, SOCKET_ADDRESS);
+    rep1 = test_socket (AF_SP_RAW, NN_REP);
+    test_connect (rep1, SOCKET_ADDRESS);
+    nn_sleep (10);
+    test_send (req1, "ABC");
+    iov.iov_base = body;
+    iov.iov_len = sizeof (body);
+    hdr.msg_iov = &iov;
+    hdr.msg_iovlen = 1;
+    hdr.msg_control = backtrace;
+    hdr.msg_controllen = sizeof (backtrace);
+    rc = nn_recvmsg (rep1, &hdr, 0);
+    errno_assert (rc == 3);
+    rc = nn_sendmsg (rep1, &hdr, 0);
+    errno_assert (rc == 3);
+    test_recv (req1, "ABC");
+    test_send (req1, "DEF");
+    rc = nn_sendmsg (rep1, &hdr, 0);
+    errno_assert (rc == 3);
+    nn_sleep (10);
+    sz = sizeof (load);
+    rc = nn_getsockopt (req1, NN_REQ, NN_REQ_PIPE_LOAD, load, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (load [0]));
+    nn_assert (load [0].outstanding == 1);
+    test_close (req1);
+    test_close (rep1);
+
+    /*  Test multiple requests in flight. */
+    req1 = test_socket (AF_SP, NN_REQ);
+    test_bind (req1, SOCKET_ADDRESS);
+    rep1 = test_socket (AF_SP_RAW, NN_REP);
+    test_connect (rep1, SOCKET_ADDRESS);
+    nn_sleep (10);
+
+    rc = nn_req_recv (req1, &hndl, buf, sizeof (buf), NN_DONTWAIT);
+    nn_assert (rc == -1 && nn_errno () == EFSM);
+    for (i = 0; i != 3; ++i) {
+        hndl.i = i;
+        buf [0] = (char) ('A' + i);
+        rc = nn_req_send (req1, hndl, buf, 1, 0);
+        errno_assert (rc == 1);
+    }
+
+    /*  A request sent the usual way doesn't cancel them. */
+    test_send (req1, "XYZ");
+
+    /*  Reply in the reverse order. */
+    for (i = 0; i != 3; ++i) {
+        iov.iov_base = &body [i];
+        iov.iov_len = 1;
+        hdr.msg_iov = &iov;
+        hdr.msg_iovlen = 1;
+        hdr.msg_control = &ctrl [i];
+        hdr.msg_controllen = NN_MSG;
+        rc = nn_recvmsg (rep1, &hdr, 0);
+        errno_assert (rc == 1);
+        nn_assert (body [i] == 'A' + i);
+    }
+    for (i = 2; i >= 0; --i) {
+        iov.iov_base = &body [i];
+        hdr.msg_control = &ctrl [i];
+        rc = nn_sendmsg (rep1, &hdr, 0);
+        errno_assert (rc == 1);
+    }
+    for (i = 2; i >= 0; --i) {
+        rc = nn_req_recv (req1, &hndl, buf, sizeof (buf), 0);
+        errno_assert (rc == 1);
+        nn_assert (hndl.i == i && buf [0] == 'A' + i);
+    }
+    rc = nn_req_recv (req1, &hndl, buf, sizeof (buf), NN_DONTWAIT);
+    nn_assert (rc == -1 && nn_errno () == EAGAIN);
+
+    /*  Each request is re-sent on its own if there's no reply. */
+    policy = 50;
+    test_setsockopt (req1, NN_REQ, NN_REQ_RESEND_IVL, &policy,
+        sizeof (policy));
+    hndl.ptr = &hndl;
+    rc = nn_req_send (req1, hndl, "D", 1, 0);
+    errno_assert (rc == 1);
+    test_recv (rep1, "XYZ");
+    test_recv (rep1, "D");
+    hdr.msg_control = &ctrl [0];
+    rc = nn_recvmsg (rep1, &hdr, 0);
+    errno_assert (rc == 1 && body [0] == 'D');
+    rc = nn_sendmsg (rep1, &hdr, 0);
+    errno_assert (rc == 1);
+    memset (&hndl, 0, sizeof (hndl));
+    rc = nn_req_recv (req1, &hndl, buf, sizeof (buf), 0);
+    errno_assert (rc == 1);
+    nn_assert (hndl.ptr == &hndl && buf [0] == 'D');
+
+    test_close (req1);
+    test_close (rep1);
+
+    /*  Test request contexts on the full REP socket. */
+    rep1 = test_socket (AF_SP, NN_REP);
+    test_bind (rep1, SOCKET_ADDRESS);
+    req1 = test_socket (AF_SP, NN_REQ);
+    test_connect (req1, SOCKET_ADDRESS);
+
+    for (i = 0; i != 3; ++i) {
+        hndl.i = i;
+        buf [0] = (char) ('A' + i);
+        rc = nn_req_send (req1, hndl, buf, 1, 0);
+        errno_assert (rc == 1);
+    }
+    for (i = 0; i != 3; ++i) {
+        rc = nn_rep_recvctx (rep1, &ctx [i], buf, sizeof (buf), 0);
+        errno_assert (rc == 1);
+        nn_assert (buf [0] == 'A' + i);
+    }
+
+    /*  Drop the first request, reply to the others in the reverse order. */
+    nn_rep_freectx (ctx [0]);
+    for (i = 2; i != 0; --i) {
+        buf [0] = (char) ('a' + i);
+        rc = nn_rep_sendctx (rep1, ctx [i], buf, 1, 0);
+        errno_assert (rc == 1);
+    }
+    for (i = 2; i != 0; --i) {
+        rc = nn_req_recv (req1, &hndl, buf, sizeof (buf), 0);
+        errno_assert (rc == 1);
+        nn_assert (hndl.i == i && buf [0] == 'a' + i);
+    }
+
+    /*  The last request received has been replied to. */
+    rc = nn_send (rep1, "ABC", 3, 0);
+    nn_assert (rc == -1 && nn_errno () == EFSM);
+
+    /*  Replying the usual way still works. */
+    test_send (req1, "ABC");
+    test_recv (rep1, "ABC");
+    test_send (rep1, "DEF");
+    test_recv (req1, "DEF");
+
+    /*  A stale SP_HDR property does not make a reply a context reply. */
+    test_send (req1, "GHI");
+    iov.iov_base = body;
+    iov.iov_len = sizeof (body);
+    hdr.msg_control = &ctrl [0];
+    hdr.msg_controllen = NN_MSG;
+    rc = nn_recvmsg (rep1, &hdr, 0);
+    errno_assert (rc == 3);
+    test_send (rep1, "JKL");
+    test_recv (req1, "JKL");
+    rc = nn_sendmsg (rep1, &hdr, 0);
+    nn_assert (rc == -1 && nn_errno () == EFSM);
+
+    /*  Test serving requests on several threads. */
+    rc = nn_rep_serve (rep1, 0, echo, NULL);
+    nn_assert (rc == -1 && nn_errno () == EINVAL);
+
+    /*  Errors other than timeouts stop the workers instead of spinning. */
+    s = test_socket (AF_SP, NN_PUSH);
+    rc = nn_rep_serve (s, 2, echo, NULL);
+    nn_assert (rc == -1 && nn_errno () == ENOTSUP);
+    test_close (s);
+    nn_thread_init (&thread, serve, &rep1);
+    for (i = 0; i != 3; ++i) {
+        hndl.i = i;
+        buf [0] = (char) ('A' + i);
+        rc = nn_req_send (req1, hndl, buf, 1, 0);
+        errno_assert (rc == 1);
+    }
+    for (i = 0; i != 3; ++i) {
+        rc = nn_req_recv (req1, &hndl, buf, sizeof (buf), 0);
+        errno_assert (rc == 1);
+        nn_assert (buf [0] == 'A' + hndl.i);
+    }
+    test_close (rep1);
+    nn_thread_term (&thread);
+    nn_assert (serve_rc == -1 && serve_errno == EBADF);
+
+    test_close (req1);
+
     return 0;
 }
 
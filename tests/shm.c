@@ -0,0 +1,148 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+#include "../src/pipeline.h"
+#include "../src/shm.h"
+
+#include "testutil.h"
+
+/*  Tests shared memory transport. */
+
+#define SOCKET_ADDRESS "shm://test.shm"
+
+int main ()
+{
+    int sb;
+    int sc;
+    int i;
+    int rc;
+    int opt;
+    size_t opt_sz = sizeof (opt);
+    void *dummy_buf;
+    int size;
+    char *buf;
+
+    /*  The transport may not be available on this platform. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    rc = nn_bind (sb, SOCKET_ADDRESS);
+    if (rc < 0) {
+        errno_assert (nn_errno () == EPROTONOSUPPORT);
+        test_close (sb);
+        return 0;
+    }
+    test_close (sb);
+
+    /*  Check the ring size option. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    rc = nn_getsockopt (sb, NN_SHM, NN_SHM_RINGSZ, &opt, &opt_sz);
+    errno_assert (rc == 0);
+    nn_assert (opt_sz == sizeof (opt) && opt == 1024 * 1024);
+    opt = 1000;
+    rc = nn_setsockopt (sb, NN_SHM, NN_SHM_RINGSZ, &opt, sizeof (opt));
+    nn_assert (rc < 0);
+    errno_assert (nn_errno () == EINVAL);
+    opt = 6000;
+    rc = nn_setsockopt (sb, NN_SHM, NN_SHM_RINGSZ, &opt, sizeof (opt));
+    nn_assert (rc < 0);
+    errno_assert (nn_errno () == EINVAL);
+    opt = 4096;
+    test_setsockopt (sb, NN_SHM, NN_SHM_RINGSZ, &opt, sizeof (opt));
+    test_bind (sb, SOCKET_ADDRESS);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, SOCKET_ADDRESS);
+
+    /*  Ping-pong test. */
+    for (i = 0; i != 100; ++i) {
+        test_send (sc, "0123456789012345678901234567890123456789");
+        test_recv (sb, "0123456789012345678901234567890123456789");
+        test_send (sb, "0123456789012345678901234567890123456789");
+        test_recv (sc, "0123456789012345678901234567890123456789");
+    }
+
+    /*  Batch transfer test. */
+    for (i = 0; i != 100; ++i) {
+        test_send (sc, "XYZ");
+    }
+    for (i = 0; i != 100; ++i) {
+        test_recv (sb, "XYZ");
+    }
+
+    /*  Messages larger than the ring are passed in fragments, the writer
+        waiting for the reader to make space in the ring. Messages of zero
+        size are passed as well. */
+    size = 100000;
+    buf = malloc (size);
+    for (i = 0; i < size; ++i) {
+        buf[i] = 48 + i % 10;
+    }
+    buf[size-1] = '\0';
+    for (i = 0; i != 3; ++i) {
+        test_send (sc, buf);
+        test_send (sc, "");
+        test_recv (sb, buf);
+        test_recv (sb, "");
+    }
+    test_send (sb, buf);
+    test_recv (sc, buf);
+    free (buf);
+
+    test_close (sc);
+    test_close (sb);
+
+    /*  Test NN_RCVMAXSIZE limit. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    test_bind (sb, SOCKET_ADDRESS);
+    sc = test_socket (AF_SP, NN_PAIR);
+    test_connect (sc, SOCKET_ADDRESS);
+    opt = 4;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_RCVMAXSIZE, &opt, sizeof (opt));
+    nn_sleep (100);
+    test_send (sc, "ABCD");
+    test_recv (sb, "ABCD");
+    test_send (sc, "ABCDE");
+    nn_sleep (100);
+    rc = nn_recv (sb, &dummy_buf, NN_MSG, NN_DONTWAIT);
+    nn_assert (rc < 0);
+    errno_assert (nn_errno () == EAGAIN);
+    test_close (sc);
+    test_close (sb);
+
+    /*  Test a pipeline with the peer that starts sending before the other
+        side is connected. */
+    sc = test_socket (AF_SP, NN_PUSH);
+    test_connect (sc, SOCKET_ADDRESS);
+    sb = test_socket (AF_SP, NN_PULL);
+    test_bind (sb, SOCKET_ADDRESS);
+    for (i = 0; i != 100; ++i) {
+        test_send (sc, "ABC");
+    }
+    for (i = 0; i != 100; ++i) {
+        test_recv (sb, "ABC");
+    }
+    test_close (sc);
+    test_close (sb);
+
+    return 0;
+}
@@ -28,6 +28,22 @@
 
 #define SOCKET_ADDRESS "inproc://test"
 
+/*  Receives both the usual survey and the one sent by nn_survey_send,
+    whatever the order, and answers each of them. */
+static void answer (int respondent)
+{
+    int rc;
+    int i;
+    char buf [8];
+
+    for (i = 0; i != 2; ++i) {
+        rc = nn_recv (respondent, buf, sizeof (buf), 0);
+        errno_assert (rc == 3 || rc == 5);
+        rc = nn_send (respondent, rc == 5 ? "p" : "c", 1, 0);
+        errno_assert (rc == 1);
+    }
+}
+
 int main ()
 {
     int rc;
@@ -36,6 +52,10 @@ int main ()
     int respondent2;
     int respondent3;
     int deadline;
+    int quorum;
+    int i;
+    int responses [3];
+    nn_survey_handle hndl;
     char buf [7];
 
     /*  Test a simple survey with three respondents. */
@@ -90,6 +110,114 @@ int main ()
     rc = nn_recv (surveyor, buf, sizeof (buf), 0);
     errno_assert (rc == -1 && nn_errno () == EFSM);
 
+    /*  Survey is complete once the quorum is reached. */
+    quorum = 2;
+    test_setsockopt (surveyor, NN_SURVEYOR, NN_SURVEYOR_QUORUM,
+        &quorum, sizeof (quorum));
+    deadline = 10000;
+    test_setsockopt (surveyor, NN_SURVEYOR, NN_SURVEYOR_DEADLINE,
+        &deadline, sizeof (deadline));
+    test_recv (respondent1, "ABC");
+    test_recv (respondent2, "ABC");
+    test_recv (respondent3, "ABC");
+    test_send (surveyor, "GHI");
+    test_recv (respondent1, "GHI");
+    test_send (respondent1, "DEF");
+    test_recv (respondent2, "GHI");
+    test_send (respondent2, "DEF");
+    test_recv (surveyor, "DEF");
+    test_recv (surveyor, "DEF");
+    rc = nn_recv (surveyor, buf, sizeof (buf), 0);
+    errno_assert (rc == -1 && nn_errno () == EFSM);
+    test_recv (respondent3, "GHI");
+
+    /*  Test multiple surveys in progress. */
+    for (i = 1; i != 3; ++i) {
+        hndl.i = i;
+        buf [0] = (char) ('A' + i);
+        rc = nn_survey_send (surveyor, hndl, buf, 1, 0);
+        errno_assert (rc == 1);
+    }
+
+    /*  A survey sent the usual way doesn't cancel them. */
+    test_send (surveyor, "XYZ");
+
+    test_recv (respondent1, "B");
+    test_send (respondent1, "b");
+    test_recv (respondent2, "B");
+    test_recv (respondent2, "C");
+    test_send (respondent2, "c");
+    test_recv (respondent1, "C");
+    test_send (respondent1, "c");
+    test_recv (respondent2, "XYZ");
+    test_send (respondent2, "xyz");
+
+    responses [0] = responses [1] = responses [2] = 0;
+    for (i = 0; i != 4; ++i) {
+        rc = nn_survey_recv (surveyor, &hndl, buf, sizeof (buf), 0);
+        errno_assert (rc >= 1);
+        nn_assert (hndl.i >= 0 && hndl.i < 3);
+        nn_assert (buf [0] == (hndl.i ? 'a' + hndl.i : 'x'));
+        ++responses [hndl.i];
+    }
+    nn_assert (responses [0] == 1 && responses [1] == 1 &&
+        responses [2] == 2);
+
+    /*  The first survey and the usual one haven't reached the quorum yet. */
+    rc = nn_survey_recv (surveyor, &hndl, buf, sizeof (buf), NN_DONTWAIT);
+    errno_assert (rc == -1 && nn_errno () == EAGAIN);
+    test_recv (respondent3, "B");
+    test_send (respondent3, "b");
+    test_recv (respondent3, "C");
+    test_recv (respondent3, "XYZ");
+    test_send (respondent3, "xyz");
+    test_recv (respondent1, "XYZ");
+    rc = nn_survey_recv (surveyor, &hndl, buf, sizeof (buf), 0);
+    errno_assert (rc == 1);
+    nn_assert (hndl.i == 1 && buf [0] == 'b');
+    test_recv (surveyor, "xyz");
+
+    /*  All the surveys are complete long before the deadline. */
+    rc = nn_recv (surveyor, buf, sizeof (buf), 0);
+    errno_assert (rc == -1 && nn_errno () == EFSM);
+
+    /*  Survey sent by nn_survey_send doesn't affect the usual survey that
+        is already in progress. */
+    test_send (surveyor, "PLAIN");
+    hndl.i = 2;
+    rc = nn_survey_send (surveyor, hndl, "CTX", 3, 0);
+    errno_assert (rc == 3);
+    answer (respondent1);
+    answer (respondent2);
+    for (i = 0; i != 2; ++i) {
+        rc = nn_recv (respondent3, buf, sizeof (buf), 0);
+        errno_assert (rc >= 0);
+    }
+    responses [0] = responses [1] = responses [2] = 0;
+    for (i = 0; i != 4; ++i) {
+        rc = nn_survey_recv (surveyor, &hndl, buf, sizeof (buf), 0);
+        errno_assert (rc == 1);
+        nn_assert (hndl.i == 0 || hndl.i == 2);
+        nn_assert (buf [0] == (hndl.i ? 'c' : 'p'));
+        ++responses [hndl.i];
+    }
+    nn_assert (responses [0] == 2 && responses [2] == 2);
+    rc = nn_recv (surveyor, buf, sizeof (buf), 0);
+    errno_assert (rc == -1 && nn_errno () == EFSM);
+
+    /*  Each survey has a deadline of its own. */
+    quorum = 0;
+    test_setsockopt (surveyor, NN_SURVEYOR, NN_SURVEYOR_QUORUM,
+        &quorum, sizeof (quorum));
+    deadline = 50;
+    test_setsockopt (surveyor, NN_SURVEYOR, NN_SURVEYOR_DEADLINE,
+        &deadline, sizeof (deadline));
+    hndl.i = 1;
+    rc = nn_survey_send (surveyor, hndl, "D", 1, 0);
+    errno_assert (rc == 1);
+    rc = nn_survey_recv (surveyor, &hndl, buf, sizeof (buf), 0);
+    errno_assert (rc == -1 && nn_errno () == EFSM);
+
     test_close (surveyor);
     test_close (respondent1);
     test_close (respondent2);
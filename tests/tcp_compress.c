@@ -0,0 +1,185 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+#include "../src/pipeline.h"
+#include "../src/reqrep.h"
+#include "../src/tcp.h"
+
+#include "testutil.h"
+
+#include <string.h>
+
+/*  Tests compression of messages sent over TCP. */
+
+#define LARGE_SIZE 100000
+#define NOISE_SIZE 50000
+
+static char large [LARGE_SIZE];
+static char noise [NOISE_SIZE];
+static char rcvbuf [LARGE_SIZE];
+
+static void test_transfer (int from, int to, const char *data, size_t size)
+{
+    int rc;
+    void *buf;
+
+    rc = nn_send (from, data, size, 0);
+    errno_assert (rc >= 0);
+    nn_assert ((size_t) rc == size);
+    rc = nn_recv (to, &buf, NN_MSG, 0);
+    errno_assert (rc >= 0);
+    nn_assert ((size_t) rc == size);
+    nn_assert (memcmp (buf, data, size) == 0);
+    rc = nn_freemsg (buf);
+    errno_assert (rc == 0);
+}
+
+int main (int argc, const char *argv[])
+{
+    int rc;
+    int sb;
+    int sc;
+    int opt;
+    size_t sz;
+    int i;
+    unsigned int seed;
+    char socket_address [128];
+
+    test_addr_from (socket_address, "tcp", "127.0.0.1",
+            get_test_port (argc, argv));
+
+    for (i = 0; i != LARGE_SIZE; ++i)
+        large [i] = "The quick brown fox jumps over the lazy dog. " [i % 45];
+    seed = 12345;
+    for (i = 0; i != NOISE_SIZE; ++i) {
+        seed = seed * 1103515245 + 12345;
+        noise [i] = (char) (seed >> 24);
+    }
+
+    /*  Check NN_TCP_COMPRESS socket option. */
+    sc = test_socket (AF_SP, NN_PAIR);
+    sz = sizeof (opt);
+    rc = nn_getsockopt (sc, NN_TCP, NN_TCP_COMPRESS, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (opt));
+    nn_assert (opt == 0);
+    opt = -1;
+    rc = nn_setsockopt (sc, NN_TCP, NN_TCP_COMPRESS, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 1024;
+    test_setsockopt (sc, NN_TCP, NN_TCP_COMPRESS, &opt, sizeof (opt));
+    sz = sizeof (opt);
+    rc = nn_getsockopt (sc, NN_TCP, NN_TCP_COMPRESS, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (opt == 1024);
+
+    /*  Compression is used only if both peers ask for it. Here, one side
+        compresses and the other one, with a threshold above any message
+        size, just decompresses. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    opt = LARGE_SIZE + 1;
+    test_setsockopt (sb, NN_TCP, NN_TCP_COMPRESS, &opt, sizeof (opt));
+    test_bind (sb, socket_address);
+    test_connect (sc, socket_address);
+    test_transfer (sc, sb, large, LARGE_SIZE);
+    test_transfer (sc, sb, noise, NOISE_SIZE);
+    test_transfer (sc, sb, large, 1023);
+    test_transfer (sc, sb, large, 1024);
+    test_transfer (sc, sb, "ABC", 3);
+    test_transfer (sb, sc, large, LARGE_SIZE);
+    test_transfer (sc, sb, large, LARGE_SIZE);
+    test_close (sc);
+    test_close (sb);
+
+    /*  Messages with protocol headers. */
+    sb = test_socket (AF_SP, NN_REP);
+    sc = test_socket (AF_SP, NN_REQ);
+    opt = 1;
+    test_setsockopt (sb, NN_TCP, NN_TCP_COMPRESS, &opt, sizeof (opt));
+    test_setsockopt (sc, NN_TCP, NN_TCP_COMPRESS, &opt, sizeof (opt));
+    test_bind (sb, socket_address);
+    test_connect (sc, socket_address);
+    for (i = 0; i != 10; ++i) {
+        test_transfer (sc, sb, large, LARGE_SIZE);
+        test_transfer (sb, sc, large, LARGE_SIZE / 2);
+        test_transfer (sc, sb, "ABC", 3);
+        test_transfer (sb, sc, noise, NOISE_SIZE);
+    }
+    test_close (sc);
+    test_close (sb);
+
+    /*  Size limit applies to the decompressed message. */
+    sb = test_socket (AF_SP, NN_PAIR);
+    sc = test_socket (AF_SP, NN_PAIR);
+    opt = 1;
+    test_setsockopt (sc, NN_TCP, NN_TCP_COMPRESS, &opt, sizeof (opt));
+    test_setsockopt (sb, NN_TCP, NN_TCP_COMPRESS, &opt, sizeof (opt));
+    opt = 1000;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_RCVMAXSIZE, &opt, sizeof (opt));
+    opt = 100;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+    test_bind (sb, socket_address);
+    test_connect (sc, socket_address);
+    test_transfer (sc, sb, large, 1000);
+    rc = nn_send (sc, large, 2000, 0);
+    errno_assert (rc == 2000);
+    test_drop (sb, ETIMEDOUT);
+    test_close (sc);
+    test_close (sb);
+
+    /*  Messages sent while a compressed one is on its way keep their order.
+        The socket can be closed while the compression is in progress. */
+    sb = test_socket (AF_SP, NN_PULL);
+    sc = test_socket (AF_SP, NN_PUSH);
+    opt = 1024;
+    test_setsockopt (sc, NN_TCP, NN_TCP_COMPRESS, &opt, sizeof (opt));
+    test_setsockopt (sb, NN_TCP, NN_TCP_COMPRESS, &opt, sizeof (opt));
+    opt = 1;
+    test_setsockopt (sc, NN_TCP, NN_TCP_BATCH, &opt, sizeof (opt));
+    test_setsockopt (sb, NN_TCP, NN_TCP_BATCH, &opt, sizeof (opt));
+    test_bind (sb, socket_address);
+    test_connect (sc, socket_address);
+    test_transfer (sc, sb, "ABC", 3);
+    for (i = 0; i != 10; ++i) {
+        rc = nn_send (sc, large, LARGE_SIZE - i, 0);
+        errno_assert (rc == LARGE_SIZE - i);
+        rc = nn_send (sc, large, i + 1, 0);
+        errno_assert (rc == i + 1);
+    }
+    for (i = 0; i != 10; ++i) {
+        rc = nn_recv (sb, rcvbuf, LARGE_SIZE, 0);
+        errno_assert (rc == LARGE_SIZE - i);
+        nn_assert (memcmp (rcvbuf, large, rc) == 0);
+        rc = nn_recv (sb, rcvbuf, LARGE_SIZE, 0);
+        errno_assert (rc == i + 1);
+        nn_assert (memcmp (rcvbuf, large, rc) == 0);
+    }
+    rc = nn_send (sc, large, LARGE_SIZE, 0);
+    errno_assert (rc == LARGE_SIZE);
+    test_close (sc);
+    test_close (sb);
+
+    return 0;
+}
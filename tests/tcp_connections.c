@@ -0,0 +1,145 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+#include "../src/pubsub.h"
+#include "../src/pipeline.h"
+#include "../src/tcp.h"
+
+#include "testutil.h"
+
+/*  Tests TCP endpoint opening several parallel connections. */
+
+#define CONNECTION_COUNT 4
+#define MESSAGE_COUNT 100
+
+int main (int argc, const char *argv[])
+{
+    int rc;
+    int sb;
+    int sc;
+    int eid;
+    int opt;
+    size_t sz;
+    int i;
+    char socket_address [128];
+
+    test_addr_from (socket_address, "tcp", "127.0.0.1",
+            get_test_port (argc, argv));
+
+    sc = test_socket (AF_SP, NN_PUSH);
+
+    /*  Check NN_TCP_CONNECTIONS socket option. */
+    sz = sizeof (opt);
+    rc = nn_getsockopt (sc, NN_TCP, NN_TCP_CONNECTIONS, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (opt));
+    nn_assert (opt == 1);
+    opt = 0;
+    rc = nn_setsockopt (sc, NN_TCP, NN_TCP_CONNECTIONS, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 65;
+    rc = nn_setsockopt (sc, NN_TCP, NN_TCP_CONNECTIONS, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = CONNECTION_COUNT;
+    test_setsockopt (sc, NN_TCP, NN_TCP_CONNECTIONS, &opt, sizeof (opt));
+    sz = sizeof (opt);
+    rc = nn_getsockopt (sc, NN_TCP, NN_TCP_CONNECTIONS, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (opt == CONNECTION_COUNT);
+
+    sb = test_socket (AF_SP, NN_PULL);
+    test_bind (sb, socket_address);
+    eid = test_connect (sc, socket_address);
+
+    /*  A single endpoint yields all the connections. */
+    for (i = 0; i != 200; ++i) {
+        if (nn_get_statistic (sb, NN_STAT_CURRENT_CONNECTIONS) ==
+              CONNECTION_COUNT &&
+              nn_get_statistic (sc, NN_STAT_CURRENT_CONNECTIONS) ==
+              CONNECTION_COUNT)
+            break;
+        nn_sleep (10);
+    }
+    nn_assert (nn_get_statistic (sb, NN_STAT_CURRENT_CONNECTIONS) ==
+        CONNECTION_COUNT);
+    nn_assert (nn_get_statistic (sc, NN_STAT_ESTABLISHED_CONNECTIONS) ==
+        CONNECTION_COUNT);
+
+    /*  Messages are spread across the connections and all arrive. */
+    for (i = 0; i != MESSAGE_COUNT; ++i)
+        test_send (sc, "ABC");
+    for (i = 0; i != MESSAGE_COUNT; ++i)
+        test_recv (sb, "ABC");
+
+    /*  Shutting the endpoint down closes all of its connections. */
+    rc = nn_shutdown (sc, eid);
+    errno_assert (rc == 0);
+    for (i = 0; i != 200; ++i) {
+        if (nn_get_statistic (sb, NN_STAT_CURRENT_CONNECTIONS) == 0)
+            break;
+        nn_sleep (10);
+    }
+    nn_assert (nn_get_statistic (sb, NN_STAT_CURRENT_CONNECTIONS) == 0);
+
+    /*  The endpoint can be closed while still connecting. */
+    test_close (sb);
+    test_connect (sc, socket_address);
+    test_close (sc);
+
+    /*  Parallel connections are refused by the sockets that would treat
+        them as separate peers. */
+    sc = test_socket (AF_SP, NN_PAIR);
+    opt = CONNECTION_COUNT;
+    test_setsockopt (sc, NN_TCP, NN_TCP_CONNECTIONS, &opt, sizeof (opt));
+    rc = nn_connect (sc, socket_address);
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    test_close (sc);
+
+    /*  Subscriber thus gets each message exactly once. */
+    sb = test_socket (AF_SP, NN_PUB);
+    test_bind (sb, socket_address);
+    sc = test_socket (AF_SP, NN_SUB);
+    test_setsockopt (sc, NN_SUB, NN_SUB_SUBSCRIBE, "", 0);
+    opt = CONNECTION_COUNT;
+    test_setsockopt (sc, NN_TCP, NN_TCP_CONNECTIONS, &opt, sizeof (opt));
+    rc = nn_connect (sc, socket_address);
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 1;
+    test_setsockopt (sc, NN_TCP, NN_TCP_CONNECTIONS, &opt, sizeof (opt));
+    test_connect (sc, socket_address);
+    nn_sleep (100);
+    for (i = 0; i != MESSAGE_COUNT; ++i)
+        test_send (sb, "ABC");
+    for (i = 0; i != MESSAGE_COUNT; ++i)
+        test_recv (sc, "ABC");
+    nn_sleep (100);
+    rc = nn_recv (sc, &opt, sizeof (opt), NN_DONTWAIT);
+    nn_assert (rc < 0 && nn_errno () == EAGAIN);
+    nn_assert (nn_get_statistic (sb, NN_STAT_CURRENT_CONNECTIONS) == 1);
+    test_close (sc);
+    test_close (sb);
+
+    return 0;
+}
@@ -0,0 +1,116 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+
+#include "../src/nn.h"
+#include "../src/pipeline.h"
+#include "../src/tcp.h"
+
+#include "testutil.h"
+
+#include <stdlib.h>
+
+/*  Tests TCP endpoint spread across several listening sockets. */
+
+#define CLIENT_COUNT 20
+
+int main (int argc, const char *argv[])
+{
+    int rc;
+    int sb;
+    int sb2;
+    int sc [CLIENT_COUNT];
+    int opt;
+    size_t sz;
+    int i;
+    char socket_address [128];
+
+    test_addr_from (socket_address, "tcp", "127.0.0.1",
+            get_test_port (argc, argv));
+
+    /*  Let the listeners run in different worker threads. */
+#if !defined NN_HAVE_WINDOWS
+    setenv ("NN_WORKERS", "4", 1);
+#endif
+
+    sb = test_socket (AF_SP, NN_PULL);
+
+    /*  Check NN_TCP_LISTENERS socket option. */
+    sz = sizeof (opt);
+    rc = nn_getsockopt (sb, NN_TCP, NN_TCP_LISTENERS, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (opt));
+    nn_assert (opt == 1);
+    opt = 0;
+    rc = nn_setsockopt (sb, NN_TCP, NN_TCP_LISTENERS, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 65;
+    rc = nn_setsockopt (sb, NN_TCP, NN_TCP_LISTENERS, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    opt = 4;
+    test_setsockopt (sb, NN_TCP, NN_TCP_LISTENERS, &opt, sizeof (opt));
+    sz = sizeof (opt);
+    rc = nn_getsockopt (sb, NN_TCP, NN_TCP_LISTENERS, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (opt == 4);
+
+    rc = nn_bind (sb, socket_address);
+    if (rc < 0 && nn_errno () == ENOTSUP) {
+        test_close (sb);
+        return 0;
+    }
+    errno_assert (rc >= 0);
+    opt = 2000;
+    test_setsockopt (sb, NN_SOL_SOCKET, NN_RCVTIMEO, &opt, sizeof (opt));
+
+    /*  The address can't be taken over by a socket that doesn't ask for
+        several listeners itself. */
+    sb2 = test_socket (AF_SP, NN_PULL);
+    rc = nn_bind (sb2, socket_address);
+    nn_assert (rc < 0);
+    errno_assert (nn_errno () == EADDRINUSE);
+    test_close (sb2);
+
+    /*  Connections accepted by any of the listeners end up in the same
+        socket. */
+    for (i = 0; i != CLIENT_COUNT; ++i) {
+        sc [i] = test_socket (AF_SP, NN_PUSH);
+        test_connect (sc [i], socket_address);
+    }
+    for (i = 0; i != CLIENT_COUNT; ++i)
+        test_send (sc [i], "ABC");
+    for (i = 0; i != CLIENT_COUNT; ++i)
+        test_recv (sb, "ABC");
+
+    for (i = 0; i != CLIENT_COUNT; ++i)
+        test_close (sc [i]);
+    test_close (sb);
+
+    /*  The endpoint can be bound anew once the listeners are closed. */
+    sb = test_socket (AF_SP, NN_PULL);
+    opt = 4;
+    test_setsockopt (sb, NN_TCP, NN_TCP_LISTENERS, &opt, sizeof (opt));
+    test_bind (sb, socket_address);
+    test_close (sb);
+
+    return 0;
+}
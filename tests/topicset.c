@@ -0,0 +1,93 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/protocols/pubsub/topicset.c"
+#include "../src/utils/alloc.c"
+#include "../src/utils/err.c"
+
+#include <stdio.h>
+
+int main ()
+{
+    int rc;
+    int i;
+    struct nn_topicset set;
+    char buf [16];
+
+    /*  Try matching with an empty set. */
+    nn_topicset_init (&set, 4);
+    rc = nn_topicset_match (&set, (const uint8_t*) "", 0);
+    nn_assert (rc == 0);
+    rc = nn_topicset_match (&set, (const uint8_t*) "ABCD", 4);
+    nn_assert (rc == 0);
+    nn_topicset_term (&set);
+
+    /*  Try some simple matching. */
+    nn_topicset_init (&set, 4);
+    rc = nn_topicset_subscribe (&set, (const uint8_t*) "ABC", 3);
+    nn_assert (rc == -EINVAL);
+    rc = nn_topicset_subscribe (&set, (const uint8_t*) "ABCD", 4);
+    nn_assert (rc == 1);
+    rc = nn_topicset_subscribe (&set, (const uint8_t*) "ABCD", 4);
+    nn_assert (rc == 0);
+    rc = nn_topicset_match (&set, (const uint8_t*) "ABC", 3);
+    nn_assert (rc == 0);
+    rc = nn_topicset_match (&set, (const uint8_t*) "ABCD", 4);
+    nn_assert (rc == 1);
+    rc = nn_topicset_match (&set, (const uint8_t*) "ABCDEF", 6);
+    nn_assert (rc == 1);
+    rc = nn_topicset_match (&set, (const uint8_t*) "ABCEF", 5);
+    nn_assert (rc == 0);
+    rc = nn_topicset_unsubscribe (&set, (const uint8_t*) "ABCD", 4);
+    nn_assert (rc == 0);
+    rc = nn_topicset_match (&set, (const uint8_t*) "ABCD", 4);
+    nn_assert (rc == 1);
+    rc = nn_topicset_unsubscribe (&set, (const uint8_t*) "ABCD", 4);
+    nn_assert (rc == 1);
+    rc = nn_topicset_match (&set, (const uint8_t*) "ABCD", 4);
+    nn_assert (rc == 0);
+    rc = nn_topicset_unsubscribe (&set, (const uint8_t*) "ABCD", 4);
+    nn_assert (rc == -EINVAL);
+    nn_topicset_term (&set);
+
+    /*  Check growing of the set and removal of items from the middle of
+        the probe sequences. */
+    nn_topicset_init (&set, 6);
+    for (i = 0; i != 5000; ++i) {
+        sprintf (buf, "%06d", i);
+        rc = nn_topicset_subscribe (&set, (const uint8_t*) buf, 6);
+        nn_assert (rc == 1);
+    }
+    for (i = 0; i != 5000; i += 2) {
+        sprintf (buf, "%06d", i);
+        rc = nn_topicset_unsubscribe (&set, (const uint8_t*) buf, 6);
+        nn_assert (rc == 1);
+    }
+    for (i = 0; i != 10000; ++i) {
+        sprintf (buf, "%06d", i);
+        rc = nn_topicset_match (&set, (const uint8_t*) buf, 6);
+        nn_assert (rc == (i < 5000 && i % 2 ? 1 : 0));
+    }
+    nn_topicset_term (&set);
+
+    return 0;
+}
@@ -29,7 +29,9 @@
 int main ()
 {
     int rc;
+    int i;
     struct nn_trie trie;
+    char buf [40];
 
     /*  Try matching with an empty trie. */
     nn_trie_init (&trie);
@@ -205,6 +207,111 @@ int main ()
     nn_assert (rc == 1);
     nn_trie_term (&trie);
 
+    /*  Check matching of long data against prefixes, including mismatches
+        at every position of a full-length prefix. */
+    nn_trie_init (&trie);
+    rc = nn_trie_subscribe (&trie, (const uint8_t*) "0123456789ABCDEFGHIJ", 20);
+    nn_assert (rc == 1);
+    rc = nn_trie_match (&trie,
+        (const uint8_t*) "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ", 36);
+    nn_assert (rc == 1);
+    memcpy (buf, "0123456789ABCDEFGHIJKLMNOPQRSTUVWXYZ", 36);
+    for (i = 0; i != 20; ++i) {
+        buf [i] = '#';
+        rc = nn_trie_match (&trie, (const uint8_t*) buf, 36);
+        nn_assert (rc == 0);
+        buf [i] = "0123456789ABCDEFGHIJ" [i];
+    }
+    nn_trie_term (&trie);
+
+    /*  Check lookup of every child in a full sparse node. */
+    nn_trie_init (&trie);
+    rc = nn_trie_subscribe (&trie, (const uint8_t*) "topic.a", 7);
+    nn_assert (rc == 1);
+    rc = nn_trie_subscribe (&trie, (const uint8_t*) "topic.h", 7);
+    nn_assert (rc == 1);
+    rc = nn_trie_subscribe (&trie, (const uint8_t*) "topic.c", 7);
+    nn_assert (rc == 1);
+    rc = nn_trie_subscribe (&trie, (const uint8_t*) "topic.f", 7);
+    nn_assert (rc == 1);
+    rc = nn_trie_subscribe (&trie, (const uint8_t*) "topic.b", 7);
+    nn_assert (rc == 1);
+    rc = nn_trie_subscribe (&trie, (const uint8_t*) "topic.g", 7);
+    nn_assert (rc == 1);
+    rc = nn_trie_subscribe (&trie, (const uint8_t*) "topic.e", 7);
+    nn_assert (rc == 1);
+    rc = nn_trie_subscribe (&trie, (const uint8_t*) "topic.d", 7);
+    nn_assert (rc == 1);
+    rc = nn_trie_match (&trie, (const uint8_t*) "topic.a", 7);
+    nn_assert (rc == 1);
+    rc = nn_trie_match (&trie, (const uint8_t*) "topic.d", 7);
+    nn_assert (rc == 1);
+    rc = nn_trie_match (&trie,
+        (const uint8_t*) "topic.h with a long body attached", 33);
+    nn_assert (rc == 1);
+    rc = nn_trie_match (&trie, (const uint8_t*) "topic.i", 7);
+    nn_assert (rc == 0);
+    rc = nn_trie_match (&trie,
+        (const uint8_t*) "topic.i with a long body attached", 33);
+    nn_assert (rc == 0);
+    rc = nn_trie_unsubscribe (&trie, (const uint8_t*) "topic.h", 7);
+    nn_assert (rc == 1);
+    rc = nn_trie_match (&trie, (const uint8_t*) "topic.h", 7);
+    nn_assert (rc == 0);
+    nn_trie_term (&trie);
+
+    /*  Check that subscriptions survive sparse/dense conversions of their
+        nodes and that unsubscribing a longer string's prefix fails. */
+    nn_trie_init (&trie);
+    rc = nn_trie_subscribe (&trie, (const uint8_t*) "q", 1);
+    nn_assert (rc == 1);
+    rc = nn_trie_subscribe (&trie, (const uint8_t*) "qABCD", 5);
+    nn_assert (rc == 1);
+    for (i = 0; i != 9; ++i) {
+        buf [0] = 'q';
+        buf [1] = (char) ('a' + i);
+        rc = nn_trie_subscribe (&trie, (const uint8_t*) buf, 2);
+        nn_assert (rc == 1);
+    }
+    rc = nn_trie_match (&trie, (const uint8_t*) "q", 1);
+    nn_assert (rc == 1);
+    rc = nn_trie_unsubscribe (&trie, (const uint8_t*) "qa", 2);
+    nn_assert (rc == 1);
+    rc = nn_trie_match (&trie, (const uint8_t*) "q", 1);
+    nn_assert (rc == 1);
+    rc = nn_trie_unsubscribe (&trie, (const uint8_t*) "qA", 2);
+    nn_assert (rc == -EINVAL);
+    rc = nn_trie_match (&trie, (const uint8_t*) "qABCD", 5);
+    nn_assert (rc == 1);
+    nn_trie_term (&trie);
+
+    /*  Check compaction after mass unsubscription. */
+    nn_trie_init (&trie);
+    for (i = 0; i != 10000; ++i) {
+        sprintf (buf, "topic.%d|", i);
+        rc = nn_trie_subscribe (&trie, (const uint8_t*) buf, strlen (buf));
+        nn_assert (rc == 1);
+    }
+    rc = nn_trie_compact (&trie);
+    nn_assert (rc == 0);
+    for (i = 0; i != 10000; ++i) {
+        if (i % 100 == 0)
+            continue;
+        sprintf (buf, "topic.%d|", i);
+        rc = nn_trie_unsubscribe (&trie, (const uint8_t*) buf, strlen (buf));
+        nn_assert (rc == 1);
+    }
+    rc = nn_trie_compact (&trie);
+    nn_assert (rc == 1);
+    rc = nn_trie_compact (&trie);
+    nn_assert (rc == 0);
+    for (i = 0; i != 10000; ++i) {
+        sprintf (buf, "topic.%d|", i);
+        rc = nn_trie_match (&trie, (const uint8_t*) buf, strlen (buf));
+        nn_assert (rc == (i % 100 == 0 ? 1 : 0));
+    }
+    nn_trie_term (&trie);
+
     return 0;
 }
 
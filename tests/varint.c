@@ -0,0 +1,143 @@
+/*
+    Copyright (c) 2016 Jack R. Dunaway. All rights reserved.
+
+    Permission is hereby granted, free of charge, to any person obtaining a copy
+    of this software and associated documentation files (the "Software"),
+    to deal in the Software without restriction, including without limitation
+    the rights to use, copy, modify, merge, publish, distribute, sublicense,
+    and/or sell copies of the Software, and to permit persons to whom
+    the Software is furnished to do so, subject to the following conditions:
+
+    The above copyright notice and this permission notice shall be included
+    in all copies or substantial portions of the Software.
+
+    THE SOFTWARE IS PROVIDED "AS IS", WITHOUT WARRANTY OF ANY KIND, EXPRESS OR
+    IMPLIED, INCLUDING BUT NOT LIMITED TO THE WARRANTIES OF MERCHANTABILITY,
+    FITNESS FOR A PARTICULAR PURPOSE AND NONINFRINGEMENT. IN NO EVENT SHALL
+    THE AUTHORS OR COPYRIGHT HOLDERS BE LIABLE FOR ANY CLAIM, DAMAGES OR OTHER
+    LIABILITY, WHETHER IN AN ACTION OF CONTRACT, TORT OR OTHERWISE, ARISING
+    FROM, OUT OF OR IN CONNECTION WITH THE SOFTWARE OR THE USE OR OTHER DEALINGS
+    IN THE SOFTWARE.
+*/
+
+#include "../src/nn.h"
+#include "../src/pair.h"
+#include "../src/tcp.h"
+#include "../src/ipc.h"
+
+#include "testutil.h"
+
+#include "../src/transports/utils/varint.c"
+
+#include <string.h>
+
+/*  Tests compact size prefixes used by the stream transports. */
+
+#define LARGE_SIZE 20000
+
+static char large [LARGE_SIZE];
+
+static void test_put (uint64_t size, size_t len, uint8_t b0, uint8_t b1)
+{
+    uint8_t buf [2];
+
+    memset (buf, 0xff, sizeof (buf));
+    nn_assert (nn_varint_put (buf, size) == len);
+    if (len == 0)
+        return;
+    nn_assert (buf [0] == b0);
+    if (len == 2)
+        nn_assert (buf [1] == b1);
+    nn_assert (nn_varint_len (buf [0]) == (int) len);
+    nn_assert (nn_varint_get (buf) == size);
+}
+
+static void test_transfer (int from, int to, size_t size)
+{
+    int rc;
+    void *buf;
+
+    rc = nn_send (from, large, size, 0);
+    errno_assert (rc >= 0);
+    nn_assert ((size_t) rc == size);
+    rc = nn_recv (to, &buf, NN_MSG, 0);
+    errno_assert (rc >= 0);
+    nn_assert ((size_t) rc == size);
+    nn_assert (memcmp (buf, large, size) == 0);
+    rc = nn_freemsg (buf);
+    errno_assert (rc == 0);
+}
+
+static void test_stream (char *addr, int level, int option, int bvarint,
+    int cvarint)
+{
+    int rc;
+    int sb;
+    int sc;
+    int opt;
+    size_t sz;
+
+    sb = test_socket (AF_SP, NN_PAIR);
+    sc = test_socket (AF_SP, NN_PAIR);
+
+    /*  Check the option. */
+    sz = sizeof (opt);
+    rc = nn_getsockopt (sc, level, option, &opt, &sz);
+    errno_assert (rc == 0);
+    nn_assert (sz == sizeof (opt));
+    nn_assert (opt == 0);
+    opt = 2;
+    rc = nn_setsockopt (sc, level, option, &opt, sizeof (opt));
+    nn_assert (rc < 0 && nn_errno () == EINVAL);
+    test_setsockopt (sb, level, option, &bvarint, sizeof (bvarint));
+    test_setsockopt (sc, level, option, &cvarint, sizeof (cvarint));
+
+    /*  Messages of all the header forms get through in both directions,
+        whatever the peers agreed on. */
+    test_bind (sb, addr);
+    test_connect (sc, addr);
+    test_transfer (sc, sb, 0);
+    test_transfer (sc, sb, 1);
+    test_transfer (sc, sb, 127);
+    test_transfer (sc, sb, 128);
+    test_transfer (sb, sc, 16383);
+    test_transfer (sb, sc, 16384);
+    test_transfer (sb, sc, LARGE_SIZE);
+    test_transfer (sc, sb, 300);
+
+    test_close (sc);
+    test_close (sb);
+}
+
+int main (int argc, const char *argv[])
+{
+    int i;
+    char socket_address [128];
+
+    /*  Boundaries of the header forms. */
+    test_put (0, 1, 0x00, 0);
+    test_put (0x7f, 1, 0x7f, 0);
+    test_put (0x80, 2, 0x80, 0x80);
+    test_put (300, 2, 0x81, 0x2c);
+    test_put (16383, 2, 0xbf, 0xff);
+    test_put (16384, 0, 0, 0);
+    test_put (((uint64_t) 1) << 62, 0, 0, 0);
+
+    /*  Escape byte announces the regular header. Bytes above it are
+        malformed. */
+    nn_assert (nn_varint_len (NN_VARINT_ESCAPE) == 0);
+    for (i = 0xc1; i != 0x100; ++i)
+        nn_assert (nn_varint_len ((uint8_t) i) == -EINVAL);
+
+    for (i = 0; i != LARGE_SIZE; ++i)
+        large [i] = (char) i;
+
+    test_addr_from (socket_address, "tcp", "127.0.0.1",
+            get_test_port (argc, argv));
+    test_stream (socket_address, NN_TCP, NN_TCP_VARINT, 1, 1);
+    test_stream (socket_address, NN_TCP, NN_TCP_VARINT, 1, 0);
+    test_stream ("ipc://test_varint.ipc", NN_IPC, NN_IPC_VARINT, 1, 1);
+    test_stream ("ipc://test_varint.ipc", NN_IPC, NN_IPC_VARINT, 0, 1);
+
+    return 0;
+}